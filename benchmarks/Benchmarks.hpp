@@ -0,0 +1,23 @@
+#ifndef BENCHMARKS_BENCHMARKS_HPP
+#define BENCHMARKS_BENCHMARKS_HPP
+
+#include "DataGenerators.hpp"
+
+namespace bench {
+
+// One registration function per benchmark file
+void registerDataFrameBenchmarks(const Scale& scale);
+void registerTreeBenchmarks(const Scale& scale);
+void registerLinearModelBenchmarks(const Scale& scale);
+void registerPCABenchmarks(const Scale& scale);
+void registerMetricsBenchmarks(const Scale& scale);
+void registerPrecisionBenchmarks(const Scale& scale);
+void registerNeighborBenchmarks(const Scale& scale);
+void registerClusteringBenchmarks(const Scale& scale);
+
+// Calls register_one(rows, features) for every combination allowed by the scale
+void forEachScale(const Scale& scale, int64_t max_rows, const std::function<void(int64_t, int64_t)>& register_one);
+
+} // namespace bench
+
+#endif // BENCHMARKS_BENCHMARKS_HPP
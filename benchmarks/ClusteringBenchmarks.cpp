@@ -0,0 +1,74 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include "Benchmarks.hpp"
+#include "L/KMeans.hpp"
+
+namespace bench {
+
+namespace {
+
+// Clusters per model
+constexpr int kClusters = 16;
+
+// Iterations per fit, run to the end (tolerance 0) so Lloyd and Elkan do the same work
+constexpr int kIterations = 10;
+
+// Rows per partial_fit batch
+constexpr int64_t kBatchRows = 10000;
+
+const Eigen::MatrixXd& clusteringData(int64_t rows, int64_t features) {
+    return cached<Eigen::MatrixXd>(key("clustering", rows, features), [=]() { return makeFeatures(rows, features); });
+}
+
+void fit(benchmark::State& state, int64_t rows, int64_t features, L::KMeans::Algorithm algorithm) {
+    const auto& X = clusteringData(rows, features);
+
+    for (auto _ : state) {
+        L::KMeans model(kClusters, kIterations, 0.0, 0, algorithm);
+        model.fit(X);
+        benchmark::DoNotOptimize(model.inertia());
+    }
+    state.SetItemsProcessed(state.iterations() * rows * kIterations);
+}
+
+void partialFit(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& X = clusteringData(rows, features);
+
+    for (auto _ : state) {
+        L::KMeans model(kClusters);
+        for (int64_t begin = 0; begin < rows; begin += kBatchRows) {
+            model.partial_fit(X.middleRows(begin, std::min(kBatchRows, rows - begin)));
+        }
+        benchmark::DoNotOptimize(model.inertia());
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+void predict(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& X = clusteringData(rows, features);
+    L::KMeans model(kClusters, 1);
+    model.fit(X);
+
+    for (auto _ : state) {
+        Eigen::VectorXd labels = model.predict(X);
+        benchmark::DoNotOptimize(labels.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+} // namespace
+
+void registerClusteringBenchmarks(const Scale& scale) {
+    forEachScale(scale, scale.rows.empty() ? 0 : scale.rows.back(), [](int64_t rows, int64_t features) {
+        if (rows < kClusters) {
+            return;
+        }
+        const std::string suffix = "/rows:" + std::to_string(rows) + "/features:" + std::to_string(features);
+        benchmark::RegisterBenchmark(("KMeans/fit/lloyd" + suffix).c_str(), fit, rows, features, L::KMeans::Algorithm::Lloyd)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("KMeans/fit/elkan" + suffix).c_str(), fit, rows, features, L::KMeans::Algorithm::Elkan)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("KMeans/partial_fit" + suffix).c_str(), partialFit, rows, features)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("KMeans/predict" + suffix).c_str(), predict, rows, features)->Unit(benchmark::kMillisecond);
+    });
+}
+
+} // namespace bench
@@ -0,0 +1,126 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include "Benchmarks.hpp"
+#include "L/CompressedDataFrame.hpp"
+#include "L/DataFrame.hpp"
+
+namespace bench {
+
+namespace {
+
+void readCSV(benchmark::State& state, int64_t rows, int64_t features) {
+    const std::string filename = "ml_cpp_benchmark_" + std::to_string(rows) + "_" + std::to_string(features) + ".csv";
+    writeCSV(filename, rows, features);
+
+    for (auto _ : state) {
+        L::DataFrame df;
+        benchmark::DoNotOptimize(df.readCSV(filename));
+    }
+
+    std::FILE* file = std::fopen(filename.c_str(), "rb");
+    std::fseek(file, 0, SEEK_END);
+    state.SetBytesProcessed(state.iterations() * std::ftell(file));
+    std::fclose(file);
+    std::remove(filename.c_str());
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+void toMatrix(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& df = cached<L::DataFrame>(key("numeric_frame", rows, features), [=]() { return makeNumericFrame(rows, features); });
+
+    for (auto _ : state) {
+        Eigen::MatrixXd X = df.toMatrix();
+        benchmark::DoNotOptimize(X.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rows * features);
+}
+
+void statistics(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& df = cached<L::DataFrame>(key("numeric_frame", rows, features), [=]() { return makeNumericFrame(rows, features); });
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        L::DataFrame fresh(df);   // The shared frame never computes its statistics, so the copy has none cached
+        state.ResumeTiming();
+        auto statistics = fresh.statistics();
+        benchmark::DoNotOptimize(statistics.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rows * features);
+}
+
+const L::DataFrame& integerFrame(int64_t rows, int64_t features) {
+    return cached<L::DataFrame>(key("integer_frame", rows, features), [=]() { return makeIntegerFrame(rows, features); });
+}
+
+void toMatrixInteger(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& df = integerFrame(rows, features);
+
+    for (auto _ : state) {
+        Eigen::MatrixXd X = df.toMatrix();
+        benchmark::DoNotOptimize(X.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rows * features);
+}
+
+void compress(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& df = integerFrame(rows, features);
+
+    size_t bytes = 0;
+    for (auto _ : state) {
+        L::CompressedDataFrame compressed(df);
+        bytes = compressed.memoryUsage();
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.SetItemsProcessed(state.iterations() * rows * features);
+    state.counters["bytes_per_cell"] = static_cast<double>(bytes) / (rows * features);
+}
+
+void toMatrixCompressed(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& compressed = cached<L::CompressedDataFrame>(key("compressed_integer_frame", rows, features), [=]() {
+        return L::CompressedDataFrame(integerFrame(rows, features));
+    });
+
+    for (auto _ : state) {
+        Eigen::MatrixXd X = compressed.toMatrix();
+        benchmark::DoNotOptimize(X.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rows * features);
+}
+
+void oneHotEncode(benchmark::State& state, int64_t rows, int64_t cardinality) {
+    const auto& df = cached<L::DataFrame>(key("categorical_frame", rows, cardinality), [=]() {
+        return makeCategoricalFrame(rows, cardinality);
+    });
+
+    for (auto _ : state) {
+        L::DataFrame encoded = df.oneHotEncode({"category"});
+        benchmark::DoNotOptimize(encoded.getRowCount());
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+} // namespace
+
+void registerDataFrameBenchmarks(const Scale& scale) {
+    forEachScale(scale, scale.rows.empty() ? 0 : scale.rows.back(), [](int64_t rows, int64_t features) {
+        benchmark::RegisterBenchmark(("DataFrame/readCSV/rows:" + std::to_string(rows) + "/features:" + std::to_string(features)).c_str(),
+                                     readCSV, rows, features)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("DataFrame/toMatrix/rows:" + std::to_string(rows) + "/features:" + std::to_string(features)).c_str(),
+                                     toMatrix, rows, features)->Unit(benchmark::kMillisecond);
+        const std::string suffix = "/rows:" + std::to_string(rows) + "/features:" + std::to_string(features);
+        benchmark::RegisterBenchmark(("DataFrame/statistics" + suffix).c_str(), statistics, rows, features)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("DataFrame/toMatrix_integer" + suffix).c_str(), toMatrixInteger, rows, features)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("CompressedDataFrame/compress" + suffix).c_str(), compress, rows, features)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("CompressedDataFrame/toMatrix" + suffix).c_str(), toMatrixCompressed, rows, features)->Unit(benchmark::kMillisecond);
+    });
+    for (int64_t rows : scale.rows) {
+        for (int64_t cardinality : {10, 1000}) {
+            if (cardinality < rows && rows * 2 <= scale.max_cells) {
+                benchmark::RegisterBenchmark(("DataFrame/oneHotEncode/rows:" + std::to_string(rows) + "/cardinality:" + std::to_string(cardinality)).c_str(),
+                                             oneHotEncode, rows, cardinality)->Unit(benchmark::kMillisecond);
+            }
+        }
+    }
+}
+
+} // namespace bench
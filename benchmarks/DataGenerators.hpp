@@ -0,0 +1,141 @@
+#ifndef BENCHMARKS_DATAGENERATORS_HPP
+#define BENCHMARKS_DATAGENERATORS_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "L/DataFrame.hpp"
+
+// Deterministic synthetic datasets for the benchmarks
+namespace bench {
+
+// Scales swept by the benchmarks, filtered by the command line limits
+struct Scale {
+    std::vector<int64_t> rows;
+    std::vector<int64_t> features;
+    int64_t max_cells;       // Largest rows x features combination
+    int64_t max_tree_rows;   // Row limit for the tree learners
+};
+
+// Standard normal features
+inline Eigen::MatrixXd makeFeatures(int64_t rows, int64_t features, unsigned int seed = 42) {
+    std::mt19937 generator(seed);
+    std::normal_distribution<double> gaussian(0.0, 1.0);
+    return Eigen::MatrixXd::NullaryExpr(rows, features, [&]() { return gaussian(generator); });
+}
+
+// y = X w + b + noise
+inline Eigen::VectorXd makeRegressionTarget(const Eigen::MatrixXd& X, unsigned int seed = 7) {
+    std::mt19937 generator(seed);
+    std::normal_distribution<double> gaussian(0.0, 1.0);
+    Eigen::VectorXd weights = Eigen::VectorXd::NullaryExpr(X.cols(), [&]() { return gaussian(generator); });
+    Eigen::VectorXd noise = Eigen::VectorXd::NullaryExpr(X.rows(), [&]() { return 0.1 * gaussian(generator); });
+    return (X * weights + noise).array() + 1.0;
+}
+
+// Labels in 0..classes-1 from the arg max of random linear scores
+inline Eigen::VectorXd makeClassLabels(const Eigen::MatrixXd& X, int classes = 2, unsigned int seed = 11) {
+    std::mt19937 generator(seed);
+    std::normal_distribution<double> gaussian(0.0, 1.0);
+    Eigen::MatrixXd weights = Eigen::MatrixXd::NullaryExpr(X.cols(), classes, [&]() { return gaussian(generator); });
+    Eigen::VectorXd labels(X.rows());
+    for (Eigen::Index i = 0; i < X.rows(); ++i) {
+        Eigen::Index best;
+        (X.row(i) * weights).maxCoeff(&best);
+        labels(i) = static_cast<double>(best);
+    }
+    return labels;
+}
+
+// Numeric DataFrame with columns f0..f{features-1}
+inline L::DataFrame makeNumericFrame(int64_t rows, int64_t features, unsigned int seed = 42) {
+    std::vector<std::string> names;
+    for (int64_t j = 0; j < features; ++j) {
+        names.push_back("f" + std::to_string(j));
+    }
+    return L::DataFrame(makeFeatures(rows, features, seed), names);
+}
+
+// Low-cardinality integer DataFrame with columns f0..f{features-1}, cycling through flags (0/1),
+// ages (18..89) and counts (0..999), like a typical feature table
+inline L::DataFrame makeIntegerFrame(int64_t rows, int64_t features, unsigned int seed = 42) {
+    std::mt19937 generator(seed);
+    const int64_t ranges[] = {2, 72, 1000};
+    const int64_t offsets[] = {0, 18, 0};
+    Eigen::MatrixXd matrix(rows, features);
+    std::vector<std::string> names;
+    for (int64_t j = 0; j < features; ++j) {
+        std::uniform_int_distribution<int64_t> value(0, ranges[j % 3] - 1);
+        for (int64_t i = 0; i < rows; ++i) {
+            matrix(i, j) = static_cast<double>(offsets[j % 3] + value(generator));
+        }
+        names.push_back("f" + std::to_string(j));
+    }
+    return L::DataFrame(matrix, names);
+}
+
+// CSV with an integer id, numeric features f0..f{features-1} and a string column, like the persons dataset
+inline void writeCSV(const std::string& filename, int64_t rows, int64_t features, unsigned int seed = 42) {
+    std::mt19937 generator(seed);
+    std::normal_distribution<double> gaussian(0.0, 1.0);
+    std::ofstream file(filename);
+    file << "Id";
+    for (int64_t j = 0; j < features; ++j) {
+        file << ",f" << j;
+    }
+    file << ",Name\n";
+    for (int64_t i = 0; i < rows; ++i) {
+        file << i;
+        for (int64_t j = 0; j < features; ++j) {
+            file << "," << gaussian(generator);
+        }
+        file << ",name" << (i % 97) << "\n";
+    }
+}
+
+// DataFrame with an integer "category" column of the given cardinality and a numeric "value" column.
+// Built through a CSV round trip so that the categories are parsed as ints, as oneHotEncode expects.
+inline L::DataFrame makeCategoricalFrame(int64_t rows, int64_t cardinality, unsigned int seed = 42) {
+    const std::string filename = "ml_cpp_benchmark_categorical.csv";
+    {
+        std::mt19937 generator(seed);
+        std::uniform_int_distribution<int64_t> category(0, cardinality - 1);
+        std::normal_distribution<double> gaussian(0.0, 1.0);
+        std::ofstream file(filename);
+        file << "category,value\n";
+        for (int64_t i = 0; i < rows; ++i) {
+            file << category(generator) << "," << gaussian(generator) << "\n";
+        }
+    }
+    L::DataFrame df;
+    df.readCSV(filename);
+    std::remove(filename.c_str());
+    return df;
+}
+
+// Single cached dataset per type, so Google Benchmark's repeated calls do not regenerate it
+template <typename T>
+const T& cached(const std::string& key, const std::function<T()>& make) {
+    static std::string cached_key;
+    static std::unique_ptr<T> value;
+    if (!value || cached_key != key) {
+        value.reset();
+        value = std::make_unique<T>(make());
+        cached_key = key;
+    }
+    return *value;
+}
+
+inline std::string key(const std::string& name, int64_t rows, int64_t features) {
+    return name + "/" + std::to_string(rows) + "/" + std::to_string(features);
+}
+
+} // namespace bench
+
+#endif // BENCHMARKS_DATAGENERATORS_HPP
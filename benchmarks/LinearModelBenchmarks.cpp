@@ -0,0 +1,124 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include "Benchmarks.hpp"
+#include "L/AsyncChunkLoader.hpp"
+#include "L/CSVChunkReader.hpp"
+#include "L/LinearRegression.hpp"
+#include "L/LogisticRegression.hpp"
+#include "L/SoftmaxRegression.hpp"
+
+namespace bench {
+
+namespace {
+
+// Gradient descent iterations per fit; throughput is reported per row and iteration
+constexpr int kIterations = 10;
+
+struct LabelledData {
+    Eigen::MatrixXd X;
+    Eigen::VectorXd y;
+};
+
+const LabelledData& regressionData(int64_t rows, int64_t features) {
+    return cached<LabelledData>(key("regression", rows, features), [=]() {
+        LabelledData data{makeFeatures(rows, features), Eigen::VectorXd()};
+        data.y = makeRegressionTarget(data.X);
+        return data;
+    });
+}
+
+const LabelledData& classificationData(int64_t rows, int64_t features, int classes) {
+    return cached<LabelledData>(key("classification" + std::to_string(classes), rows, features), [=]() {
+        LabelledData data{makeFeatures(rows, features), Eigen::VectorXd()};
+        data.y = makeClassLabels(data.X, classes);
+        return data;
+    });
+}
+
+void linearFit(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = regressionData(rows, features);
+
+    for (auto _ : state) {
+        L::LinearRegression model;
+        model.fit(data.X, data.y);
+        benchmark::DoNotOptimize(model.getIntercept());
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+    state.SetBytesProcessed(state.iterations() * rows * features * sizeof(double));
+}
+
+// One streaming pass over a CSV (target Id), reading each chunk either in turn with training or ahead of it;
+// wall time, since the prefetching thread does the parsing
+void linearFitStream(benchmark::State& state, int64_t rows, int64_t features, bool prefetch) {
+    const std::string filename = "ml_cpp_benchmark_stream_" + std::to_string(rows) + "_" + std::to_string(features) + ".csv";
+    writeCSV(filename, rows, features);
+    std::vector<std::string> columns;
+    for (int64_t j = 0; j < features; ++j) {
+        columns.push_back("f" + std::to_string(j));
+    }
+
+    for (auto _ : state) {
+        L::LinearRegression model;
+        if (prefetch) {
+            L::AsyncChunkLoader loader(filename, columns, "Id", 16384);
+            model.fit([&](Eigen::MatrixXd& X, Eigen::VectorXd& y) { return loader.next(X, y); });
+        } else {
+            L::CSVChunkReader reader(filename, columns, "Id", 16384);
+            model.fit([&](Eigen::MatrixXd& X, Eigen::VectorXd& y) { return reader.next(X, y); });
+        }
+        benchmark::DoNotOptimize(model.getIntercept());
+    }
+    std::remove(filename.c_str());
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+void logisticFit(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = classificationData(rows, features, 2);
+
+    for (auto _ : state) {
+        L::LogisticRegression model;
+        model.fit(data.X, data.y, 0.1, kIterations);
+        benchmark::DoNotOptimize(model.intercept());
+    }
+    state.SetItemsProcessed(state.iterations() * rows * kIterations);
+}
+
+void logisticPredictProba(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = classificationData(rows, features, 2);
+    L::LogisticRegression model;
+    model.fit(data.X, data.y, 0.1, 1);
+
+    for (auto _ : state) {
+        Eigen::VectorXd probabilities = model.predict_proba(data.X);
+        benchmark::DoNotOptimize(probabilities.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+    state.SetBytesProcessed(state.iterations() * rows * features * sizeof(double));
+}
+
+void softmaxFit(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = classificationData(rows, features, 10);
+
+    for (auto _ : state) {
+        L::SoftmaxRegression model;
+        model.fit(data.X, data.y, 0.1, kIterations);
+        benchmark::DoNotOptimize(model.intercept().data());
+    }
+    state.SetItemsProcessed(state.iterations() * rows * kIterations);
+}
+
+} // namespace
+
+void registerLinearModelBenchmarks(const Scale& scale) {
+    forEachScale(scale, scale.rows.empty() ? 0 : scale.rows.back(), [](int64_t rows, int64_t features) {
+        const std::string suffix = "/rows:" + std::to_string(rows) + "/features:" + std::to_string(features);
+        benchmark::RegisterBenchmark(("LinearRegression/fit" + suffix).c_str(), linearFit, rows, features)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("LinearRegression/fit_stream/sync" + suffix).c_str(), linearFitStream, rows, features, false)->Unit(benchmark::kMillisecond)->UseRealTime();
+        benchmark::RegisterBenchmark(("LinearRegression/fit_stream/prefetch" + suffix).c_str(), linearFitStream, rows, features, true)->Unit(benchmark::kMillisecond)->UseRealTime();
+        benchmark::RegisterBenchmark(("LogisticRegression/fit" + suffix).c_str(), logisticFit, rows, features)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("LogisticRegression/predict_proba" + suffix).c_str(), logisticPredictProba, rows, features)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("SoftmaxRegression/fit" + suffix).c_str(), softmaxFit, rows, features)->Unit(benchmark::kMillisecond);
+    });
+}
+
+} // namespace bench
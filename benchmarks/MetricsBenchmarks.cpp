@@ -0,0 +1,67 @@
+#include <benchmark/benchmark.h>
+#include "Benchmarks.hpp"
+#include "L/ClassificationMetrics.hpp"
+#include "L/RegressionMetrics.hpp"
+
+namespace bench {
+
+namespace {
+
+struct Predictions {
+    Eigen::VectorXd predicted;
+    Eigen::VectorXd actual;
+};
+
+const Predictions& classPredictions(int64_t rows, int classes) {
+    return cached<Predictions>(key("class_predictions", rows, classes), [=]() {
+        Eigen::MatrixXd X = makeFeatures(rows, 4);
+        return Predictions{makeClassLabels(X, classes, 1), makeClassLabels(X, classes, 2)};
+    });
+}
+
+void classification(benchmark::State& state, int64_t rows, int classes) {
+    const auto& data = classPredictions(rows, classes);
+    std::vector<int> labels(classes);
+    for (int k = 0; k < classes; ++k) {
+        labels[k] = k;
+    }
+
+    for (auto _ : state) {
+        L::ClassificationMetrics metrics(data.predicted, data.actual, labels);
+        benchmark::DoNotOptimize(metrics.accuracy());
+        benchmark::DoNotOptimize(metrics.f1_score(0));
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+void regression(benchmark::State& state, int64_t rows) {
+    const auto& data = cached<Predictions>(key("regression_predictions", rows, 1), [=]() {
+        Eigen::MatrixXd noise = makeFeatures(rows, 2);
+        return Predictions{noise.col(0), noise.col(0) + 0.1 * noise.col(1)};
+    });
+
+    for (auto _ : state) {
+        L::RegressionMetrics metrics(data.predicted, data.actual);
+        benchmark::DoNotOptimize(metrics.r2Score());
+        benchmark::DoNotOptimize(metrics.meanAbsoluteError());
+        benchmark::DoNotOptimize(metrics.rootMeanSquaredError());
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+} // namespace
+
+void registerMetricsBenchmarks(const Scale& scale) {
+    for (int64_t rows : scale.rows) {
+        if (rows > scale.max_cells) {
+            continue;
+        }
+        for (int classes : {2, 50}) {
+            benchmark::RegisterBenchmark(("ClassificationMetrics/rows:" + std::to_string(rows) + "/classes:" + std::to_string(classes)).c_str(),
+                                         classification, rows, classes)->Unit(benchmark::kMillisecond);
+        }
+        benchmark::RegisterBenchmark(("RegressionMetrics/rows:" + std::to_string(rows)).c_str(), regression, rows)->Unit(benchmark::kMillisecond);
+    }
+}
+
+} // namespace bench
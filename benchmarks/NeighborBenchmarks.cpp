@@ -0,0 +1,79 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include "Benchmarks.hpp"
+#include "L/KNeighborsClassifier.hpp"
+#include "U/NeighborIndex.hpp"
+
+namespace bench {
+
+namespace {
+
+// Query rows per predict call
+constexpr int64_t kQueries = 1000;
+
+// Neighbours per query
+constexpr int kNeighbors = 5;
+
+struct NeighborData {
+    Eigen::MatrixXd X;
+    Eigen::VectorXd y;
+    Eigen::MatrixXd queries;
+};
+
+const NeighborData& neighborData(int64_t rows, int64_t features) {
+    return cached<NeighborData>(key("neighbors", rows, features), [=]() {
+        NeighborData data{makeFeatures(rows, features), Eigen::VectorXd(), Eigen::MatrixXd()};
+        data.y = makeClassLabels(data.X, 2);
+        data.queries = data.X.topRows(std::min<int64_t>(rows, kQueries));
+        return data;
+    });
+}
+
+void buildIndex(benchmark::State& state, int64_t rows, int64_t features, U::NeighborIndex::Kind kind) {
+    const auto& data = neighborData(rows, features);
+
+    for (auto _ : state) {
+        U::NeighborIndex index(data.X, kind);
+        benchmark::DoNotOptimize(index.nodeCount());
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+void query(benchmark::State& state, int64_t rows, int64_t features, U::NeighborIndex::Kind kind) {
+    const auto& data = neighborData(rows, features);
+    const U::NeighborIndex index(data.X, kind);
+
+    for (auto _ : state) {
+        U::Neighbors neighbors = index.query(data.queries, kNeighbors);
+        benchmark::DoNotOptimize(neighbors.indices.data());
+    }
+    state.SetItemsProcessed(state.iterations() * data.queries.rows());
+}
+
+void predict(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = neighborData(rows, features);
+    L::KNeighborsClassifier model(kNeighbors);
+    model.fit(data.X, data.y);
+
+    for (auto _ : state) {
+        Eigen::VectorXd predictions = model.predict(data.queries);
+        benchmark::DoNotOptimize(predictions.data());
+    }
+    state.SetItemsProcessed(state.iterations() * data.queries.rows());
+}
+
+} // namespace
+
+void registerNeighborBenchmarks(const Scale& scale) {
+    forEachScale(scale, scale.rows.empty() ? 0 : scale.rows.back(), [](int64_t rows, int64_t features) {
+        const std::string suffix = "/rows:" + std::to_string(rows) + "/features:" + std::to_string(features);
+        for (auto [name, kind] : {std::make_pair("KDTree", U::NeighborIndex::Kind::KDTree),
+                                  std::make_pair("BallTree", U::NeighborIndex::Kind::BallTree)}) {
+            benchmark::RegisterBenchmark(("NeighborIndex/" + std::string(name) + "/build" + suffix).c_str(), buildIndex, rows, features, kind)->Unit(benchmark::kMillisecond);
+            benchmark::RegisterBenchmark(("NeighborIndex/" + std::string(name) + "/query" + suffix).c_str(), query, rows, features, kind)->Unit(benchmark::kMillisecond);
+        }
+        benchmark::RegisterBenchmark(("KNeighborsClassifier/predict" + suffix).c_str(), predict, rows, features)->Unit(benchmark::kMillisecond);
+    });
+}
+
+} // namespace bench
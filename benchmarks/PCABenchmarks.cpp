@@ -0,0 +1,68 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include "Benchmarks.hpp"
+#include "L/IncrementalPrincipalComponentAnalysis.hpp"
+#include "L/PrincipalComponentAnalysis.hpp"
+
+namespace bench {
+
+namespace {
+
+// Components kept by the truncated solvers
+constexpr int kComponents = 10;
+
+const Eigen::MatrixXd& features(int64_t rows, int64_t n_features) {
+    return cached<Eigen::MatrixXd>(key("pca", rows, n_features), [=]() { return makeFeatures(rows, n_features); });
+}
+
+void fit(benchmark::State& state, int64_t rows, int64_t n_features, L::PrincipalComponentAnalysis::Solver solver) {
+    const auto& X = features(rows, n_features);
+    const int components = static_cast<int>(std::min<int64_t>(kComponents, n_features));
+
+    for (auto _ : state) {
+        L::PrincipalComponentAnalysis pca(components, solver);
+        pca.fit(X);
+        benchmark::DoNotOptimize(pca.eigen_values().data());
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+void transform(benchmark::State& state, int64_t rows, int64_t n_features) {
+    const auto& X = features(rows, n_features);
+    L::PrincipalComponentAnalysis pca(static_cast<int>(std::min<int64_t>(kComponents, n_features)));
+    pca.fit(X);
+
+    for (auto _ : state) {
+        Eigen::MatrixXd projected = pca.transform(X);
+        benchmark::DoNotOptimize(projected.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+void incrementalPartialFit(benchmark::State& state, int64_t rows, int64_t n_features) {
+    const auto& X = features(rows, n_features);
+    const int components = static_cast<int>(std::min<int64_t>(kComponents, n_features));
+
+    for (auto _ : state) {
+        L::IncrementalPrincipalComponentAnalysis pca(components);
+        pca.partial_fit(X);
+        benchmark::DoNotOptimize(pca.eigen_values().data());
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+} // namespace
+
+void registerPCABenchmarks(const Scale& scale) {
+    using Solver = L::PrincipalComponentAnalysis::Solver;
+    forEachScale(scale, scale.rows.empty() ? 0 : scale.rows.back(), [](int64_t rows, int64_t n_features) {
+        const std::string suffix = "/rows:" + std::to_string(rows) + "/features:" + std::to_string(n_features);
+        benchmark::RegisterBenchmark(("PrincipalComponentAnalysis/fit/solver:auto" + suffix).c_str(), fit, rows, n_features, Solver::Auto)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("PrincipalComponentAnalysis/fit/solver:full" + suffix).c_str(), fit, rows, n_features, Solver::Full)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("PrincipalComponentAnalysis/fit/solver:randomized" + suffix).c_str(), fit, rows, n_features, Solver::Randomized)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("PrincipalComponentAnalysis/transform" + suffix).c_str(), transform, rows, n_features)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("IncrementalPrincipalComponentAnalysis/partial_fit" + suffix).c_str(), incrementalPartialFit, rows, n_features)->Unit(benchmark::kMillisecond);
+    });
+}
+
+} // namespace bench
@@ -0,0 +1,181 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include "Benchmarks.hpp"
+#include "L/ClassificationMetrics.hpp"
+#include "L/DecisionTreeClassifier.hpp"
+#include "L/LinearRegression.hpp"
+#include "L/LogisticRegression.hpp"
+#include "L/PrincipalComponentAnalysis.hpp"
+#include "L/RegressionMetrics.hpp"
+
+// The same workloads in double and float, on the same values: compare the pairs of
+// Precision/<workload>/double and Precision/<workload>/float. bytes_per_second is the
+// input read per second and the input_bytes counter the memory held by X.
+namespace bench {
+
+namespace {
+
+// Gradient descent iterations per fit
+constexpr int kIterations = 10;
+
+// Components kept by the PCA
+constexpr int kComponents = 10;
+
+template <typename Scalar>
+struct PrecisionData {
+    U::DenseMatrix<Scalar> X;
+    U::DenseVector<Scalar> y_regression;
+    U::DenseVector<Scalar> y_class;
+};
+
+// Generated in double and rounded, so both precisions see the same features
+template <typename Scalar>
+const PrecisionData<Scalar>& precisionData(int64_t rows, int64_t features) {
+    return cached<PrecisionData<Scalar>>(key("precision", rows, features), [=]() {
+        Eigen::MatrixXd X = makeFeatures(rows, features);
+        PrecisionData<Scalar> data;
+        data.y_regression = makeRegressionTarget(X).cast<Scalar>();
+        data.y_class = makeClassLabels(X, 2).cast<Scalar>();
+        data.X = X.cast<Scalar>();
+        return data;
+    });
+}
+
+template <typename Scalar>
+void setInputCounters(benchmark::State& state, int64_t rows, int64_t features, int64_t passes = 1) {
+    state.SetItemsProcessed(state.iterations() * rows * passes);
+    state.SetBytesProcessed(state.iterations() * rows * features * passes * static_cast<int64_t>(sizeof(Scalar)));
+    state.counters["input_bytes"] = benchmark::Counter(static_cast<double>(rows * features * sizeof(Scalar)),
+                                                       benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+}
+
+template <typename Scalar>
+void toMatrix(benchmark::State& state, int64_t rows, int64_t features) {
+    const L::DataFrame& df = cached<L::DataFrame>(key("precision_frame", rows, features),
+                                                  [=]() { return makeNumericFrame(rows, features); });
+
+    for (auto _ : state) {
+        auto X = df.toMatrix<Scalar>();
+        benchmark::DoNotOptimize(X.data());
+    }
+    setInputCounters<Scalar>(state, rows, features);
+}
+
+template <typename Scalar>
+void linearFit(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = precisionData<Scalar>(rows, features);
+
+    for (auto _ : state) {
+        L::LinearRegression model;
+        model.fit(data.X, data.y_regression);
+        benchmark::DoNotOptimize(model.getIntercept());
+    }
+    setInputCounters<Scalar>(state, rows, features);
+}
+
+template <typename Scalar>
+void linearPredict(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = precisionData<Scalar>(rows, features);
+    L::LinearRegression model;
+    model.fit(data.X, data.y_regression);
+
+    for (auto _ : state) {
+        auto predictions = model.predict(data.X);
+        benchmark::DoNotOptimize(predictions.data());
+    }
+    setInputCounters<Scalar>(state, rows, features);
+}
+
+template <typename Scalar>
+void logisticFit(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = precisionData<Scalar>(rows, features);
+
+    for (auto _ : state) {
+        L::LogisticRegression model;
+        model.fit(data.X, data.y_class, 0.1, kIterations);
+        benchmark::DoNotOptimize(model.intercept());
+    }
+    // Each iteration reads X twice, for the scores and for the gradient
+    setInputCounters<Scalar>(state, rows, features, 2 * kIterations);
+}
+
+template <typename Scalar>
+void logisticPredictProba(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = precisionData<Scalar>(rows, features);
+    L::LogisticRegression model;
+    model.fit(data.X, data.y_class, 0.1, 1);
+
+    for (auto _ : state) {
+        auto probabilities = model.predict_proba(data.X);
+        benchmark::DoNotOptimize(probabilities.data());
+    }
+    setInputCounters<Scalar>(state, rows, features);
+}
+
+template <typename Scalar>
+void pcaTransform(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = precisionData<Scalar>(rows, features);
+    L::PrincipalComponentAnalysis pca(static_cast<int>(std::min<int64_t>(kComponents, features)));
+    pca.fit(data.X);
+
+    for (auto _ : state) {
+        auto projected = pca.transform(data.X);
+        benchmark::DoNotOptimize(projected.data());
+    }
+    setInputCounters<Scalar>(state, rows, features);
+}
+
+template <typename Scalar>
+void treePredict(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = precisionData<Scalar>(rows, features);
+    // Trained on the first rows only: the benchmark is about inference
+    const int64_t train_rows = std::min<int64_t>(rows, 1000);
+    L::DecisionTreeClassifier model(8);
+    model.fit(U::DenseMatrix<Scalar>(data.X.topRows(train_rows)),
+              U::DenseVector<Scalar>(data.y_class.head(train_rows)));
+
+    for (auto _ : state) {
+        auto predictions = model.predict(data.X);
+        benchmark::DoNotOptimize(predictions.data());
+    }
+    setInputCounters<Scalar>(state, rows, features);
+}
+
+template <typename Scalar>
+void metrics(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = precisionData<Scalar>(rows, features);
+    const U::DenseVector<Scalar> predictions = data.y_regression.reverse();
+
+    for (auto _ : state) {
+        L::RegressionMetrics regression(predictions, data.y_regression);
+        L::ClassificationMetrics classification(data.y_class, data.y_class);
+        benchmark::DoNotOptimize(regression.r2Score());
+        benchmark::DoNotOptimize(classification.accuracy());
+    }
+    // Two vectors per metric, rather than the features
+    setInputCounters<Scalar>(state, rows, 4);
+}
+
+template <typename Scalar>
+void registerPrecision(const std::string& precision, int64_t rows, int64_t features) {
+    const std::string suffix = "/" + precision + "/rows:" + std::to_string(rows) + "/features:" + std::to_string(features);
+    benchmark::RegisterBenchmark(("Precision/DataFrame/toMatrix" + suffix).c_str(), toMatrix<Scalar>, rows, features)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(("Precision/LinearRegression/fit" + suffix).c_str(), linearFit<Scalar>, rows, features)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(("Precision/LinearRegression/predict" + suffix).c_str(), linearPredict<Scalar>, rows, features)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(("Precision/LogisticRegression/fit" + suffix).c_str(), logisticFit<Scalar>, rows, features)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(("Precision/LogisticRegression/predict_proba" + suffix).c_str(), logisticPredictProba<Scalar>, rows, features)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(("Precision/PrincipalComponentAnalysis/transform" + suffix).c_str(), pcaTransform<Scalar>, rows, features)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(("Precision/DecisionTreeClassifier/predict" + suffix).c_str(), treePredict<Scalar>, rows, features)->Unit(benchmark::kMillisecond);
+    benchmark::RegisterBenchmark(("Precision/Metrics" + suffix).c_str(), metrics<Scalar>, rows, features)->Unit(benchmark::kMillisecond);
+}
+
+} // namespace
+
+void registerPrecisionBenchmarks(const Scale& scale) {
+    forEachScale(scale, scale.rows.empty() ? 0 : scale.rows.back(), [](int64_t rows, int64_t features) {
+        registerPrecision<double>("double", rows, features);
+        registerPrecision<float>("float", rows, features);
+    });
+}
+
+} // namespace bench
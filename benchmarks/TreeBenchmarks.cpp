@@ -0,0 +1,112 @@
+#include <benchmark/benchmark.h>
+#include "Benchmarks.hpp"
+#include "L/DecisionTreeClassifier.hpp"
+#include "U/Binning.hpp"
+#include "U/TreeUtils.hpp"
+
+namespace bench {
+
+namespace {
+
+struct ClassificationData {
+    Eigen::MatrixXd X;
+    Eigen::VectorXd y;
+};
+
+const ClassificationData& classificationData(int64_t rows, int64_t features) {
+    return cached<ClassificationData>(key("tree_classification", rows, features), [=]() {
+        ClassificationData data{makeFeatures(rows, features), Eigen::VectorXd()};
+        data.y = makeClassLabels(data.X, 2);
+        return data;
+    });
+}
+
+void findBestSplit(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = classificationData(rows, features);
+
+    for (auto _ : state) {
+        int best_feature;
+        double best_threshold, best_gini;
+        U::TreeUtils::findBestSplit(data.X, data.y, best_feature, best_threshold, best_gini);
+        benchmark::DoNotOptimize(best_gini);
+    }
+    state.SetItemsProcessed(state.iterations() * rows * features);
+}
+
+void fit(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = classificationData(rows, features);
+
+    for (auto _ : state) {
+        L::DecisionTreeClassifier model(8);
+        model.fit(data.X, data.y);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+// Binned once outside the loop, as when the matrix is shared by the trees of an ensemble
+void fitBinned(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = classificationData(rows, features);
+    const U::BinnedMatrix binned(data.X);
+
+    for (auto _ : state) {
+        L::DecisionTreeClassifier model(8);
+        model.fit(binned, data.y);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+void binMatrix(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = classificationData(rows, features);
+
+    for (auto _ : state) {
+        U::BinnedMatrix binned(data.X);
+        benchmark::DoNotOptimize(binned.bytes());
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+void predict(benchmark::State& state, int64_t rows, int64_t features) {
+    const auto& data = classificationData(rows, features);
+    L::DecisionTreeClassifier model(8);
+    model.fit(data.X, data.y);
+
+    for (auto _ : state) {
+        Eigen::VectorXd predictions = model.predict(data.X);
+        benchmark::DoNotOptimize(predictions.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+}
+
+// A tree grown without a depth limit, as pruned by ccp_alpha (0: left fully grown)
+void predictGrown(benchmark::State& state, int64_t rows, int64_t features, double ccp_alpha) {
+    const auto& data = classificationData(rows, features);
+    L::DecisionTreeClassifier model(1000, 2, 1, 0, ccp_alpha);
+    model.fit(data.X, data.y);
+
+    for (auto _ : state) {
+        Eigen::VectorXd predictions = model.predict(data.X);
+        benchmark::DoNotOptimize(predictions.data());
+    }
+    state.SetItemsProcessed(state.iterations() * rows);
+    state.counters["nodes"] = static_cast<double>(model.nodeCount());
+    state.counters["depth"] = model.depth();
+}
+
+} // namespace
+
+void registerTreeBenchmarks(const Scale& scale) {
+    forEachScale(scale, scale.max_tree_rows, [](int64_t rows, int64_t features) {
+        const std::string suffix = "/rows:" + std::to_string(rows) + "/features:" + std::to_string(features);
+        benchmark::RegisterBenchmark(("TreeUtils/findBestSplit" + suffix).c_str(), findBestSplit, rows, features)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("DecisionTreeClassifier/fit" + suffix).c_str(), fit, rows, features)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("DecisionTreeClassifier/fit_binned" + suffix).c_str(), fitBinned, rows, features)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("BinnedMatrix/build" + suffix).c_str(), binMatrix, rows, features)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("DecisionTreeClassifier/predict" + suffix).c_str(), predict, rows, features)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("DecisionTreeClassifier/predict_grown" + suffix).c_str(), predictGrown, rows, features, 0.0)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark(("DecisionTreeClassifier/predict_pruned" + suffix).c_str(), predictGrown, rows, features, 1e-3)->Unit(benchmark::kMillisecond);
+    });
+}
+
+} // namespace bench
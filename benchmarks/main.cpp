@@ -0,0 +1,95 @@
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Benchmarks.hpp"
+
+#ifndef ML_CPP_BUILD_TYPE
+#define ML_CPP_BUILD_TYPE "unknown"
+#endif
+
+namespace bench {
+
+void forEachScale(const Scale& scale, int64_t max_rows, const std::function<void(int64_t, int64_t)>& register_one) {
+    for (int64_t rows : scale.rows) {
+        for (int64_t features : scale.features) {
+            if (rows <= max_rows && rows * features <= scale.max_cells) {
+                register_one(rows, features);
+            }
+        }
+    }
+}
+
+} // namespace bench
+
+namespace {
+
+// Parses --name=value and removes it from argv; returns false if the flag is absent
+bool takeFlag(int& argc, char** argv, const std::string& name, int64_t& value) {
+    const std::string prefix = "--" + name + "=";
+    for (int i = 1; i < argc; ++i) {
+        std::string argument = argv[i];
+        if (argument.compare(0, prefix.size(), prefix) == 0) {
+            value = std::strtoll(argument.c_str() + prefix.size(), nullptr, 10);
+            for (int j = i; j + 1 < argc; ++j) {
+                argv[j] = argv[j + 1];
+            }
+            --argc;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+// Usage: benchmarks [--max_rows=N] [--max_features=N] [--max_cells=N] [--max_tree_rows=N] [Google Benchmark flags]
+// e.g. benchmarks --max_rows=100000000 --benchmark_out=results.json --benchmark_out_format=json
+int main(int argc, char** argv) {
+    int64_t max_rows = 100000;
+    int64_t max_features = 100;
+    int64_t max_cells = 10000000;
+    int64_t max_tree_rows = 1000;
+    takeFlag(argc, argv, "max_rows", max_rows);
+    takeFlag(argc, argv, "max_features", max_features);
+    takeFlag(argc, argv, "max_cells", max_cells);
+    takeFlag(argc, argv, "max_tree_rows", max_tree_rows);
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+
+    // 10^3 to 10^8 rows and 1 to 1000 features, capped by the limits above
+    bench::Scale scale;
+    for (int64_t rows = 1000; rows <= 100000000 && rows <= max_rows; rows *= 10) {
+        scale.rows.push_back(rows);
+    }
+    for (int64_t features : {1, 10, 100, 1000}) {
+        if (features <= max_features) {
+            scale.features.push_back(features);
+        }
+    }
+    scale.max_cells = max_cells;
+    scale.max_tree_rows = max_tree_rows;
+
+    benchmark::AddCustomContext("ml_cpp_build_type", ML_CPP_BUILD_TYPE);
+    if (std::string(ML_CPP_BUILD_TYPE) != "Release") {
+        std::cerr << "***WARNING*** ML_CPP was built as " << ML_CPP_BUILD_TYPE
+                  << "; configure with -DCMAKE_BUILD_TYPE=Release for meaningful timings." << std::endl;
+    }
+
+    bench::registerDataFrameBenchmarks(scale);
+    bench::registerTreeBenchmarks(scale);
+    bench::registerLinearModelBenchmarks(scale);
+    bench::registerPCABenchmarks(scale);
+    bench::registerMetricsBenchmarks(scale);
+    bench::registerPrecisionBenchmarks(scale);
+    bench::registerNeighborBenchmarks(scale);
+    bench::registerClusteringBenchmarks(scale);
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include "DistributedFit.hpp"
+#include <stdexcept>
+#include "L/CSVChunkReader.hpp"
+#include "U/Trace.hpp"
+
+namespace dist {
+
+namespace {
+
+L::CSVChunkReader openShard(const Dataset& data, size_t shard, size_t shards) {
+    L::CSVChunkReader reader(data.path, data.features, data.target, data.chunk_rows);
+    if (!reader.isOpen()) {
+        throw std::runtime_error("Failed to open " + data.path);
+    }
+    reader.restrictToShard(shard, shards);
+    return reader;
+}
+
+// [count, mean_y, scatter_yy, mean_x, scatter_xy, scatter_xx], zeros for a rank without rows
+std::vector<double> pack(const L::LinearRegression::SufficientStatistics& statistics, Eigen::Index d) {
+    std::vector<double> packed(3 + 2 * d + d * d, 0.0);
+    if (statistics.count == 0) {
+        return packed;
+    }
+    packed[0] = statistics.count;
+    packed[1] = statistics.mean_y;
+    packed[2] = statistics.scatter_yy;
+    Eigen::Map<Eigen::VectorXd>(packed.data() + 3, d) = statistics.mean_x;
+    Eigen::Map<Eigen::VectorXd>(packed.data() + 3 + d, d) = statistics.scatter_xy;
+    Eigen::Map<Eigen::MatrixXd>(packed.data() + 3 + 2 * d, d, d) = statistics.scatter_xx;
+    return packed;
+}
+
+L::LinearRegression::SufficientStatistics unpack(const double* packed, Eigen::Index d) {
+    L::LinearRegression::SufficientStatistics statistics;
+    statistics.count = packed[0];
+    statistics.mean_y = packed[1];
+    statistics.scatter_yy = packed[2];
+    statistics.mean_x = Eigen::Map<const Eigen::VectorXd>(packed + 3, d);
+    statistics.scatter_xy = Eigen::Map<const Eigen::VectorXd>(packed + 3 + d, d);
+    statistics.scatter_xx = Eigen::Map<const Eigen::MatrixXd>(packed + 3 + 2 * d, d, d);
+    return statistics;
+}
+
+} // namespace
+
+void readShard(const Dataset& data, size_t shard, size_t shards, Eigen::MatrixXd& X, Eigen::VectorXd& y) {
+    U_TRACE_SCOPE("dist::readShard");
+    L::CSVChunkReader reader = openShard(data, shard, shards);
+    std::vector<Eigen::MatrixXd> X_chunks;
+    std::vector<Eigen::VectorXd> y_chunks;
+    Eigen::MatrixXd X_chunk;
+    Eigen::VectorXd y_chunk;
+    Eigen::Index rows = 0;
+    while (reader.next(X_chunk, y_chunk)) {
+        rows += X_chunk.rows();
+        X_chunks.push_back(X_chunk);
+        y_chunks.push_back(y_chunk);
+    }
+
+    X.resize(rows, static_cast<Eigen::Index>(data.features.size()));
+    y.resize(rows);
+    Eigen::Index row = 0;
+    for (size_t i = 0; i < X_chunks.size(); ++i) {
+        X.middleRows(row, X_chunks[i].rows()) = X_chunks[i];
+        y.segment(row, y_chunks[i].size()) = y_chunks[i];
+        row += X_chunks[i].rows();
+    }
+}
+
+void fit(Ring& ring, const Dataset& data, L::LinearRegression& model) {
+    U_TRACE_SCOPE("dist::fit linear");
+    L::CSVChunkReader reader = openShard(data, static_cast<size_t>(ring.rank()), static_cast<size_t>(ring.size()));
+    L::LinearRegression::SufficientStatistics local;
+    Eigen::MatrixXd X;
+    Eigen::VectorXd y;
+    while (reader.next(X, y)) {
+        local.merge(L::LinearRegression::accumulate(X, y));
+    }
+
+    // Gathered rather than summed: merging centered moments is not a plain sum
+    const Eigen::Index d = static_cast<Eigen::Index>(data.features.size());
+    const std::vector<double> packed = pack(local, d);
+    const std::vector<double> gathered = ring.allgather(packed.data(), packed.size());
+    L::LinearRegression::SufficientStatistics total;
+    for (int rank = 0; rank < ring.size(); ++rank) {
+        const double* statistics = gathered.data() + rank * packed.size();
+        if (statistics[0] > 0) {
+            total.merge(unpack(statistics, d));
+        }
+    }
+    if (total.count == 0) {
+        throw std::invalid_argument("No rows in " + data.path);
+    }
+    model.fit(total);
+}
+
+void fit(Ring& ring, const Eigen::MatrixXd& X, const Eigen::VectorXd& y, L::LogisticRegression& model,
+         double learning_rate, int iterations) {
+    U_TRACE_SCOPE("dist::fit logistic");
+    model.fit(X, y, [&ring](Eigen::VectorXd& sums) { ring.allreduce(sums.data(), static_cast<size_t>(sums.size())); },
+              learning_rate, iterations);
+}
+
+} // namespace dist
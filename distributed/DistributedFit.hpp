@@ -0,0 +1,35 @@
+#ifndef DIST_DISTRIBUTEDFIT_HPP
+#define DIST_DISTRIBUTEDFIT_HPP
+
+#include <Eigen/Dense>
+#include <string>
+#include <vector>
+#include "L/LinearRegression.hpp"
+#include "L/LogisticRegression.hpp"
+#include "RingAllreduce.hpp"
+
+namespace dist {
+
+// A CSV file split by rows between the ranks of a ring, each reading only its own byte range
+struct Dataset {
+    std::string path;
+    std::vector<std::string> features;
+    std::string target;
+    size_t chunk_rows = 65536;
+};
+
+// Rows of shard `shard` of `shards`, loaded in memory
+void readShard(const Dataset& data, size_t shard, size_t shards, Eigen::MatrixXd& X, Eigen::VectorXd& y);
+
+// Streams this rank's shard into sufficient statistics and merges every rank's statistics in rank
+// order, so all ranks solve the same system and end with the same coefficients. Only
+// 3 + 2d + d^2 values per rank cross the ring, whatever the number of rows.
+void fit(Ring& ring, const Dataset& data, L::LinearRegression& model);
+
+// Gradient descent on this rank's rows, with the gradient summed over the ring every iteration
+void fit(Ring& ring, const Eigen::MatrixXd& X, const Eigen::VectorXd& y, L::LogisticRegression& model,
+         double learning_rate = 0.01, int iterations = 1000);
+
+} // namespace dist
+
+#endif // DIST_DISTRIBUTEDFIT_HPP
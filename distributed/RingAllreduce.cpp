@@ -0,0 +1,246 @@
+#include "RingAllreduce.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace dist {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::runtime_error systemError(const std::string& what) {
+    return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+sockaddr_un socketAddress(const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path too long: " + path);
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return address;
+}
+
+std::string socketPath(const std::string& directory, int rank) {
+    return directory + "/rank-" + std::to_string(rank) + ".sock";
+}
+
+int millisecondsLeft(Clock::time_point deadline) {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+    return static_cast<int>(std::max<decltype(left)>(left, 0));
+}
+
+// The next rank may not be listening yet: retry until it is, or until the deadline
+int connectTo(const std::string& path, Clock::time_point deadline) {
+    sockaddr_un address = socketAddress(path);
+    while (true) {
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) {
+            throw systemError("socket");
+        }
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+            return fd;
+        }
+        int error = errno;
+        ::close(fd);
+        if ((error != ENOENT && error != ECONNREFUSED && error != EINTR) || Clock::now() >= deadline) {
+            errno = error;
+            throw systemError("Failed to connect to " + path);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+int acceptFrom(int listen_fd, Clock::time_point deadline) {
+    while (true) {
+        pollfd ready{listen_fd, POLLIN, 0};
+        int events = ::poll(&ready, 1, millisecondsLeft(deadline));
+        if (events < 0 && errno == EINTR) {
+            continue;
+        }
+        if (events < 0) {
+            throw systemError("poll");
+        }
+        if (events == 0) {
+            throw std::runtime_error("Timed out waiting for the previous rank to connect");
+        }
+        int fd = ::accept(listen_fd, nullptr, nullptr);
+        if (fd >= 0) {
+            return fd;
+        }
+        if (errno != EINTR) {
+            throw systemError("accept");
+        }
+    }
+}
+
+void setNonBlocking(int fd) {
+    int flags = ::fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        throw systemError("fcntl");
+    }
+}
+
+} // namespace
+
+Ring::Ring(int rank, int size, const std::string& directory, std::chrono::milliseconds timeout)
+    : rank_(rank), size_(size), timeout_(timeout) {
+    if (size < 1 || rank < 0 || rank >= size) {
+        throw std::invalid_argument("Ring rank must be in [0, size).");
+    }
+    if (size == 1) {
+        return;
+    }
+
+    path_ = socketPath(directory, rank);
+    sockaddr_un address = socketAddress(path_);
+    int listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(path_.c_str());
+    if (listen_fd < 0 || ::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listen_fd, 1) < 0) {
+        std::runtime_error error = systemError("Failed to listen on " + path_);
+        if (listen_fd >= 0) {
+            ::close(listen_fd);
+        }
+        throw error;
+    }
+
+    // A connection is queued by the listening side before it is accepted, so connecting
+    // first and accepting second cannot deadlock around the ring
+    try {
+        const Clock::time_point deadline = Clock::now() + timeout_;
+        next_fd_ = connectTo(socketPath(directory, (rank + 1) % size), deadline);
+        previous_fd_ = acceptFrom(listen_fd, deadline);
+        setNonBlocking(next_fd_);
+        setNonBlocking(previous_fd_);
+    } catch (...) {
+        ::close(listen_fd);
+        ::unlink(path_.c_str());
+        if (next_fd_ >= 0) {
+            ::close(next_fd_);
+        }
+        if (previous_fd_ >= 0) {
+            ::close(previous_fd_);
+        }
+        throw;
+    }
+    ::close(listen_fd);
+    ::unlink(path_.c_str());
+}
+
+Ring::~Ring() {
+    if (next_fd_ >= 0) {
+        ::close(next_fd_);
+    }
+    if (previous_fd_ >= 0) {
+        ::close(previous_fd_);
+    }
+}
+
+void Ring::exchange(const double* send, std::size_t send_count, double* receive, std::size_t receive_count) {
+    const char* out = reinterpret_cast<const char*>(send);
+    char* in = reinterpret_cast<char*>(receive);
+    std::size_t out_left = send_count * sizeof(double);
+    std::size_t in_left = receive_count * sizeof(double);
+    bytes_sent_ += out_left;
+
+    while (out_left > 0 || in_left > 0) {
+        pollfd fds[2];
+        nfds_t count = 0;
+        if (out_left > 0) {
+            fds[count++] = {next_fd_, POLLOUT, 0};
+        }
+        if (in_left > 0) {
+            fds[count++] = {previous_fd_, POLLIN, 0};
+        }
+        int events = ::poll(fds, count, static_cast<int>(timeout_.count()));
+        if (events < 0 && errno == EINTR) {
+            continue;
+        }
+        if (events < 0) {
+            throw systemError("poll");
+        }
+        if (events == 0) {
+            throw std::runtime_error("Timed out exchanging with the neighbouring ranks");
+        }
+
+        for (nfds_t i = 0; i < count; ++i) {
+            if (fds[i].revents == 0) {
+                continue;
+            }
+            if (fds[i].fd == next_fd_) {
+                ssize_t written = ::write(next_fd_, out, out_left);
+                if (written < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    throw systemError("Failed to send to rank " + std::to_string((rank_ + 1) % size_));
+                }
+                if (written > 0) {
+                    out += written;
+                    out_left -= static_cast<std::size_t>(written);
+                }
+            } else {
+                ssize_t read = ::read(previous_fd_, in, in_left);
+                if (read == 0) {
+                    throw std::runtime_error("Rank " + std::to_string((rank_ + size_ - 1) % size_) + " closed the connection");
+                }
+                if (read < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    throw systemError("Failed to receive from rank " + std::to_string((rank_ + size_ - 1) % size_));
+                }
+                if (read > 0) {
+                    in += read;
+                    in_left -= static_cast<std::size_t>(read);
+                }
+            }
+        }
+    }
+}
+
+void Ring::allreduce(double* data, std::size_t n) {
+    if (size_ == 1 || n == 0) {
+        return;
+    }
+    const std::size_t ranks = static_cast<std::size_t>(size_);
+    auto begin = [n, ranks](std::size_t block) { return n * block / ranks; };
+    auto length = [&begin](std::size_t block) { return begin(block + 1) - begin(block); };
+    auto block = [this](int offset) { return static_cast<std::size_t>(((rank_ + offset) % size_ + size_) % size_); };
+
+    // Reduce-scatter: after step s each rank holds s + 2 contributions to the block it receives,
+    // so after size - 1 steps rank r holds the full sum of block r + 1
+    std::vector<double> incoming(n / ranks + 1);
+    for (int step = 0; step + 1 < size_; ++step) {
+        std::size_t out = block(-step);
+        std::size_t in = block(-step - 1);
+        exchange(data + begin(out), length(out), incoming.data(), length(in));
+        for (std::size_t i = 0; i < length(in); ++i) {
+            data[begin(in) + i] += incoming[i];
+        }
+    }
+
+    // Allgather: pass the summed blocks around the ring
+    for (int step = 0; step + 1 < size_; ++step) {
+        std::size_t out = block(1 - step);
+        std::size_t in = block(-step);
+        exchange(data + begin(out), length(out), data + begin(in), length(in));
+    }
+}
+
+std::vector<double> Ring::allgather(const double* data, std::size_t n) {
+    std::vector<double> gathered(n * static_cast<std::size_t>(size_));
+    std::copy(data, data + n, gathered.begin() + static_cast<std::ptrdiff_t>(n * rank_));
+    for (int step = 0; step + 1 < size_; ++step) {
+        std::size_t out = static_cast<std::size_t>(((rank_ - step) % size_ + size_) % size_);
+        std::size_t in = static_cast<std::size_t>(((rank_ - step - 1) % size_ + size_) % size_);
+        exchange(gathered.data() + out * n, n, gathered.data() + in * n, n);
+    }
+    return gathered;
+}
+
+} // namespace dist
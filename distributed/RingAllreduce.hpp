@@ -0,0 +1,50 @@
+#ifndef DIST_RINGALLREDUCE_HPP
+#define DIST_RINGALLREDUCE_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace dist {
+
+// The workers of a data-parallel fit, connected in a ring over Unix domain sockets: each rank
+// listens on <directory>/rank-<rank>.sock, connects to the next rank and accepts the previous one.
+// Every rank must make the same calls with the same sizes, in the same order.
+// Errors (a peer that exits or does not show up within the timeout) throw std::runtime_error.
+class Ring {
+public:
+    Ring(int rank, int size, const std::string& directory,
+         std::chrono::milliseconds timeout = std::chrono::seconds(60));
+    ~Ring();
+    Ring(const Ring&) = delete;
+    Ring& operator=(const Ring&) = delete;
+
+    // Sum data over every rank, in place: a reduce-scatter then an allgather of size blocks, so each
+    // rank sends 2 (size - 1) / size of the buffer whatever the number of ranks. Every rank ends with
+    // the same values; they match a sequential sum up to the order of the additions.
+    void allreduce(double* data, std::size_t n);
+
+    // The n values of every rank, concatenated in rank order
+    std::vector<double> allgather(const double* data, std::size_t n);
+
+    int rank() const { return rank_; }
+    int size() const { return size_; }
+    std::size_t bytesSent() const { return bytes_sent_; }
+
+private:
+    // Send to the next rank while receiving from the previous one, so a full ring never blocks
+    void exchange(const double* send, std::size_t send_count, double* receive, std::size_t receive_count);
+
+    int rank_;
+    int size_;
+    std::string path_;                   // Socket this rank listens on
+    std::chrono::milliseconds timeout_;
+    int next_fd_ = -1;                   // Connected to rank + 1
+    int previous_fd_ = -1;               // Accepted from rank - 1
+    std::size_t bytes_sent_ = 0;
+};
+
+} // namespace dist
+
+#endif // DIST_RINGALLREDUCE_HPP
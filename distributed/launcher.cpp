@@ -0,0 +1,326 @@
+// ml_distributed: data-parallel training of a linear or logistic regression over several worker processes.
+//
+//   ml_distributed --model linear|logistic --data FILE --target COLUMN [--features a,b,c] [--workers 4]
+//                  [--threads N] [--learning-rate 0.01] [--iterations 1000] [--output FILE] [--verify 1]
+//
+// Each worker reads its own byte range of the CSV and the workers combine their results through a
+// ring over Unix domain sockets in a temporary directory; rank 0 saves the model. --verify 1 also
+// fits the model in this process on the whole file and fails if the coefficients differ.
+// With --rank R --rendezvous DIR a single worker is run instead, e.g. to start the ranks by hand.
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "DistributedFit.hpp"
+#include "L/CSVChunkReader.hpp"
+#include "U/ThreadPool.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string model;
+    dist::Dataset data;
+    int workers = 4;
+    int threads = 0;             // Per worker; by default the cores are split between the workers
+    double learning_rate = 0.01;
+    int iterations = 1000;
+    std::string output;
+    bool verify = false;
+    int rank = -1;
+    std::string rendezvous;
+};
+
+void usage() {
+    std::cerr << "usage: ml_distributed --model linear|logistic --data FILE --target COLUMN [--features a,b,c] [--workers N]"
+                 " [--threads N] [--learning-rate X] [--iterations N] [--output FILE] [--verify 1]"
+                 " [--rank R --rendezvous DIR]" << std::endl;
+}
+
+std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> names;
+    std::istringstream stream(list);
+    std::string name;
+    while (std::getline(stream, name, ',')) {
+        names.push_back(name);
+    }
+    return names;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (flag == "--model") {
+            options.model = value;
+        } else if (flag == "--data") {
+            options.data.path = value;
+        } else if (flag == "--target") {
+            options.data.target = value;
+        } else if (flag == "--features") {
+            options.data.features = split(value);
+        } else if (flag == "--workers") {
+            options.workers = std::atoi(value.c_str());
+        } else if (flag == "--threads") {
+            options.threads = std::atoi(value.c_str());
+        } else if (flag == "--learning-rate") {
+            options.learning_rate = std::atof(value.c_str());
+        } else if (flag == "--iterations") {
+            options.iterations = std::atoi(value.c_str());
+        } else if (flag == "--output") {
+            options.output = value;
+        } else if (flag == "--verify") {
+            options.verify = value != "0";
+        } else if (flag == "--rank") {
+            options.rank = std::atoi(value.c_str());
+        } else if (flag == "--rendezvous") {
+            options.rendezvous = value;
+        } else {
+            return false;
+        }
+    }
+    bool single_worker = options.rank >= 0 || !options.rendezvous.empty();
+    return (options.model == "linear" || options.model == "logistic") && !options.data.path.empty() &&
+           !options.data.target.empty() && options.workers > 0 && options.iterations > 0 &&
+           (!single_worker || (options.rank < options.workers && !options.rendezvous.empty()));
+}
+
+// Every column but the target when --features is not given
+bool resolveFeatures(Options& options) {
+    if (!options.data.features.empty()) {
+        return true;
+    }
+    std::ifstream file(options.data.path);
+    std::string header;
+    if (!file || !std::getline(file, header)) {
+        std::cerr << "Failed to read the header of " << options.data.path << std::endl;
+        return false;
+    }
+    for (const std::string& name : split(header)) {
+        if (name != options.data.target) {
+            options.data.features.push_back(name);
+        }
+    }
+    return !options.data.features.empty();
+}
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template <typename Model>
+void save(const Model& model, const std::string& path) {
+    std::ofstream out(path);
+    model.save(out);
+    if (!out) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+// One rank: connect the ring, fit on the shard, save from rank 0
+int runWorker(const Options& options, int rank, const std::string& rendezvous, const std::string& output) {
+    try {
+        if (options.threads > 0) {
+            U::ExecutionPolicy::setDefault(U::ExecutionPolicy::threads(static_cast<std::size_t>(options.threads)));
+        }
+        Clock::time_point start = Clock::now();
+        dist::Ring ring(rank, options.workers, rendezvous);
+        double connect_seconds = secondsSince(start);
+
+        std::size_t rows = 0;
+        double read_seconds = 0.0;
+        start = Clock::now();
+        if (options.model == "linear") {
+            L::LinearRegression model;
+            dist::fit(ring, options.data, model);
+            if (rank == 0 && !output.empty()) {
+                save(model, output);
+            }
+        } else {
+            Eigen::MatrixXd X;
+            Eigen::VectorXd y;
+            dist::readShard(options.data, static_cast<size_t>(rank), static_cast<size_t>(options.workers), X, y);
+            rows = static_cast<std::size_t>(X.rows());
+            read_seconds = secondsSince(start);
+            start = Clock::now();
+            L::LogisticRegression model;
+            dist::fit(ring, X, y, model, options.learning_rate, options.iterations);
+            if (rank == 0 && !output.empty()) {
+                save(model, output);
+            }
+        }
+        double fit_seconds = secondsSince(start);
+
+        std::cerr << "rank " << rank << "/" << options.workers;
+        if (options.model == "logistic") {
+            std::cerr << ": " << rows << " rows, read " << read_seconds << " s,";
+        } else {
+            std::cerr << ":";
+        }
+        std::cerr << " connect " << connect_seconds << " s, fit " << fit_seconds << " s, sent "
+                  << ring.bytesSent() << " bytes" << std::endl;
+        return 0;
+    } catch (const std::exception& error) {
+        std::cerr << "rank " << rank << ": " << error.what() << std::endl;
+        return 1;
+    }
+}
+
+// Wait for every worker; the first failure stops the others, which would otherwise wait on the ring
+bool waitForWorkers(std::vector<pid_t>& workers) {
+    bool ok = true;
+    for (std::size_t remaining = workers.size(); remaining > 0; --remaining) {
+        int status = 0;
+        pid_t pid = ::wait(&status);
+        if (pid < 0) {
+            return false;
+        }
+        for (pid_t& worker : workers) {
+            if (worker == pid) {
+                worker = -1;
+            }
+        }
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            if (ok) {
+                for (pid_t worker : workers) {
+                    if (worker > 0) {
+                        ::kill(worker, SIGTERM);
+                    }
+                }
+            }
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+// Coefficients followed by the intercept
+Eigen::VectorXd parameters(const L::LinearRegression& model) {
+    Eigen::VectorXd values(model.getCoefficients().size() + 1);
+    values << model.getCoefficients(), model.getIntercept();
+    return values;
+}
+
+Eigen::VectorXd parameters(const L::LogisticRegression& model) {
+    Eigen::VectorXd values(model.coefficients().size() + 1);
+    values << model.coefficients(), model.intercept();
+    return values;
+}
+
+// Fit on the whole file in this process and compare with the saved model
+template <typename Model>
+bool verify(const Options& options, const Model& single, const std::string& output) {
+    Model distributed;
+    std::ifstream in(output);
+    distributed.load(in);
+
+    constexpr double kTolerance = 1e-8;
+    const Eigen::VectorXd single_coefficients = parameters(single);
+    const Eigen::VectorXd distributed_coefficients = parameters(distributed);
+    bool ok = single_coefficients.size() == distributed_coefficients.size();
+    double difference = ok ? (single_coefficients - distributed_coefficients).lpNorm<Eigen::Infinity>() : INFINITY;
+    ok = ok && difference <= kTolerance * std::max(1.0, single_coefficients.lpNorm<Eigen::Infinity>());
+    std::cerr << "verify " << options.model << ": largest coefficient difference " << difference
+              << (ok ? " (ok)" : " (MISMATCH)") << std::endl;
+    return ok;
+}
+
+bool verifyAgainstSingleProcess(const Options& options, const std::string& output) {
+    L::CSVChunkReader reader(options.data.path, options.data.features, options.data.target, options.data.chunk_rows);
+    if (options.model == "linear") {
+        L::LinearRegression model;
+        model.fit([&reader](Eigen::MatrixXd& X, Eigen::VectorXd& y) { return reader.next(X, y); });
+        return verify(options, model, output);
+    }
+    Eigen::MatrixXd X;
+    Eigen::VectorXd y;
+    dist::readShard(options.data, 0, 1, X, y);
+    L::LogisticRegression model;
+    model.fit(X, y, options.learning_rate, options.iterations);
+    return verify(options, model, output);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+    if (!resolveFeatures(options)) {
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN);  // A worker that dies shows up as a write error on its neighbours
+
+    if (options.rank >= 0) {
+        return runWorker(options, options.rank, options.rendezvous, options.output);
+    }
+
+    // No thread pool is started before fork(): the workers create their own
+    if (options.threads == 0) {
+        options.threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / options.workers);
+    }
+    char rendezvous[] = "/tmp/ml_distributed.XXXXXX";
+    if (!::mkdtemp(rendezvous)) {
+        std::cerr << "Failed to create a rendezvous directory: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::string output = options.output;
+    if (output.empty() && options.verify) {
+        output = std::string(rendezvous) + "/model.txt";
+    }
+
+    Clock::time_point start = Clock::now();
+    std::vector<pid_t> workers;
+    bool ok = true;
+    for (int rank = 0; rank < options.workers; ++rank) {
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            std::_Exit(runWorker(options, rank, rendezvous, output));
+        }
+        if (pid < 0) {
+            std::cerr << "fork: " << std::strerror(errno) << std::endl;
+            ok = false;
+            break;
+        }
+        workers.push_back(pid);
+    }
+    if (!ok) {
+        for (pid_t worker : workers) {
+            ::kill(worker, SIGTERM);
+        }
+    }
+    ok = waitForWorkers(workers) && ok;
+    std::cerr << options.workers << " workers, " << options.threads << " threads each: " << secondsSince(start)
+              << " s" << (ok ? "" : " (failed)") << std::endl;
+
+    if (ok && options.verify) {
+        try {
+            ok = verifyAgainstSingleProcess(options, output);
+        } catch (const std::exception& error) {
+            std::cerr << "verify: " << error.what() << std::endl;
+            ok = false;
+        }
+    }
+    if (output != options.output) {
+        ::unlink(output.c_str());
+    }
+    ::rmdir(rendezvous);
+    return ok ? 0 : 1;
+}
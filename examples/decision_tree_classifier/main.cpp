@@ -47,7 +47,8 @@ int main() {
     // Make predictions on the test set
     Eigen::VectorXd predictions = model.predict(X_test);
 
-    Eigen::VectorXd predictions_proba = model.predict_proba(X_test);
+    // One column per class; print the probability of the predicted one
+    Eigen::MatrixXd predictions_proba = model.predict_proba(X_test);
 
     // Retrieve the "Name" column from test data
     std::vector<L::DataFrame::DataType> name_column = test_df.getColumn("Name");
@@ -56,7 +57,7 @@ int main() {
     std::cout << "Predictions:" << std::endl;
     for (int i = 0; i < predictions.size(); ++i) {
         std::string name = std::get<std::string>(name_column[i]);  // Assuming "Name" column is of type string
-        std::cout << "Name: " << name << ", prediction: " << predictions(i) << ", proba : " << predictions_proba(i) << std::endl;
+        std::cout << "Name: " << name << ", prediction: " << predictions(i) << ", proba : " << predictions_proba.row(i).maxCoeff() << std::endl;
     }
 
     Eigen::VectorXd y_true = test_df.selectColumns({target_column}).toMatrix().col(0);
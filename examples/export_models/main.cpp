@@ -0,0 +1,51 @@
+#include <iostream>
+#include "L/DataFrame.hpp"
+#include "L/PrincipalComponentAnalysis.hpp"
+#include "L/LogisticRegression.hpp"
+#include "L/DecisionTreeClassifier.hpp"
+#include "../../serving/ModelChain.hpp"
+
+#include <Eigen/Dense>
+
+// Trains models on the persons dataset and writes them as chain files for ml_serve
+int main() {
+    L::DataFrame train_df;
+
+    // Load training data
+    if (!train_df.readCSV("examples/datasets/persons/train.csv")) {
+        std::cerr << "Failed to load train.csv" << std::endl;
+        return -1;
+    }
+
+    // Select feature and target columns and convert to Eigen
+    std::vector<std::string> feature_columns = {"Age", "Height", "Weight"};
+    std::string target_column = "Genre";
+    Eigen::MatrixXd X_train = train_df.selectColumns(feature_columns).toMatrix();
+    Eigen::VectorXd y_train = train_df.selectColumns({target_column}).toMatrix().col(0);
+
+    // Logistic regression on raw features
+    L::LogisticRegression logistic;
+    logistic.fit(X_train, y_train);
+    serve::ModelChain::save("logistic.model", logistic);
+
+    // PCA -> logistic regression
+    L::PrincipalComponentAnalysis PCA_object(2);
+    Eigen::MatrixXd X_projected = PCA_object.fit_transform(X_train);
+    L::LogisticRegression pca_logistic;
+    pca_logistic.fit(X_projected, y_train);
+    serve::ModelChain::save("pca_logistic.model", pca_logistic, &PCA_object);
+
+    // Decision tree
+    L::DecisionTreeClassifier tree(5);
+    tree.fit(X_train, y_train);
+    serve::ModelChain::save("tree.model", tree);
+
+    // Check the round trip: the loaded chain scores like the in-memory models
+    serve::ModelChain loaded = serve::ModelChain::load("pca_logistic.model");
+    double difference = (loaded.score(X_train).col(1) - pca_logistic.predict_proba(X_projected)).cwiseAbs().maxCoeff();
+
+    std::cout << "Wrote logistic.model, pca_logistic.model and tree.model (" << loaded.describe()
+              << ", max round-trip difference " << difference << ")" << std::endl;
+    std::cout << "Serve one with: ./build/bin/ml_serve --model pca_logistic.model --socket /tmp/ml_serve.sock" << std::endl;
+    return 0;
+}
@@ -28,12 +28,11 @@ int main() {
     L::DataFrame features_df = train_df.selectColumns(feature_columns);
     Eigen::MatrixXd X_train = features_df.toMatrix();
 
-    if(use_PCA){
-        L::PrincipalComponentAnalysis train_PCA_object = L::PrincipalComponentAnalysis(X_train);
-
-        train_PCA_object.transform();
+    // PCA is fitted on the training set only and reused for the test set
+    L::PrincipalComponentAnalysis PCA_object;
 
-        X_train = train_PCA_object.principal_components();
+    if(use_PCA){
+        X_train = PCA_object.fit_transform(X_train);
     }
 
     // Select target column and convert to Eigen vector
@@ -57,11 +56,7 @@ int main() {
     Eigen::MatrixXd X_test = test_features_df.toMatrix();
 
     if(use_PCA){
-        L::PrincipalComponentAnalysis test_PCA_object = L::PrincipalComponentAnalysis(X_test);
-
-        test_PCA_object.transform();
-
-        X_test = test_PCA_object.principal_components();
+        X_test = PCA_object.transform(X_test);
     }
 
     // Make predictions on the test set
@@ -0,0 +1,89 @@
+#ifndef L_ASYNCCHUNKLOADER_HPP
+#define L_ASYNCCHUNKLOADER_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Eigen/Dense>
+
+namespace L {
+
+class CSVChunkReader;
+
+// Prefetches a stream of chunks on a background thread into a bounded ring of buffers, so the next
+// chunk is read and parsed while the model trains on the current one and an epoch takes about
+// max(I/O, compute) instead of their sum. next() has the ChunkReader signature of the streaming
+// fits (LinearRegression, LogisticRegression, IncrementalPrincipalComponentAnalysis, KMeans):
+//
+//     L::AsyncChunkLoader loader("data.csv", features, "target");
+//     model.fit([&](Eigen::MatrixXd& X, Eigen::VectorXd& y) { return loader.next(X, y); });
+class AsyncChunkLoader {
+public:
+    // Fills X (and y) with the next chunk and returns false when the stream is exhausted; runs on the loader thread
+    using Source = std::function<bool(Eigen::MatrixXd& X, Eigen::VectorXd& y)>;
+    using FeatureSource = std::function<bool(Eigen::MatrixXd& X)>;
+
+    // depth: chunks loaded ahead of the one being trained on (2: one ready, one being filled).
+    // rewind, if given, restarts the source for reset().
+    AsyncChunkLoader(Source source, size_t depth = 2, std::function<void()> rewind = {});
+    AsyncChunkLoader(FeatureSource source, size_t depth = 2, std::function<void()> rewind = {});
+
+    // Prefetches from a CSVChunkReader over the file; target_column may be empty when only features are needed
+    AsyncChunkLoader(const std::string& filename, const std::vector<std::string>& feature_columns,
+                     const std::string& target_column = "", size_t chunk_rows = 65536, size_t depth = 2);
+
+    AsyncChunkLoader(const AsyncChunkLoader&) = delete;
+    AsyncChunkLoader& operator=(const AsyncChunkLoader&) = delete;
+    ~AsyncChunkLoader();   // Stops the loader thread after the chunk it is reading
+
+    // Swaps the next chunk into X (and y) and returns false once the stream is exhausted. The previous
+    // buffers of X and y go back to the ring, so a stream of equal chunks allocates nothing after the
+    // first pass through the ring. An exception thrown by the source is rethrown here.
+    bool next(Eigen::MatrixXd& X, Eigen::VectorXd& y);
+    bool next(Eigen::MatrixXd& X);
+
+    // Drops the prefetched chunks and restarts the stream from its beginning, e.g. for another epoch
+    void reset();
+
+    // Seconds next() spent waiting for a chunk: close to 0 when training is the bottleneck
+    double waitSeconds() const;
+
+private:
+    struct Buffer {
+        Eigen::MatrixXd X;
+        Eigen::VectorXd y;
+    };
+
+    std::unique_ptr<CSVChunkReader> reader_;   // Owned source of the CSV constructor
+    Source source_;
+    std::function<void()> rewind_;
+    bool has_target_;
+
+    std::vector<Buffer> ring_;
+    std::deque<size_t> free_;    // Buffers the loader may fill
+    std::deque<size_t> ready_;   // Filled buffers, in stream order
+    bool exhausted_ = false;     // The source returned false or threw
+    bool stopping_ = false;
+    std::exception_ptr error_;
+    double wait_seconds_ = 0.0;
+
+    mutable std::mutex mutex_;
+    std::condition_variable filled_;   // A buffer became ready, or the stream ended
+    std::condition_variable freed_;    // A buffer became free, or the loader must stop
+    std::thread thread_;
+
+    void start();
+    void stop();
+    void load();   // Loader thread
+    bool take(Eigen::MatrixXd& X, Eigen::VectorXd* y);
+};
+
+} // namespace L
+
+#endif // L_ASYNCCHUNKLOADER_HPP
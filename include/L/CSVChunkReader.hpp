@@ -0,0 +1,50 @@
+#ifndef L_CSVCHUNKREADER_HPP
+#define L_CSVCHUNKREADER_HPP
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+
+namespace L {
+
+// Streams a CSV file in fixed-size blocks of rows, for data that does not fit in a DataFrame
+class CSVChunkReader {
+public:
+    // target_column may be empty when only features are needed
+    CSVChunkReader(const std::string& filename, const std::vector<std::string>& feature_columns,
+                   const std::string& target_column = "", size_t chunk_rows = 65536);
+
+    bool isOpen() const { return file_.is_open(); }
+
+    // Read the next block; returns false once the file is exhausted
+    bool next(Eigen::MatrixXd& X, Eigen::VectorXd& y);
+    bool next(Eigen::MatrixXd& X);
+
+    // Rewind to the first data row, e.g. for another epoch
+    void reset();
+
+    // Read only shard `shard` of `shards`: the rows whose line starts in that part of the data rows,
+    // cut into equal byte ranges. Shards 0 to shards - 1 read every row once, in file order, each
+    // seeking straight to its own range, e.g. one per worker of a data-parallel fit.
+    // reset() then rewinds to the first row of the shard.
+    void restrictToShard(size_t shard, size_t shards);
+
+    size_t rowsRead() const { return rows_read_; }
+
+private:
+    std::ifstream file_;
+    std::vector<size_t> feature_indices_; // Position of each feature column in a line
+    long target_index_ = -1;              // Position of the target column, -1 if none
+    size_t chunk_rows_;
+    size_t rows_read_ = 0;
+    std::streampos data_start_;           // Offset of the first data row
+    std::streamoff position_ = 0;         // Offset of the next line
+    std::streamoff end_ = -1;             // Lines starting from there belong to the next shard, -1 for none
+
+    bool readChunk(Eigen::MatrixXd& X, Eigen::VectorXd* y);
+};
+
+} // namespace L
+
+#endif // L_CSVCHUNKREADER_HPP
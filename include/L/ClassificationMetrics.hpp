@@ -2,29 +2,73 @@
 #define L_CLASSIFICATIONMETRICS_HPP
 
 #include <Eigen/Dense>
+#include "../U/MatrixUtils.hpp"
+#include "../U/ThreadPool.hpp"
+#include <unordered_map>
 #include <vector>
 
 namespace L {
 
+// Streaming confusion matrix: batches are folded in one pass and accumulators from
+// different threads or shards can be merged. Labels are mapped through the class list.
+class ClassificationMetricsAccumulator {
+public:
+    explicit ClassificationMetricsAccumulator(const std::vector<int>& classes = {0, 1});
+
+    void update(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true);
+    template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+    void update(const U::DenseVector<Scalar>& predictions, const U::DenseVector<Scalar>& y_true);
+    void merge(const ClassificationMetricsAccumulator& other);
+
+    // Metrics methods
+    double accuracy() const;
+    double precision(int class_label = 1) const;
+    double recall(int class_label = 1) const;
+    double f1_score(int class_label = 1) const;
+    Eigen::MatrixXd confusion_matrix() const;       // Rows are actual classes, columns predicted ones, in classes() order
+
+    const std::vector<int>& classes() const { return classes_; }
+    double count() const { return count_; }
+
+private:
+    friend class ClassificationMetrics;
+
+    // Shared by the double and float overloads, on any vector expression
+    template <typename Vector>
+    void fold(const Vector& predictions, const Vector& y_true);
+
+    int classIndex(int label) const;                // Throws for labels outside the class list
+
+    std::vector<int> classes_;
+    int min_label_ = 0;                             // Offset of the lookup table
+    std::vector<int> label_table_;                  // Dense label -> index table when the label range is small
+    std::unordered_map<int, int> label_map_;        // Fallback for sparse label ranges
+    Eigen::MatrixXd confusion_matrix_;
+    double count_ = 0.0;
+};
+
 class ClassificationMetrics {
 public:
-    // Constructor that takes predictions, actual values, and an optional set of class labels
-    ClassificationMetrics(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true, const std::vector<int>& classes = {0, 1});
+    // Constructor that takes predictions, actual values, and an optional set of class labels;
+    // chunks are counted in parallel and merged in order
+    ClassificationMetrics(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true, const std::vector<int>& classes = {0, 1},
+                          const U::ExecutionPolicy& policy = U::ExecutionPolicy());
+    template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+    ClassificationMetrics(const U::DenseVector<Scalar>& predictions, const U::DenseVector<Scalar>& y_true,
+                          const std::vector<int>& classes = {0, 1}, const U::ExecutionPolicy& policy = U::ExecutionPolicy());
 
     // Metrics methods
-    double accuracy();
-    double precision(int class_label = 1);      // Default for binary (positive class = 1)
-    double recall(int class_label = 1);         // Default for binary (positive class = 1)
-    double f1_score(int class_label = 1);       // Default for binary (positive class = 1)
+    double accuracy() const;
+    double precision(int class_label = 1) const;      // Default for binary (positive class = 1)
+    double recall(int class_label = 1) const;         // Default for binary (positive class = 1)
+    double f1_score(int class_label = 1) const;       // Default for binary (positive class = 1)
     Eigen::MatrixXd confusion_matrix() const;  
 
 private:
-    void check_computed(); 
-    // Attributes
-    Eigen::MatrixXd confusion_matrix_;
-    Eigen::VectorXd predictions_;
-    Eigen::VectorXd y_true_;
-    std::vector<int> classes_;                         // Vector to store class labels
+    template <typename Vector>
+    void accumulate(const Vector& predictions, const Vector& y_true, const U::ExecutionPolicy& policy);
+
+    ClassificationMetricsAccumulator accumulator_;  // Filled once by the constructor
 };
 
 } // namespace L
@@ -0,0 +1,99 @@
+#ifndef L_COMPRESSEDDATAFRAME_HPP
+#define L_COMPRESSEDDATAFRAME_HPP
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <Eigen/Dense>
+#include "DataFrame.hpp"
+#include "../U/MatrixUtils.hpp"
+#include "../U/ThreadPool.hpp"
+
+namespace L {
+
+// Read-only, column-oriented copy of a DataFrame whose columns are compressed in segments of rows.
+// Every segment of every column picks the smallest of the encodings below for its values, so a
+// table of low-cardinality integers takes a few bits per cell instead of a 40-byte DataType.
+// toMatrix and the scans decode straight from the encoded segments.
+class CompressedDataFrame {
+public:
+    using DataType = DataFrame::DataType;
+
+    enum class Encoding {
+        BitPacked,    // Integers as offsets from the segment minimum, in the fewest bits that hold the range
+        RunLength,    // Integers as (value, end of run) pairs, for sorted or repetitive columns
+        Dictionary,   // Strings or doubles as bit-packed indices into the sorted distinct values of the segment
+        Double,       // Doubles with too many distinct values for a dictionary, 8 bytes each
+        Plain,        // Anything else (mixed strings and numbers, floats), stored as DataType
+    };
+
+    // Rows per segment: the unit of encoding and of parallel work
+    static constexpr size_t kSegmentRows = 65536;
+
+    CompressedDataFrame() = default;
+    explicit CompressedDataFrame(const DataFrame& df, const U::ExecutionPolicy& policy = U::ExecutionPolicy());
+
+    // Reads and compresses the file one segment at a time, so the uncompressed table is never held in
+    // memory as a whole; cells are parsed as in DataFrame::readCSV
+    bool readCSV(const std::string& filename, const U::ExecutionPolicy& policy = U::ExecutionPolicy());
+
+    // Appends the rows of df, which must have the same columns (any columns if this frame is empty)
+    void append(const DataFrame& df, const U::ExecutionPolicy& policy = U::ExecutionPolicy());
+
+    // Same as DataFrame::toMatrix, decoding each segment directly into the matrix
+    template <typename Scalar = double>
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> toMatrix(const U::ExecutionPolicy& policy = U::ExecutionPolicy()) const;
+    template <typename Scalar = double>
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> toMatrix(const std::vector<std::string>& column_names,
+                                                                   size_t first_row = 0,
+                                                                   size_t row_count = static_cast<size_t>(-1)) const;
+    U::SparseMatrix toSparseMatrix() const;
+
+    // Sum of a numeric column; runs and dictionary codes are counted, not expanded
+    double sum(const std::string& column_name) const;
+
+    // Integers come back as int when they fit and as long otherwise, as readCSV parses them
+    std::vector<DataType> getColumn(const std::string& column_name) const;
+    DataFrame decompress() const;
+
+    size_t getRowCount() const { return segment_starts_.empty() ? 0 : segment_starts_.back(); }
+    std::vector<std::string> columnNames() const;
+    bool hasColumn(const std::string& column) const;
+
+    // Encoding of each segment of a column
+    std::vector<Encoding> encodings(const std::string& column_name) const;
+
+    // Bytes held by the encoded columns
+    size_t memoryUsage() const;
+
+private:
+    struct Segment {
+        Encoding encoding = Encoding::Plain;
+        bool doubles = false;               // Numbers that were all doubles, decoded as double
+        std::vector<std::uint64_t> double_rows;   // Numbers mixing ints and doubles: one bit per row, set for a double
+        int bits = 0;                       // BitPacked / Dictionary: width of each packed value
+        std::int64_t base = 0;              // BitPacked: minimum of the segment
+        std::vector<std::uint64_t> words;   // BitPacked / Dictionary: packed values and one spare word
+        std::vector<std::int64_t> run_values;   // RunLength
+        std::vector<std::uint32_t> run_ends;    // RunLength: end of each run, relative to the segment
+        std::vector<double> numbers;        // Dictionary of doubles, or Double
+        std::vector<std::string> strings;   // Dictionary of strings
+        std::vector<DataType> plain;        // Plain
+    };
+
+    std::vector<std::string> column_names_;
+    std::map<std::string, size_t> column_indices_;
+    std::vector<size_t> segment_starts_;          // First row of each segment, then the row count
+    std::vector<std::vector<Segment>> columns_;   // [column][segment]
+
+    size_t columnIndex(const std::string& column_name) const;
+    static Segment encode(const std::vector<DataFrame::Row>& rows, size_t begin, size_t end, size_t column);
+    template <typename Scalar>
+    static void decode(const Segment& segment, size_t first, size_t count, Scalar* out);
+    static void appendValues(const Segment& segment, size_t count, std::vector<DataType>& out);
+};
+
+} // namespace L
+
+#endif // L_COMPRESSEDDATAFRAME_HPP
@@ -2,13 +2,17 @@
 #define L_DATAFRAME_HPP
 
 #include <iostream>
+#include <limits>
 #include <fstream>
 #include <sstream>
 #include <string>
 #include <vector>
 #include <variant>
 #include <map>
+#include <memory>
 #include <Eigen/Dense>
+#include "../U/MatrixUtils.hpp"
+#include "../U/ThreadPool.hpp"
 
 namespace L {
 
@@ -17,11 +21,42 @@ public:
     using DataType = std::variant<int, double, float, long, std::string>;  // Supports multiple numeric types and strings
     using Row = std::vector<DataType>;
 
+    // Summary of one column, computed in one parallel pass over its rows on first use and cached
+    // until the frame is modified, so repeated preprocessing of a large frame does not rescan it
+    struct ColumnStatistics {
+        size_t count = 0;            // Numeric cells (int, long, float, double), NaN excluded
+        size_t strings = 0;          // String cells
+        double min = std::numeric_limits<double>::quiet_NaN();
+        double max = std::numeric_limits<double>::quiet_NaN();
+        double mean = std::numeric_limits<double>::quiet_NaN();
+        double variance = std::numeric_limits<double>::quiet_NaN();   // Of the numeric cells, divided by count
+
+        // Distinct values (numbers and strings), counted exactly up to kMaxExactDistinct and
+        // estimated with a HyperLogLog sketch (about 1.6% error) above
+        double distinct = 0.0;
+        bool exact = true;                     // values and categories hold every distinct value
+        std::vector<double> values;            // Distinct numbers, sorted (when exact)
+        bool categorical = true;               // Only int and string cells, the types oneHotEncode accepts
+        std::vector<std::string> categories;   // Distinct cells as oneHotEncode names them, sorted (when exact and categorical)
+
+        // Sorted numbers of a fixed sample of kSampleRows rows (every row of smaller frames)
+        std::vector<double> sample;
+
+        double quantile(double q) const;   // From the sample; NaN without numbers
+        // Upper bin edges as U::BinnedMatrix learns them: the distinct values when there are at most
+        // max_bins, else quantiles of the sample with the last edge at max
+        std::vector<double> cutPoints(int max_bins = 256) const;
+
+        static constexpr size_t kMaxExactDistinct = 4096;
+        static constexpr size_t kSampleRows = 1 << 14;
+    };
+
     DataFrame() = default;
     DataFrame(const Eigen::MatrixXd& matrix, const std::vector<std::string>& column_names);
     DataFrame(const Eigen::VectorXd& vector, const std::string& column_name);
 
-    bool readCSV(const std::string& filename);
+    // Lines are read sequentially and parsed in parallel; rows keep the file order
+    bool readCSV(const std::string& filename, const U::ExecutionPolicy& policy = U::ExecutionPolicy());
 
     // Export DataFrame to CSV
     bool toCsv(const std::string& filename) const;
@@ -31,7 +66,15 @@ public:
     // Column operations
     DataFrame selectColumns(const std::vector<std::string>& column_names) const;
     DataFrame oneHotEncode(const std::vector<std::string>& column_names) const;
-    Eigen::MatrixXd toMatrix() const;
+    // Scalar is double or float (toMatrix<float>() halves the memory of the matrix)
+    template <typename Scalar = double>
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> toMatrix(const U::ExecutionPolicy& policy = U::ExecutionPolicy()) const;
+    // Selected columns of rows [first_row, first_row + row_count), without building an intermediate DataFrame
+    template <typename Scalar = double>
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> toMatrix(const std::vector<std::string>& column_names,
+                                                                   size_t first_row = 0,
+                                                                   size_t row_count = static_cast<size_t>(-1)) const;
+    U::SparseMatrix toSparseMatrix() const;    // CSR matrix holding only the non-zero cells, e.g. after oneHotEncode
 
     // Row operations
     void head(size_t n = 5) const;
@@ -46,15 +89,27 @@ public:
     std::vector<std::string> columnNames() const;
     std::map<std::string, size_t> columnIndices() const;
 
+    // Statistics of a column, or of every column (those not cached yet are computed one after the other)
+    ColumnStatistics statistics(const std::string& column_name, const U::ExecutionPolicy& policy = U::ExecutionPolicy()) const;
+    std::vector<ColumnStatistics> statistics(const U::ExecutionPolicy& policy = U::ExecutionPolicy()) const;
+
     void printColumnNames() const;
     bool hasColumn(std::string column) const;
 
 private:
+    friend class CompressedDataFrame;   // Encodes and decodes the rows directly
+
     std::vector<std::string> column_names_;
     std::vector<Row> data_;
     std::map<std::string, size_t> column_indices_;
 
+    // Cached statistics, one slot per column (null until computed), read and written atomically;
+    // every change of the rows or columns resets it
+    mutable std::vector<std::shared_ptr<const ColumnStatistics>> statistics_;
+
     DataType parseValue(const std::string& value) const;
+    void resetStatistics();
+    std::shared_ptr<const ColumnStatistics> columnStatistics(size_t column, const U::ExecutionPolicy& policy) const;
 };
 
 } // namespace L
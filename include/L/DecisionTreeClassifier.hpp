@@ -2,28 +2,135 @@
 #define L_DECISIONTREECLASSIFIER_HPP
 
 #include <Eigen/Dense>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <vector>
+#include "../U/MatrixUtils.hpp"
 #include "../U/TreeUtils.hpp"
+#include "../U/ThreadPool.hpp"
 
 namespace L {
 
 class DecisionTreeClassifier {
 public:
-    explicit DecisionTreeClassifier(const int max_depth = 1000);
+    // A node is split only if it has at least min_samples_split rows, and only where each child gets at
+    // least min_samples_leaf. max_leaf_nodes > 0 grows the tree best-first, always splitting the leaf
+    // whose split lowers the total impurity most, until it has that many leaves. ccp_alpha > 0 then
+    // prunes the grown tree with prune(ccp_alpha).
+    explicit DecisionTreeClassifier(const int max_depth = 1000, int min_samples_split = 2, int min_samples_leaf = 1,
+                                    int max_leaf_nodes = 0, double ccp_alpha = 0.0);
+
+    // Copies get their own nodes; moves take the nodes over
+    DecisionTreeClassifier(const DecisionTreeClassifier& other);
+    DecisionTreeClassifier(DecisionTreeClassifier&& other) noexcept;
+    DecisionTreeClassifier& operator=(DecisionTreeClassifier other) noexcept;
 
     void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y);
     Eigen::VectorXd predict(const Eigen::MatrixXd& X) const;
     Eigen::MatrixXd predict_proba(const Eigen::MatrixXd& X) const;
 
-    ~DecisionTreeClassifier();
+    // Train on a matrix binned once with U::BinnedMatrix, which can be shared by many trees: each node
+    // sweeps class histograms over the bins instead of sorting every feature, and the larger child gets
+    // its histogram by subtraction. Thresholds are bin edges, so predict() still takes raw rows. When no
+    // feature has more distinct values than bins, the tree is the one fit(MatrixXd) builds.
+    void fit(const U::BinnedMatrix& X, const Eigen::VectorXd& y);
+
+    // Single-precision rows: the thresholds stay in double, so a float row gets the same
+    // prediction as the same row widened to double, with half the memory traffic at inference
+    template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+    void fit(const U::DenseMatrix<Scalar>& X, const U::DenseVector<Scalar>& y);
+    template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+    U::DenseVector<Scalar> predict(const U::DenseMatrix<Scalar>& X) const;
+    template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+    U::DenseMatrix<Scalar> predict_proba(const U::DenseMatrix<Scalar>& X) const;
+
+    // Plain-text persistence of the fitted tree, nodes in preorder (see U/Serialization.hpp)
+    void save(std::ostream& out) const;
+    void load(std::istream& in);
+
+    // Threads used for split search, subtree building and inference; the tree does not depend on it
+    void setExecutionPolicy(const U::ExecutionPolicy& policy);
+
+    // Allocate the nodes from an arena shared with other trees, e.g. the members of an ensemble; call it
+    // before fit() or load(). The shared arena is append-only: only the next tree is built in it, and a
+    // refit, or a prune() or compact() that drops nodes, moves the tree to a private arena. Its nodes are
+    // released with the arena, or by its owner with TreeNodeArena::clear() once none of its trees is used.
+    void setArena(std::shared_ptr<U::TreeNodeArena> arena);
+
+    // Minimal cost-complexity pruning: collapses the weakest links, the splits t with the smallest
+    // g(t) = (R(t) - R(T_t)) / (leaves(T_t) - 1), while g(t) <= alpha, where R is the Gini impurity
+    // weighted by the share of training rows (of node t, or of the leaves of its subtree T_t). This
+    // gives the smallest subtree minimizing R(T) + alpha * leaves(T). A fitted tree can be pruned
+    // further without refitting; trees read by load() keep no training statistics and cannot.
+    void prune(double alpha);
+
+    // The distinct effective alphas of the weakest links, in increasing order: prune(path[i]) gives
+    // the i-th smaller tree, the last one a single leaf. Candidates for ccp_alpha, e.g. in a grid search.
+    std::vector<double> pruningPath() const;
 
+    // Merge every split whose children are leaves of the same class into one such leaf, bottom-up;
+    // predictions do not change. fit() and prune() already do it.
+    void compact();
+
+    // Number of nodes of the fitted tree
+    size_t nodeCount() const;
+
+    // Levels below the root, the number of steps every row takes at inference
+    int depth() const { return flat_.depth; }
+
+    // Number of features of the training rows, which predict() expects too; 0 for a tree read
+    // from a version-1 file, which did not record it
+    int featureCount() const { return n_features_; }
 
 private:
-    const int max_depth_;
-    U::TreeNode* root_; // Use TreeNode from U namespace
+    int max_depth_;
+    int min_samples_split_;
+    int min_samples_leaf_;
+    int max_leaf_nodes_;
+    double ccp_alpha_;
+    int n_features_ = 0;
+    U::TreeNode* root_; // Use TreeNode from U namespace, owned by arena_
+    std::shared_ptr<U::TreeNodeArena> arena_;
+    U::FlatTree flat_;  // Same tree as arrays, for the inference kernel
+    U::ExecutionPolicy execution_policy_;
+
+    // Split chosen for a node: feature -1 when it stays a leaf, else its threshold (and bin, in binned
+    // training) and gain, the decrease of rows * Gini impurity from the node to its children
+    struct Split {
+        int feature = -1;
+        double threshold = 0.0;
+        int bin = 0;
+        double gain = 0.0;
+    };
+    bool splittable(std::ptrdiff_t n, int depth, double impurity) const;
 
     U::TreeNode* buildTree(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, int depth);
-    int predictInstance(const Eigen::VectorXd& instance, U::TreeNode* node) const;
-    void deleteTree(U::TreeNode* node);
+    Split findSplit(const U::TreeNode* node, const Eigen::MatrixXd& X, const Eigen::VectorXd& y, int depth) const;
+    U::TreeNode* growBestFirst(const Eigen::MatrixXd& X, const Eigen::VectorXd& y);
+
+    // Binned training: rows[0, n) are the rows of the node, in their original order
+    struct BinnedFit;
+    U::TreeNode* buildBinnedTree(const BinnedFit& fit, int* rows, std::ptrdiff_t n, std::vector<double> histogram, int depth);
+    U::TreeNode* binnedNode(const BinnedFit& fit, const int* rows, std::ptrdiff_t n);
+    Split findBinnedSplit(const BinnedFit& fit, const U::TreeNode* node, const std::vector<double>& histogram, int depth) const;
+    std::ptrdiff_t partitionRows(const BinnedFit& fit, int* rows, std::ptrdiff_t n, const Split& split) const;
+    U::TreeNode* growBinnedBestFirst(const BinnedFit& fit, int* rows, std::ptrdiff_t n, std::vector<double> histogram);
+
+    void finishTree();         // Prunes with ccp_alpha (or only compacts) the grown tree
+    // compact() of a tree that had nodes_before nodes; leave_shared_arena: copy it out of a shared arena if it lost any
+    void compactTree(size_t nodes_before, bool leave_shared_arena);
+    void releaseDeadNodes(size_t nodes_before, bool leave_shared_arena); // Copies a pruned tree into a fresh private arena
+
+    // Shared by the double and float overloads
+    template <typename Scalar>
+    void checkInput(const U::DenseMatrix<Scalar>& X, const char* method) const;
+    template <typename Scalar>
+    U::DenseVector<Scalar> labels(const U::DenseMatrix<Scalar>& X) const;
+    template <typename Scalar>
+    U::DenseMatrix<Scalar> probabilities(const U::DenseMatrix<Scalar>& X) const;
+    void resetArena();
+    U::TreeNode* copyTree(const U::TreeNode* node);
 };
 
 } // namespace L
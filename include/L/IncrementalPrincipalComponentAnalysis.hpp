@@ -0,0 +1,54 @@
+#ifndef L_INCREMENTALPRINCIPALCOMPONENTANALYSIS_HPP
+#define L_INCREMENTALPRINCIPALCOMPONENTANALYSIS_HPP
+
+#include <Eigen/Dense>
+#include <functional>
+
+namespace L {
+
+// PCA over a stream of row batches: keeps a running mean and a rank-k SVD of the centered data
+class IncrementalPrincipalComponentAnalysis {
+public:
+    // Fills X with the next batch and returns false when the stream is exhausted
+    using ChunkReader = std::function<bool(Eigen::MatrixXd& X)>;
+
+    explicit IncrementalPrincipalComponentAnalysis(int n_components);
+
+    // Fold a batch of rows into the model
+    void partial_fit(const Eigen::MatrixXd& X);
+
+    // Forget every row seen so far; the next partial_fit starts a new model
+    void reset();
+
+    // partial_fit on every batch of a stream, e.g. a CSVChunkReader
+    void fit(const ChunkReader& next_chunk);
+
+    // Combine with a model fitted on other rows (another thread or shard)
+    void merge(const IncrementalPrincipalComponentAnalysis& other);
+
+    // Project data onto the principal axes
+    Eigen::MatrixXd transform(const Eigen::MatrixXd& X) const;
+
+    // Get the first n principal axes
+    Eigen::MatrixXd eigen_vectors(int n = 0) const;
+
+    // Get the first n eigenvalues of the covariance matrix (explained variances)
+    Eigen::VectorXd eigen_values(int n = 0) const;
+
+    Eigen::VectorXd mean() const { return mean_; }   // Running column means
+    double count() const { return count_; }           // Number of rows seen
+
+private:
+    // Replace the model by the top singular directions of the rows of stacked
+    void truncate(const Eigen::MatrixXd& stacked);
+
+    int n_components_;
+    double count_ = 0.0;              // Rows seen so far
+    Eigen::VectorXd mean_;            // Running column means
+    Eigen::MatrixXd components_;      // d x k principal axes
+    Eigen::VectorXd singular_values_; // Singular values of the centered data seen so far
+};
+
+} // namespace L
+
+#endif // L_INCREMENTALPRINCIPALCOMPONENTANALYSIS_HPP
@@ -0,0 +1,83 @@
+#ifndef L_KMEANS_HPP
+#define L_KMEANS_HPP
+
+#include <Eigen/Dense>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include "../U/ThreadPool.hpp"
+
+namespace L {
+
+// K-means clustering with k-means++ seeding, on dense rows (e.g. embeddings or PCA output)
+class KMeans {
+public:
+    // Fills X with the next batch and returns false when the stream is exhausted
+    using ChunkReader = std::function<bool(Eigen::MatrixXd& X)>;
+
+    enum class Algorithm {
+        Auto,    // Elkan from kMinElkanFeatures features while its bounds fit in kMaxElkanBounds, Lloyd otherwise
+        Lloyd,   // Distances to every centroid through one matrix product per block of rows
+        Elkan,   // Triangle-inequality bounds per row and centroid skip most distance computations
+    };
+
+    explicit KMeans(int n_clusters = 8, int max_iterations = 300, double tolerance = 1e-4, unsigned int seed = 0,
+                    Algorithm algorithm = Algorithm::Auto);
+
+    // Batch k-means until the centroids move less than tolerance times the mean feature variance
+    // (sum of squared shifts) or max_iterations is reached. Rows are processed in fixed blocks whose
+    // per-cluster sums are reduced in order, so the result does not depend on the execution policy.
+    void fit(const Eigen::MatrixXd& X);
+
+    // Mini-batch k-means for streams: rows of the batch pull their closest centroid with a per-centroid
+    // learning rate of 1 / (rows assigned to it so far). The first batch seeds the centroids and must
+    // hold at least n_clusters rows.
+    void partial_fit(const Eigen::MatrixXd& X);
+
+    // partial_fit on every batch of a stream, e.g. a CSVChunkReader
+    void fit(const ChunkReader& next_chunk);
+
+    Eigen::VectorXd predict(const Eigen::MatrixXd& X) const;     // Index of the closest centroid of each row
+    Eigen::MatrixXd transform(const Eigen::MatrixXd& X) const;   // Distance of each row to every centroid
+    Eigen::VectorXd fit_predict(const Eigen::MatrixXd& X);
+
+    Eigen::MatrixXd cluster_centers() const;  // One row per cluster
+    double inertia() const;                   // Sum of squared distances to the closest centroid: of X after fit, of the last batch after partial_fit
+    int iterations() const;                   // Iterations run by the last fit
+
+    // Plain-text persistence of the centroids (see U/Serialization.hpp)
+    void save(std::ostream& out) const;
+    void load(std::istream& in);
+
+    // Threads used per pass over the rows
+    void setExecutionPolicy(const U::ExecutionPolicy& policy);
+
+    // Elkan keeps rows x n_clusters lower bounds (8 bytes each); Auto falls back to Lloyd beyond this
+    static constexpr std::size_t kMaxElkanBounds = std::size_t(1) << 27;
+
+    // Below this many features a skipped distance saves less than Elkan's bookkeeping costs
+    static constexpr Eigen::Index kMinElkanFeatures = 16;
+
+private:
+    void seed(const Eigen::MatrixXd& X);   // k-means++
+    void lloyd(const Eigen::MatrixXd& X, double tolerance);
+    void elkan(const Eigen::MatrixXd& X, double tolerance);
+
+    // Closest centroid and squared distance of every row, and the total
+    double assign(const Eigen::MatrixXd& X, int* labels, double* distances) const;
+
+    int n_clusters_;
+    int max_iterations_;
+    double tolerance_;
+    unsigned int seed_;
+    Algorithm algorithm_;
+    Eigen::MatrixXd centroids_;          // k x d
+    Eigen::VectorXd counts_;             // Rows assigned to each centroid by partial_fit
+    double inertia_ = 0.0;
+    int iterations_ = 0;
+    U::ExecutionPolicy execution_policy_;
+};
+
+} // namespace L
+
+#endif // L_KMEANS_HPP
@@ -0,0 +1,45 @@
+#ifndef L_KNEIGHBORSCLASSIFIER_HPP
+#define L_KNEIGHBORSCLASSIFIER_HPP
+
+#include <Eigen/Dense>
+#include <vector>
+#include "../U/NeighborIndex.hpp"
+#include "../U/ThreadPool.hpp"
+
+namespace L {
+
+// k-nearest-neighbours classifier: fit() builds a KD-tree or ball tree over the training rows
+// (see U/NeighborIndex.hpp) and each prediction is a vote among the k closest of them
+class KNeighborsClassifier {
+public:
+    explicit KNeighborsClassifier(int n_neighbors = 5, U::NeighborWeights weights = U::NeighborWeights::Uniform,
+                                  U::NeighborIndex::Kind algorithm = U::NeighborIndex::Kind::Auto, int leaf_size = 40);
+
+    // Index the training rows; X can be dropped afterwards, the index keeps its own copy
+    void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y);
+
+    Eigen::VectorXd predict(const Eigen::MatrixXd& X) const;         // Winning class label; ties go to the smallest label
+    Eigen::MatrixXd predict_proba(const Eigen::MatrixXd& X) const;   // Share of the vote, one column per class in classes() order
+
+    // Nearest training rows of each row of X, closest first; n_neighbors = 0 uses the model's
+    U::Neighbors kneighbors(const Eigen::MatrixXd& X, int n_neighbors = 0) const;
+
+    std::vector<int> classes() const;      // Returns the class labels in column order
+
+    // Threads used to build the index and to run the queries; results do not depend on it
+    void setExecutionPolicy(const U::ExecutionPolicy& policy);
+
+private:
+    int n_neighbors_;
+    U::NeighborWeights weights_;
+    U::NeighborIndex::Kind algorithm_;
+    int leaf_size_;
+    U::NeighborIndex index_;
+    std::vector<int> labels_;              // Class column of every training row
+    std::vector<int> classes_;             // Sorted class labels
+    U::ExecutionPolicy execution_policy_;
+};
+
+} // namespace L
+
+#endif // L_KNEIGHBORSCLASSIFIER_HPP
@@ -0,0 +1,40 @@
+#ifndef L_KNEIGHBORSREGRESSOR_HPP
+#define L_KNEIGHBORSREGRESSOR_HPP
+
+#include <Eigen/Dense>
+#include "../U/NeighborIndex.hpp"
+#include "../U/ThreadPool.hpp"
+
+namespace L {
+
+// k-nearest-neighbours regression: the prediction is the (weighted) mean target of the k
+// closest training rows, found through the same KD-tree / ball tree as KNeighborsClassifier
+class KNeighborsRegressor {
+public:
+    explicit KNeighborsRegressor(int n_neighbors = 5, U::NeighborWeights weights = U::NeighborWeights::Uniform,
+                                 U::NeighborIndex::Kind algorithm = U::NeighborIndex::Kind::Auto, int leaf_size = 40);
+
+    // Index the training rows; X can be dropped afterwards, the index keeps its own copy
+    void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y);
+
+    Eigen::VectorXd predict(const Eigen::MatrixXd& X) const;
+
+    // Nearest training rows of each row of X, closest first; n_neighbors = 0 uses the model's
+    U::Neighbors kneighbors(const Eigen::MatrixXd& X, int n_neighbors = 0) const;
+
+    // Threads used to build the index and to run the queries; results do not depend on it
+    void setExecutionPolicy(const U::ExecutionPolicy& policy);
+
+private:
+    int n_neighbors_;
+    U::NeighborWeights weights_;
+    U::NeighborIndex::Kind algorithm_;
+    int leaf_size_;
+    U::NeighborIndex index_;
+    Eigen::VectorXd targets_;
+    U::ExecutionPolicy execution_policy_;
+};
+
+} // namespace L
+
+#endif // L_KNEIGHBORSREGRESSOR_HPP
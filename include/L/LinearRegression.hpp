@@ -2,21 +2,85 @@
 #define L_LINEARREGRESSION_HPP
 
 #include <Eigen/Dense>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include "../U/MatrixUtils.hpp"
+#include "../U/ThreadPool.hpp"
 
 namespace L {
 
 class LinearRegression {
 public:
-    LinearRegression();
+    // Statistiques suffisantes des moindres carrés, fusionnables entre blocs, threads et shards.
+    // Les moments sont centrés (formule de Chan) pour rester stables sur 10^8 lignes ; mémoire O(d²).
+    struct SufficientStatistics {
+        double count = 0.0;          // Nombre de lignes accumulées
+        Eigen::VectorXd mean_x;      // Moyenne de chaque feature
+        double mean_y = 0.0;         // Moyenne de la cible
+        Eigen::MatrixXd scatter_xx;  // Somme de (x - mean_x)(x - mean_x)^T
+        Eigen::VectorXd scatter_xy;  // Somme de (x - mean_x)(y - mean_y)
+        double scatter_yy = 0.0;     // Somme de (y - mean_y)^2
+
+        void update(const Eigen::MatrixXd& X, const Eigen::VectorXd& y);   // Ajoute un bloc de lignes
+        template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+        void update(const U::DenseMatrix<Scalar>& X, const U::DenseVector<Scalar>& y); // Lignes en float, accumulées en double
+        void merge(const SufficientStatistics& other);                      // Fusionne un autre accumulateur
+    };
+
+    // Lecteur par blocs : remplit X et y et renvoie false quand il n'y a plus de données
+    using ChunkReader = std::function<bool(Eigen::MatrixXd& X, Eigen::VectorXd& y)>;
+
+    // ridge_alpha > 0 : régularisation L2 (l'ordonnée n'est pas pénalisée)
+    // forgetting_factor < 1 : partial_fit oublie exponentiellement les anciens lots
+    explicit LinearRegression(double ridge_alpha = 0.0, double forgetting_factor = 1.0);
     void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y);    // Utilise Eigen pour les données d'entrée
+    void fit(const U::SparseMatrix& X, const Eigen::VectorXd& y);    // Données creuses (CSR), coût en O(nnz)
+    void fit(const ChunkReader& next_chunk);                         // Une seule passe sur un flux de blocs
+    void fit(const SufficientStatistics& statistics);                // Résout à partir de statistiques déjà accumulées
+    // Moindres carrés récursifs : O(d² k) par lot de k lignes ; un lot avec un autre nombre de features
+    // que le modèle déjà ajusté lève std::invalid_argument
+    void partial_fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y);
     Eigen::VectorXd predict(const Eigen::MatrixXd& X) const;         // Prédictions avec une matrice Eigen
+    Eigen::VectorXd predict(const U::SparseMatrix& X) const;         // Prédictions avec une matrice creuse
+
+    // Simple précision : X est lu en float (moitié moins de mémoire à parcourir) et les statistiques
+    // sont accumulées en double, donc les coefficients sont ceux du même X converti en double
+    template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+    void fit(const U::DenseMatrix<Scalar>& X, const U::DenseVector<Scalar>& y);
+    template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+    U::DenseVector<Scalar> predict(const U::DenseMatrix<Scalar>& X) const;
+
+    // Accumule les statistiques de X et y par blocs, fusionnés dans l'ordre : le résultat ne dépend pas du nombre de threads
+    static SufficientStatistics accumulate(const Eigen::MatrixXd& X, const Eigen::VectorXd& y,
+                                           const U::ExecutionPolicy& policy = U::ExecutionPolicy());
+    template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+    static SufficientStatistics accumulate(const U::DenseMatrix<Scalar>& X, const U::DenseVector<Scalar>& y,
+                                           const U::ExecutionPolicy& policy = U::ExecutionPolicy());
+
+    // Sauvegarde en texte du modèle ajusté, inverse des moindres carrés récursifs comprise (voir U/Serialization.hpp)
+    void save(std::ostream& out) const;
+    void load(std::istream& in);
+
+    // Threads utilisés par fit et predict (par défaut, le pool partagé de la bibliothèque)
+    void setExecutionPolicy(const U::ExecutionPolicy& policy);
 
     Eigen::VectorXd getCoefficients() const;  // Renvoie les coefficients (les pentes pour chaque feature)
     double getIntercept() const;              // Renvoie l'ordonnée à l'origine
     
 private:
+    // Partagés par les surcharges double et float
+    template <typename Matrix, typename Vector>
+    static SufficientStatistics accumulateRows(const Matrix& X, const Vector& y, const U::ExecutionPolicy& policy);
+    template <typename Matrix>
+    U::DenseVector<typename Matrix::Scalar> predictRows(const Matrix& X) const;
+
     Eigen::VectorXd coefficients; // Pentes pour chaque feature
     double intercept;             // Ordonnée à l'origine
+    double ridge_alpha;           // Coefficient de régularisation L2
+    double forgetting_factor;     // Facteur d'oubli des moindres carrés récursifs, dans (0, 1]
+    Eigen::MatrixXd rls_inverse;  // Inverse de [1, X]^T [1, X] (+ ridge), vide tant qu'elle n'est pas connue
+    U::ExecutionPolicy execution_policy; // Pool sur lequel tournent les boucles parallèles
 };
 
 } // namespace L
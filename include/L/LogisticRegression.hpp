@@ -2,28 +2,86 @@
 #define L_LOGISTICREGRESSION_HPP
 
 #include <Eigen/Dense>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include "../U/MatrixUtils.hpp"
+#include "../U/ThreadPool.hpp"
 
 namespace L {
 
 class LogisticRegression {
 public:
+    // Fills X and y with the next batch and returns false when the stream is exhausted
+    using ChunkReader = std::function<bool(Eigen::MatrixXd& X, Eigen::VectorXd& y)>;
+
     // Constructor with an optional threshold parameter
     LogisticRegression(double threshold = 0.5, bool optimize_threshold = false);
 
     void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, double learning_rate = 0.01, int iterations = 1000);
+    void fit(const U::SparseMatrix& X, const Eigen::VectorXd& y, double learning_rate = 0.01, int iterations = 1000); // Sparse (CSR) input, O(nnz) per iteration
+
+    // Mini-batch gradient descent: iterations steps on this batch, from the current coefficients
+    // (zeros before the first batch). The threshold is not re-optimized.
+    void partial_fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, double learning_rate = 0.01, int iterations = 1);
+    // One pass of partial_fit over a stream, e.g. an AsyncChunkLoader; starts from zeros unless warm start is set
+    void fit(const ChunkReader& next_chunk, double learning_rate = 0.01, int iterations = 1);
+
+    // Sums the gradient of a data-parallel fit over every process (e.g. with a ring allreduce): called
+    // each iteration with this shard's [X^T residuals, sum of residuals, rows], to be replaced in place
+    // by the totals over all shards
+    using GradientReducer = std::function<void(Eigen::VectorXd& sums)>;
+    // Data-parallel fit on one shard of the rows: every process calls it with the same learning rate
+    // and iterations and ends with the coefficients fit() finds on all the rows (up to the order of
+    // the sums). The threshold, which needs every row, is not optimized.
+    void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, const GradientReducer& reduce,
+             double learning_rate = 0.01, int iterations = 1000);
     Eigen::VectorXd predict(const Eigen::MatrixXd& X) const;         // Predictions using the set or optimized threshold
+    Eigen::VectorXd predict(const U::SparseMatrix& X) const;
     Eigen::VectorXd predict_proba(const Eigen::MatrixXd& X) const;   // Returns probabilities without threshold application
+    Eigen::VectorXd predict_proba(const U::SparseMatrix& X) const;
+
+    // Single-precision rows: each block of rows is scored in float, and the gradient of every
+    // block is accumulated in double, so the coefficients stay double
+    template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+    void fit(const U::DenseMatrix<Scalar>& X, const U::DenseVector<Scalar>& y, double learning_rate = 0.01, int iterations = 1000);
+    template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+    U::DenseVector<Scalar> predict(const U::DenseMatrix<Scalar>& X) const;
+    template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+    U::DenseVector<Scalar> predict_proba(const U::DenseMatrix<Scalar>& X) const;
 
     Eigen::VectorXd coefficients() const;  // Returns the coefficients (slopes for each feature)
     double intercept() const;              // Returns the intercept
     double threshold() const;              // Returns the threshold
+
+    // Plain-text persistence of the fitted model (see U/Serialization.hpp)
+    void save(std::ostream& out) const;
+    void load(std::istream& in);
+
+    // Threads used for the gradient and the scoring passes; results do not depend on it
+    void setExecutionPolicy(const U::ExecutionPolicy& policy);
+
+    // When enabled, fit() resumes gradient descent from the current coefficients instead of zeros
+    // (if the number of features matches), so a later fit with more iterations only runs the extra ones
+    void setWarmStart(bool warm_start);
 private:
-    void optimizeThreshold(const Eigen::MatrixXd& X, const Eigen::VectorXd& y); // Method to find the optimal threshold
+    // Shared by the dense, sparse and single-precision overloads
+    // incremental (partial_fit): start from the current coefficients and leave the threshold alone;
+    // reduce, if given, sums each gradient over the shards of a data-parallel fit
+    template <typename Matrix, typename Vector>
+    void gradientDescent(const Matrix& X, const Vector& y, double learning_rate, int iterations, bool incremental,
+                         const GradientReducer* reduce = nullptr);
+    template <typename Matrix>
+    U::DenseVector<typename Matrix::Scalar> probabilities(const Matrix& X) const;
+
+    void optimizeThreshold(const Eigen::VectorXd& probabilities, const Eigen::VectorXd& y); // Method to find the optimal threshold
 
     Eigen::VectorXd coefficients_; // Slopes for each feature
     double intercept_;             // Intercept
     double threshold_;             // Classification threshold, defaults to 0.5
     bool optimize_threshold_;      // Whether to find the optimal threshold during training
+    bool warm_start_ = false;      // Whether fit() starts from the fitted coefficients
+    U::ExecutionPolicy execution_policy_;
 };
 
 } // namespace L
@@ -0,0 +1,143 @@
+#ifndef L_MODELSELECTION_HPP
+#define L_MODELSELECTION_HPP
+
+#include <Eigen/Dense>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../U/ThreadPool.hpp"
+
+namespace L {
+
+// Hyperparameter values by name, e.g. {{"max_depth", 8}}
+using ParameterSet = std::map<std::string, double>;
+
+// Train and test rows of one fold, as indices into the original data
+struct Fold {
+    std::vector<Eigen::Index> train;
+    std::vector<Eigen::Index> test;
+};
+
+// Rows of X (or entries of y) picked by a fold, as an Eigen view: nothing is copied until it is assigned
+inline auto rowsOf(const Eigen::MatrixXd& X, const std::vector<Eigen::Index>& indices) {
+    return X(indices, Eigen::all);
+}
+inline auto rowsOf(const Eigen::VectorXd& y, const std::vector<Eigen::Index>& indices) {
+    return y(indices);
+}
+
+// Contiguous folds, optionally after shuffling the rows
+class KFold {
+public:
+    explicit KFold(int n_splits = 5, bool shuffle = false, unsigned int seed = 0);
+    std::vector<Fold> split(Eigen::Index n_rows) const;
+
+private:
+    int n_splits_;
+    bool shuffle_;
+    unsigned int seed_;
+};
+
+// Folds that keep the class proportions of y
+class StratifiedKFold {
+public:
+    explicit StratifiedKFold(int n_splits = 5, bool shuffle = false, unsigned int seed = 0);
+    std::vector<Fold> split(const Eigen::VectorXd& y) const;
+
+private:
+    int n_splits_;
+    bool shuffle_;
+    unsigned int seed_;
+};
+
+// Candidate values of each hyperparameter
+class ParameterGrid {
+public:
+    ParameterGrid& add(const std::string& name, std::vector<double> values);
+
+    std::vector<ParameterSet> configurations() const;                          // Every combination (grid search)
+    std::vector<ParameterSet> sample(size_t count, unsigned int seed = 0) const; // Distinct combinations drawn at random (random search)
+    size_t size() const;                                                        // Number of combinations
+
+private:
+    ParameterSet combination(size_t index) const;
+
+    std::vector<std::pair<std::string, std::vector<double>>> parameters_;
+};
+
+// A model built from one configuration, as seen by the search
+class SearchModel {
+public:
+    virtual ~SearchModel() = default;
+
+    // Train with a fraction budget in (0, 1] of the configured iterations. Iterative models
+    // warm-start: called again with a larger budget, they only run the extra iterations.
+    virtual void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, double budget) = 0;
+    virtual Eigen::VectorXd predict(const Eigen::MatrixXd& X) const = 0;
+
+    // Non-iterative models are trained on a budget fraction of the rows instead
+    virtual bool iterative() const { return false; }
+    virtual void setExecutionPolicy(const U::ExecutionPolicy&) {}
+};
+
+using ModelFactory = std::function<std::unique_ptr<SearchModel>(const ParameterSet& parameters)>;
+
+// Factories for the library models; parameters missing from the set keep the model defaults
+ModelFactory logisticRegressionFactory();   // learning_rate, iterations, threshold
+ModelFactory softmaxRegressionFactory();    // learning_rate, iterations, batch_size
+ModelFactory linearRegressionFactory();     // ridge_alpha
+ModelFactory decisionTreeFactory();         // max_depth, min_samples_split, min_samples_leaf, max_leaf_nodes, ccp_alpha
+
+// Scores, higher is better
+using Scorer = std::function<double(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true)>;
+double accuracyScore(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true);
+double r2Score(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true);
+double negativeMeanSquaredError(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true);
+
+struct CandidateResult {
+    ParameterSet parameters;
+    std::vector<double> fold_scores;   // At the largest budget the candidate reached
+    double mean_score = 0.0;
+    double std_score = 0.0;
+    double budget = 0.0;               // 1 unless successive halving dropped it earlier
+};
+
+struct SearchResult {
+    std::vector<CandidateResult> candidates;   // In the order they were given
+    size_t best_index = 0;                     // Best mean score at full budget, lowest index on ties
+
+    const CandidateResult& best() const { return candidates.at(best_index); }
+};
+
+// Grid or random search with cross-validation. Every (candidate, fold) job runs as a task on
+// the execution policy; with successive halving, candidates are trained on a small budget first
+// and only the best 1/factor of them move on to the next budget, up to the full one.
+class HyperparameterSearch {
+public:
+    HyperparameterSearch(ModelFactory factory, std::vector<ParameterSet> candidates, Scorer scorer = accuracyScore);
+
+    // Budgets min_budget, min_budget * factor, ... up to 1
+    void setSuccessiveHalving(int factor = 3, double min_budget = 1.0 / 9);
+    void setExecutionPolicy(const U::ExecutionPolicy& policy);
+
+    SearchResult fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, const std::vector<Fold>& folds) const;
+
+private:
+    ModelFactory factory_;
+    std::vector<ParameterSet> candidates_;
+    Scorer scorer_;
+    int factor_ = 3;
+    double min_budget_ = 1.0;   // 1 disables successive halving
+    U::ExecutionPolicy execution_policy_;
+};
+
+// Scores of one configuration on every fold, folds trained in parallel
+std::vector<double> crossValScore(const ModelFactory& factory, const ParameterSet& parameters, const Eigen::MatrixXd& X,
+                                  const Eigen::VectorXd& y, const std::vector<Fold>& folds, const Scorer& scorer = accuracyScore,
+                                  const U::ExecutionPolicy& policy = U::ExecutionPolicy());
+
+} // namespace L
+
+#endif // L_MODELSELECTION_HPP
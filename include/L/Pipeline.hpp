@@ -0,0 +1,137 @@
+#ifndef L_PIPELINE_HPP
+#define L_PIPELINE_HPP
+
+#include <Eigen/Dense>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "DataFrame.hpp"
+#include "DecisionTreeClassifier.hpp"
+#include "IncrementalPrincipalComponentAnalysis.hpp"
+#include "LinearRegression.hpp"
+#include "LogisticRegression.hpp"
+#include "PrincipalComponentAnalysis.hpp"
+#include "SoftmaxRegression.hpp"
+#include "../U/ThreadPool.hpp"
+
+namespace L {
+
+// DataFrame columns -> transforms -> estimator, with one fit/predict interface.
+//
+// After fit, consecutive affine transforms (PCA) are folded into one matrix, and when the
+// estimator is linear in its input (logistic, linear, softmax) that matrix is folded into the
+// estimator's weights too: scoring is then a single product per block of rows followed by the
+// link function. Inference streams blocks of rows from the input, so its memory is O(block)
+// besides the output, and no intermediate full-size matrix is built.
+class Pipeline {
+public:
+    // Common interface of the transform stages
+    class Transform {
+    public:
+        virtual ~Transform() = default;
+        virtual void fit(const Eigen::MatrixXd& X) = 0;
+        virtual Eigen::MatrixXd transform(const Eigen::MatrixXd& X) const = 0;
+
+        // Describe the fitted transform as X * weights + offset, or return false
+        virtual bool affine(Eigen::MatrixXd& /*weights*/, Eigen::RowVectorXd& /*offset*/) const { return false; }
+    };
+
+    // Common interface of the final stage
+    class Estimator {
+    public:
+        virtual ~Estimator() = default;
+        virtual void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) = 0;
+        virtual Eigen::VectorXd predict(const Eigen::MatrixXd& X) const = 0;
+        virtual Eigen::MatrixXd predict_proba(const Eigen::MatrixXd& X) const = 0;
+
+        // Describe the fitted model as link(X * weights + intercepts), or return false.
+        // The *FromScores methods apply the link to scores computed that way.
+        virtual bool linear(Eigen::MatrixXd& /*weights*/, Eigen::RowVectorXd& /*intercepts*/) const { return false; }
+        virtual Eigen::VectorXd predictFromScores(Eigen::MatrixXd& scores) const;
+        virtual Eigen::MatrixXd probaFromScores(Eigen::MatrixXd& scores) const;
+    };
+
+    // feature_columns: columns read from DataFrame inputs, in order
+    explicit Pipeline(std::vector<std::string> feature_columns = {});
+
+    // Append a transform built in place, e.g. addTransform<PrincipalComponentAnalysis>(2).
+    // The returned reference stays valid for the lifetime of the pipeline.
+    template <typename Model, typename... Args>
+    Model& addTransform(Args&&... args) {
+        auto model = std::make_shared<Model>(std::forward<Args>(args)...);
+        addTransform(wrap(model));
+        return *model;
+    }
+    void addTransform(std::unique_ptr<Transform> transform);
+
+    // Set the final stage, e.g. setEstimator<LogisticRegression>()
+    template <typename Model, typename... Args>
+    Model& setEstimator(Args&&... args) {
+        auto model = std::make_shared<Model>(std::forward<Args>(args)...);
+        setEstimator(wrap(model));
+        return *model;
+    }
+    void setEstimator(std::unique_ptr<Estimator> estimator);
+
+    // Fit every stage in order on the output of the previous one, then fuse
+    void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y);
+    void fit(const DataFrame& df, const std::string& target_column);
+
+    // Recompute the fused weights; call it after fitting or changing stages outside fit()
+    void fuse();
+
+    // Streamed over blocks of rows
+    Eigen::VectorXd predict(const Eigen::MatrixXd& X) const;
+    Eigen::VectorXd predict(const DataFrame& df) const;
+    Eigen::MatrixXd predict_proba(const Eigen::MatrixXd& X) const;
+    Eigen::MatrixXd predict_proba(const DataFrame& df) const;
+    Eigen::MatrixXd transform(const Eigen::MatrixXd& X) const;   // Output of the last transform
+    Eigen::MatrixXd transform(const DataFrame& df) const;
+
+    // True when predictions are a single product per block
+    bool fused() const { return fully_fused_; }
+
+    // Rows per streamed block
+    void setBlockSize(Eigen::Index block_rows);
+
+    // Threads used to score blocks; results do not depend on it
+    void setExecutionPolicy(const U::ExecutionPolicy& policy);
+
+private:
+    enum class Output { Predict, Proba, Transform };
+
+    static std::unique_ptr<Transform> wrap(std::shared_ptr<PrincipalComponentAnalysis> model);
+    static std::unique_ptr<Transform> wrap(std::shared_ptr<IncrementalPrincipalComponentAnalysis> model);
+    static std::unique_ptr<Estimator> wrap(std::shared_ptr<LogisticRegression> model);
+    static std::unique_ptr<Estimator> wrap(std::shared_ptr<LinearRegression> model);
+    static std::unique_ptr<Estimator> wrap(std::shared_ptr<SoftmaxRegression> model);
+    static std::unique_ptr<Estimator> wrap(std::shared_ptr<DecisionTreeClassifier> model);
+
+    // Scores n rows, fetching them block by block with block(begin, rows)
+    template <typename BlockSource>
+    Eigen::MatrixXd stream(Eigen::Index n, const BlockSource& block, Output output) const;
+    Eigen::MatrixXd scoreBlock(const Eigen::MatrixXd& X, Output output) const;
+    Eigen::MatrixXd applyTransforms(const Eigen::MatrixXd& X) const;
+    void requireFitted() const;
+
+    std::vector<std::string> feature_columns_;
+    std::vector<std::unique_ptr<Transform>> transforms_;
+    std::unique_ptr<Estimator> estimator_;
+
+    // Fused form: the affine prefix of the transforms, and the whole pipeline when the estimator is linear
+    size_t affine_stages_ = 0;
+    Eigen::MatrixXd affine_weights_;
+    Eigen::RowVectorXd affine_offset_;
+    bool fully_fused_ = false;
+    Eigen::MatrixXd fused_weights_;
+    Eigen::RowVectorXd fused_intercepts_;
+    bool ready_ = false;
+
+    Eigen::Index block_rows_ = 4096;
+    U::ExecutionPolicy execution_policy_;
+};
+
+} // namespace L
+
+#endif // L_PIPELINE_HPP
@@ -2,18 +2,54 @@
 #define L_PRINCIPALCOMPONENTANALYSIS_HPP
 
 #include <Eigen/Dense>
+#include <istream>
+#include <ostream>
+#include "../U/MatrixUtils.hpp"
 
 namespace L {
 
 class PrincipalComponentAnalysis {
 public:
-    PrincipalComponentAnalysis(const Eigen::MatrixXd& X);
+    // Eigen solver used by fit()
+    enum class Solver {
+        Auto,       // Picked from the shape of the data and the number of components
+        Full,       // Eigendecomposition of the d x d covariance matrix
+        Gram,       // Eigendecomposition of the n x n Gram matrix, cheaper when n < d
+        Randomized  // Randomized range finder and truncated SVD of the top components only
+    };
 
-    // Perform PCA
-    void transform();
+    // n_components = 0 keeps every component
+    explicit PrincipalComponentAnalysis(int n_components = 0, Solver solver = Solver::Auto);
 
-    // Get the first n principal components
-    Eigen::MatrixXd principal_components(int n = 0) const;
+    // Options of the randomized solver
+    void setRandomizedOptions(int oversamples = 10, int power_iterations = 4, unsigned int seed = 0);
+
+    // Learn the mean and the principal axes; the data itself is not kept.
+    // Sparse (CSR) input is centered implicitly and never densified.
+    void fit(const Eigen::MatrixXd& X);
+    void fit(const U::SparseMatrix& X);
+    // Same with the column means already known (e.g. from L::DataFrame::statistics), saving their pass over X
+    void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& mean);
+
+    // Project data onto the fitted principal axes with a single matrix product
+    Eigen::MatrixXd transform(const Eigen::MatrixXd& X) const;
+    Eigen::MatrixXd transform(const U::SparseMatrix& X) const;
+
+    // fit(X) followed by transform(X)
+    Eigen::MatrixXd fit_transform(const Eigen::MatrixXd& X);
+    Eigen::MatrixXd fit_transform(const U::SparseMatrix& X);
+
+    // Single-precision rows: fit widens one block of rows at a time and accumulates in double,
+    // transform projects in float onto the fitted axes
+    template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+    void fit(const U::DenseMatrix<Scalar>& X);
+    template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+    U::DenseMatrix<Scalar> transform(const U::DenseMatrix<Scalar>& X) const;
+    template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+    U::DenseMatrix<Scalar> fit_transform(const U::DenseMatrix<Scalar>& X);
+
+    // Column means of the training data
+    Eigen::VectorXd mean() const { return mean_; }
 
     // Get the first n eigenvectors of the covariance matrix
     Eigen::MatrixXd eigen_vectors(int n = 0) const;
@@ -21,9 +57,27 @@ public:
     // Get the first n eigenvalues of the covariance matrix
     Eigen::VectorXd eigen_values(int n = 0) const;
 
+    // Plain-text persistence of the fitted mean and axes (see U/Serialization.hpp)
+    void save(std::ostream& out) const;
+    void load(std::istream& in);
+
+    // Solver actually used by the last fit()
+    Solver solver() const { return solver_used_; }
+
 private:
-    Eigen::MatrixXd X_;                   // Centered data matrix
-    Eigen::MatrixXd principal_components_; // Projected data
+    template <typename Matrix>
+    void decompose(const Matrix& X, const Eigen::VectorXd* known_mean = nullptr);
+    template <typename Matrix>
+    U::DenseMatrix<typename Matrix::Scalar> project(const Matrix& X) const;
+
+    Eigen::VectorXd mean_;                // Column means
+    Eigen::RowVectorXd projected_mean_;   // mean^T * eigen_vectors, subtracted after projecting
+    int n_components_;                    // Number of components to compute, 0 for all
+    Solver solver_;                       // Requested solver
+    Solver solver_used_ = Solver::Auto;   // Solver picked by fit()
+    int oversamples_ = 10;                // Extra random directions of the range finder
+    int power_iterations_ = 4;            // Subspace iterations of the range finder
+    unsigned int seed_ = 0;               // Seed of the random test matrix
     Eigen::MatrixXd eigen_vectors_;        // Eigenvectors (principal axes)
     Eigen::VectorXd eigen_values_;         // Eigenvalues
 };
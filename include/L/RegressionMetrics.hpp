@@ -2,13 +2,51 @@
 #define L_REGRESSIONMETRICS_HPP
 
 #include <Eigen/Dense>
+#include "../U/MatrixUtils.hpp"
+#include "../U/ThreadPool.hpp"
 
 namespace L {
 
+// Streaming regression metrics: every batch is folded in one fused pass and
+// accumulators from different threads or shards can be merged
+class RegressionMetricsAccumulator {
+public:
+    void update(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true);
+    template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+    void update(const U::DenseVector<Scalar>& predictions, const U::DenseVector<Scalar>& y_true); // Summed in double
+    void merge(const RegressionMetricsAccumulator& other);
+
+    // Each metric throws std::logic_error while no value has been accumulated
+    double r2Score() const;             // R² Score
+    double meanAbsoluteError() const;   // MAE
+    double meanSquaredError() const;    // MSE
+    double rootMeanSquaredError() const; // RMSE
+
+    double count() const { return count_; }
+
+private:
+    friend class RegressionMetrics;
+
+    // Shared by the double and float overloads, on any vector expression
+    template <typename Vector>
+    void fold(const Vector& predictions, const Vector& y_true);
+    void checkNotEmpty() const;
+
+    double count_ = 0.0;
+    double mean_y_ = 0.0;               // Running mean of the actual values
+    double scatter_y_ = 0.0;            // Sum of squared deviations of the actual values from their mean
+    double sum_absolute_error_ = 0.0;
+    double sum_squared_error_ = 0.0;
+};
+
 class RegressionMetrics {
 public:
-    // Constructor that takes predictions and actual values
-    RegressionMetrics(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true);
+    // Constructor that takes non-empty predictions and actual values; chunks are accumulated in parallel and merged in order
+    RegressionMetrics(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true,
+                      const U::ExecutionPolicy& policy = U::ExecutionPolicy());
+    template <typename Scalar, U::IfSinglePrecision<Scalar> = 0>
+    RegressionMetrics(const U::DenseVector<Scalar>& predictions, const U::DenseVector<Scalar>& y_true,
+                      const U::ExecutionPolicy& policy = U::ExecutionPolicy());
 
     double r2Score() const;             // R² Score
     double meanAbsoluteError() const;   // MAE
@@ -16,10 +54,11 @@ public:
     double rootMeanSquaredError() const; // RMSE
 
 private:
-    Eigen::VectorXd predictions;
-    Eigen::VectorXd y_true;
+    template <typename Vector>
+    static RegressionMetricsAccumulator accumulate(const Vector& predictions, const Vector& y_true,
+                                                   const U::ExecutionPolicy& policy);
 
-    double mean(const Eigen::VectorXd& values) const;
+    RegressionMetricsAccumulator accumulator_;  // Filled once by the constructor
 };
 
 } // namespace L
@@ -0,0 +1,68 @@
+#ifndef L_SOFTMAXREGRESSION_HPP
+#define L_SOFTMAXREGRESSION_HPP
+
+#include <Eigen/Dense>
+#include <istream>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+#include "../U/ThreadPool.hpp"
+
+namespace L {
+
+// Multinomial logistic regression: all class logits come from one matrix-matrix product per block of rows
+class SoftmaxRegression {
+public:
+    // Constructor with the number of rows scored per matrix-matrix product
+    explicit SoftmaxRegression(int block_size = 1024);
+
+    // Batch gradient descent when batch_size is 0, mini-batch gradient descent otherwise.
+    // Every iteration is a single pass over X that updates all the classes at once.
+    void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, double learning_rate = 0.01, int iterations = 1000, int batch_size = 0);
+
+    // Streaming training: one gradient step on a batch. The full set of class labels
+    // must be given on the first call unless the model has already been fitted.
+    void partial_fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, double learning_rate = 0.01, const std::vector<int>& classes = {});
+
+    Eigen::VectorXd predict(const Eigen::MatrixXd& X) const;         // Most probable class label for each row
+    Eigen::MatrixXd predict_proba(const Eigen::MatrixXd& X) const;   // One column per class, in classes() order
+    double log_loss(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) const; // Mean cross-entropy
+
+    Eigen::MatrixXd coefficients() const;  // Returns the coefficients (one column of slopes per class)
+    Eigen::VectorXd intercept() const;     // Returns the intercepts (one per class)
+    std::vector<int> classes() const;      // Returns the class labels in column order
+
+    // Plain-text persistence of the fitted model (see U/Serialization.hpp)
+    void save(std::ostream& out) const;
+    void load(std::istream& in);
+
+    // Threads used per pass; blocks are reduced in row order, so results do not depend on it
+    void setExecutionPolicy(const U::ExecutionPolicy& policy);
+
+    // When enabled, fit() resumes from the current weights if the features and classes match
+    void setWarmStart(bool warm_start);
+
+private:
+    void initialize(const std::vector<int>& classes, Eigen::Index n_features);
+    std::vector<int> classIndices(const Eigen::VectorXd& y) const;
+    void checkInput(const Eigen::MatrixXd& X) const;   // Throws unless fitted on as many features as X has
+
+    // Logits of rows [begin, begin + rows), overwritten with their softmax probabilities
+    Eigen::VectorXd blockProbabilities(const Eigen::MatrixXd& X, Eigen::Index begin, Eigen::Index rows, Eigen::MatrixXd& probabilities) const;
+
+    // Cross-entropy gradient of rows [begin, begin + rows), added to grad_W and grad_b
+    void accumulateGradient(const Eigen::MatrixXd& X, const std::vector<int>& labels, Eigen::Index begin, Eigen::Index rows,
+                            Eigen::MatrixXd& grad_W, Eigen::RowVectorXd& grad_b) const;
+
+    Eigen::MatrixXd coefficients_;             // d x K slopes
+    Eigen::VectorXd intercept_;                // K intercepts
+    std::vector<int> classes_;                 // Sorted class labels
+    std::unordered_map<int, int> class_index_; // Class label -> column
+    int block_size_;                           // Rows per matrix-matrix product
+    bool warm_start_ = false;                  // Whether fit() starts from the fitted weights
+    U::ExecutionPolicy execution_policy_;      // Blocks run in parallel on this policy
+};
+
+} // namespace L
+
+#endif // L_SOFTMAXREGRESSION_HPP
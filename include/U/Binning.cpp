@@ -0,0 +1,200 @@
+#include "Binning.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace U {
+
+namespace {
+
+// Distinct non-NaN values of a column, sorted, or nothing when there are more than max_bins
+std::vector<double> distinctValues(const double* column, Eigen::Index rows, int max_bins) {
+    std::unordered_set<double> distinct;
+    for (Eigen::Index i = 0; i < rows; ++i) {
+        if (!std::isnan(column[i]) && distinct.insert(column[i]).second &&
+            distinct.size() > static_cast<std::size_t>(max_bins)) {
+            return {};
+        }
+    }
+    std::vector<double> values(distinct.begin(), distinct.end());
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+// Cut points at evenly spaced ranks of sorted (non-NaN) values, so each bin holds about the same number of rows.
+// With fewer values than bins the first ranks are 0 and skipped, as in DataFrame::ColumnStatistics::cutPoints.
+std::vector<double> quantileCuts(const std::vector<double>& sorted, int max_bins) {
+    std::vector<double> cuts;
+    const std::size_t n = sorted.size();
+    for (int k = 1; k <= max_bins; ++k) {
+        const std::size_t rank = (static_cast<std::size_t>(k) * n) / max_bins;
+        if (rank == 0) {
+            continue;
+        }
+        double cut = sorted[rank - 1];
+        if (cuts.empty() || cut > cuts.back()) {
+            cuts.push_back(cut);
+        }
+    }
+    return cuts;
+}
+
+// Rows used to estimate the quantiles: all of them, or a fixed random subset (Floyd's algorithm)
+std::vector<Eigen::Index> quantileRows(Eigen::Index rows) {
+    std::vector<Eigen::Index> sample;
+    if (rows <= BinnedMatrix::kQuantileSampleRows) {
+        return sample;   // Empty: every row
+    }
+    std::mt19937_64 generator(0);
+    std::unordered_set<Eigen::Index> chosen;
+    chosen.reserve(BinnedMatrix::kQuantileSampleRows);
+    for (Eigen::Index j = rows - BinnedMatrix::kQuantileSampleRows; j < rows; ++j) {
+        Eigen::Index candidate = std::uniform_int_distribution<Eigen::Index>(0, j)(generator);
+        chosen.insert(chosen.count(candidate) ? j : candidate);
+    }
+    sample.assign(chosen.begin(), chosen.end());
+    std::sort(sample.begin(), sample.end());
+    return sample;
+}
+
+// Bin of a value: the first cut point at or above it; NaN and values past the last cut go to the last bin.
+// A lower bound without branches on the comparisons, which std::lower_bound mispredicts on most values.
+int binOf(const std::vector<double>& cuts, double value) {
+    const double* base = cuts.data();
+    std::size_t n = cuts.size();
+    while (n > 1) {
+        std::size_t half = n / 2;
+        base = base[half] < value ? base + half : base;
+        n -= half;
+    }
+    std::size_t bin = static_cast<std::size_t>(base - cuts.data()) + (*base < value);
+    return bin == cuts.size() || std::isnan(value) ? static_cast<int>(cuts.size()) - 1 : static_cast<int>(bin);
+}
+
+} // namespace
+
+BinnedMatrix::BinnedMatrix(const Eigen::MatrixXd& X, int max_bins, const ExecutionPolicy& policy) {
+    U_TRACE_SCOPE("BinnedMatrix::fit");
+    if (max_bins < 2 || max_bins > kMaxBins) {
+        throw std::invalid_argument("max_bins must be between 2 and 65536.");
+    }
+
+    const std::vector<Eigen::Index> sample = quantileRows(X.rows());
+    cut_points_.resize(X.cols());
+    policy.parallel_for(0, X.cols(), 1, [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+        std::vector<double> values;
+        for (std::ptrdiff_t feature = first; feature < last; ++feature) {
+            const double* column = X.data() + feature * X.rows();
+
+            // Few distinct values (counted over every row): one bin each
+            std::vector<double> cuts = distinctValues(column, X.rows(), max_bins);
+            if (!cuts.empty()) {
+                cut_points_[feature] = std::move(cuts);
+                continue;
+            }
+
+            values.clear();
+            if (sample.empty()) {
+                values.assign(column, column + X.rows());
+            } else {
+                for (Eigen::Index row : sample) {
+                    values.push_back(column[row]);
+                }
+            }
+            values.erase(std::remove_if(values.begin(), values.end(), [](double value) { return std::isnan(value); }),
+                         values.end());
+            std::sort(values.begin(), values.end());
+
+            // The distinct count was over every row: a sample, once its NaNs are dropped, may hold
+            // fewer values than bins, which then become the cut points themselves
+            if (values.empty()) {
+                cuts = {std::numeric_limits<double>::infinity()};
+            } else if (values.size() <= static_cast<std::size_t>(max_bins)) {
+                cuts.assign(values.begin(), std::unique(values.begin(), values.end()));
+            } else {
+                cuts = quantileCuts(values, max_bins);
+            }
+
+            // The last bin reaches the largest value, sampled or not
+            for (Eigen::Index i = 0; i < X.rows() && !sample.empty(); ++i) {
+                if (column[i] > cuts.back()) {
+                    cuts.back() = column[i];
+                }
+            }
+            cut_points_[feature] = std::move(cuts);
+        }
+    });
+
+    bin_offsets_.assign(1, 0);
+    for (const auto& cuts : cut_points_) {
+        bin_offsets_.push_back(bin_offsets_.back() + static_cast<int>(cuts.size()));
+        wide_codes_ = wide_codes_ || cuts.size() > 256;
+    }
+    assign(X, policy);
+}
+
+BinnedMatrix::BinnedMatrix(const Eigen::MatrixXd& X, std::vector<std::vector<double>> cut_points,
+                           const ExecutionPolicy& policy)
+    : cut_points_(std::move(cut_points)) {
+    U_TRACE_SCOPE("BinnedMatrix::fit");
+    if (static_cast<Eigen::Index>(cut_points_.size()) != X.cols()) {
+        throw std::invalid_argument("Number of cut point lists does not match the number of features.");
+    }
+    bin_offsets_.assign(1, 0);
+    for (const auto& cuts : cut_points_) {
+        if (cuts.empty() || cuts.size() > static_cast<std::size_t>(kMaxBins) ||
+            std::adjacent_find(cuts.begin(), cuts.end(), std::greater_equal<double>()) != cuts.end()) {
+            throw std::invalid_argument("Cut points must be 1 to 65536 increasing values per feature.");
+        }
+        bin_offsets_.push_back(bin_offsets_.back() + static_cast<int>(cuts.size()));
+        wide_codes_ = wide_codes_ || cuts.size() > 256;
+    }
+    assign(X, policy);
+}
+
+BinnedMatrix BinnedMatrix::transform(const Eigen::MatrixXd& X, const ExecutionPolicy& policy) const {
+    U_TRACE_SCOPE("BinnedMatrix::transform");
+    if (X.cols() != cols()) {
+        throw std::invalid_argument("Number of features does not match the binned matrix.");
+    }
+    BinnedMatrix binned;
+    binned.wide_codes_ = wide_codes_;
+    binned.cut_points_ = cut_points_;
+    binned.bin_offsets_ = bin_offsets_;
+    binned.assign(X, policy);
+    return binned;
+}
+
+void BinnedMatrix::assign(const Eigen::MatrixXd& X, const ExecutionPolicy& policy) {
+    rows_ = X.rows();
+    narrow_.clear();
+    wide_.clear();
+    if (wide_codes_) {
+        wide_.resize(static_cast<std::size_t>(X.size()));
+    } else {
+        narrow_.resize(static_cast<std::size_t>(X.size()));
+    }
+    U_TRACE_BYTES("BinnedMatrix allocated", bytes());
+
+    policy.parallel_for(0, X.cols(), 1, [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+        for (std::ptrdiff_t feature = first; feature < last; ++feature) {
+            const std::vector<double>& cuts = cut_points_[feature];
+            const double* column = X.data() + feature * X.rows();
+            for (Eigen::Index i = 0; i < X.rows(); ++i) {
+                int code = binOf(cuts, column[i]);
+                if (wide_codes_) {
+                    wide_[feature * rows_ + i] = static_cast<std::uint16_t>(code);
+                } else {
+                    narrow_[feature * rows_ + i] = static_cast<std::uint8_t>(code);
+                }
+            }
+        }
+    });
+}
+
+} // namespace U
@@ -0,0 +1,81 @@
+#ifndef U_BINNING_HPP
+#define U_BINNING_HPP
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <vector>
+#include "ThreadPool.hpp"
+
+namespace U {
+
+// Feature matrix quantized once into per-feature quantile bins, for the tree learners.
+// Codes are stored column-major in 1 byte per cell (up to 256 bins per feature) or 2 bytes
+// (up to 65536), i.e. 1/8 or 1/4 of the double matrix, and the raw matrix can be dropped.
+//
+// Bin b of a feature holds the values in (cut(b - 1), cut(b)], so "bin <= b" is the same
+// test as "value <= cut(b)" and a tree split on bins applies unchanged to raw rows. When a
+// feature has no more distinct values than bins, every distinct value gets its own bin and
+// the candidate splits are exactly those of a search on the raw values.
+class BinnedMatrix {
+public:
+    BinnedMatrix() = default;
+
+    // Learn the cut points of every feature and bin X with them. Distinct values are counted over
+    // every row; quantiles are taken over all the rows, or over a fixed random sample of
+    // kQuantileSampleRows rows on larger inputs. All-NaN features get a single bin.
+    explicit BinnedMatrix(const Eigen::MatrixXd& X, int max_bins = 256, const ExecutionPolicy& policy = ExecutionPolicy());
+
+    // Bin X with cut points computed beforehand (e.g. L::DataFrame::ColumnStatistics::cutPoints),
+    // skipping both passes over the columns; each feature needs 1 to kMaxBins increasing cut points
+    BinnedMatrix(const Eigen::MatrixXd& X, std::vector<std::vector<double>> cut_points,
+                 const ExecutionPolicy& policy = ExecutionPolicy());
+
+    // Bin other rows (e.g. a validation set) with the cut points of this matrix; values above
+    // the last cut point, and NaN, go to the last bin
+    BinnedMatrix transform(const Eigen::MatrixXd& X, const ExecutionPolicy& policy = ExecutionPolicy()) const;
+
+    Eigen::Index rows() const { return rows_; }
+    Eigen::Index cols() const { return static_cast<Eigen::Index>(cut_points_.size()); }
+
+    int binCount(Eigen::Index feature) const { return static_cast<int>(cut_points_[feature].size()); }
+    int totalBins() const { return bin_offsets_.empty() ? 0 : bin_offsets_.back(); }
+    int binOffset(Eigen::Index feature) const { return bin_offsets_[feature]; }   // First bin of the feature among all bins
+
+    // Upper edge of every bin; the last one is the largest value seen when fitting
+    const std::vector<double>& cutPoints(Eigen::Index feature) const { return cut_points_[feature]; }
+    double threshold(Eigen::Index feature, int bin) const { return cut_points_[feature][bin]; }
+
+    int bin(Eigen::Index row, Eigen::Index feature) const {
+        return wide() ? wide_[feature * rows_ + row] : narrow_[feature * rows_ + row];
+    }
+
+    // Codes of one feature, contiguous over the rows: f(const std::uint8_t*) or f(const std::uint16_t*)
+    template <typename Function>
+    void withColumn(Eigen::Index feature, Function&& f) const {
+        if (wide()) {
+            f(wide_.data() + feature * rows_);
+        } else {
+            f(narrow_.data() + feature * rows_);
+        }
+    }
+
+    bool wide() const { return wide_codes_; }   // 2 bytes per code
+    std::size_t bytes() const { return narrow_.size() * sizeof(std::uint8_t) + wide_.size() * sizeof(std::uint16_t); }
+
+    static constexpr int kMaxBins = 65536;
+    static constexpr Eigen::Index kQuantileSampleRows = 1 << 18;
+
+private:
+    void assign(const Eigen::MatrixXd& X, const ExecutionPolicy& policy);
+
+    Eigen::Index rows_ = 0;
+    bool wide_codes_ = false;
+    std::vector<std::vector<double>> cut_points_;
+    std::vector<int> bin_offsets_;          // Prefix sums of the bin counts, cols() + 1 entries
+    std::vector<std::uint8_t> narrow_;
+    std::vector<std::uint16_t> wide_;
+};
+
+} // namespace U
+
+#endif // U_BINNING_HPP
@@ -0,0 +1,147 @@
+// Kernel bodies shared by Kernels.cpp, KernelsAVX2.cpp and KernelsAVX512.cpp, each compiled with
+// its own instruction set. Plain loops over raw arrays only: any inline function from a shared
+// header (Eigen, the standard library) would be emitted once per instruction set and the linker
+// could keep a wide copy for the baseline callers.
+//
+// Each including file defines ML_CPP_KERNEL_ISA, the name of its table, first.
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace {
+
+// The C functions, not the std:: overloads, which are inline functions of a shared header
+double expOf(double z) {
+    return exp(z);
+}
+
+float expOf(float z) {
+    return expf(z);
+}
+
+template <typename T>
+void sigmoidAffine(const T* X, ptrdiff_t rows, ptrdiff_t cols, ptrdiff_t ld, const T* weights, T bias, T* out) {
+    // Column by column, so the inner loop runs down contiguous rows and vectorizes;
+    // every row still sums its features in order
+    for (ptrdiff_t i = 0; i < rows; ++i) {
+        out[i] = 0;
+    }
+    for (ptrdiff_t j = 0; j < cols; ++j) {
+        const T* column = X + j * ld;
+        const T w = weights[j];
+        for (ptrdiff_t i = 0; i < rows; ++i) {
+            out[i] += column[i] * w;
+        }
+    }
+    for (ptrdiff_t i = 0; i < rows; ++i) {
+        out[i] = 1 / (1 + expOf(-(out[i] + bias)));
+    }
+}
+
+// 1 - sum_k (counts[k] / size)^2, or 1 for an empty side
+double gini(const double* counts, int n_classes, double size) {
+    double impurity = 1.0;
+    if (size > 0) {
+        for (int k = 0; k < n_classes; ++k) {
+            double p = counts[k] / size;
+            impurity -= p * p;
+        }
+    }
+    return impurity;
+}
+
+bool giniSweep(const double* sorted_values, const int* sorted_labels, ptrdiff_t n, int n_classes, ptrdiff_t min_leaf,
+               double* counts, double& best_gini, double& best_threshold) {
+    double* left = counts;
+    double* right = counts + n_classes;
+    for (int k = 0; k < n_classes; ++k) {
+        left[k] = 0.0;
+        right[k] = 0.0;
+    }
+    for (ptrdiff_t i = 0; i < n; ++i) {
+        right[sorted_labels[i]] += 1.0;
+    }
+
+    const double total = static_cast<double>(n);
+    bool improved = false;
+    ptrdiff_t i = 0;
+    while (i < n) {
+        // Move every row with this value to the left side
+        const double threshold = sorted_values[i];
+        for (; i < n && sorted_values[i] == threshold; ++i) {
+            left[sorted_labels[i]] += 1.0;
+            right[sorted_labels[i]] -= 1.0;
+        }
+
+        if (i < min_leaf || n - i < min_leaf) {
+            continue;
+        }
+        double left_size = static_cast<double>(i);
+        double right_size = total - left_size;
+        double weighted = (left_size / total) * gini(left, n_classes, left_size) +
+                          (right_size / total) * gini(right, n_classes, right_size);
+        if (weighted < best_gini) {
+            best_gini = weighted;
+            best_threshold = threshold;
+            improved = true;
+        }
+    }
+    return improved;
+}
+
+template <typename T>
+void traverseTree(const int* feature, const double* threshold, const int* left, const int* right, int depth,
+                  const T* X, ptrdiff_t rows, ptrdiff_t ld, int* leaves) {
+    // Rows descend one level at a time in blocks that stay in L1, so the loop over rows vectorizes
+    // (with gathers where the instruction set has them); leaves point to themselves
+    const ptrdiff_t kBlock = 256;
+    for (ptrdiff_t begin = 0; begin < rows; begin += kBlock) {
+        ptrdiff_t end = begin + kBlock < rows ? begin + kBlock : rows;
+        for (ptrdiff_t i = begin; i < end; ++i) {
+            leaves[i] = 0;
+        }
+        for (int level = 0; level < depth; ++level) {
+            for (ptrdiff_t i = begin; i < end; ++i) {
+                int node = leaves[i];
+                leaves[i] = X[i + feature[node] * ld] <= threshold[node] ? left[node] : right[node];
+            }
+        }
+    }
+}
+
+void squaredDistances(const double* X, ptrdiff_t rows, ptrdiff_t cols, ptrdiff_t ld, const double* query, double* out) {
+    // Column by column, so the inner loop runs down contiguous rows and vectorizes;
+    // every row still sums its features in order
+    for (ptrdiff_t i = 0; i < rows; ++i) {
+        out[i] = 0;
+    }
+    for (ptrdiff_t j = 0; j < cols; ++j) {
+        const double* column = X + j * ld;
+        const double q = query[j];
+        for (ptrdiff_t i = 0; i < rows; ++i) {
+            const double difference = column[i] - q;
+            out[i] += difference * difference;
+        }
+    }
+}
+
+template <typename T>
+void unpackBits(const uint64_t* words, int bits, int64_t base, ptrdiff_t first, ptrdiff_t count, T* out) {
+    // A value may straddle two words; the spare word lets every value read both, so the loop has no
+    // branch and vectorizes (with gathers where the instruction set has them). The double shift of the
+    // high word keeps every shift below 64 when the value starts at bit 0.
+    const uint64_t mask = bits == 64 ? ~uint64_t(0) : (uint64_t(1) << bits) - 1;
+    for (ptrdiff_t i = 0; i < count; ++i) {
+        const uint64_t bit = static_cast<uint64_t>(first + i) * static_cast<uint64_t>(bits);
+        const uint64_t word = bit >> 6;
+        const unsigned shift = static_cast<unsigned>(bit & 63);
+        const uint64_t value = ((words[word] >> shift) | ((words[word + 1] << 1) << (63 - shift))) & mask;
+        out[i] = static_cast<T>(static_cast<int64_t>(static_cast<uint64_t>(base) + value));
+    }
+}
+
+const U::KernelTable kTable = {ML_CPP_KERNEL_ISA, sigmoidAffine<double>, sigmoidAffine<float>, giniSweep,
+                               traverseTree<double>, traverseTree<float>, squaredDistances,
+                               unpackBits<double>, unpackBits<float>};
+
+} // namespace
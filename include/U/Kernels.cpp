@@ -0,0 +1,116 @@
+#include "Kernels.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#define ML_CPP_KERNEL_ISA "baseline"
+#include "KernelBodies.inl"
+
+namespace U {
+
+namespace detail {
+
+const KernelTable* baselineKernels() {
+    return &kTable;
+}
+
+// The wider tables live in their own files, compiled only when CMake found the compiler flags
+#ifndef ML_CPP_KERNELS_AVX2
+const KernelTable* avx2Kernels() {
+    return nullptr;
+}
+#endif
+
+#ifndef ML_CPP_KERNELS_AVX512
+const KernelTable* avx512Kernels() {
+    return nullptr;
+}
+#endif
+
+} // namespace detail
+
+namespace {
+
+bool cpuSupports(const char* isa) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (std::strcmp(isa, "avx2") == 0) {
+        return __builtin_cpu_supports("avx2");
+    }
+    if (std::strcmp(isa, "avx512") == 0) {
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl") &&
+               __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512dq");
+    }
+#endif
+    return std::strcmp(isa, "baseline") == 0;
+}
+
+// requested: an instruction set name, or null for the widest one available
+const KernelTable* select(const char* requested) {
+    struct Candidate {
+        const char* isa;
+        const KernelTable* table;
+    };
+    // Widest first
+    const Candidate candidates[] = {
+        {"avx512", detail::avx512Kernels()},
+        {"avx2", detail::avx2Kernels()},
+        {"baseline", detail::baselineKernels()},
+    };
+
+    for (const Candidate& candidate : candidates) {
+        if (requested && std::strcmp(requested, candidate.isa) != 0) {
+            continue;
+        }
+        if (candidate.table && cpuSupports(candidate.isa)) {
+            return candidate.table;
+        }
+    }
+    // Unknown or unsupported request
+    return requested ? select(nullptr) : detail::baselineKernels();
+}
+
+} // namespace
+
+const KernelTable& kernels() {
+    static const KernelTable* table = select(std::getenv("ML_CPP_ISA"));
+    return *table;
+}
+
+bool parseNumber(const char* begin, const char* end, double& value) {
+    while (begin < end && (*begin == ' ' || *begin == '\t')) {
+        ++begin;
+    }
+    while (end > begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) {
+        --end;
+    }
+    if (begin < end && *begin == '+') {
+        ++begin;
+    }
+    if (begin == end) {
+        return false;
+    }
+    auto [parsed, error] = std::from_chars(begin, end, value);
+    return error == std::errc() && parsed == end;
+}
+
+std::size_t parseFields(const char* begin, const char* end, char delimiter, double* out, std::size_t capacity) {
+    std::size_t fields = 0;
+    while (true) {
+        const char* separator = static_cast<const char*>(std::memchr(begin, delimiter, end - begin));
+        const char* field_end = separator ? separator : end;
+        if (fields < capacity) {
+            double value;
+            out[fields] = parseNumber(begin, field_end, value) ? value : std::numeric_limits<double>::quiet_NaN();
+        }
+        ++fields;
+        if (!separator) {
+            return fields;
+        }
+        begin = separator + 1;
+    }
+}
+
+} // namespace U
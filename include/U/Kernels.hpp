@@ -0,0 +1,71 @@
+#ifndef U_KERNELS_HPP
+#define U_KERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace U {
+
+// Hot numeric kernels, compiled once per instruction set (baseline, AVX2, AVX-512) and picked
+// at load time from what the CPU supports, so one portable binary runs the widest version.
+// The kernel files are built without floating-point contraction: every version returns
+// bit-identical results, only faster.
+struct KernelTable {
+    const char* isa;   // "baseline", "avx2" or "avx512"
+
+    // out[i] = sigmoid(bias + sum_j X[i + j * ld] * weights[j]) for a column-major block of rows
+    void (*sigmoid_affine)(const double* X, std::ptrdiff_t rows, std::ptrdiff_t cols, std::ptrdiff_t ld,
+                           const double* weights, double bias, double* out);
+    void (*sigmoid_affine_f32)(const float* X, std::ptrdiff_t rows, std::ptrdiff_t cols, std::ptrdiff_t ld,
+                               const float* weights, float bias, float* out);
+
+    // Sweep the distinct values of one feature in ascending order, with the rows sorted by value and
+    // their labels as class indices in [0, n_classes). Left of threshold t are the rows with value <= t;
+    // only thresholds leaving at least min_leaf (>= 1) rows on each side are candidates.
+    // Updates best_gini / best_threshold when a threshold has a strictly lower weighted Gini impurity,
+    // the first one on ties, and returns whether it did. counts is scratch space for 2 * n_classes entries.
+    bool (*gini_sweep)(const double* sorted_values, const int* sorted_labels, std::ptrdiff_t n, int n_classes,
+                       std::ptrdiff_t min_leaf, double* counts, double& best_gini, double& best_threshold);
+
+    // Leaf reached by each row of a column-major block, in a tree flattened into arrays where leaves
+    // point to themselves (see TreeUtils::flatten); depth is the number of levels to descend
+    void (*traverse_tree)(const int* feature, const double* threshold, const int* left, const int* right, int depth,
+                          const double* X, std::ptrdiff_t rows, std::ptrdiff_t ld, int* leaves);
+    // Same on single-precision rows; the thresholds stay in double, so a float row reaches the
+    // same leaf as the same row widened to double
+    void (*traverse_tree_f32)(const int* feature, const double* threshold, const int* left, const int* right, int depth,
+                              const float* X, std::ptrdiff_t rows, std::ptrdiff_t ld, int* leaves);
+
+    // out[i] = sum_j (X[i + j * ld] - query[j])^2 for a column-major block of rows
+    void (*squared_distances)(const double* X, std::ptrdiff_t rows, std::ptrdiff_t cols, std::ptrdiff_t ld,
+                              const double* query, double* out);
+
+    // out[i] = base + (value first + i of the bits-wide unsigned values packed back to back, lowest bit
+    // first, into words), with the integer sum wrapping; words holds one spare word after the last value
+    void (*unpack_bits)(const std::uint64_t* words, int bits, std::int64_t base, std::ptrdiff_t first,
+                        std::ptrdiff_t count, double* out);
+    void (*unpack_bits_f32)(const std::uint64_t* words, int bits, std::int64_t base, std::ptrdiff_t first,
+                            std::ptrdiff_t count, float* out);
+};
+
+// Table selected on first use: the widest instruction set the CPU supports, or the one named
+// by the ML_CPP_ISA environment variable (baseline, avx2, avx512) if the CPU supports it
+const KernelTable& kernels();
+
+// Parse the numeric fields of a delimited line into out (at most capacity); fields that are not
+// a number as a whole (surrounding spaces allowed) are NaN. Returns the number of fields.
+std::size_t parseFields(const char* begin, const char* end, char delimiter, double* out, std::size_t capacity);
+
+// Parse a whole field as a number; false if anything but spaces surrounds it
+bool parseNumber(const char* begin, const char* end, double& value);
+
+namespace detail {
+// Per instruction set tables; the wider ones are null when the compiler cannot target them
+const KernelTable* baselineKernels();
+const KernelTable* avx2Kernels();
+const KernelTable* avx512Kernels();
+} // namespace detail
+
+} // namespace U
+
+#endif // U_KERNELS_HPP
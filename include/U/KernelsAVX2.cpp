@@ -0,0 +1,15 @@
+// Kernels compiled for AVX2 (see KernelBodies.inl); CMake only builds this file when the compiler supports it
+#include "Kernels.hpp"
+
+#define ML_CPP_KERNEL_ISA "avx2"
+#include "KernelBodies.inl"
+
+namespace U {
+namespace detail {
+
+const KernelTable* avx2Kernels() {
+    return &kTable;
+}
+
+} // namespace detail
+} // namespace U
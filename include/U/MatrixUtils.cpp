@@ -1,5 +1,4 @@
-#include <unordered_map>
-#include <Eigen/Dense>
+#include "MatrixUtils.hpp"
 
 namespace U {
 
@@ -21,4 +20,16 @@ namespace U {
         return mode;
     }
 
-}
\ No newline at end of file
+    Eigen::VectorXd softmaxRows(Eigen::MatrixXd& logits) {
+        // Shift every row by its max so that exp() never overflows
+        Eigen::VectorXd row_max = logits.rowwise().maxCoeff();
+        logits.colwise() -= row_max;
+        logits = logits.array().exp();
+
+        Eigen::VectorXd row_sum = logits.rowwise().sum();
+        logits.array().colwise() /= row_sum.array();
+
+        return row_max.array() + row_sum.array().log();
+    }
+
+}
@@ -1,9 +1,35 @@
+#ifndef U_MATRIXUTILS_HPP
+#define U_MATRIXUTILS_HPP
+
+#include <type_traits>
 #include <unordered_map>
 #include <Eigen/Dense>
+#include <Eigen/Sparse>
 
 namespace U {
 
+    // Compressed sparse row matrix accepted by the linear models
+    using SparseMatrix = Eigen::SparseMatrix<double, Eigen::RowMajor>;
+
+    // Dense matrix and vector of a given scalar type
+    template <typename Scalar>
+    using DenseMatrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+    template <typename Scalar>
+    using DenseVector = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+
+    // The single-precision overloads are member templates enabled for float only: a template
+    // matches an Eigen::MatrixXf as is, so expressions (blocks, products) still convert to the
+    // double overloads instead of making the call ambiguous
+    template <typename Scalar>
+    using IfSinglePrecision = std::enable_if_t<std::is_same_v<Scalar, float>, int>;
+
     // Function to calculate mode
     int computeMode(const Eigen::VectorXd& y);
 
-}
\ No newline at end of file
+    // Row-wise softmax computed in place with the max-shift trick.
+    // Returns the row-wise log-sum-exp of the original logits.
+    Eigen::VectorXd softmaxRows(Eigen::MatrixXd& logits);
+
+}
+
+#endif // U_MATRIXUTILS_HPP
@@ -0,0 +1,269 @@
+#include "NeighborIndex.hpp"
+#include "Kernels.hpp"
+#include "Trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace U {
+
+namespace {
+
+// Below this many rows both subtrees are built on the current thread
+constexpr int kParallelBuildRows = 1 << 15;
+
+// Query rows per parallel chunk
+constexpr std::ptrdiff_t kQueryGrain = 64;
+
+} // namespace
+
+void neighborWeights(const Neighbors& neighbors, Eigen::Index row, NeighborWeights weights, double* out) {
+    const Eigen::Index k = neighbors.indices.cols();
+    int exact = 0;
+    for (Eigen::Index m = 0; m < k; ++m) {
+        exact += neighbors.distances(row, m) == 0.0;
+    }
+    double total = 0.0;
+    for (Eigen::Index m = 0; m < k; ++m) {
+        const double distance = neighbors.distances(row, m);
+        out[m] = weights == NeighborWeights::Uniform ? 1.0 : exact > 0 ? (distance == 0.0 ? 1.0 : 0.0) : 1.0 / distance;
+        total += out[m];
+    }
+    for (Eigen::Index m = 0; m < k; ++m) {
+        out[m] /= total;
+    }
+}
+
+NeighborIndex::NeighborIndex(const Eigen::MatrixXd& X, Kind kind, int leaf_size, const ExecutionPolicy& policy) {
+    U_TRACE_SCOPE("NeighborIndex::build");
+    if (X.rows() == 0) {
+        throw std::invalid_argument("Cannot build a neighbor index on an empty matrix.");
+    }
+    if (X.rows() > std::numeric_limits<int>::max()) {
+        throw std::invalid_argument("Too many rows for a neighbor index.");
+    }
+    if (leaf_size < 1) {
+        throw std::invalid_argument("leaf_size must be positive.");
+    }
+    kind_ = kind != Kind::Auto ? kind : X.cols() <= kMaxKDTreeFeatures ? Kind::KDTree : Kind::BallTree;
+
+    // Levels until the leaves hold at most leaf_size rows; midpoint splits keep every level complete.
+    // The smallest node at depth d has n >> d rows, and no level is added that would leave one empty,
+    // so for n close to a power of two times leaf_size some leaves hold more than leaf_size rows.
+    const std::ptrdiff_t n = X.rows();
+    int levels = 1;
+    while (levels < 31 && (n >> levels) > 0 && (n + (std::ptrdiff_t(1) << (levels - 1)) - 1) >> (levels - 1) > leaf_size) {
+        ++levels;
+    }
+    const int nodes = (1 << levels) - 1;
+    node_begin_.assign(nodes, 0);
+    node_end_.assign(nodes, 0);
+    node_end_[0] = static_cast<int>(n);
+    for (int node = 0; 2 * node + 2 < nodes; ++node) {
+        const int middle = node_begin_[node] + (node_end_[node] - node_begin_[node]) / 2;
+        node_begin_[2 * node + 1] = node_begin_[node];
+        node_end_[2 * node + 1] = middle;
+        node_begin_[2 * node + 2] = middle;
+        node_end_[2 * node + 2] = node_end_[node];
+    }
+
+    order_.resize(n);
+    std::iota(order_.begin(), order_.end(), 0);
+    buildNode(X, 0, policy);
+
+    // Rows in tree order, so each node covers a contiguous block of every column
+    points_.resize(n, X.cols());
+    policy.parallel_for(0, X.cols(), 1, [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+        for (std::ptrdiff_t j = first; j < last; ++j) {
+            for (std::ptrdiff_t i = 0; i < n; ++i) {
+                points_(i, j) = X(order_[i], j);
+            }
+        }
+    });
+    U_TRACE_BYTES("NeighborIndex allocated", points_.size() * sizeof(double));
+
+    // Bounds from the leaves up, one level at a time
+    if (kind_ == Kind::KDTree) {
+        lower_.resize(X.cols(), nodes);
+        upper_.resize(X.cols(), nodes);
+    } else {
+        centers_.resize(X.cols(), nodes);
+        radius_.assign(nodes, 0.0);
+    }
+    for (int level = levels - 1; level >= 0; --level) {
+        const int first = (1 << level) - 1;
+        policy.parallel_for(first, 2 * first + 1, 16, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+            for (std::ptrdiff_t node = begin; node < end; ++node) {
+                boundNode(static_cast<int>(node));
+            }
+        });
+    }
+}
+
+void NeighborIndex::buildNode(const Eigen::MatrixXd& X, int node, const ExecutionPolicy& policy) {
+    const int left = 2 * node + 1;
+    if (left >= nodeCount()) {
+        return;
+    }
+    const int begin = node_begin_[node];
+    const int end = node_end_[node];
+
+    // Split on the feature with the largest spread, at the median row
+    Eigen::Index split_feature = 0;
+    double widest = -1.0;
+    for (Eigen::Index j = 0; j < X.cols(); ++j) {
+        double low = std::numeric_limits<double>::infinity();
+        double high = -std::numeric_limits<double>::infinity();
+        for (int i = begin; i < end; ++i) {
+            low = std::min(low, X(order_[i], j));
+            high = std::max(high, X(order_[i], j));
+        }
+        if (high - low > widest) {
+            widest = high - low;
+            split_feature = j;
+        }
+    }
+    std::nth_element(order_.begin() + begin, order_.begin() + node_end_[left], order_.begin() + end,
+                     [&](int a, int b) { return X(a, split_feature) < X(b, split_feature); });
+
+    if (end - begin >= kParallelBuildRows) {
+        policy.parallel_for(0, 2, 1, [&](std::ptrdiff_t side, std::ptrdiff_t) {
+            buildNode(X, left + static_cast<int>(side), policy);
+        });
+    } else {
+        buildNode(X, left, policy);
+        buildNode(X, left + 1, policy);
+    }
+}
+
+void NeighborIndex::boundNode(int node) {
+    const int left = 2 * node + 1;
+    const int begin = node_begin_[node];
+    const int end = node_end_[node];
+    const bool leaf = left >= nodeCount();
+
+    if (kind_ == Kind::KDTree) {
+        if (leaf) {
+            auto block = points_.middleRows(begin, end - begin);
+            lower_.col(node) = block.colwise().minCoeff().transpose();
+            upper_.col(node) = block.colwise().maxCoeff().transpose();
+        } else {
+            lower_.col(node) = lower_.col(left).cwiseMin(lower_.col(left + 1));
+            upper_.col(node) = upper_.col(left).cwiseMax(upper_.col(left + 1));
+        }
+        return;
+    }
+
+    // Ball: centroid of the rows, radius to the farthest one
+    if (leaf) {
+        centers_.col(node) = points_.middleRows(begin, end - begin).colwise().mean().transpose();
+    } else {
+        const double left_rows = node_end_[left] - node_begin_[left];
+        const double right_rows = node_end_[left + 1] - node_begin_[left + 1];
+        centers_.col(node) = (left_rows * centers_.col(left) + right_rows * centers_.col(left + 1)) / (left_rows + right_rows);
+    }
+    std::vector<double> distances(end - begin);
+    kernels().squared_distances(points_.data() + begin, end - begin, points_.cols(), points_.rows(),
+                                centers_.col(node).data(), distances.data());
+    radius_[node] = std::sqrt(*std::max_element(distances.begin(), distances.end()));
+}
+
+double NeighborIndex::nodeDistance(int node, const double* query) const {
+    double distance = 0.0;
+    if (kind_ == Kind::KDTree) {
+        // Each term is at most the one of any row in the box, so the bound holds after rounding too
+        for (Eigen::Index j = 0; j < points_.cols(); ++j) {
+            double gap = std::max({lower_(j, node) - query[j], query[j] - upper_(j, node), 0.0});
+            distance += gap * gap;
+        }
+        return distance;
+    }
+    for (Eigen::Index j = 0; j < points_.cols(); ++j) {
+        double difference = query[j] - centers_(j, node);
+        distance += difference * difference;
+    }
+    double gap = std::sqrt(distance) - radius_[node];
+    return gap > 0.0 ? gap * gap : 0.0;
+}
+
+void NeighborIndex::search(const double* query, int k, std::vector<std::pair<double, int>>& heap,
+                           std::vector<double>& scratch) const {
+    // heap: max-heap of (squared distance, training row) holding the k best so far
+    heap.clear();
+    const KernelTable& kernel = kernels();
+    std::vector<std::pair<double, int>> pending = {{0.0, 0}};   // (bound, node), nearer child on top
+    while (!pending.empty()) {
+        auto [bound, node] = pending.back();
+        pending.pop_back();
+        if (static_cast<int>(heap.size()) == k && bound > heap.front().first) {
+            continue;
+        }
+
+        const int left = 2 * node + 1;
+        if (left < nodeCount()) {
+            double left_bound = nodeDistance(left, query);
+            double right_bound = nodeDistance(left + 1, query);
+            if (left_bound <= right_bound) {
+                pending.emplace_back(right_bound, left + 1);
+                pending.emplace_back(left_bound, left);
+            } else {
+                pending.emplace_back(left_bound, left);
+                pending.emplace_back(right_bound, left + 1);
+            }
+            continue;
+        }
+
+        const int begin = node_begin_[node];
+        const int rows = node_end_[node] - begin;
+        scratch.resize(rows);
+        kernel.squared_distances(points_.data() + begin, rows, points_.cols(), points_.rows(), query, scratch.data());
+        for (int i = 0; i < rows; ++i) {
+            std::pair<double, int> candidate(scratch[i], order_[begin + i]);
+            if (static_cast<int>(heap.size()) < k) {
+                heap.push_back(candidate);
+                std::push_heap(heap.begin(), heap.end());
+            } else if (candidate < heap.front()) {
+                std::pop_heap(heap.begin(), heap.end());
+                heap.back() = candidate;
+                std::push_heap(heap.begin(), heap.end());
+            }
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end());
+}
+
+Neighbors NeighborIndex::query(const Eigen::MatrixXd& Q, int k, const ExecutionPolicy& policy) const {
+    U_TRACE_SCOPE("NeighborIndex::query");
+    if (rows() == 0) {
+        throw std::logic_error("NeighborIndex must be built before query.");
+    }
+    if (k < 1 || k > rows()) {
+        throw std::invalid_argument("k must be between 1 and the number of indexed rows.");
+    }
+    if (Q.cols() != cols()) {
+        throw std::invalid_argument("Number of features does not match the neighbor index.");
+    }
+
+    Neighbors neighbors{Eigen::MatrixXi(Q.rows(), k), Eigen::MatrixXd(Q.rows(), k)};
+    policy.parallel_for(0, Q.rows(), kQueryGrain, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+        std::vector<std::pair<double, int>> heap;
+        heap.reserve(k);
+        std::vector<double> scratch;
+        std::vector<double> query(Q.cols());
+        for (std::ptrdiff_t i = begin; i < end; ++i) {
+            for (Eigen::Index j = 0; j < Q.cols(); ++j) {
+                query[j] = Q(i, j);
+            }
+            search(query.data(), k, heap, scratch);
+            for (int m = 0; m < k; ++m) {
+                neighbors.indices(i, m) = heap[m].second;
+                neighbors.distances(i, m) = std::sqrt(heap[m].first);
+            }
+        }
+    });
+    return neighbors;
+}
+
+} // namespace U
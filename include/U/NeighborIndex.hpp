@@ -0,0 +1,84 @@
+#ifndef U_NEIGHBORINDEX_HPP
+#define U_NEIGHBORINDEX_HPP
+
+#include <Eigen/Dense>
+#include <utility>
+#include <vector>
+#include "ThreadPool.hpp"
+
+namespace U {
+
+// The k nearest training rows of each query row, closest first: one row per query, k columns.
+// Distances are Euclidean; equal distances are ordered by training row index.
+struct Neighbors {
+    Eigen::MatrixXi indices;
+    Eigen::MatrixXd distances;
+};
+
+// How the neighbours of a query count in a vote or an average
+enum class NeighborWeights {
+    Uniform,    // Equally
+    Distance,   // By inverse distance; neighbours at distance 0, if any, share all the weight
+};
+
+// Weights of the neighbours of query row `row`, summing to 1, into out (neighbors.indices.cols() entries)
+void neighborWeights(const Neighbors& neighbors, Eigen::Index row, NeighborWeights weights, double* out);
+
+// Space-partitioning index over the rows of a matrix for exact k-nearest-neighbour queries.
+//
+// The tree is stored as flat arrays in heap order (children of node i are 2i + 1 and 2i + 2):
+// every node splits its rows at the median of the feature with the largest spread, so the tree is
+// balanced and its shape depends only on the number of rows. A KD-tree bounds each node with a box,
+// a ball tree with a centre and radius, which stay tight in more dimensions than boxes do.
+// The rows are copied column-major in tree order, so the rows of a leaf are contiguous and their
+// distances to a query come from one vectorized kernel call.
+class NeighborIndex {
+public:
+    enum class Kind {
+        Auto,       // KD-tree up to kMaxKDTreeFeatures features, ball tree above
+        KDTree,
+        BallTree,
+    };
+
+    NeighborIndex() = default;
+
+    // Build the index in O(n log n); subtrees are built in parallel on the policy
+    explicit NeighborIndex(const Eigen::MatrixXd& X, Kind kind = Kind::Auto, int leaf_size = 40,
+                           const ExecutionPolicy& policy = ExecutionPolicy());
+
+    // Exact k nearest neighbours of every row of Q, queries run in parallel on the policy.
+    // Each query visits the nearer child first and skips the nodes that cannot beat its k-th
+    // neighbour, so it typically touches O(log n) leaves in low dimensions.
+    Neighbors query(const Eigen::MatrixXd& Q, int k, const ExecutionPolicy& policy = ExecutionPolicy()) const;
+
+    Eigen::Index rows() const { return points_.rows(); }
+    Eigen::Index cols() const { return points_.cols(); }
+    Kind kind() const { return kind_; }
+    int nodeCount() const { return static_cast<int>(node_begin_.size()); }
+
+    static constexpr int kMaxKDTreeFeatures = 15;
+
+private:
+    void buildNode(const Eigen::MatrixXd& X, int node, const ExecutionPolicy& policy);
+    void boundNode(int node);
+
+    // Lower bound on the squared distance from the query to any row of the node
+    double nodeDistance(int node, const double* query) const;
+
+    // k nearest rows of one query as (squared distance, training row) pairs in heap, closest first
+    void search(const double* query, int k, std::vector<std::pair<double, int>>& heap, std::vector<double>& scratch) const;
+
+    Kind kind_ = Kind::KDTree;
+    Eigen::MatrixXd points_;        // Rows in tree order
+    std::vector<int> order_;        // Training row index of each row of points_
+    std::vector<int> node_begin_;   // Rows [node_begin_, node_end_) of points_ under each node
+    std::vector<int> node_end_;
+    Eigen::MatrixXd lower_;         // KD-tree: per-node box, one column per node
+    Eigen::MatrixXd upper_;
+    Eigen::MatrixXd centers_;       // Ball tree: per-node centre, one column per node, and radius
+    std::vector<double> radius_;
+};
+
+} // namespace U
+
+#endif // U_NEIGHBORINDEX_HPP
@@ -0,0 +1,79 @@
+#include "Serialization.hpp"
+#include <iomanip>
+#include <limits>
+
+namespace U {
+
+namespace {
+
+// Restores the caller's precision when a write is done
+class PrecisionGuard {
+public:
+    explicit PrecisionGuard(std::ostream& out)
+        : out_(out), precision_(out.precision(std::numeric_limits<double>::max_digits10)) {}
+    ~PrecisionGuard() { out_.precision(precision_); }
+
+private:
+    std::ostream& out_;
+    std::streamsize precision_;
+};
+
+} // namespace
+
+void writeHeader(std::ostream& out, const std::string& tag, int version) {
+    out << tag << ' ' << version << '\n';
+}
+
+int readHeader(std::istream& in, const std::string& tag) {
+    std::string found;
+    if (!(in >> found) || found != tag) {
+        throw std::runtime_error("Malformed model file: expected a " + tag + " section, found '" + found + "'.");
+    }
+    return readValue<int>(in, "a format version");
+}
+
+void writeValue(std::ostream& out, double value) {
+    PrecisionGuard guard(out);
+    out << value << '\n';
+}
+
+void writeMatrix(std::ostream& out, const Eigen::MatrixXd& matrix) {
+    PrecisionGuard guard(out);
+    out << matrix.rows() << ' ' << matrix.cols() << '\n';
+    for (Eigen::Index i = 0; i < matrix.rows(); ++i) {
+        for (Eigen::Index j = 0; j < matrix.cols(); ++j) {
+            out << (j == 0 ? "" : " ") << matrix(i, j);
+        }
+        out << '\n';
+    }
+}
+
+void writeVector(std::ostream& out, const Eigen::VectorXd& vector) {
+    writeMatrix(out, vector);
+}
+
+Eigen::MatrixXd readMatrix(std::istream& in) {
+    auto rows = readValue<Eigen::Index>(in, "a row count");
+    auto cols = readValue<Eigen::Index>(in, "a column count");
+    if (rows < 0 || cols < 0) {
+        throw std::runtime_error("Malformed model file: negative matrix size.");
+    }
+
+    Eigen::MatrixXd matrix(rows, cols);
+    for (Eigen::Index i = 0; i < rows; ++i) {
+        for (Eigen::Index j = 0; j < cols; ++j) {
+            matrix(i, j) = readValue<double>(in, "a matrix coefficient");
+        }
+    }
+    return matrix;
+}
+
+Eigen::VectorXd readVector(std::istream& in) {
+    Eigen::MatrixXd matrix = readMatrix(in);
+    if (matrix.cols() != 1 && matrix.size() != 0) {
+        throw std::runtime_error("Malformed model file: expected a column vector.");
+    }
+    return Eigen::Map<Eigen::VectorXd>(matrix.data(), matrix.size());
+}
+
+} // namespace U
@@ -0,0 +1,37 @@
+#ifndef U_SERIALIZATION_HPP
+#define U_SERIALIZATION_HPP
+
+#include <Eigen/Dense>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+namespace U {
+
+// Plain-text model files. Every object starts with a "<tag> <version>" line and numbers are
+// written with max_digits10 significant digits, so a save/load round trip is exact.
+// Readers throw std::runtime_error on malformed or truncated input.
+
+void writeHeader(std::ostream& out, const std::string& tag, int version);
+int readHeader(std::istream& in, const std::string& tag);   // Returns the version
+
+void writeValue(std::ostream& out, double value);
+void writeMatrix(std::ostream& out, const Eigen::MatrixXd& matrix);  // "rows cols" then the values row by row
+void writeVector(std::ostream& out, const Eigen::VectorXd& vector);
+
+Eigen::MatrixXd readMatrix(std::istream& in);
+Eigen::VectorXd readVector(std::istream& in);
+
+template <typename T>
+T readValue(std::istream& in, const char* what) {
+    T value;
+    if (!(in >> value)) {
+        throw std::runtime_error(std::string("Malformed model file: expected ") + what + ".");
+    }
+    return value;
+}
+
+} // namespace U
+
+#endif // U_SERIALIZATION_HPP
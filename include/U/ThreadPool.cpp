@@ -0,0 +1,216 @@
+#include "ThreadPool.hpp"
+#include <exception>
+
+namespace U {
+
+namespace {
+
+// Lets submit() and the workers find their own deque
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local std::size_t current_index = 0;
+
+std::mutex& defaultMutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::unique_ptr<ExecutionPolicy>& defaultPolicy() {
+    static std::unique_ptr<ExecutionPolicy> policy;
+    return policy;
+}
+
+} // namespace
+
+ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (std::size_t i = 0; i < threads; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    for (std::size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back([this, i]() { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(Task task) {
+    std::size_t index = (current_pool == this) ? current_index : next_queue_++ % queues_.size();
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    pending_++;
+
+    // Taking the lock orders the increment before a worker's check of pending_
+    { std::lock_guard<std::mutex> lock(wake_mutex_); }
+    wake_.notify_one();
+}
+
+bool ThreadPool::tryRunTask(std::size_t home) {
+    Task task;
+
+    // Own deque first, newest task first: it is the most likely to be in cache
+    {
+        std::lock_guard<std::mutex> lock(queues_[home]->mutex);
+        if (!queues_[home]->tasks.empty()) {
+            task = std::move(queues_[home]->tasks.back());
+            queues_[home]->tasks.pop_back();
+        }
+    }
+
+    // Otherwise steal the oldest task of another worker
+    for (std::size_t offset = 1; !task && offset < queues_.size(); ++offset) {
+        Queue& victim = *queues_[(home + offset) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+
+    if (!task) {
+        return false;
+    }
+    pending_--;
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(std::size_t index) {
+    current_pool = this;
+    current_index = index;
+
+    while (true) {
+        if (tryRunTask(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait(lock, [this]() { return stopping_ || pending_ > 0; });
+        if (stopping_ && pending_ == 0) {
+            return;
+        }
+    }
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::shared() {
+    static std::shared_ptr<ThreadPool> pool =
+        std::make_shared<ThreadPool>(std::max(2u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+ExecutionPolicy::ExecutionPolicy(std::shared_ptr<ThreadPool> pool, Executor submit, std::size_t concurrency)
+    : pool_(std::move(pool)), submit_(std::move(submit)), concurrency_(std::max<std::size_t>(1, concurrency)) {
+    if (concurrency_ == 1) {
+        submit_ = nullptr;
+    }
+}
+
+ExecutionPolicy::ExecutionPolicy() {
+    std::lock_guard<std::mutex> lock(defaultMutex());
+    auto& current = defaultPolicy();
+    if (!current) {
+        current = std::make_unique<ExecutionPolicy>(pool(ThreadPool::shared()));
+    }
+    *this = *current;
+}
+
+ExecutionPolicy ExecutionPolicy::sequential() {
+    return ExecutionPolicy(nullptr, nullptr, 1);
+}
+
+ExecutionPolicy ExecutionPolicy::threads(std::size_t count) {
+    if (count <= 1) {
+        return sequential();
+    }
+    // The calling thread is one of the count threads
+    return pool(std::make_shared<ThreadPool>(count - 1));
+}
+
+ExecutionPolicy ExecutionPolicy::pool(std::shared_ptr<ThreadPool> pool) {
+    if (!pool) {
+        return sequential();
+    }
+    ThreadPool* raw = pool.get();
+    std::size_t concurrency = pool->size() + 1;
+    return ExecutionPolicy(std::move(pool), [raw](std::function<void()> task) { raw->submit(std::move(task)); }, concurrency);
+}
+
+ExecutionPolicy ExecutionPolicy::executor(Executor submit, std::size_t concurrency) {
+    if (!submit) {
+        return sequential();
+    }
+    return ExecutionPolicy(nullptr, std::move(submit), concurrency);
+}
+
+void ExecutionPolicy::setDefault(const ExecutionPolicy& policy) {
+    std::lock_guard<std::mutex> lock(defaultMutex());
+    defaultPolicy() = std::make_unique<ExecutionPolicy>(policy);
+}
+
+void ExecutionPolicy::run(std::size_t chunks, const std::function<void(std::size_t)>& chunk) const {
+    if (!submit_ || chunks == 1) {
+        for (std::size_t c = 0; c < chunks; ++c) {
+            chunk(c);
+        }
+        return;
+    }
+
+    // Helpers outlive the call if they are scheduled late, so the shared state is reference counted
+    struct State {
+        std::size_t chunks = 0;
+        const std::function<void(std::size_t)>* chunk = nullptr;
+        std::atomic<std::size_t> next{0};
+        std::atomic<std::size_t> done{0};
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::exception_ptr error;
+    };
+    auto state = std::make_shared<State>();
+    state->chunks = chunks;
+    state->chunk = &chunk;
+
+    // Chunks are claimed from a shared counter. The calling thread claims them too, so the
+    // loop completes even if no helper is ever scheduled (busy pool, nested loops).
+    auto work = [state]() {
+        for (std::size_t c = state->next++; c < state->chunks; c = state->next++) {
+            try {
+                (*state->chunk)(c);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (!state->error) {
+                    state->error = std::current_exception();
+                }
+            }
+            if (++state->done == state->chunks) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    std::size_t helpers = std::min(concurrency_ - 1, chunks - 1);
+    for (std::size_t i = 0; i < helpers; ++i) {
+        submit_(work);
+    }
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&state]() { return state->done == state->chunks; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+} // namespace U
@@ -0,0 +1,140 @@
+#ifndef U_THREADPOOL_HPP
+#define U_THREADPOOL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace U {
+
+// Work-stealing thread pool: every worker owns a task deque, runs its own tasks newest first
+// and steals the oldest task of another worker when it runs dry.
+class ThreadPool {
+public:
+    using Task = std::function<void()>;
+
+    // threads = 0: one worker per hardware thread
+    explicit ThreadPool(std::size_t threads = 0);
+
+    // Runs the tasks still queued, then joins the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Tasks submitted from a worker go to its own deque, others are spread round robin
+    void submit(Task task);
+
+    std::size_t size() const { return workers_.size(); }
+
+    // Pool behind default-constructed ExecutionPolicy objects, created on first use.
+    // It keeps one hardware thread free for the thread that calls into the library.
+    static std::shared_ptr<ThreadPool> shared();
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    bool tryRunTask(std::size_t home);
+    void workerLoop(std::size_t index);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::vector<std::thread> workers_;
+    std::atomic<std::size_t> pending_{0};
+    std::atomic<std::size_t> next_queue_{0};
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+};
+
+// Where the parallel loops of the library run. Copies share the same pool.
+// A range is always cut into the same chunks for a given grain, whatever the number of
+// threads, and parallel_reduce combines the chunk results in index order, so results
+// do not depend on the policy or on scheduling.
+class ExecutionPolicy {
+public:
+    // Hands a task to a scheduler owned by someone else, e.g. the pool of a service
+    using Executor = std::function<void(std::function<void()>)>;
+
+    // Copy of the library default: the shared pool unless replaced with setDefault
+    ExecutionPolicy();
+
+    static ExecutionPolicy sequential();                                    // Everything on the calling thread
+    static ExecutionPolicy threads(std::size_t count);                      // Dedicated pool, count threads in total
+    static ExecutionPolicy pool(std::shared_ptr<ThreadPool> pool);          // Existing pool, shared with the caller
+    static ExecutionPolicy executor(Executor submit, std::size_t concurrency); // External scheduler running up to concurrency tasks
+
+    // Policy picked up by estimators and functions that are not given one
+    static void setDefault(const ExecutionPolicy& policy);
+
+    // Threads that may run chunks of one loop, the calling thread included
+    std::size_t concurrency() const { return concurrency_; }
+
+    // Calls body(chunk_begin, chunk_end) on chunks of at most grain indices of [begin, end)
+    template <typename Body>
+    void parallel_for(std::ptrdiff_t begin, std::ptrdiff_t end, std::ptrdiff_t grain, Body&& body) const;
+
+    // Folds combine(result, map(chunk_begin, chunk_end)) over the chunks in order, starting from identity
+    template <typename T, typename Map, typename Combine>
+    T parallel_reduce(std::ptrdiff_t begin, std::ptrdiff_t end, std::ptrdiff_t grain, T identity,
+                      Map&& map, Combine&& combine) const;
+
+private:
+    ExecutionPolicy(std::shared_ptr<ThreadPool> pool, Executor submit, std::size_t concurrency);
+
+    // Runs chunk(0) ... chunk(chunks - 1); the calling thread claims chunks too and rethrows the first error
+    void run(std::size_t chunks, const std::function<void(std::size_t)>& chunk) const;
+
+    std::shared_ptr<ThreadPool> pool_;  // Keeps the pool alive while a policy uses it
+    Executor submit_;                   // Empty for sequential policies
+    std::size_t concurrency_ = 1;
+};
+
+template <typename Body>
+void ExecutionPolicy::parallel_for(std::ptrdiff_t begin, std::ptrdiff_t end, std::ptrdiff_t grain, Body&& body) const {
+    if (end <= begin) {
+        return;
+    }
+    grain = std::max<std::ptrdiff_t>(1, grain);
+    std::size_t chunks = static_cast<std::size_t>((end - begin + grain - 1) / grain);
+    run(chunks, [&](std::size_t chunk) {
+        std::ptrdiff_t chunk_begin = begin + static_cast<std::ptrdiff_t>(chunk) * grain;
+        body(chunk_begin, std::min(end, chunk_begin + grain));
+    });
+}
+
+template <typename T, typename Map, typename Combine>
+T ExecutionPolicy::parallel_reduce(std::ptrdiff_t begin, std::ptrdiff_t end, std::ptrdiff_t grain, T identity,
+                                   Map&& map, Combine&& combine) const {
+    if (end <= begin) {
+        return identity;
+    }
+    grain = std::max<std::ptrdiff_t>(1, grain);
+    std::size_t chunks = static_cast<std::size_t>((end - begin + grain - 1) / grain);
+
+    std::vector<T> partials(chunks);
+    run(chunks, [&](std::size_t chunk) {
+        std::ptrdiff_t chunk_begin = begin + static_cast<std::ptrdiff_t>(chunk) * grain;
+        partials[chunk] = map(chunk_begin, std::min(end, chunk_begin + grain));
+    });
+
+    T result = std::move(identity);
+    for (auto& partial : partials) {
+        result = combine(std::move(result), std::move(partial));
+    }
+    return result;
+}
+
+} // namespace U
+
+#endif // U_THREADPOOL_HPP
@@ -0,0 +1,171 @@
+#include "Trace.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <map>
+
+namespace U {
+
+namespace {
+
+// Spans kept per thread for the Chrome trace; aggregates keep counting past this limit
+constexpr size_t kMaxSpansPerThread = 1 << 20;
+
+// Minimal JSON string escaping for span and counter names
+std::string escape(const char* text) {
+    std::string escaped;
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            escaped += '\\';
+        }
+        escaped += *c;
+    }
+    return escaped;
+}
+
+} // namespace
+
+Tracer& Tracer::instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+Tracer::Tracer() : origin_(std::chrono::steady_clock::now()) {}
+
+int64_t Tracer::now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin_).count();
+}
+
+Tracer::ThreadBuffer& Tracer::localBuffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        buffers_.push_back(std::make_unique<ThreadBuffer>());
+        buffer = buffers_.back().get();
+        buffer->thread_id = static_cast<int>(buffers_.size());
+    }
+    return *buffer;
+}
+
+void Tracer::recordSpan(const char* name, int64_t start_ns, int64_t duration_ns) {
+    ThreadBuffer& buffer = localBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+
+    Aggregate& aggregate = buffer.aggregates[name];
+    aggregate.calls++;
+    aggregate.total_ns += duration_ns;
+    aggregate.max_ns = std::max(aggregate.max_ns, duration_ns);
+
+    if (buffer.spans.size() < kMaxSpansPerThread) {
+        buffer.spans.push_back({name, start_ns, duration_ns});
+    }
+}
+
+void Tracer::addTally(const char* name, int64_t value, bool bytes) {
+    if (!enabled()) {
+        return;
+    }
+    ThreadBuffer& buffer = localBuffer();
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+
+    Tally& tally = buffer.tallies[name];
+    tally.events++;
+    tally.total += value;
+    tally.bytes = bytes;
+}
+
+void Tracer::addCount(const char* name, int64_t value) {
+    addTally(name, value, false);
+}
+
+void Tracer::addBytes(const char* name, int64_t bytes) {
+    addTally(name, bytes, true);
+}
+
+void Tracer::reset() {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    for (auto& buffer : buffers_) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        buffer->spans.clear();
+        buffer->aggregates.clear();
+        buffer->tallies.clear();
+    }
+}
+
+bool Tracer::writeChromeTrace(const std::string& filename) const {
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    // Trace Event Format: complete events ("X") per span, counter events ("C") with the final tallies
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    const int64_t end_ns = now();
+
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    for (const auto& buffer : buffers_) {
+        std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+        for (const Span& span : buffer->spans) {
+            file << (first ? "" : ",") << "\n{\"name\":\"" << escape(span.name) << "\",\"cat\":\"ml_cpp\",\"ph\":\"X\""
+                 << ",\"ts\":" << span.start_ns / 1000.0 << ",\"dur\":" << span.duration_ns / 1000.0
+                 << ",\"pid\":1,\"tid\":" << buffer->thread_id << "}";
+            first = false;
+        }
+        for (const auto& [name, tally] : buffer->tallies) {
+            file << (first ? "" : ",") << "\n{\"name\":\"" << escape(name) << "\",\"ph\":\"C\",\"ts\":" << end_ns / 1000.0
+                 << ",\"pid\":1,\"tid\":" << buffer->thread_id << ",\"args\":{\"" << (tally.bytes ? "bytes" : "value") << "\":" << tally.total << "}}";
+            first = false;
+        }
+    }
+    file << "\n]}\n";
+    return file.good();
+}
+
+void Tracer::printSummary(std::ostream& out) const {
+    // Merge the per-thread aggregates by name
+    std::map<std::string, Aggregate> spans;
+    std::map<std::string, Tally> tallies;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        for (const auto& buffer : buffers_) {
+            std::lock_guard<std::mutex> buffer_lock(buffer->mutex);
+            for (const auto& [name, aggregate] : buffer->aggregates) {
+                Aggregate& total = spans[name];
+                total.calls += aggregate.calls;
+                total.total_ns += aggregate.total_ns;
+                total.max_ns = std::max(total.max_ns, aggregate.max_ns);
+            }
+            for (const auto& [name, tally] : buffer->tallies) {
+                Tally& total = tallies[name];
+                total.events += tally.events;
+                total.total += tally.total;
+                total.bytes = tally.bytes;
+            }
+        }
+    }
+
+    std::vector<std::pair<std::string, Aggregate>> sorted(spans.begin(), spans.end());
+    std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second.total_ns > b.second.total_ns; });
+
+    out << std::left << std::setw(48) << "span" << std::right << std::setw(10) << "calls"
+        << std::setw(14) << "total ms" << std::setw(14) << "mean us" << std::setw(14) << "max us" << "\n";
+    for (const auto& [name, aggregate] : sorted) {
+        out << std::left << std::setw(48) << name << std::right << std::setw(10) << aggregate.calls
+            << std::fixed << std::setprecision(3)
+            << std::setw(14) << aggregate.total_ns / 1e6
+            << std::setw(14) << aggregate.total_ns / 1e3 / aggregate.calls
+            << std::setw(14) << aggregate.max_ns / 1e3 << "\n";
+    }
+
+    if (!tallies.empty()) {
+        out << "\n" << std::left << std::setw(48) << "counter" << std::right << std::setw(10) << "events" << std::setw(20) << "total" << "\n";
+        for (const auto& [name, tally] : tallies) {
+            out << std::left << std::setw(48) << name << std::right << std::setw(10) << tally.events
+                << std::setw(20) << tally.total << (tally.bytes ? " B" : "") << "\n";
+        }
+    }
+    out.unsetf(std::ios::floatfield);
+}
+
+} // namespace U
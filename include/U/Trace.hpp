@@ -0,0 +1,118 @@
+#ifndef U_TRACE_HPP
+#define U_TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace U {
+
+// Hot-path instrumentation: scoped timers, counters and byte tallies, recorded into
+// per-thread buffers and exported as a Chrome trace (chrome://tracing, Perfetto) or a text summary.
+// Everything compiles to nothing unless ML_CPP_TRACING is defined (CMake option ML_CPP_TRACING).
+class Tracer {
+public:
+    static Tracer& instance();
+
+    // Recording can be paused at run time, from any thread; it starts enabled. Spans and tallies
+    // already under way when it changes may still be recorded, as no ordering is implied.
+    void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    // Names must be string literals: they are stored by pointer
+    void recordSpan(const char* name, int64_t start_ns, int64_t duration_ns);
+    void addCount(const char* name, int64_t value);
+    void addBytes(const char* name, int64_t bytes);
+
+    // Export the recorded spans and counters; returns false if the file cannot be written
+    bool writeChromeTrace(const std::string& filename) const;
+    void printSummary(std::ostream& out) const;
+
+    // Drop everything recorded so far
+    void reset();
+
+    // Nanoseconds since the tracer was created
+    int64_t now() const;
+
+private:
+    Tracer();
+
+    struct Span {
+        const char* name;
+        int64_t start_ns;
+        int64_t duration_ns;
+    };
+
+    struct Aggregate {
+        int64_t calls = 0;
+        int64_t total_ns = 0;
+        int64_t max_ns = 0;
+    };
+
+    struct Tally {
+        int64_t events = 0;  // Number of increments (allocations for byte tallies)
+        int64_t total = 0;
+        bool bytes = false;
+    };
+
+    // One buffer per thread; only its own thread writes, exports lock it briefly
+    struct ThreadBuffer {
+        std::mutex mutex;
+        int thread_id;
+        std::vector<Span> spans;
+        std::unordered_map<const char*, Aggregate> aggregates;
+        std::unordered_map<const char*, Tally> tallies;
+    };
+
+    ThreadBuffer& localBuffer();
+    void addTally(const char* name, int64_t value, bool bytes);
+
+    std::atomic<bool> enabled_{true};
+    std::chrono::steady_clock::time_point origin_;
+    mutable std::mutex buffers_mutex_;
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers_;
+};
+
+// Records the lifetime of a scope as a span
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char* name)
+        : name_(name), start_ns_(Tracer::instance().enabled() ? Tracer::instance().now() : -1) {}
+
+    ~ScopedTimer() {
+        if (start_ns_ >= 0) {
+            Tracer& tracer = Tracer::instance();
+            tracer.recordSpan(name_, start_ns_, tracer.now() - start_ns_);
+        }
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    const char* name_;
+    int64_t start_ns_;
+};
+
+} // namespace U
+
+#define U_TRACE_CONCAT_INNER(a, b) a##b
+#define U_TRACE_CONCAT(a, b) U_TRACE_CONCAT_INNER(a, b)
+
+#ifdef ML_CPP_TRACING
+#define U_TRACE_SCOPE(name) U::ScopedTimer U_TRACE_CONCAT(u_trace_scope_, __LINE__)(name)
+#define U_TRACE_COUNT(name, value) U::Tracer::instance().addCount(name, static_cast<int64_t>(value))
+#define U_TRACE_BYTES(name, bytes) U::Tracer::instance().addBytes(name, static_cast<int64_t>(bytes))
+#else
+#define U_TRACE_SCOPE(name) ((void)0)
+#define U_TRACE_COUNT(name, value) ((void)0)
+#define U_TRACE_BYTES(name, bytes) ((void)0)
+#endif
+
+#endif // U_TRACE_HPP
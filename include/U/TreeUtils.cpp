@@ -1,8 +1,61 @@
 #include "TreeUtils.hpp"
+#include "Kernels.hpp"
+#include "MatrixUtils.hpp"
+#include "Trace.hpp"
+#include <algorithm>
 #include <limits>
+#include <type_traits>
+#include <utility>
 
 namespace U {
 
+namespace {
+
+// Slabs double from the first size up to the last, so small trees stay small
+constexpr size_t kFirstSlabNodes = 64;
+constexpr size_t kMaxSlabNodes = 8192;
+
+} // namespace
+
+TreeNode* TreeNodeArena::allocate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (slab_ < slabs_.size() && used_ == slab_sizes_[slab_]) {
+        ++slab_;
+        used_ = 0;
+    }
+    if (slab_ == slabs_.size()) {
+        size_t nodes = slab_sizes_.empty() ? kFirstSlabNodes : std::min(2 * slab_sizes_.back(), kMaxSlabNodes);
+        slabs_.emplace_back(new TreeNode[nodes]);
+        slab_sizes_.push_back(nodes);
+        used_ = 0;
+    }
+    ++size_;
+    TreeNode* node = &slabs_[slab_][used_++];
+    *node = TreeNode();  // Slots are reused after clear()
+    return node;
+}
+
+void TreeNodeArena::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    slab_ = 0;
+    used_ = 0;
+    size_ = 0;
+}
+
+size_t TreeNodeArena::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+size_t TreeNodeArena::capacity() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t nodes = 0;
+    for (size_t slab_nodes : slab_sizes_) {
+        nodes += slab_nodes;
+    }
+    return nodes;
+}
+
 double TreeUtils::calculateGini(const Eigen::VectorXd& y_left, const Eigen::VectorXd& y_right) {
     auto calculateProportions = [](const Eigen::VectorXd& y) -> std::unordered_map<int, double> {
         std::unordered_map<int, double> proportions;
@@ -31,39 +84,246 @@ double TreeUtils::calculateGini(const Eigen::VectorXd& y_left, const Eigen::Vect
 }
 
 void TreeUtils::findBestSplit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, int& best_feature,
-                              double& best_threshold, double& best_gini) {
-    best_feature = -1;
-    best_threshold = 0.0;
-    best_gini = std::numeric_limits<double>::max();
-
-    for (int feature = 0; feature < X.cols(); ++feature) {
-        std::vector<double> thresholds;
-        for (int i = 0; i < X.rows(); ++i) {
-            thresholds.push_back(X(i, feature));
+                              double& best_threshold, double& best_gini, const ExecutionPolicy& policy,
+                              int min_samples_leaf) {
+    U_TRACE_SCOPE("TreeUtils::findBestSplit");
+
+    struct Split {
+        int feature = -1;
+        double threshold = 0.0;
+        double gini = std::numeric_limits<double>::max();
+    };
+
+    // Class index of every row, labels compared as integers as in calculateGini
+    std::vector<int> classes(y.size());
+    for (Eigen::Index i = 0; i < y.size(); ++i) {
+        classes[i] = static_cast<int>(y[i]);
+    }
+    std::vector<int> labels = classes;
+    std::sort(labels.begin(), labels.end());
+    labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+    for (int& label : classes) {
+        label = static_cast<int>(std::lower_bound(labels.begin(), labels.end(), label) - labels.begin());
+    }
+    const int n_classes = static_cast<int>(labels.size());
+    const KernelTable& kernel = kernels();
+
+    // Best split of each feature, reduced in feature order
+    auto scanFeatures = [&](std::ptrdiff_t first_feature, std::ptrdiff_t last_feature) {
+        Split best;
+        std::vector<std::pair<double, int>> rows(X.rows());
+        std::vector<double> values(X.rows());
+        std::vector<int> sorted_classes(X.rows());
+        std::vector<double> counts(2 * n_classes);
+        for (int feature = first_feature; feature < last_feature; ++feature) {
+            for (Eigen::Index i = 0; i < X.rows(); ++i) {
+                rows[i] = {X(i, feature), classes[i]};
+            }
+            std::sort(rows.begin(), rows.end(),
+                      [](const std::pair<double, int>& a, const std::pair<double, int>& b) { return a.first < b.first; });
+            for (Eigen::Index i = 0; i < X.rows(); ++i) {
+                values[i] = rows[i].first;
+                sorted_classes[i] = rows[i].second;
+            }
+
+            if (kernel.gini_sweep(values.data(), sorted_classes.data(), X.rows(), n_classes, min_samples_leaf,
+                                  counts.data(), best.gini, best.threshold)) {
+                best.feature = feature;
+            }
+        }
+        return best;
+    };
+
+    Split best = policy.parallel_reduce(0, X.cols(), 1, Split(), scanFeatures,
+                                        [](Split current, Split candidate) { return candidate.gini < current.gini ? candidate : current; });
+
+    best_feature = best.feature;
+    best_threshold = best.threshold;
+    best_gini = best.gini;
+}
+
+namespace {
+
+// As in the split kernel: 1 - sum_k (counts[k] / size)^2, or 1 for an empty side. Classes
+// missing from the node add nothing, so the result matches a search over the node's own classes.
+double giniOf(const double* counts, int n_classes, double size) {
+    double impurity = 1.0;
+    if (size > 0) {
+        for (int k = 0; k < n_classes; ++k) {
+            double p = counts[k] / size;
+            impurity -= p * p;
         }
-        std::sort(thresholds.begin(), thresholds.end());
-        thresholds.erase(std::unique(thresholds.begin(), thresholds.end()), thresholds.end());
-
-        for (const double& threshold : thresholds) {
-            Eigen::VectorXd y_left, y_right;
-            for (int i = 0; i < X.rows(); ++i) {
-                if (X(i, feature) <= threshold) {
-                    y_left.conservativeResize(y_left.size() + 1);
-                    y_left[y_left.size() - 1] = y[i];
-                } else {
-                    y_right.conservativeResize(y_right.size() + 1);
-                    y_right[y_right.size() - 1] = y[i];
+    }
+    return impurity;
+}
+
+} // namespace
+
+void TreeUtils::binHistogram(const BinnedMatrix& X, const int* classes, int n_classes, const int* rows,
+                             std::ptrdiff_t n, double* histogram, const ExecutionPolicy& policy) {
+    U_TRACE_SCOPE("TreeUtils::binHistogram");
+    // Each feature fills its own slice of the histogram
+    policy.parallel_for(0, X.cols(), 1, [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+        for (std::ptrdiff_t feature = first; feature < last; ++feature) {
+            double* counts = histogram + static_cast<std::ptrdiff_t>(X.binOffset(feature)) * n_classes;
+            std::fill(counts, counts + static_cast<std::ptrdiff_t>(X.binCount(feature)) * n_classes, 0.0);
+            X.withColumn(feature, [&](const auto* codes) {
+                for (std::ptrdiff_t i = 0; i < n; ++i) {
+                    const int row = rows[i];
+                    counts[codes[row] * n_classes + classes[row]] += 1.0;
+                }
+            });
+        }
+    });
+}
+
+void TreeUtils::findBestSplit(const BinnedMatrix& X, const double* histogram, int n_classes, int& best_feature,
+                              int& best_bin, double& best_gini, const ExecutionPolicy& policy, int min_samples_leaf) {
+    U_TRACE_SCOPE("TreeUtils::findBestSplit");
+
+    struct Split {
+        int feature = -1;
+        int bin = 0;
+        double gini = std::numeric_limits<double>::max();
+    };
+
+    // Same sweep as the gini_sweep kernel, over the non-empty bins instead of the distinct values
+    auto scanFeatures = [&](std::ptrdiff_t first_feature, std::ptrdiff_t last_feature) {
+        Split best;
+        std::vector<double> left(n_classes);
+        std::vector<double> right(n_classes);
+        for (int feature = first_feature; feature < last_feature; ++feature) {
+            const double* counts = histogram + static_cast<std::ptrdiff_t>(X.binOffset(feature)) * n_classes;
+            const int bins = X.binCount(feature);
+            std::fill(left.begin(), left.end(), 0.0);
+            std::fill(right.begin(), right.end(), 0.0);
+            for (int b = 0; b < bins; ++b) {
+                for (int k = 0; k < n_classes; ++k) {
+                    right[k] += counts[b * n_classes + k];
                 }
             }
+            double total = 0.0;
+            for (int k = 0; k < n_classes; ++k) {
+                total += right[k];
+            }
 
-            double gini = calculateGini(y_left, y_right);
-            if (gini < best_gini) {
-                best_gini = gini;
-                best_feature = feature;
-                best_threshold = threshold;
+            double left_size = 0.0;
+            for (int b = 0; b < bins; ++b) {
+                double bin_size = 0.0;
+                for (int k = 0; k < n_classes; ++k) {
+                    const double count = counts[b * n_classes + k];
+                    left[k] += count;
+                    right[k] -= count;
+                    bin_size += count;
+                }
+                if (bin_size == 0.0) {
+                    continue;
+                }
+                left_size += bin_size;
+                double right_size = total - left_size;
+                if (left_size < min_samples_leaf || right_size < min_samples_leaf) {
+                    continue;
+                }
+                double weighted = (left_size / total) * giniOf(left.data(), n_classes, left_size) +
+                                  (right_size / total) * giniOf(right.data(), n_classes, right_size);
+                if (weighted < best.gini) {
+                    best.gini = weighted;
+                    best.feature = feature;
+                    best.bin = b;
+                }
             }
         }
+        return best;
+    };
+
+    Split best = policy.parallel_reduce(0, X.cols(), 1, Split(), scanFeatures,
+                                        [](Split current, Split candidate) { return candidate.gini < current.gini ? candidate : current; });
+
+    best_feature = best.feature;
+    best_bin = best.bin;
+    best_gini = best.gini;
+}
+
+FlatTree TreeUtils::flatten(const TreeNode* root) {
+    FlatTree tree;
+    if (!root) {
+        return tree;
     }
+
+    // Nodes are numbered in the order they are reached; pending holds (node, index, depth)
+    struct Pending {
+        const TreeNode* node;
+        int index;
+        int depth;
+    };
+    std::vector<Pending> pending = {{root, 0, 0}};
+    auto append = [&tree]() {
+        tree.feature.push_back(0);
+        tree.threshold.push_back(std::numeric_limits<double>::infinity());
+        tree.left.push_back(-1);
+        tree.right.push_back(-1);
+        tree.label.push_back(-1);
+        return static_cast<int>(tree.feature.size() - 1);
+    };
+    append();
+
+    while (!pending.empty()) {
+        Pending current = pending.back();
+        pending.pop_back();
+        tree.depth = std::max(tree.depth, current.depth);
+        const TreeNode* node = current.node;
+        if (!node->left && !node->right) {
+            tree.left[current.index] = current.index;
+            tree.right[current.index] = current.index;
+            tree.label[current.index] = node->class_label;
+            continue;
+        }
+        int left = append();
+        int right = append();
+        tree.feature[current.index] = node->feature_index;
+        tree.threshold[current.index] = node->threshold;
+        tree.left[current.index] = left;
+        tree.right[current.index] = right;
+        pending.push_back({node->right, right, current.depth + 1});
+        pending.push_back({node->left, left, current.depth + 1});
+    }
+    return tree;
+}
+
+namespace {
+
+template <typename Scalar>
+void leavesOf(const FlatTree& tree, const DenseMatrix<Scalar>& X, std::ptrdiff_t begin,
+              std::ptrdiff_t end, int* leaves) {
+    // Every row descends the full depth in the kernel, so very deep trees follow each row instead
+    constexpr int kMaxKernelDepth = 64;
+    if (tree.depth <= kMaxKernelDepth) {
+        if constexpr (std::is_same_v<Scalar, float>) {
+            kernels().traverse_tree_f32(tree.feature.data(), tree.threshold.data(), tree.left.data(), tree.right.data(),
+                                        tree.depth, X.data() + begin, end - begin, X.rows(), leaves);
+        } else {
+            kernels().traverse_tree(tree.feature.data(), tree.threshold.data(), tree.left.data(), tree.right.data(),
+                                    tree.depth, X.data() + begin, end - begin, X.rows(), leaves);
+        }
+        return;
+    }
+    for (std::ptrdiff_t i = begin; i < end; ++i) {
+        int node = 0;
+        while (tree.left[node] != node) {
+            node = X(i, tree.feature[node]) <= tree.threshold[node] ? tree.left[node] : tree.right[node];
+        }
+        leaves[i - begin] = node;
+    }
+}
+
+} // namespace
+
+void TreeUtils::findLeaves(const FlatTree& tree, const Eigen::MatrixXd& X, std::ptrdiff_t begin, std::ptrdiff_t end, int* leaves) {
+    leavesOf(tree, X, begin, end, leaves);
+}
+
+void TreeUtils::findLeaves(const FlatTree& tree, const Eigen::MatrixXf& X, std::ptrdiff_t begin, std::ptrdiff_t end, int* leaves) {
+    leavesOf(tree, X, begin, end, leaves);
 }
 
 } // namespace U
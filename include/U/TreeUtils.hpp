@@ -2,6 +2,11 @@
 #define U_TREEUTILS_HPP
 
 #include <Eigen/Dense>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "Binning.hpp"
+#include "ThreadPool.hpp"
 
 namespace U {
 
@@ -9,12 +14,53 @@ namespace U {
 struct TreeNode {
     int feature_index;      // Feature used for the split
     double threshold;       // Threshold value for the split
-    int class_label;        // Class label for leaf nodes
+    int class_label;        // Class label for leaf nodes (the majority class of split nodes too)
+    int samples;            // Training rows that reached the node, 0 in trees loaded from a file
+    double impurity;        // Gini impurity of those rows, for cost-complexity pruning
     TreeNode* left;         // Pointer to left child
     TreeNode* right;        // Pointer to right child
 
     TreeNode() 
-        : feature_index(-1), threshold(0.0), class_label(-1), left(nullptr), right(nullptr) {}
+        : feature_index(-1), threshold(0.0), class_label(-1), samples(0), impurity(0.0), left(nullptr), right(nullptr) {}
+};
+
+// Owns the nodes of a tree, or of every tree of an ensemble, in contiguous slabs.
+// Nodes are never freed one by one: clear() rewinds the arena and keeps its slabs for the
+// next tree, and destroying the arena releases every slab at once, whatever the tree depth.
+// allocate() may be called from several threads, e.g. while subtrees are built in parallel.
+class TreeNodeArena {
+public:
+    TreeNodeArena() = default;
+    TreeNodeArena(const TreeNodeArena&) = delete;
+    TreeNodeArena& operator=(const TreeNodeArena&) = delete;
+
+    // A default-constructed node whose address stays valid until clear() or destruction
+    TreeNode* allocate();
+
+    // Invalidate every node but keep the slabs for reuse
+    void clear();
+
+    size_t size() const;        // Nodes allocated since the last clear()
+    size_t capacity() const;    // Nodes the current slabs can hold
+
+private:
+    mutable std::mutex mutex_;
+    std::vector<std::unique_ptr<TreeNode[]>> slabs_;
+    std::vector<size_t> slab_sizes_;
+    size_t slab_ = 0;           // Slab being filled
+    size_t used_ = 0;           // Nodes taken from it
+    size_t size_ = 0;
+};
+
+// A tree as arrays indexed by node, root first, for the traversal kernel: leaves point to
+// themselves with threshold +inf, so descending past a leaf keeps a row on it
+struct FlatTree {
+    std::vector<int> feature;
+    std::vector<double> threshold;
+    std::vector<int> left;
+    std::vector<int> right;
+    std::vector<int> label;       // Class label of the leaves, -1 for splits
+    int depth = 0;                // Levels below the root
 };
 
 // Utility class for tree operations
@@ -23,9 +69,33 @@ public:
     // Calculate Gini impurity for a split
     static double calculateGini(const Eigen::VectorXd& y_left, const Eigen::VectorXd& y_right);
 
-    // Find the best split for a given dataset
+    // Find the best split for a given dataset; features are scanned in parallel and ties
+    // go to the lowest feature index, as in a sequential scan. Each feature is sorted once and
+    // its thresholds are swept in order with running class counts. Only splits leaving at least
+    // min_samples_leaf rows on each side count; best_feature is -1 if there is none.
     static void findBestSplit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, int& best_feature,
-                              double& best_threshold, double& best_gini);
+                              double& best_threshold, double& best_gini,
+                              const ExecutionPolicy& policy = ExecutionPolicy(), int min_samples_leaf = 1);
+
+    // Class counts of the given rows in every bin of every feature, for split search on a binned
+    // matrix: histogram[(X.binOffset(f) + b) * n_classes + k] is the number of rows of class k in bin b
+    // of feature f, and must hold X.totalBins() * n_classes entries. classes are class indices per row.
+    static void binHistogram(const BinnedMatrix& X, const int* classes, int n_classes, const int* rows,
+                             std::ptrdiff_t n, double* histogram, const ExecutionPolicy& policy = ExecutionPolicy());
+
+    // Best split from a histogram: the bins of each feature are swept in order, with the same Gini
+    // impurity and tie-breaking as the exact search. Left of best_bin are the rows with bin <= best_bin,
+    // i.e. with value <= X.threshold(best_feature, best_bin); best_feature is -1 if no split was found.
+    static void findBestSplit(const BinnedMatrix& X, const double* histogram, int n_classes, int& best_feature,
+                              int& best_bin, double& best_gini, const ExecutionPolicy& policy = ExecutionPolicy(),
+                              int min_samples_leaf = 1);
+
+    // Flatten a tree into arrays, without recursion
+    static FlatTree flatten(const TreeNode* root);
+
+    // Leaf index reached by every row of X, with the dispatched traversal kernel for shallow trees
+    static void findLeaves(const FlatTree& tree, const Eigen::MatrixXd& X, std::ptrdiff_t begin, std::ptrdiff_t end, int* leaves);
+    static void findLeaves(const FlatTree& tree, const Eigen::MatrixXf& X, std::ptrdiff_t begin, std::ptrdiff_t end, int* leaves);
 };
 
 } // namespace U
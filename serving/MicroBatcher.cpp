@@ -0,0 +1,195 @@
+#include "MicroBatcher.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include "U/Trace.hpp"
+
+namespace serve {
+
+namespace {
+
+// Latencies kept for the percentiles
+constexpr size_t kLatencyWindow = 1 << 16;
+
+double percentile(std::vector<double> values, double fraction) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t rank = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+} // namespace
+
+std::string ServingStats::toJson() const {
+    char json[512];
+    std::snprintf(json, sizeof(json),
+                  "{\"requests\":%llu,\"rows\":%llu,\"batches\":%llu,\"errors\":%llu,\"mean_batch_rows\":%.2f,"
+                  "\"p50_latency_us\":%.1f,\"p99_latency_us\":%.1f,\"max_latency_us\":%.1f,"
+                  "\"requests_per_second\":%.1f,\"rows_per_second\":%.1f,\"uptime_seconds\":%.3f}",
+                  static_cast<unsigned long long>(requests), static_cast<unsigned long long>(rows),
+                  static_cast<unsigned long long>(batches), static_cast<unsigned long long>(errors), mean_batch_rows,
+                  p50_latency_us, p99_latency_us, max_latency_us, requests_per_second, rows_per_second, uptime_seconds);
+    return json;
+}
+
+MicroBatcher::MicroBatcher(ScoreFunction score, BatcherOptions options)
+    : score_(std::move(score)), options_(options), start_(Clock::now()) {
+    if (options_.max_batch_rows <= 0) {
+        throw std::invalid_argument("max_batch_rows must be positive.");
+    }
+    latencies_us_.reserve(kLatencyWindow);
+    worker_ = std::thread([this]() { loop(); });
+}
+
+MicroBatcher::~MicroBatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    ready_.notify_all();
+    worker_.join();
+}
+
+std::future<Eigen::MatrixXd> MicroBatcher::submit(Eigen::MatrixXd rows) {
+    Request request;
+    request.rows = std::move(rows);
+    request.arrival = Clock::now();
+    std::future<Eigen::MatrixXd> result = request.result.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_) {
+            throw std::logic_error("MicroBatcher is shutting down.");
+        }
+        queued_rows_ += request.rows.rows();
+        queue_.push_back(std::move(request));
+    }
+
+    // Wakes the batching thread for the first request of a batch or when the batch is full
+    ready_.notify_one();
+    return result;
+}
+
+void MicroBatcher::loop() {
+    std::vector<Request> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            ready_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;  // Stopping and drained
+            }
+
+            // Hold the batch open until it is full or its oldest request reaches the latency budget
+            Clock::time_point deadline = queue_.front().arrival + options_.max_delay;
+            ready_.wait_until(lock, deadline, [this]() { return stopping_ || queued_rows_ >= options_.max_batch_rows; });
+
+            // Take whole requests up to max_batch_rows; a larger request is scored alone
+            Eigen::Index rows = 0;
+            while (!queue_.empty() && (batch.empty() || rows + queue_.front().rows.rows() <= options_.max_batch_rows)) {
+                rows += queue_.front().rows.rows();
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+            queued_rows_ -= rows;
+        }
+
+        scoreBatch(batch);
+        batch.clear();
+    }
+}
+
+void MicroBatcher::scoreBatch(std::vector<Request>& batch) {
+    U_TRACE_SCOPE("MicroBatcher::scoreBatch");
+    Eigen::Index rows = 0;
+    for (const auto& request : batch) {
+        rows += request.rows.rows();
+    }
+    U_TRACE_COUNT("MicroBatcher batch rows", rows);
+
+    try {
+        // Requests of different widths cannot share a matrix; the model rejects the odd ones out
+        Eigen::Index columns = batch.front().rows.cols();
+        for (const auto& request : batch) {
+            if (request.rows.cols() != columns) {
+                throw std::invalid_argument("Requests of one batch have different numbers of features.");
+            }
+        }
+
+        Eigen::MatrixXd X(rows, columns);
+        Eigen::Index offset = 0;
+        for (const auto& request : batch) {
+            X.middleRows(offset, request.rows.rows()) = request.rows;
+            offset += request.rows.rows();
+        }
+
+        Eigen::MatrixXd scores = score_(X);
+        if (scores.rows() != rows) {
+            throw std::logic_error("The scoring function returned the wrong number of rows.");
+        }
+
+        // Counted before the replies go out, so a client never sees counters missing its own request
+        record(batch, rows, false);
+        offset = 0;
+        for (auto& request : batch) {
+            request.result.set_value(scores.middleRows(offset, request.rows.rows()));
+            offset += request.rows.rows();
+        }
+    } catch (...) {
+        if (batch.size() > 1) {
+            // One bad request must not fail the others: score them one by one instead
+            for (auto& request : batch) {
+                std::vector<Request> single;
+                single.push_back(std::move(request));
+                scoreBatch(single);
+            }
+            return;
+        }
+        record(batch, rows, true);
+        batch.front().result.set_exception(std::current_exception());
+    }
+}
+
+void MicroBatcher::record(const std::vector<Request>& batch, Eigen::Index rows, bool failed) {
+    Clock::time_point now = Clock::now();
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    ++batches_;
+    rows_ += static_cast<uint64_t>(rows);
+    requests_ += batch.size();
+    errors_ += failed ? batch.size() : 0;
+    for (const auto& request : batch) {
+        double latency = std::chrono::duration<double, std::micro>(now - request.arrival).count();
+        if (latencies_us_.size() < kLatencyWindow) {
+            latencies_us_.push_back(latency);
+        } else {
+            latencies_us_[next_latency_] = latency;
+        }
+        next_latency_ = (next_latency_ + 1) % kLatencyWindow;
+    }
+}
+
+ServingStats MicroBatcher::stats() const {
+    ServingStats stats;
+    std::vector<double> latencies;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        stats.requests = requests_;
+        stats.rows = rows_;
+        stats.batches = batches_;
+        stats.errors = errors_;
+        latencies = latencies_us_;
+    }
+
+    stats.uptime_seconds = std::chrono::duration<double>(Clock::now() - start_).count();
+    stats.mean_batch_rows = stats.batches ? static_cast<double>(stats.rows) / stats.batches : 0.0;
+    stats.requests_per_second = stats.uptime_seconds > 0 ? stats.requests / stats.uptime_seconds : 0.0;
+    stats.rows_per_second = stats.uptime_seconds > 0 ? stats.rows / stats.uptime_seconds : 0.0;
+    stats.p50_latency_us = percentile(latencies, 0.50);
+    stats.p99_latency_us = percentile(latencies, 0.99);
+    stats.max_latency_us = latencies.empty() ? 0.0 : *std::max_element(latencies.begin(), latencies.end());
+    return stats;
+}
+
+} // namespace serve
@@ -0,0 +1,96 @@
+#ifndef SERVE_MICROBATCHER_HPP
+#define SERVE_MICROBATCHER_HPP
+
+#include <Eigen/Dense>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace serve {
+
+struct BatcherOptions {
+    Eigen::Index max_batch_rows = 512;               // A batch is scored as soon as it holds this many rows
+    std::chrono::microseconds max_delay{500};        // ... or when its oldest request has waited this long
+};
+
+// Snapshot of the serving counters
+struct ServingStats {
+    uint64_t requests = 0;
+    uint64_t rows = 0;
+    uint64_t batches = 0;
+    uint64_t errors = 0;
+    double mean_batch_rows = 0.0;
+    double p50_latency_us = 0.0;      // Queueing plus scoring, over the most recent requests
+    double p99_latency_us = 0.0;
+    double max_latency_us = 0.0;
+    double requests_per_second = 0.0; // Since start
+    double rows_per_second = 0.0;
+    double uptime_seconds = 0.0;
+
+    std::string toJson() const;
+};
+
+// Coalesces concurrent scoring requests into micro-batches. One thread concatenates the waiting
+// requests, scores them with a single call and hands every request its own rows of the result.
+class MicroBatcher {
+public:
+    using ScoreFunction = std::function<Eigen::MatrixXd(const Eigen::MatrixXd&)>;
+
+    MicroBatcher(ScoreFunction score, BatcherOptions options = BatcherOptions());
+
+    // Scores the requests still queued, then stops the batching thread
+    ~MicroBatcher();
+
+    MicroBatcher(const MicroBatcher&) = delete;
+    MicroBatcher& operator=(const MicroBatcher&) = delete;
+
+    // Thread safe. The future holds one row of scores per input row, or the scoring error.
+    std::future<Eigen::MatrixXd> submit(Eigen::MatrixXd rows);
+
+    ServingStats stats() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        Eigen::MatrixXd rows;
+        std::promise<Eigen::MatrixXd> result;
+        Clock::time_point arrival;
+    };
+
+    void loop();
+    void scoreBatch(std::vector<Request>& batch);
+    void record(const std::vector<Request>& batch, Eigen::Index rows, bool failed);
+
+    ScoreFunction score_;
+    BatcherOptions options_;
+
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<Request> queue_;
+    Eigen::Index queued_rows_ = 0;
+    bool stopping_ = false;
+
+    // Counters, and a ring of the latest latencies for the percentiles
+    mutable std::mutex stats_mutex_;
+    Clock::time_point start_;
+    uint64_t requests_ = 0;
+    uint64_t rows_ = 0;
+    uint64_t batches_ = 0;
+    uint64_t errors_ = 0;
+    std::vector<double> latencies_us_;
+    size_t next_latency_ = 0;
+
+    std::thread worker_;
+};
+
+} // namespace serve
+
+#endif // SERVE_MICROBATCHER_HPP
@@ -0,0 +1,185 @@
+#include "ModelChain.hpp"
+#include <fstream>
+#include <stdexcept>
+#include "U/Serialization.hpp"
+
+namespace serve {
+
+namespace {
+
+Eigen::MatrixXd scoreWith(const L::LogisticRegression& model, const Eigen::MatrixXd& X) {
+    // Probabilities are computed once and thresholded here rather than calling predict as well
+    Eigen::VectorXd probabilities = model.predict_proba(X);
+    Eigen::MatrixXd scores(X.rows(), 2);
+    scores.col(0) = (probabilities.array() >= model.threshold()).cast<double>();
+    scores.col(1) = probabilities;
+    return scores;
+}
+
+Eigen::MatrixXd scoreWith(const L::DecisionTreeClassifier& model, const Eigen::MatrixXd& X) {
+    Eigen::MatrixXd probabilities = model.predict_proba(X);
+    Eigen::MatrixXd scores(X.rows(), 1 + probabilities.cols());
+    scores.col(0) = model.predict(X);
+    scores.rightCols(probabilities.cols()) = probabilities;
+    return scores;
+}
+
+Eigen::MatrixXd scoreWith(const L::LinearRegression& model, const Eigen::MatrixXd& X) {
+    return model.predict(X);
+}
+
+Eigen::MatrixXd scoreWith(const L::SoftmaxRegression& model, const Eigen::MatrixXd& X) {
+    Eigen::MatrixXd probabilities = model.predict_proba(X);
+    Eigen::MatrixXd scores(X.rows(), 1 + probabilities.cols());
+    for (Eigen::Index i = 0; i < X.rows(); ++i) {
+        Eigen::Index best;
+        probabilities.row(i).maxCoeff(&best);
+        scores(i, 0) = model.classes()[best];
+    }
+    scores.rightCols(probabilities.cols()) = probabilities;
+    return scores;
+}
+
+// Number of input features an estimator expects, 0 when it does not record it
+Eigen::Index inputsOf(const L::LogisticRegression& model) { return model.coefficients().size(); }
+Eigen::Index inputsOf(const L::DecisionTreeClassifier& model) { return model.featureCount(); }
+Eigen::Index inputsOf(const L::LinearRegression& model) { return model.getCoefficients().size(); }
+Eigen::Index inputsOf(const L::SoftmaxRegression& model) { return model.coefficients().rows(); }
+
+} // namespace
+
+template <typename Model>
+struct ModelChain::EstimatorStage : ModelChain::Estimator {
+    explicit EstimatorStage(std::string kind) : kind(std::move(kind)) {}
+
+    Eigen::MatrixXd score(const Eigen::MatrixXd& X) const override { return scoreWith(model, X); }
+    void setExecutionPolicy(const U::ExecutionPolicy& policy) override { model.setExecutionPolicy(policy); }
+    std::string name() const override { return kind; }
+
+    Model model;
+    std::string kind;
+};
+
+ModelChain ModelChain::load(const std::string& filename) {
+    std::ifstream in(filename);
+    if (!in.is_open()) {
+        throw std::runtime_error("Failed to open model file: " + filename);
+    }
+
+    ModelChain chain;
+    Eigen::Index estimator_inputs = 0;
+    U::readHeader(in, "ModelChain");
+    auto stages = U::readValue<int>(in, "the number of stages");
+    for (int stage = 0; stage < stages; ++stage) {
+        auto kind = U::readValue<std::string>(in, "a stage kind");
+        if (chain.estimator_) {
+            throw std::runtime_error("Malformed model file: the estimator must be the last stage.");
+        }
+
+        // Width of the rows the next stage receives, 0 while unknown
+        Eigen::Index width = chain.transforms_.empty() ? 0 : chain.transforms_.back().eigen_vectors().cols();
+
+        if (kind == "pca") {
+            chain.transforms_.emplace_back();
+            chain.transforms_.back().load(in);
+            if (width != 0 && chain.transforms_.back().mean().size() != width) {
+                throw std::runtime_error("Malformed model file: consecutive transforms do not match.");
+            }
+            continue;
+        }
+
+        auto loadStage = [&](auto* stage) {
+            chain.estimator_.reset(stage);
+            stage->model.load(in);
+            estimator_inputs = inputsOf(stage->model);
+        };
+        if (kind == "logistic") {
+            loadStage(new EstimatorStage<L::LogisticRegression>(kind));
+        } else if (kind == "tree") {
+            loadStage(new EstimatorStage<L::DecisionTreeClassifier>(kind));
+        } else if (kind == "linear") {
+            loadStage(new EstimatorStage<L::LinearRegression>(kind));
+        } else if (kind == "softmax") {
+            loadStage(new EstimatorStage<L::SoftmaxRegression>(kind));
+        } else {
+            throw std::runtime_error("Malformed model file: unknown stage '" + kind + "'.");
+        }
+
+        if (width != 0 && estimator_inputs != 0 && width != estimator_inputs) {
+            throw std::runtime_error("Malformed model file: the estimator does not match the last transform.");
+        }
+    }
+    if (!chain.estimator_) {
+        throw std::runtime_error("Malformed model file: no estimator stage.");
+    }
+
+    chain.input_dimension_ = chain.transforms_.empty() ? estimator_inputs : chain.transforms_.front().mean().size();
+    return chain;
+}
+
+template <typename Model>
+void ModelChain::saveChain(const std::string& filename, const char* kind, const Model& model, const L::PrincipalComponentAnalysis* pca) {
+    std::ofstream out(filename);
+    if (!out.is_open()) {
+        throw std::runtime_error("Failed to open model file for writing: " + filename);
+    }
+
+    U::writeHeader(out, "ModelChain", 1);
+    out << (pca ? 2 : 1) << '\n';
+    if (pca) {
+        out << "pca\n";
+        pca->save(out);
+    }
+    out << kind << '\n';
+    model.save(out);
+
+    if (!out) {
+        throw std::runtime_error("Failed to write model file: " + filename);
+    }
+}
+
+void ModelChain::save(const std::string& filename, const L::LogisticRegression& model, const L::PrincipalComponentAnalysis* pca) {
+    saveChain(filename, "logistic", model, pca);
+}
+
+void ModelChain::save(const std::string& filename, const L::DecisionTreeClassifier& model, const L::PrincipalComponentAnalysis* pca) {
+    saveChain(filename, "tree", model, pca);
+}
+
+void ModelChain::save(const std::string& filename, const L::LinearRegression& model, const L::PrincipalComponentAnalysis* pca) {
+    saveChain(filename, "linear", model, pca);
+}
+
+void ModelChain::save(const std::string& filename, const L::SoftmaxRegression& model, const L::PrincipalComponentAnalysis* pca) {
+    saveChain(filename, "softmax", model, pca);
+}
+
+Eigen::MatrixXd ModelChain::score(const Eigen::MatrixXd& X) const {
+    if (input_dimension_ != 0 && X.cols() != input_dimension_) {
+        throw std::invalid_argument("Expected " + std::to_string(input_dimension_) + " features per row, got " +
+                                    std::to_string(X.cols()) + ".");
+    }
+    if (transforms_.empty()) {
+        return estimator_->score(X);
+    }
+
+    Eigen::MatrixXd features = transforms_.front().transform(X);
+    for (size_t i = 1; i < transforms_.size(); ++i) {
+        features = transforms_[i].transform(features);
+    }
+    return estimator_->score(features);
+}
+
+std::string ModelChain::describe() const {
+    std::string description;
+    for (const auto& transform : transforms_) {
+        description += "pca(" + std::to_string(transform.eigen_vectors().cols()) + ") -> ";
+    }
+    return description + estimator_->name();
+}
+
+void ModelChain::setExecutionPolicy(const U::ExecutionPolicy& policy) {
+    estimator_->setExecutionPolicy(policy);
+}
+
+} // namespace serve
@@ -0,0 +1,66 @@
+#ifndef SERVE_MODELCHAIN_HPP
+#define SERVE_MODELCHAIN_HPP
+
+#include <Eigen/Dense>
+#include <memory>
+#include <string>
+#include <vector>
+#include "L/DecisionTreeClassifier.hpp"
+#include "L/LinearRegression.hpp"
+#include "L/LogisticRegression.hpp"
+#include "L/PrincipalComponentAnalysis.hpp"
+#include "L/SoftmaxRegression.hpp"
+
+namespace serve {
+
+// A chain of optional PCA transforms followed by one estimator, loaded from a model file:
+//
+//   ModelChain 1
+//   <number of stages>
+//   <stage kind: pca | logistic | tree | linear | softmax>
+//   <the stage's own save() output>
+//   ...
+//
+// The last stage must be an estimator. Files are written with ModelChain::save.
+class ModelChain {
+public:
+    static ModelChain load(const std::string& filename);   // Throws std::runtime_error
+
+    // Write a chain file; pca may be null when the estimator takes raw features
+    static void save(const std::string& filename, const L::LogisticRegression& model, const L::PrincipalComponentAnalysis* pca = nullptr);
+    static void save(const std::string& filename, const L::DecisionTreeClassifier& model, const L::PrincipalComponentAnalysis* pca = nullptr);
+    static void save(const std::string& filename, const L::LinearRegression& model, const L::PrincipalComponentAnalysis* pca = nullptr);
+    static void save(const std::string& filename, const L::SoftmaxRegression& model, const L::PrincipalComponentAnalysis* pca = nullptr);
+
+    // Scores a batch of rows with one vectorized call per stage. Column 0 holds the prediction,
+    // the following columns the class probabilities when the estimator has them.
+    Eigen::MatrixXd score(const Eigen::MatrixXd& X) const;
+
+    Eigen::Index inputDimension() const { return input_dimension_; }  // 0 when the file does not say
+    std::string describe() const;                                    // e.g. "pca(5) -> logistic"
+
+    // Policy used by the stages to score a batch
+    void setExecutionPolicy(const U::ExecutionPolicy& policy);
+
+private:
+    // Type-erased final stage
+    struct Estimator {
+        virtual ~Estimator() = default;
+        virtual Eigen::MatrixXd score(const Eigen::MatrixXd& X) const = 0;
+        virtual void setExecutionPolicy(const U::ExecutionPolicy& policy) = 0;
+        virtual std::string name() const = 0;
+    };
+    template <typename Model>
+    struct EstimatorStage;
+
+    template <typename Model>
+    static void saveChain(const std::string& filename, const char* kind, const Model& model, const L::PrincipalComponentAnalysis* pca);
+
+    std::vector<L::PrincipalComponentAnalysis> transforms_;
+    std::shared_ptr<Estimator> estimator_;
+    Eigen::Index input_dimension_ = 0;
+};
+
+} // namespace serve
+
+#endif // SERVE_MODELCHAIN_HPP
@@ -0,0 +1,130 @@
+#include "Protocol.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace serve {
+
+Eigen::MatrixXd parseRows(const std::string& line) {
+    std::vector<double> values;
+    Eigen::Index columns = 0;
+    Eigen::Index rows = 0;
+    Eigen::Index in_row = 0;
+
+    const char* cursor = line.c_str();
+    const char* end = cursor + line.size();
+    while (cursor < end) {
+        char* parsed_end = nullptr;
+        double value = std::strtod(cursor, &parsed_end);
+        if (parsed_end == cursor) {
+            throw std::invalid_argument("Malformed number in request.");
+        }
+        values.push_back(value);
+        ++in_row;
+        cursor = parsed_end;
+
+        while (cursor < end && (*cursor == ' ' || *cursor == '\r')) {
+            ++cursor;
+        }
+        if (cursor < end && *cursor == ',') {
+            ++cursor;
+            continue;
+        }
+        if (cursor < end && *cursor != ';') {
+            throw std::invalid_argument("Unexpected character in request.");
+        }
+
+        // End of a row
+        if (rows == 0) {
+            columns = in_row;
+        } else if (in_row != columns) {
+            throw std::invalid_argument("All rows of a request must have the same number of features.");
+        }
+        ++rows;
+        in_row = 0;
+        if (cursor < end) {
+            ++cursor;
+        }
+    }
+    if (in_row != 0) {
+        throw std::invalid_argument("Request ends in the middle of a row.");
+    }
+    if (rows == 0) {
+        throw std::invalid_argument("Empty request.");
+    }
+
+    return Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(values.data(), rows, columns);
+}
+
+std::string formatRows(const Eigen::MatrixXd& rows) {
+    std::string out;
+    char number[32];
+    for (Eigen::Index i = 0; i < rows.rows(); ++i) {
+        if (i > 0) {
+            out += ';';
+        }
+        for (Eigen::Index j = 0; j < rows.cols(); ++j) {
+            if (j > 0) {
+                out += ',';
+            }
+            std::snprintf(number, sizeof(number), "%.17g", rows(i, j));
+            out += number;
+        }
+    }
+    return out;
+}
+
+bool LineReader::next(std::string& line) {
+    while (true) {
+        size_t newline = buffer_.find('\n', start_);
+        if (newline != std::string::npos) {
+            line.assign(buffer_, start_, newline - start_);
+            start_ = newline + 1;
+            return true;
+        }
+
+        // Keep the partial line, then read more
+        buffer_.erase(0, start_);
+        start_ = 0;
+        char chunk[65536];
+        ssize_t received = ::read(fd_, chunk, sizeof(chunk));
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            // A last line without a newline still counts
+            if (!buffer_.empty()) {
+                line.swap(buffer_);
+                buffer_.clear();
+                return true;
+            }
+            return false;
+        }
+        buffer_.append(chunk, static_cast<size_t>(received));
+    }
+}
+
+bool writeAll(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        // send() with MSG_NOSIGNAL keeps a closed socket from raising SIGPIPE; stdout is not a socket
+        ssize_t count = ::send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (count < 0 && errno == ENOTSOCK) {
+            count = ::write(fd, data.data() + written, data.size() - written);
+        }
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        written += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+} // namespace serve
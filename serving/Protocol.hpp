@@ -0,0 +1,39 @@
+#ifndef SERVE_PROTOCOL_HPP
+#define SERVE_PROTOCOL_HPP
+
+#include <Eigen/Dense>
+#include <string>
+
+namespace serve {
+
+// Line protocol shared by the daemon and the load generator.
+//   request:  rows separated by ';', features separated by ','      e.g. "1.5,2,0.3;4,5,6"
+//   response: one row of scores per request row, in the same format
+//   "STATS" returns the serving counters as one JSON object; errors come back as "ERR <message>"
+
+// Parses a request line; throws std::invalid_argument on a malformed line or ragged rows
+Eigen::MatrixXd parseRows(const std::string& line);
+
+// Formats rows with enough digits to round trip
+std::string formatRows(const Eigen::MatrixXd& rows);
+
+// Buffered line reader over a file descriptor (socket or stdin)
+class LineReader {
+public:
+    explicit LineReader(int fd) : fd_(fd) {}
+
+    // False on end of file or error
+    bool next(std::string& line);
+
+private:
+    int fd_;
+    std::string buffer_;
+    size_t start_ = 0;
+};
+
+// Writes the whole string, retrying on partial writes; false if the peer went away
+bool writeAll(int fd, const std::string& data);
+
+} // namespace serve
+
+#endif // SERVE_PROTOCOL_HPP
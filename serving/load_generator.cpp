@@ -0,0 +1,157 @@
+// ml_loadgen: closed-loop load generator for ml_serve.
+//
+//   ml_loadgen --socket PATH --features D [--connections 16] [--requests 20000] [--rows 1] [--seed 0]
+//
+// Every connection sends its next request as soon as the previous reply arrives, with random
+// feature values. Prints the client-side throughput and latency percentiles, then the daemon's counters.
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "Protocol.hpp"
+
+namespace {
+
+struct Options {
+    std::string socket;
+    int features = 0;
+    int connections = 16;
+    long requests = 20000;
+    int rows = 1;
+    unsigned int seed = 0;
+};
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        const char* value = argv[i + 1];
+        if (flag == "--socket") {
+            options.socket = value;
+        } else if (flag == "--features") {
+            options.features = std::atoi(value);
+        } else if (flag == "--connections") {
+            options.connections = std::atoi(value);
+        } else if (flag == "--requests") {
+            options.requests = std::atol(value);
+        } else if (flag == "--rows") {
+            options.rows = std::atoi(value);
+        } else if (flag == "--seed") {
+            options.seed = static_cast<unsigned int>(std::atol(value));
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && !options.socket.empty() && options.features > 0 && options.connections > 0 &&
+           options.requests > 0 && options.rows > 0;
+}
+
+int connectTo(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+double percentile(std::vector<double>& values, double fraction) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    size_t rank = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cerr << "usage: ml_loadgen --socket PATH --features D [--connections N] [--requests N] [--rows N] [--seed N]" << std::endl;
+        return 2;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    std::vector<std::vector<double>> latencies(options.connections);
+    std::vector<long> errors(options.connections, 0);
+    std::vector<std::thread> clients;
+
+    Clock::time_point start = Clock::now();
+    for (int c = 0; c < options.connections; ++c) {
+        // Requests are split evenly; the first connections take the remainder
+        long share = options.requests / options.connections + (c < options.requests % options.connections ? 1 : 0);
+        clients.emplace_back([&options, &latencies, &errors, c, share]() {
+            int fd = connectTo(options.socket);
+            if (fd < 0) {
+                errors[c] = share;
+                return;
+            }
+
+            std::mt19937 generator(options.seed + c);
+            std::normal_distribution<double> normal(0.0, 1.0);
+            Eigen::MatrixXd rows(options.rows, options.features);
+            serve::LineReader reader(fd);
+            std::string reply;
+            latencies[c].reserve(share);
+
+            for (long r = 0; r < share; ++r) {
+                for (Eigen::Index i = 0; i < rows.size(); ++i) {
+                    rows(i) = normal(generator);
+                }
+                std::string request = serve::formatRows(rows) + '\n';
+
+                Clock::time_point sent = Clock::now();
+                if (!serve::writeAll(fd, request) || !reader.next(reply)) {
+                    errors[c] += share - r;
+                    break;
+                }
+                latencies[c].push_back(std::chrono::duration<double, std::micro>(Clock::now() - sent).count());
+                if (reply.compare(0, 4, "ERR ") == 0) {
+                    ++errors[c];
+                }
+            }
+            ::close(fd);
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::vector<double> all;
+    long failed = 0;
+    for (int c = 0; c < options.connections; ++c) {
+        all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+        failed += errors[c];
+    }
+
+    std::cout << "requests:        " << all.size() << " (" << failed << " errors)" << std::endl;
+    std::cout << "throughput:      " << all.size() / elapsed << " requests/s, "
+              << all.size() * options.rows / elapsed << " rows/s" << std::endl;
+    std::cout << "latency p50:     " << percentile(all, 0.50) << " us" << std::endl;
+    std::cout << "latency p99:     " << percentile(all, 0.99) << " us" << std::endl;
+
+    // Server-side counters
+    int fd = connectTo(options.socket);
+    if (fd >= 0) {
+        serve::LineReader reader(fd);
+        std::string stats;
+        if (serve::writeAll(fd, "STATS\n") && reader.next(stats)) {
+            std::cout << "server:          " << stats << std::endl;
+        }
+        ::close(fd);
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,266 @@
+// ml_serve: scores requests with a saved model chain, coalescing concurrent requests into micro-batches.
+//
+//   ml_serve --model model.txt [--socket /tmp/ml_serve.sock] [--max-batch-rows 512] [--max-delay-us 500] [--threads N]
+//
+// Without --socket, requests are read from stdin and answered on stdout in order; lines are
+// pipelined so consecutive requests still share batches, and STATS counts every request before
+// it. See Protocol.hpp for the line format.
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "MicroBatcher.hpp"
+#include "ModelChain.hpp"
+#include "Protocol.hpp"
+
+namespace {
+
+std::atomic<bool> stop_requested{false};
+int listen_fd = -1;
+
+void onSignal(int) {
+    stop_requested = true;
+    if (listen_fd >= 0) {
+        ::shutdown(listen_fd, SHUT_RDWR);  // Unblocks accept()
+    }
+}
+
+struct Options {
+    std::string model;
+    std::string socket;
+    serve::BatcherOptions batcher;
+    int threads = 0;
+};
+
+void usage() {
+    std::cerr << "usage: ml_serve --model FILE [--socket PATH] [--max-batch-rows N] [--max-delay-us N] [--threads N]" << std::endl;
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        if (flag == "--model") {
+            options.model = value;
+        } else if (flag == "--socket") {
+            options.socket = value;
+        } else if (flag == "--max-batch-rows") {
+            options.batcher.max_batch_rows = std::atol(value.c_str());
+        } else if (flag == "--max-delay-us") {
+            options.batcher.max_delay = std::chrono::microseconds(std::atol(value.c_str()));
+        } else if (flag == "--threads") {
+            options.threads = std::atoi(value.c_str());
+        } else {
+            return false;
+        }
+    }
+    return !options.model.empty() && options.batcher.max_batch_rows > 0;
+}
+
+// Reply to one request line, waiting for its batch
+std::string answer(serve::MicroBatcher& batcher, const std::string& line) {
+    if (line == "STATS") {
+        return batcher.stats().toJson();
+    }
+    try {
+        return serve::formatRows(batcher.submit(serve::parseRows(line)).get());
+    } catch (const std::exception& error) {
+        return std::string("ERR ") + error.what();
+    }
+}
+
+// Open client connections, so shutdown can close them and wait for their threads
+struct Connections {
+    std::mutex mutex;
+    std::condition_variable closed;
+    std::set<int> open;
+};
+
+void serveConnection(serve::MicroBatcher& batcher, Connections& connections, int fd) {
+    serve::LineReader reader(fd);
+    std::string line;
+    while (!stop_requested && reader.next(line)) {
+        if (line.empty()) {
+            continue;
+        }
+        if (!serve::writeAll(fd, answer(batcher, line) + '\n')) {
+            break;
+        }
+    }
+
+    // Forget the descriptor before closing it, as accept() may hand the number out again
+    std::lock_guard<std::mutex> lock(connections.mutex);
+    connections.open.erase(fd);
+    ::close(fd);
+    connections.closed.notify_all();
+}
+
+int serveSocket(serve::MicroBatcher& batcher, const std::string& path) {
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path too long: " << path << std::endl;
+        return 1;
+    }
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    ::unlink(path.c_str());
+    if (listen_fd < 0 || ::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listen_fd, SOMAXCONN) < 0) {
+        std::cerr << "Failed to listen on " << path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    std::cerr << "Listening on " << path << std::endl;
+
+    // One thread per connection; they block on their own requests while the batcher coalesces them
+    Connections connections;
+    while (!stop_requested) {
+        int client = ::accept(listen_fd, nullptr, nullptr);
+        if (client < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        std::lock_guard<std::mutex> lock(connections.mutex);
+        connections.open.insert(client);
+        std::thread(serveConnection, std::ref(batcher), std::ref(connections), client).detach();
+    }
+
+    ::close(listen_fd);
+    ::unlink(path.c_str());
+
+    // Wake the client threads and wait for them before the batcher goes away
+    std::unique_lock<std::mutex> lock(connections.mutex);
+    for (int fd : connections.open) {
+        ::shutdown(fd, SHUT_RDWR);
+    }
+    connections.closed.wait(lock, [&connections]() { return connections.open.empty(); });
+    return 0;
+}
+
+int serveStdin(serve::MicroBatcher& batcher) {
+    // The reader submits without waiting and the writer answers in order, so a piped stream
+    // of requests fills batches instead of being scored one line at a time
+    struct Pending {
+        std::string immediate;                        // Parse errors
+        std::future<Eigen::MatrixXd> scores;
+        bool stats = false;                           // STATS, read once every earlier request is answered
+    };
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Pending> pending;
+    bool done = false;
+    constexpr size_t kMaxInFlight = 4096;
+
+    std::thread writer([&]() {
+        while (true) {
+            Pending next;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&]() { return done || !pending.empty(); });
+                if (pending.empty()) {
+                    return;
+                }
+                next = std::move(pending.front());
+                pending.pop_front();
+            }
+            changed.notify_all();
+
+            std::string reply = next.immediate;
+            if (next.stats) {
+                reply = batcher.stats().toJson();
+            } else if (next.scores.valid()) {
+                try {
+                    reply = serve::formatRows(next.scores.get());
+                } catch (const std::exception& error) {
+                    reply = std::string("ERR ") + error.what();
+                }
+            }
+            serve::writeAll(STDOUT_FILENO, reply + '\n');
+        }
+    });
+
+    serve::LineReader reader(STDIN_FILENO);
+    std::string line;
+    while (!stop_requested && reader.next(line)) {
+        if (line.empty()) {
+            continue;
+        }
+        Pending request;
+        if (line == "STATS") {
+            request.stats = true;
+        } else {
+            try {
+                request.scores = batcher.submit(serve::parseRows(line));
+            } catch (const std::exception& error) {
+                request.immediate = std::string("ERR ") + error.what();
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]() { return pending.size() < kMaxInFlight; });
+        pending.push_back(std::move(request));
+        lock.unlock();
+        changed.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    changed.notify_all();
+    writer.join();
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+
+    serve::ModelChain model;
+    try {
+        model = serve::ModelChain::load(options.model);
+    } catch (const std::exception& error) {
+        std::cerr << error.what() << std::endl;
+        return 1;
+    }
+    if (options.threads > 0) {
+        U::ExecutionPolicy::setDefault(U::ExecutionPolicy::threads(options.threads));
+        model.setExecutionPolicy(U::ExecutionPolicy());
+    }
+    std::cerr << "Serving " << model.describe() << " (batches of up to " << options.batcher.max_batch_rows
+              << " rows, " << options.batcher.max_delay.count() << " us budget)" << std::endl;
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int status;
+    {
+        serve::MicroBatcher batcher([&model](const Eigen::MatrixXd& X) { return model.score(X); }, options.batcher);
+        status = options.socket.empty() ? serveStdin(batcher) : serveSocket(batcher, options.socket);
+        std::cerr << batcher.stats().toJson() << std::endl;
+    }
+    return status;
+}
@@ -0,0 +1,160 @@
+#include "L/AsyncChunkLoader.hpp"
+#include "L/CSVChunkReader.hpp"
+#include "U/Trace.hpp"
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+namespace L {
+
+AsyncChunkLoader::AsyncChunkLoader(Source source, size_t depth, std::function<void()> rewind)
+    : source_(std::move(source)), rewind_(std::move(rewind)), has_target_(true), ring_(depth) {
+    if (depth == 0) {
+        throw std::invalid_argument("depth must be positive.");
+    }
+    start();
+}
+
+AsyncChunkLoader::AsyncChunkLoader(FeatureSource source, size_t depth, std::function<void()> rewind)
+    : AsyncChunkLoader(Source([source = std::move(source)](Eigen::MatrixXd& X, Eigen::VectorXd&) { return source(X); }),
+                       depth, std::move(rewind)) {
+    has_target_ = false;
+}
+
+AsyncChunkLoader::AsyncChunkLoader(const std::string& filename, const std::vector<std::string>& feature_columns,
+                                   const std::string& target_column, size_t chunk_rows, size_t depth)
+    : reader_(std::make_unique<CSVChunkReader>(filename, feature_columns, target_column, chunk_rows)),
+      has_target_(!target_column.empty()), ring_(depth) {
+    if (depth == 0) {
+        throw std::invalid_argument("depth must be positive.");
+    }
+    CSVChunkReader* reader = reader_.get();
+    if (has_target_) {
+        source_ = [reader](Eigen::MatrixXd& X, Eigen::VectorXd& y) { return reader->next(X, y); };
+    } else {
+        source_ = [reader](Eigen::MatrixXd& X, Eigen::VectorXd&) { return reader->next(X); };
+    }
+    rewind_ = [reader]() { reader->reset(); };
+    start();
+}
+
+AsyncChunkLoader::~AsyncChunkLoader() {
+    stop();
+}
+
+void AsyncChunkLoader::start() {
+    free_.clear();
+    ready_.clear();
+    for (size_t i = 0; i < ring_.size(); ++i) {
+        free_.push_back(i);
+    }
+    exhausted_ = false;
+    stopping_ = false;
+    error_ = nullptr;
+    thread_ = std::thread(&AsyncChunkLoader::load, this);
+}
+
+void AsyncChunkLoader::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    freed_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+}
+
+void AsyncChunkLoader::load() {
+    while (true) {
+        size_t slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            freed_.wait(lock, [this]() { return stopping_ || !free_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            slot = free_.front();
+            free_.pop_front();
+        }
+
+        // Outside the lock: the consumer keeps taking the chunks already loaded meanwhile
+        bool loaded = false;
+        std::exception_ptr error;
+        try {
+            U_TRACE_SCOPE("AsyncChunkLoader::load");
+            loaded = source_(ring_[slot].X, ring_[slot].y);
+        } catch (...) {
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (loaded) {
+                ready_.push_back(slot);
+            } else {
+                free_.push_back(slot);
+                exhausted_ = true;
+                error_ = error;
+            }
+        }
+        filled_.notify_one();
+        if (!loaded) {
+            return;
+        }
+    }
+}
+
+bool AsyncChunkLoader::take(Eigen::MatrixXd& X, Eigen::VectorXd* y) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (ready_.empty() && !exhausted_) {
+        U_TRACE_SCOPE("AsyncChunkLoader::wait");
+        const auto start = std::chrono::steady_clock::now();
+        filled_.wait(lock, [this]() { return !ready_.empty() || exhausted_; });
+        wait_seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+    if (ready_.empty()) {
+        if (error_) {
+            std::rethrow_exception(error_);
+        }
+        return false;
+    }
+
+    const size_t slot = ready_.front();
+    ready_.pop_front();
+    X.swap(ring_[slot].X);
+    if (y) {
+        y->swap(ring_[slot].y);
+    }
+    free_.push_back(slot);
+    lock.unlock();
+    freed_.notify_one();
+    return true;
+}
+
+bool AsyncChunkLoader::next(Eigen::MatrixXd& X, Eigen::VectorXd& y) {
+    if (!has_target_) {
+        throw std::logic_error("AsyncChunkLoader was created without a target.");
+    }
+    return take(X, &y);
+}
+
+bool AsyncChunkLoader::next(Eigen::MatrixXd& X) {
+    return take(X, nullptr);
+}
+
+void AsyncChunkLoader::reset() {
+    if (!rewind_) {
+        throw std::logic_error("AsyncChunkLoader was created without a way to rewind its source.");
+    }
+    stop();
+    rewind_();
+    start();
+}
+
+double AsyncChunkLoader::waitSeconds() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return wait_seconds_;
+}
+
+} // namespace L
@@ -0,0 +1,156 @@
+#include "L/CSVChunkReader.hpp"
+#include "U/Trace.hpp"
+#include "U/Kernels.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace L {
+
+CSVChunkReader::CSVChunkReader(const std::string& filename, const std::vector<std::string>& feature_columns,
+                               const std::string& target_column, size_t chunk_rows)
+    : file_(filename), chunk_rows_(chunk_rows) {
+    if (chunk_rows_ == 0) {
+        throw std::invalid_argument("chunk_rows must be positive.");
+    }
+    if (!file_.is_open()) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return;
+    }
+
+    // Resolve the requested columns against the header
+    std::string header;
+    std::getline(file_, header);
+    std::vector<std::string> names;
+    std::istringstream header_stream(header);
+    std::string cell;
+    while (std::getline(header_stream, cell, ',')) {
+        names.push_back(cell);
+    }
+
+    auto position = [&names](const std::string& name) -> size_t {
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (names[i] == name) {
+                return i;
+            }
+        }
+        throw std::runtime_error("Column '" + name + "' does not exist in the CSV header.");
+    };
+
+    for (const auto& name : feature_columns) {
+        feature_indices_.push_back(position(name));
+    }
+    if (!target_column.empty()) {
+        target_index_ = static_cast<long>(position(target_column));
+    }
+
+    data_start_ = file_.tellg();
+    position_ = data_start_;
+}
+
+void CSVChunkReader::restrictToShard(size_t shard, size_t shards) {
+    if (shards == 0 || shard >= shards) {
+        throw std::invalid_argument("shard must be in [0, shards).");
+    }
+    if (!file_.is_open()) {
+        return;
+    }
+    file_.clear();
+    file_.seekg(0, std::ios::end);
+    const std::streamoff first = data_start_;
+    const std::streamoff size = static_cast<std::streamoff>(file_.tellg()) - first;
+    const std::streamoff begin = first + static_cast<std::streamoff>(size * shard / shards);
+    end_ = first + static_cast<std::streamoff>(size * (shard + 1) / shards);
+
+    // A line cut by the start of the range belongs to the previous shard
+    position_ = begin;
+    if (begin > first) {
+        file_.seekg(begin - 1);
+        if (file_.get() != '\n') {
+            std::string rest;
+            std::getline(file_, rest);
+            position_ += static_cast<std::streamoff>(rest.size()) + 1;
+        }
+    }
+    file_.clear();
+    file_.seekg(position_);
+    data_start_ = position_;
+    rows_read_ = 0;
+}
+
+bool CSVChunkReader::next(Eigen::MatrixXd& X, Eigen::VectorXd& y) {
+    if (target_index_ < 0) {
+        throw std::logic_error("CSVChunkReader was created without a target column.");
+    }
+    return readChunk(X, &y);
+}
+
+bool CSVChunkReader::next(Eigen::MatrixXd& X) {
+    return readChunk(X, nullptr);
+}
+
+void CSVChunkReader::reset() {
+    file_.clear();
+    file_.seekg(data_start_);
+    position_ = data_start_;
+    rows_read_ = 0;
+}
+
+bool CSVChunkReader::readChunk(Eigen::MatrixXd& X, Eigen::VectorXd* y) {
+    U_TRACE_SCOPE("CSVChunkReader::next");
+    if (!file_.is_open()) {
+        return false;
+    }
+
+    // Resizing to the same shape is free, so only the last, shorter block reallocates
+    X.resize(chunk_rows_, feature_indices_.size());
+    if (y) {
+        y->resize(chunk_rows_);
+    }
+
+    std::string line;
+    std::vector<double> cells;
+    size_t rows = 0;
+    while (rows < chunk_rows_ && (end_ < 0 || position_ < end_) && std::getline(file_, line)) {
+        position_ += static_cast<std::streamoff>(line.size()) + 1;
+        if (line.empty()) {
+            continue;
+        }
+
+        // Non-numeric cells are kept as NaN and rejected below only if they are used
+        size_t fields = U::parseFields(line.data(), line.data() + line.size(), ',', cells.data(), cells.size());
+        if (fields > cells.size()) {
+            cells.resize(fields);
+            U::parseFields(line.data(), line.data() + line.size(), ',', cells.data(), cells.size());
+        }
+        cells.resize(fields);
+
+        for (size_t j = 0; j < feature_indices_.size(); ++j) {
+            if (feature_indices_[j] >= cells.size() || std::isnan(cells[feature_indices_[j]])) {
+                throw std::invalid_argument("Non-numeric value in CSV feature column at data row " + std::to_string(rows_read_ + rows));
+            }
+            X(rows, j) = cells[feature_indices_[j]];
+        }
+        if (y) {
+            if (static_cast<size_t>(target_index_) >= cells.size() || std::isnan(cells[target_index_])) {
+                throw std::invalid_argument("Non-numeric value in CSV target column at data row " + std::to_string(rows_read_ + rows));
+            }
+            (*y)(rows) = cells[target_index_];
+        }
+        ++rows;
+    }
+
+    if (rows < chunk_rows_) {
+        X.conservativeResize(rows, Eigen::NoChange);
+        if (y) {
+            y->conservativeResize(rows);
+        }
+    }
+    rows_read_ += rows;
+    return rows > 0;
+}
+
+} // namespace L
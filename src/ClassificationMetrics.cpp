@@ -1,56 +1,123 @@
 #include "L/ClassificationMetrics.hpp"
+#include "U/Trace.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
 
 namespace L {
 
-// Constructor
-ClassificationMetrics::ClassificationMetrics(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true, const std::vector<int>& classes)
-    : predictions_(predictions), y_true_(y_true), classes_(classes) {}
+namespace {
 
+// Rows counted per parallel chunk by the one-shot constructor
+constexpr std::ptrdiff_t kChunkRows = 65536;
 
+} // namespace
 
-void ClassificationMetrics::check_computed(){
-    if(confusion_matrix_.size() == 0){
-        confusion_matrix_ = confusion_matrix();
+namespace {
+
+// Largest label range served by the dense lookup table
+constexpr long kMaxLabelTableSize = 1 << 16;
+
+} // namespace
+
+ClassificationMetricsAccumulator::ClassificationMetricsAccumulator(const std::vector<int>& classes)
+    : classes_(classes) {
+    if (classes_.empty()) {
+        throw std::invalid_argument("classes must not be empty.");
     }
-}
 
-// Confusion matrix
-Eigen::MatrixXd ClassificationMetrics::confusion_matrix() const {
-    if(confusion_matrix_.size() == 0){
-        Eigen::MatrixXd matrix = Eigen::MatrixXd::Zero(classes_.size(), classes_.size());
+    auto [min_it, max_it] = std::minmax_element(classes_.begin(), classes_.end());
+    long range = static_cast<long>(*max_it) - *min_it + 1;
+    if (range <= kMaxLabelTableSize) {
+        min_label_ = *min_it;
+        label_table_.assign(range, -1);
+    }
 
-        for (size_t i = 0; i < predictions_.size(); ++i) {
-            int actual = y_true_[i];
-            int predicted = predictions_[i];
-            matrix(actual, predicted)++;
+    for (size_t k = 0; k < classes_.size(); ++k) {
+        if (!label_table_.empty()) {
+            if (label_table_[classes_[k] - min_label_] != -1) {
+                throw std::invalid_argument("classes must not contain duplicates.");
+            }
+            label_table_[classes_[k] - min_label_] = static_cast<int>(k);
+        } else if (!label_map_.emplace(classes_[k], static_cast<int>(k)).second) {
+            throw std::invalid_argument("classes must not contain duplicates.");
         }
+    }
+
+    confusion_matrix_ = Eigen::MatrixXd::Zero(classes_.size(), classes_.size());
+}
+
+int ClassificationMetricsAccumulator::classIndex(int label) const {
+    int index = -1;
+    if (!label_table_.empty()) {
+        long offset = static_cast<long>(label) - min_label_;
+        if (offset >= 0 && offset < static_cast<long>(label_table_.size())) {
+            index = label_table_[offset];
+        }
+    } else {
+        auto it = label_map_.find(label);
+        if (it != label_map_.end()) {
+            index = it->second;
+        }
+    }
 
-        return matrix;
+    if (index < 0) {
+        throw std::invalid_argument("Label " + std::to_string(label) + " is not in the list of classes.");
+    }
+    return index;
+}
 
-    }else{
+void ClassificationMetricsAccumulator::update(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true) {
+    fold(predictions, y_true);
+}
 
-        return confusion_matrix_;
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+void ClassificationMetricsAccumulator::update(const U::DenseVector<Scalar>& predictions, const U::DenseVector<Scalar>& y_true) {
+    fold(predictions, y_true);
+}
+
+template void ClassificationMetricsAccumulator::update<float>(const Eigen::VectorXf&, const Eigen::VectorXf&);
+
+template <typename Vector>
+void ClassificationMetricsAccumulator::fold(const Vector& predictions, const Vector& y_true) {
+    U_TRACE_SCOPE("ClassificationMetrics::update");
+    if (predictions.size() != y_true.size()) {
+        throw std::invalid_argument("Predictions and actual values must have the same length.");
+    }
 
+    for (Eigen::Index i = 0; i < predictions.size(); ++i) {
+        int actual = classIndex(static_cast<int>(y_true[i]));
+        int predicted = classIndex(static_cast<int>(predictions[i]));
+        confusion_matrix_(actual, predicted)++;
     }
+    count_ += predictions.size();
 }
 
-// Accuracy
-double ClassificationMetrics::accuracy() {
-    check_computed();
+void ClassificationMetricsAccumulator::merge(const ClassificationMetricsAccumulator& other) {
+    if (other.classes_ != classes_) {
+        throw std::invalid_argument("Cannot merge accumulators with different classes.");
+    }
+    confusion_matrix_ += other.confusion_matrix_;
+    count_ += other.count_;
+}
 
-    int correct = 0;
-    for (int i = 0; i < confusion_matrix_.rows(); ++i) {
-        correct += confusion_matrix_(i, i);
+Eigen::MatrixXd ClassificationMetricsAccumulator::confusion_matrix() const {
+    return confusion_matrix_;
+}
+
+// Accuracy
+double ClassificationMetricsAccumulator::accuracy() const {
+    if (count_ == 0) {
+        return 0.0;
     }
-    return static_cast<double>(correct) / predictions_.size();
+    return confusion_matrix_.diagonal().sum() / count_;
 }
 
 // Precision for a specific class
-double ClassificationMetrics::precision(int class_label) {
-    check_computed();
-
-    double true_positive = confusion_matrix_(class_label, class_label);
-    double false_positive = confusion_matrix_.col(class_label).sum() - true_positive;
+double ClassificationMetricsAccumulator::precision(int class_label) const {
+    int k = classIndex(class_label);
+    double true_positive = confusion_matrix_(k, k);
+    double false_positive = confusion_matrix_.col(k).sum() - true_positive;
 
     if (true_positive + false_positive == 0) {
         return 0.0;
@@ -59,13 +126,11 @@ double ClassificationMetrics::precision(int class_label) {
     return true_positive / (true_positive + false_positive);
 }
 
-
 // Recall for a specific class
-double ClassificationMetrics::recall(int class_label) {
-    check_computed();
-
-    double true_positive = confusion_matrix_(class_label, class_label);
-    double false_negative = confusion_matrix_.row(class_label).sum() - true_positive;
+double ClassificationMetricsAccumulator::recall(int class_label) const {
+    int k = classIndex(class_label);
+    double true_positive = confusion_matrix_(k, k);
+    double false_negative = confusion_matrix_.row(k).sum() - true_positive;
 
     if (true_positive + false_negative == 0) {
         return 0.0;
@@ -74,12 +139,69 @@ double ClassificationMetrics::recall(int class_label) {
     return true_positive / (true_positive + false_negative);
 }
 
-
 // F1 Score for a specific class
-double ClassificationMetrics::f1_score(int class_label) {
+double ClassificationMetricsAccumulator::f1_score(int class_label) const {
     double prec = precision(class_label);
     double rec = recall(class_label);
     return (prec + rec) > 0 ? 2 * (prec * rec) / (prec + rec) : 0.0;
 }
 
+// Constructor: a single pass fills the confusion matrix, the inputs are not copied
+ClassificationMetrics::ClassificationMetrics(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true, const std::vector<int>& classes,
+                                             const U::ExecutionPolicy& policy)
+    : accumulator_(classes) {
+    accumulate(predictions, y_true, policy);
+}
+
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+ClassificationMetrics::ClassificationMetrics(const U::DenseVector<Scalar>& predictions, const U::DenseVector<Scalar>& y_true,
+                                             const std::vector<int>& classes, const U::ExecutionPolicy& policy)
+    : accumulator_(classes) {
+    accumulate(predictions, y_true, policy);
+}
+
+template ClassificationMetrics::ClassificationMetrics<float>(const Eigen::VectorXf&, const Eigen::VectorXf&, const std::vector<int>&,
+                                                             const U::ExecutionPolicy&);
+
+template <typename Vector>
+void ClassificationMetrics::accumulate(const Vector& predictions, const Vector& y_true, const U::ExecutionPolicy& policy) {
+    if (predictions.size() != y_true.size()) {
+        throw std::invalid_argument("Predictions and actual values must have the same length.");
+    }
+
+    // Chunks start from copies of the empty accumulator, so the label table is built once
+    const ClassificationMetricsAccumulator empty = accumulator_;
+    accumulator_ = policy.parallel_reduce(
+        0, predictions.size(), kChunkRows, empty,
+        [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+            ClassificationMetricsAccumulator partial = empty;
+            partial.fold(predictions.segment(begin, end - begin), y_true.segment(begin, end - begin));
+            return partial;
+        },
+        [](ClassificationMetricsAccumulator total, const ClassificationMetricsAccumulator& partial) {
+            total.merge(partial);
+            return total;
+        });
+}
+
+Eigen::MatrixXd ClassificationMetrics::confusion_matrix() const {
+    return accumulator_.confusion_matrix();
+}
+
+double ClassificationMetrics::accuracy() const {
+    return accumulator_.accuracy();
+}
+
+double ClassificationMetrics::precision(int class_label) const {
+    return accumulator_.precision(class_label);
+}
+
+double ClassificationMetrics::recall(int class_label) const {
+    return accumulator_.recall(class_label);
+}
+
+double ClassificationMetrics::f1_score(int class_label) const {
+    return accumulator_.f1_score(class_label);
+}
+
 } // namespace L
@@ -0,0 +1,612 @@
+#include "L/CompressedDataFrame.hpp"
+#include "U/Kernels.hpp"
+#include "U/Trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace L {
+
+namespace {
+
+// Lines parsed per parallel chunk, as in DataFrame::readCSV
+constexpr std::ptrdiff_t kParseRows = 4096;
+
+// Rows decoded at a time by the row-oriented scans (toSparseMatrix, sum)
+constexpr size_t kScanRows = 1024;
+
+// Integral doubles up to this magnitude are exact as int64 and are bit-packed like integers
+constexpr double kMaxExactInteger = 9007199254740992.0;   // 2^53
+
+int bitWidth(std::uint64_t range) {
+    int bits = 0;
+    while (range != 0) {
+        ++bits;
+        range >>= 1;
+    }
+    return bits;
+}
+
+// Words for count values of the given width, plus the spare word the unpack kernel reads past the end
+size_t packedWords(size_t count, int bits) {
+    return count * static_cast<size_t>(bits) / 64 + 2;
+}
+
+std::vector<std::uint64_t> pack(const std::vector<std::uint64_t>& values, int bits) {
+    std::vector<std::uint64_t> words(packedWords(values.size(), bits), 0);
+    if (bits == 0) {
+        return words;
+    }
+    for (size_t i = 0; i < values.size(); ++i) {
+        const std::uint64_t bit = static_cast<std::uint64_t>(i) * bits;
+        const size_t word = bit >> 6;
+        const unsigned shift = bit & 63;
+        words[word] |= values[i] << shift;
+        if (shift + bits > 64) {
+            words[word + 1] |= values[i] >> (64 - shift);
+        }
+    }
+    return words;
+}
+
+// Single value of a packed array; the bulk decode goes through the unpack_bits kernel
+std::uint64_t packedValue(const std::vector<std::uint64_t>& words, int bits, size_t i) {
+    const std::uint64_t mask = bits == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << bits) - 1;
+    const std::uint64_t bit = static_cast<std::uint64_t>(i) * bits;
+    const size_t word = bit >> 6;
+    const unsigned shift = bit & 63;
+    return ((words[word] >> shift) | ((words[word + 1] << 1) << (63 - shift))) & mask;
+}
+
+void unpackBits(const std::uint64_t* words, int bits, std::int64_t base, size_t first, size_t count, double* out) {
+    U::kernels().unpack_bits(words, bits, base, first, count, out);
+}
+
+void unpackBits(const std::uint64_t* words, int bits, std::int64_t base, size_t first, size_t count, float* out) {
+    U::kernels().unpack_bits_f32(words, bits, base, first, count, out);
+}
+
+// Bytes of a vector's heap block
+template <typename T>
+size_t heapBytes(const std::vector<T>& values) {
+    return values.capacity() * sizeof(T);
+}
+
+size_t stringBytes(const std::string& value) {
+    // Short strings live inside the object
+    return value.capacity() >= sizeof(std::string) ? value.capacity() + 1 : 0;
+}
+
+template <typename Scalar>
+Scalar numericValue(const DataFrame::DataType& value) {
+    return std::visit([](const auto& cell) -> Scalar {
+        if constexpr (std::is_arithmetic_v<std::decay_t<decltype(cell)>>) {
+            return static_cast<Scalar>(cell);
+        } else {
+            throw std::invalid_argument("Non-numeric value in CompressedDataFrame for toMatrix conversion");
+        }
+    }, value);
+}
+
+// Integers come back as int when they fit and as long otherwise, as DataFrame::parseValue gives them
+DataFrame::DataType integerValue(std::int64_t value) {
+    if (value >= std::numeric_limits<int>::min() && value <= std::numeric_limits<int>::max()) {
+        return static_cast<int>(value);
+    }
+    return static_cast<long>(value);
+}
+
+} // namespace
+
+CompressedDataFrame::CompressedDataFrame(const DataFrame& df, const U::ExecutionPolicy& policy) {
+    append(df, policy);
+}
+
+bool CompressedDataFrame::readCSV(const std::string& filename, const U::ExecutionPolicy& policy) {
+    U_TRACE_SCOPE("CompressedDataFrame::readCSV");
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filename << std::endl;
+        return false;
+    }
+
+    DataFrame chunk;
+    std::string line;
+    if (std::getline(file, line)) {
+        std::istringstream line_stream(line);
+        std::string cell;
+        while (std::getline(line_stream, cell, ',')) {
+            chunk.column_names_.push_back(cell);
+            chunk.column_indices_[cell] = chunk.column_names_.size() - 1;
+        }
+    }
+
+    // One segment of lines at a time: only that much of the table is ever held as DataType
+    std::vector<std::string> lines;
+    bool more = true;
+    while (more) {
+        lines.clear();
+        while (lines.size() < kSegmentRows && (more = static_cast<bool>(std::getline(file, line)))) {
+            lines.push_back(std::move(line));
+        }
+        if (lines.empty() && !column_names_.empty()) {
+            break;
+        }
+
+        chunk.data_.assign(lines.size(), DataFrame::Row());
+        policy.parallel_for(0, lines.size(), kParseRows, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+            for (std::ptrdiff_t i = begin; i < end; ++i) {
+                std::istringstream line_stream(lines[i]);
+                std::string cell;
+                DataFrame::Row& row = chunk.data_[i];
+                row.reserve(chunk.column_names_.size());
+                while (std::getline(line_stream, cell, ',')) {
+                    row.push_back(chunk.parseValue(cell));
+                }
+            }
+        });
+        append(chunk, policy);
+        U_TRACE_COUNT("CompressedDataFrame::readCSV rows", lines.size());
+    }
+    return true;
+}
+
+void CompressedDataFrame::append(const DataFrame& df, const U::ExecutionPolicy& policy) {
+    U_TRACE_SCOPE("CompressedDataFrame::append");
+    if (segment_starts_.empty()) {
+        column_names_ = df.column_names_;
+        column_indices_ = df.column_indices_;
+        columns_.assign(column_names_.size(), {});
+        segment_starts_.push_back(0);
+    } else if (df.column_names_ != column_names_) {
+        throw std::invalid_argument("Appended DataFrame must have the same columns as the CompressedDataFrame.");
+    }
+    for (const auto& row : df.data_) {
+        if (row.size() != column_names_.size()) {
+            throw std::invalid_argument("Every row of the DataFrame must have one value per column.");
+        }
+    }
+
+    const size_t rows = df.getRowCount();
+    const size_t first_segment = segment_starts_.size() - 1;
+    const size_t new_segments = (rows + kSegmentRows - 1) / kSegmentRows;
+    for (auto& column : columns_) {
+        column.resize(first_segment + new_segments);
+    }
+
+    // Every (segment, column) pair is encoded independently
+    const size_t n_columns = column_names_.size();
+    policy.parallel_for(0, new_segments * n_columns, 1, [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+        for (std::ptrdiff_t task = first; task < last; ++task) {
+            const size_t segment = task / n_columns;
+            const size_t column = task % n_columns;
+            const size_t begin = segment * kSegmentRows;
+            const size_t end = std::min(rows, begin + kSegmentRows);
+            columns_[column][first_segment + segment] = encode(df.data_, begin, end, column);
+        }
+    });
+
+    const size_t offset = segment_starts_.back();
+    for (size_t segment = 1; segment <= new_segments; ++segment) {
+        segment_starts_.push_back(offset + std::min(rows, segment * kSegmentRows));
+    }
+}
+
+CompressedDataFrame::Segment CompressedDataFrame::encode(const std::vector<DataFrame::Row>& rows, size_t begin,
+                                                         size_t end, size_t column) {
+    const size_t n = end - begin;
+    size_t integers = 0;
+    size_t doubles = 0;
+    size_t strings = 0;
+    for (size_t i = begin; i < end; ++i) {
+        const DataType& value = rows[i][column];
+        integers += std::holds_alternative<int>(value) || std::holds_alternative<long>(value);
+        doubles += std::holds_alternative<double>(value);
+        strings += std::holds_alternative<std::string>(value);
+    }
+
+    Segment segment;
+
+    // Numbers: as int64 when every one is an exact integer, as doubles otherwise. A segment mixing
+    // ints and doubles (e.g. "2" and "2.5" in a CSV column) marks its double rows to restore the types.
+    std::vector<std::int64_t> values;
+    bool integral = true;
+    bool exact = true;       // Every integer is exact as a double
+    bool orderable = true;   // No NaN or -0, which sorting and equality would not keep apart
+    const bool numeric = integers + doubles == n;
+    if (numeric) {
+        for (size_t i = begin; i < end; ++i) {
+            const DataType& cell = rows[i][column];
+            if (std::holds_alternative<double>(cell)) {
+                const double value = std::get<double>(cell);
+                const bool negative_zero = value == 0.0 && std::signbit(value);
+                integral = integral && std::trunc(value) == value && std::abs(value) <= kMaxExactInteger && !negative_zero;
+                orderable = orderable && !std::isnan(value) && !negative_zero;
+            } else if (std::holds_alternative<long>(cell)) {
+                exact = exact && std::abs(static_cast<double>(std::get<long>(cell))) < kMaxExactInteger;
+            }
+        }
+    }
+
+    if (numeric && (integral || exact)) {
+        segment.doubles = doubles == n;
+        if (doubles != 0 && doubles != n) {
+            std::vector<std::uint64_t> double_rows(n);
+            for (size_t i = begin; i < end; ++i) {
+                double_rows[i - begin] = std::holds_alternative<double>(rows[i][column]);
+            }
+            segment.double_rows = pack(double_rows, 1);
+        }
+
+        if (integral) {
+            values.reserve(n);
+            for (size_t i = begin; i < end; ++i) {
+                values.push_back(numericValue<std::int64_t>(rows[i][column]));
+            }
+        } else {
+            std::vector<double> numbers(n);
+            for (size_t i = begin; i < end; ++i) {
+                numbers[i - begin] = numericValue<double>(rows[i][column]);
+            }
+            if (orderable) {
+                std::vector<double> dictionary = numbers;
+                std::sort(dictionary.begin(), dictionary.end());
+                dictionary.erase(std::unique(dictionary.begin(), dictionary.end()), dictionary.end());
+                const int bits = bitWidth(dictionary.size() - 1);
+                if ((dictionary.size() + packedWords(n, bits)) * 8 < n * sizeof(double)) {
+                    std::vector<std::uint64_t> codes(n);
+                    for (size_t i = 0; i < n; ++i) {
+                        codes[i] = std::lower_bound(dictionary.begin(), dictionary.end(), numbers[i]) - dictionary.begin();
+                    }
+                    segment.encoding = Encoding::Dictionary;
+                    segment.bits = bits;
+                    segment.words = pack(codes, bits);
+                    segment.numbers = std::move(dictionary);
+                    return segment;
+                }
+            }
+            segment.encoding = Encoding::Double;
+            segment.numbers = std::move(numbers);
+            return segment;
+        }
+    } else if (strings == n) {
+        std::vector<std::string> dictionary;
+        dictionary.reserve(n);
+        for (size_t i = begin; i < end; ++i) {
+            dictionary.push_back(std::get<std::string>(rows[i][column]));
+        }
+        std::sort(dictionary.begin(), dictionary.end());
+        dictionary.erase(std::unique(dictionary.begin(), dictionary.end()), dictionary.end());
+        dictionary.shrink_to_fit();
+        std::vector<std::uint64_t> codes(n);
+        for (size_t i = begin; i < end; ++i) {
+            const std::string& value = std::get<std::string>(rows[i][column]);
+            codes[i - begin] = std::lower_bound(dictionary.begin(), dictionary.end(), value) - dictionary.begin();
+        }
+        segment.encoding = Encoding::Dictionary;
+        segment.bits = bitWidth(dictionary.size() - 1);
+        segment.words = pack(codes, segment.bits);
+        segment.strings = std::move(dictionary);
+        return segment;
+    } else {
+        segment.encoding = Encoding::Plain;
+        segment.plain.reserve(n);
+        for (size_t i = begin; i < end; ++i) {
+            segment.plain.push_back(rows[i][column]);
+        }
+        return segment;
+    }
+
+    // Bit-packed offsets from the minimum, or runs when they take less space
+    const auto [min, max] = std::minmax_element(values.begin(), values.end());
+    const int bits = bitWidth(static_cast<std::uint64_t>(*max) - static_cast<std::uint64_t>(*min));
+    size_t runs = 1;
+    for (size_t i = 1; i < n; ++i) {
+        runs += values[i] != values[i - 1];
+    }
+    if (runs * (sizeof(std::int64_t) + sizeof(std::uint32_t)) < packedWords(n, bits) * sizeof(std::uint64_t)) {
+        segment.encoding = Encoding::RunLength;
+        segment.run_values.reserve(runs);
+        segment.run_ends.reserve(runs);
+        for (size_t i = 0; i < n; ++i) {
+            if (i + 1 == n || values[i + 1] != values[i]) {
+                segment.run_values.push_back(values[i]);
+                segment.run_ends.push_back(static_cast<std::uint32_t>(i + 1));
+            }
+        }
+        return segment;
+    }
+
+    segment.encoding = Encoding::BitPacked;
+    segment.bits = bits;
+    segment.base = *min;
+    std::vector<std::uint64_t> offsets(n);
+    for (size_t i = 0; i < n; ++i) {
+        offsets[i] = static_cast<std::uint64_t>(values[i]) - static_cast<std::uint64_t>(segment.base);
+    }
+    segment.words = pack(offsets, bits);
+    return segment;
+}
+
+template <typename Scalar>
+void CompressedDataFrame::decode(const Segment& segment, size_t first, size_t count, Scalar* out) {
+    switch (segment.encoding) {
+    case Encoding::BitPacked:
+        unpackBits(segment.words.data(), segment.bits, segment.base, first, count, out);
+        break;
+    case Encoding::RunLength: {
+        size_t run = std::upper_bound(segment.run_ends.begin(), segment.run_ends.end(), first) - segment.run_ends.begin();
+        for (size_t i = first; i < first + count; ++run) {
+            const size_t run_end = std::min<size_t>(segment.run_ends[run], first + count);
+            std::fill(out + (i - first), out + (run_end - first), static_cast<Scalar>(segment.run_values[run]));
+            i = run_end;
+        }
+        break;
+    }
+    case Encoding::Dictionary:
+        if (!segment.strings.empty()) {
+            throw std::invalid_argument("Non-numeric value in CompressedDataFrame for toMatrix conversion");
+        }
+        // Codes first (exact in float too, a segment has fewer than 2^24 rows), then their values
+        unpackBits(segment.words.data(), segment.bits, 0, first, count, out);
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = static_cast<Scalar>(segment.numbers[static_cast<size_t>(out[i])]);
+        }
+        break;
+    case Encoding::Double:
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = static_cast<Scalar>(segment.numbers[first + i]);
+        }
+        break;
+    case Encoding::Plain:
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = numericValue<Scalar>(segment.plain[first + i]);
+        }
+        break;
+    }
+}
+
+void CompressedDataFrame::appendValues(const Segment& segment, size_t count, std::vector<DataType>& out) {
+    // Numbers get back the type they had: all doubles, all integers, or per row in a mixed segment
+    auto isDouble = [&](size_t i) {
+        return segment.doubles || (!segment.double_rows.empty() && packedValue(segment.double_rows, 1, i) != 0);
+    };
+    auto integer = [&](std::int64_t value, size_t i) {
+        return isDouble(i) ? DataType(static_cast<double>(value)) : integerValue(value);
+    };
+    auto number = [&](double value, size_t i) {
+        return isDouble(i) ? DataType(value) : integerValue(static_cast<std::int64_t>(value));
+    };
+
+    switch (segment.encoding) {
+    case Encoding::BitPacked:
+        for (size_t i = 0; i < count; ++i) {
+            const std::uint64_t offset = packedValue(segment.words, segment.bits, i);
+            out.push_back(integer(static_cast<std::int64_t>(static_cast<std::uint64_t>(segment.base) + offset), i));
+        }
+        break;
+    case Encoding::RunLength:
+        for (size_t run = 0, i = 0; run < segment.run_values.size(); ++run) {
+            for (; i < segment.run_ends[run]; ++i) {
+                out.push_back(integer(segment.run_values[run], i));
+            }
+        }
+        break;
+    case Encoding::Dictionary:
+        for (size_t i = 0; i < count; ++i) {
+            const size_t code = packedValue(segment.words, segment.bits, i);
+            out.push_back(segment.strings.empty() ? number(segment.numbers[code], i) : DataType(segment.strings[code]));
+        }
+        break;
+    case Encoding::Double:
+        for (size_t i = 0; i < count; ++i) {
+            out.push_back(number(segment.numbers[i], i));
+        }
+        break;
+    case Encoding::Plain:
+        out.insert(out.end(), segment.plain.begin(), segment.plain.end());
+        break;
+    }
+}
+
+template <typename Scalar>
+Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> CompressedDataFrame::toMatrix(const U::ExecutionPolicy& policy) const {
+    U_TRACE_SCOPE("CompressedDataFrame::toMatrix");
+    U_TRACE_BYTES("CompressedDataFrame::toMatrix allocated", getRowCount() * column_names_.size() * sizeof(Scalar));
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> matrix(getRowCount(), column_names_.size());
+
+    // Each segment of each column decodes into its own contiguous slice of the matrix
+    const size_t n_segments = segment_starts_.empty() ? 0 : segment_starts_.size() - 1;
+    const size_t n_columns = column_names_.size();
+    policy.parallel_for(0, n_segments * n_columns, 1, [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+        for (std::ptrdiff_t task = first; task < last; ++task) {
+            const size_t segment = task / n_columns;
+            const size_t column = task % n_columns;
+            const size_t begin = segment_starts_[segment];
+            decode(columns_[column][segment], 0, segment_starts_[segment + 1] - begin,
+                   matrix.col(column).data() + begin);
+        }
+    });
+    return matrix;
+}
+
+template <typename Scalar>
+Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> CompressedDataFrame::toMatrix(const std::vector<std::string>& column_names,
+                                                                                    size_t first_row, size_t row_count) const {
+    std::vector<size_t> indices;
+    for (const auto& name : column_names) {
+        indices.push_back(columnIndex(name));
+    }
+
+    first_row = std::min(first_row, getRowCount());
+    row_count = std::min(row_count, getRowCount() - first_row);
+    const size_t last_row = first_row + row_count;
+
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> matrix(row_count, indices.size());
+    if (row_count == 0) {
+        return matrix;
+    }
+    // Only the segments overlapping the requested rows are decoded
+    const size_t first_segment = std::upper_bound(segment_starts_.begin(), segment_starts_.end(), first_row) - segment_starts_.begin() - 1;
+    for (size_t j = 0; j < indices.size(); ++j) {
+        for (size_t segment = first_segment; segment_starts_[segment] < last_row; ++segment) {
+            const size_t begin = std::max(first_row, segment_starts_[segment]);
+            const size_t end = std::min(last_row, segment_starts_[segment + 1]);
+            decode(columns_[indices[j]][segment], begin - segment_starts_[segment], end - begin,
+                   matrix.col(j).data() + (begin - first_row));
+        }
+    }
+    return matrix;
+}
+
+template Eigen::MatrixXd CompressedDataFrame::toMatrix<double>(const U::ExecutionPolicy&) const;
+template Eigen::MatrixXf CompressedDataFrame::toMatrix<float>(const U::ExecutionPolicy&) const;
+template Eigen::MatrixXd CompressedDataFrame::toMatrix<double>(const std::vector<std::string>&, size_t, size_t) const;
+template Eigen::MatrixXf CompressedDataFrame::toMatrix<float>(const std::vector<std::string>&, size_t, size_t) const;
+
+U::SparseMatrix CompressedDataFrame::toSparseMatrix() const {
+    U_TRACE_SCOPE("CompressedDataFrame::toSparseMatrix");
+    const size_t n_columns = column_names_.size();
+    U::SparseMatrix matrix(getRowCount(), n_columns);
+
+    // Blocks of rows are decoded column by column, then appended row by row in CSR order
+    Eigen::MatrixXd block(kScanRows, n_columns);
+    for (size_t segment = 0; segment + 1 < segment_starts_.size(); ++segment) {
+        const size_t segment_rows = segment_starts_[segment + 1] - segment_starts_[segment];
+        for (size_t begin = 0; begin < segment_rows; begin += kScanRows) {
+            const size_t count = std::min(kScanRows, segment_rows - begin);
+            for (size_t j = 0; j < n_columns; ++j) {
+                decode(columns_[j][segment], begin, count, block.col(j).data());
+            }
+            for (size_t i = 0; i < count; ++i) {
+                const size_t row = segment_starts_[segment] + begin + i;
+                matrix.startVec(row);
+                for (size_t j = 0; j < n_columns; ++j) {
+                    if (block(i, j) != 0.0) {
+                        matrix.insertBack(row, j) = block(i, j);
+                    }
+                }
+            }
+        }
+    }
+    matrix.finalize();
+    return matrix;
+}
+
+double CompressedDataFrame::sum(const std::string& column_name) const {
+    const auto& column = columns_[columnIndex(column_name)];
+    double total = 0.0;
+    double block[kScanRows];
+    for (size_t segment = 0; segment < column.size(); ++segment) {
+        const Segment& encoded = column[segment];
+        const size_t segment_rows = segment_starts_[segment + 1] - segment_starts_[segment];
+        if (encoded.encoding == Encoding::RunLength) {
+            size_t begin = 0;
+            for (size_t run = 0; run < encoded.run_values.size(); ++run) {
+                total += static_cast<double>(encoded.run_values[run]) * (encoded.run_ends[run] - begin);
+                begin = encoded.run_ends[run];
+            }
+        } else if (encoded.encoding == Encoding::Dictionary && encoded.strings.empty()) {
+            std::vector<size_t> counts(encoded.numbers.size(), 0);
+            for (size_t i = 0; i < segment_rows; ++i) {
+                ++counts[packedValue(encoded.words, encoded.bits, i)];
+            }
+            for (size_t code = 0; code < counts.size(); ++code) {
+                total += encoded.numbers[code] * counts[code];
+            }
+        } else {
+            for (size_t begin = 0; begin < segment_rows; begin += kScanRows) {
+                const size_t count = std::min(kScanRows, segment_rows - begin);
+                decode(encoded, begin, count, block);
+                for (size_t i = 0; i < count; ++i) {
+                    total += block[i];
+                }
+            }
+        }
+    }
+    return total;
+}
+
+std::vector<CompressedDataFrame::DataType> CompressedDataFrame::getColumn(const std::string& column_name) const {
+    std::vector<DataType> values;
+    auto it = column_indices_.find(column_name);
+    if (it == column_indices_.end()) {
+        std::cerr << "Column not found: " << column_name << std::endl;
+        return values;
+    }
+    values.reserve(getRowCount());
+    const auto& column = columns_[it->second];
+    for (size_t segment = 0; segment < column.size(); ++segment) {
+        appendValues(column[segment], segment_starts_[segment + 1] - segment_starts_[segment], values);
+    }
+    return values;
+}
+
+DataFrame CompressedDataFrame::decompress() const {
+    U_TRACE_SCOPE("CompressedDataFrame::decompress");
+    DataFrame df;
+    df.column_names_ = column_names_;
+    df.column_indices_ = column_indices_;
+    df.data_.assign(getRowCount(), DataFrame::Row());
+    for (auto& row : df.data_) {
+        row.reserve(column_names_.size());
+    }
+    for (const auto& name : column_names_) {
+        std::vector<DataType> values = getColumn(name);
+        for (size_t i = 0; i < values.size(); ++i) {
+            df.data_[i].push_back(std::move(values[i]));
+        }
+    }
+    df.resetStatistics();
+    return df;
+}
+
+std::vector<std::string> CompressedDataFrame::columnNames() const {
+    return column_names_;
+}
+
+bool CompressedDataFrame::hasColumn(const std::string& column) const {
+    return column_indices_.count(column) != 0;
+}
+
+std::vector<CompressedDataFrame::Encoding> CompressedDataFrame::encodings(const std::string& column_name) const {
+    std::vector<Encoding> result;
+    for (const auto& segment : columns_[columnIndex(column_name)]) {
+        result.push_back(segment.encoding);
+    }
+    return result;
+}
+
+size_t CompressedDataFrame::memoryUsage() const {
+    size_t bytes = 0;
+    for (const auto& column : columns_) {
+        for (const auto& segment : column) {
+            bytes += sizeof(Segment) + heapBytes(segment.words) + heapBytes(segment.double_rows) + heapBytes(segment.run_values) +
+                     heapBytes(segment.run_ends) + heapBytes(segment.numbers) + heapBytes(segment.strings) +
+                     heapBytes(segment.plain);
+            for (const auto& value : segment.strings) {
+                bytes += stringBytes(value);
+            }
+            for (const auto& value : segment.plain) {
+                if (std::holds_alternative<std::string>(value)) {
+                    bytes += stringBytes(std::get<std::string>(value));
+                }
+            }
+        }
+    }
+    return bytes;
+}
+
+size_t CompressedDataFrame::columnIndex(const std::string& column_name) const {
+    auto it = column_indices_.find(column_name);
+    if (it == column_indices_.end()) {
+        throw std::invalid_argument("Column " + column_name + " not found in CompressedDataFrame.");
+    }
+    return it->second;
+}
+
+} // namespace L
@@ -1,9 +1,195 @@
 #include "L/DataFrame.hpp"
+#include "U/Trace.hpp"
+#include "U/Kernels.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <random>
 #include <set>
+#include <type_traits>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace L {
 
+    namespace {
+
+        // Lines parsed and rows converted per parallel chunk
+        constexpr std::ptrdiff_t kParseRows = 4096;
+
+        // Rows per block of the statistics pass; larger frames use longer blocks, so that at most
+        // kMaxStatisticsBlocks partial results (with their sets and sketches) are alive at once
+        constexpr std::ptrdiff_t kStatisticsRows = 65536;
+        constexpr std::ptrdiff_t kMaxStatisticsBlocks = 64;
+
+        // HyperLogLog registers: 2^12 of them, about 1.6% standard error on the distinct count
+        constexpr int kSketchBits = 12;
+        constexpr size_t kSketchRegisters = size_t(1) << kSketchBits;
+
+        // Finalizer of splitmix64, spreads similar keys (consecutive integers) over all the bits
+        std::uint64_t mix(std::uint64_t x) {
+            x ^= x >> 30;
+            x *= 0xbf58476d1ce4e5b9ULL;
+            x ^= x >> 27;
+            x *= 0x94d049bb133111ebULL;
+            return x ^ (x >> 31);
+        }
+
+        // Partial statistics of one column over a block of rows; blocks are merged in order
+        struct ColumnAccumulator {
+            size_t count = 0;
+            size_t strings = 0;
+            double mean = 0.0;
+            double m2 = 0.0;      // Sum of squared deviations from the mean
+            double min = std::numeric_limits<double>::infinity();
+            double max = -std::numeric_limits<double>::infinity();
+            bool categorical = true;
+            bool exact = true;
+            std::unordered_set<double> numbers;
+            std::unordered_set<std::string> texts;
+            std::vector<std::uint8_t> registers;   // HyperLogLog, allocated with the first value
+
+            void add(const DataFrame::DataType& value) {
+                if (std::holds_alternative<std::string>(value)) {
+                    const std::string& text = std::get<std::string>(value);
+                    ++strings;
+                    sketch(mix(std::hash<std::string>()(text)));
+                    if (exact) {
+                        texts.insert(text);
+                        limit();
+                    }
+                    return;
+                }
+
+                categorical = categorical && std::holds_alternative<int>(value);
+                double x = std::visit([](const auto& cell) -> double {
+                    if constexpr (std::is_arithmetic_v<std::decay_t<decltype(cell)>>) {
+                        return static_cast<double>(cell);
+                    } else {
+                        return 0.0;
+                    }
+                }, value);
+                if (std::isnan(x)) {
+                    return;
+                }
+                x = x == 0.0 ? 0.0 : x;   // -0 and 0 are the same value
+
+                // Welford's update
+                ++count;
+                const double delta = x - mean;
+                mean += delta / count;
+                m2 += delta * (x - mean);
+                min = std::min(min, x);
+                max = std::max(max, x);
+
+                std::uint64_t bits;
+                std::memcpy(&bits, &x, sizeof(bits));
+                sketch(mix(bits));
+                if (exact) {
+                    numbers.insert(x);
+                    limit();
+                }
+            }
+
+            void sketch(std::uint64_t hash) {
+                if (registers.empty()) {
+                    registers.assign(kSketchRegisters, 0);
+                }
+                // The first bits pick the register, which keeps the longest run of leading zeros of the rest
+                const size_t index = hash >> (64 - kSketchBits);
+                std::uint64_t rest = hash << kSketchBits;
+                std::uint8_t rank = 1;
+                while (rank <= 64 - kSketchBits && (rest & (std::uint64_t(1) << 63)) == 0) {
+                    ++rank;
+                    rest <<= 1;
+                }
+                registers[index] = std::max(registers[index], rank);
+            }
+
+            // Past kMaxExactDistinct values only the sketch counts them
+            void limit() {
+                if (numbers.size() + texts.size() > DataFrame::ColumnStatistics::kMaxExactDistinct) {
+                    exact = false;
+                    std::unordered_set<double>().swap(numbers);
+                    std::unordered_set<std::string>().swap(texts);
+                }
+            }
+
+            void merge(ColumnAccumulator&& other) {
+                // Chan et al.'s combination of two means and sums of squared deviations
+                if (other.count > 0) {
+                    const double total = static_cast<double>(count + other.count);
+                    const double delta = other.mean - mean;
+                    mean += delta * other.count / total;
+                    m2 += other.m2 + delta * delta * (static_cast<double>(count) * other.count / total);
+                    count += other.count;
+                    min = std::min(min, other.min);
+                    max = std::max(max, other.max);
+                }
+                strings += other.strings;
+                categorical = categorical && other.categorical;
+
+                exact = exact && other.exact;
+                if (exact) {
+                    numbers.insert(other.numbers.begin(), other.numbers.end());
+                    texts.insert(other.texts.begin(), other.texts.end());
+                    limit();
+                } else {
+                    std::unordered_set<double>().swap(numbers);
+                    std::unordered_set<std::string>().swap(texts);
+                }
+
+                if (registers.empty()) {
+                    registers = std::move(other.registers);
+                } else if (!other.registers.empty()) {
+                    for (size_t j = 0; j < kSketchRegisters; ++j) {
+                        registers[j] = std::max(registers[j], other.registers[j]);
+                    }
+                }
+            }
+
+            // HyperLogLog estimate, with the linear counting correction for small counts
+            double estimate() const {
+                if (registers.empty()) {
+                    return 0.0;
+                }
+                const double m = static_cast<double>(kSketchRegisters);
+                double sum = 0.0;
+                size_t zeros = 0;
+                for (std::uint8_t rank : registers) {
+                    sum += std::ldexp(1.0, -rank);
+                    zeros += rank == 0;
+                }
+                const double raw = (0.7213 / (1.0 + 1.079 / m)) * m * m / sum;
+                return raw <= 2.5 * m && zeros > 0 ? m * std::log(m / zeros) : raw;
+            }
+        };
+
+        // Rows of the quantile sample: all of them, or a fixed random subset (Floyd's algorithm)
+        std::vector<size_t> sampleRows(size_t rows) {
+            std::vector<size_t> sample;
+            if (rows <= DataFrame::ColumnStatistics::kSampleRows) {
+                for (size_t i = 0; i < rows; ++i) {
+                    sample.push_back(i);
+                }
+                return sample;
+            }
+            std::mt19937_64 generator(0);
+            std::unordered_set<size_t> chosen;
+            chosen.reserve(DataFrame::ColumnStatistics::kSampleRows);
+            for (size_t j = rows - DataFrame::ColumnStatistics::kSampleRows; j < rows; ++j) {
+                size_t candidate = std::uniform_int_distribution<size_t>(0, j)(generator);
+                chosen.insert(chosen.count(candidate) ? j : candidate);
+            }
+            sample.assign(chosen.begin(), chosen.end());
+            std::sort(sample.begin(), sample.end());
+            return sample;
+        }
+
+    } // namespace
+
     // Constructor that creates a DataFrame from an Eigen::VectorXd with a specified column name
     DataFrame::DataFrame(const Eigen::VectorXd& vector, const std::string& column_name) {
         column_names_.push_back(column_name);
@@ -14,6 +200,7 @@ namespace L {
             row.push_back(vector(i));
             data_.push_back(row);
         }
+        resetStatistics();
     }
 
     // Constructor that creates a DataFrame from an Eigen::MatrixXd with a list of column names
@@ -35,9 +222,11 @@ namespace L {
             }
             data_.push_back(row);
         }
+        resetStatistics();
     }
 
-    bool DataFrame::readCSV(const std::string& filename) {
+    bool DataFrame::readCSV(const std::string& filename, const U::ExecutionPolicy& policy) {
+        U_TRACE_SCOPE("DataFrame::readCSV");
         std::ifstream file(filename);
         if (!file.is_open()) {
             std::cerr << "Failed to open file: " << filename << std::endl;
@@ -45,36 +234,58 @@ namespace L {
         }
 
         std::string line;
-        bool is_header = true;
-
-        while (std::getline(file, line)) {
+        if (std::getline(file, line)) {
             std::istringstream line_stream(line);
             std::string cell;
-            Row row;
+            while (std::getline(line_stream, cell, ',')) {
+                column_names_.push_back(cell);
+                column_indices_[cell] = column_names_.size() - 1;
+            }
+        }
 
-            if (is_header) {
-                while (std::getline(line_stream, cell, ',')) {
-                    column_names_.push_back(cell);
-                    column_indices_[cell] = column_names_.size() - 1;
-                }
-                is_header = false;
-            } else {
+        // Reading is sequential; parsing the cells is the expensive part and runs in parallel
+        std::vector<std::string> lines;
+        while (std::getline(file, line)) {
+            lines.push_back(std::move(line));
+        }
+        file.close();
+
+        size_t first_row = data_.size();
+        data_.resize(first_row + lines.size());
+        policy.parallel_for(0, lines.size(), kParseRows, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+            for (std::ptrdiff_t i = begin; i < end; ++i) {
+                std::istringstream line_stream(lines[i]);
+                std::string cell;
+                Row& row = data_[first_row + i];
                 while (std::getline(line_stream, cell, ',')) {
                     row.push_back(parseValue(cell));
                 }
-                data_.push_back(row);
             }
-        }
+        });
 
-        file.close();
+        resetStatistics();
+        U_TRACE_COUNT("DataFrame::readCSV rows", lines.size());
         return true;
     }
 
     DataFrame::DataType DataFrame::parseValue(const std::string& value) const {
-        try { return std::stoi(value); } catch (...) {}
-        try { return std::stol(value); } catch (...) {}
-        try { return std::stof(value); } catch (...) {}
-        try { return std::stod(value); } catch (...) {}
+        // The whole cell must be a number: "1.5" is a double and "12abc" a string
+        const char* begin = value.data();
+        const char* end = begin + value.size();
+        int int_value;
+        auto [int_end, int_error] = std::from_chars(begin, end, int_value);
+        if (int_error == std::errc() && int_end == end) {
+            return int_value;
+        }
+        long long_value;
+        auto [long_end, long_error] = std::from_chars(begin, end, long_value);
+        if (long_error == std::errc() && long_end == end) {
+            return long_value;
+        }
+        double double_value;
+        if (U::parseNumber(begin, end, double_value)) {
+            return double_value;
+        }
         return value;
     }
 
@@ -103,28 +314,105 @@ namespace L {
             new_df.data_.push_back(new_row);
         }
 
+        // Same rows: the statistics already computed still hold
+        new_df.resetStatistics();
+        for (size_t j = 0; j < selected_indices.size() && statistics_.size() == column_names_.size(); ++j) {
+            std::atomic_store(&new_df.statistics_[j], std::atomic_load(&statistics_[selected_indices[j]]));
+        }
+
         return new_df;
     }
 
-    Eigen::MatrixXd DataFrame::toMatrix() const {
-        Eigen::MatrixXd matrix(getRowCount(), column_names_.size());
+    template <typename Scalar>
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> DataFrame::toMatrix(const U::ExecutionPolicy& policy) const {
+        U_TRACE_SCOPE("DataFrame::toMatrix");
+        U_TRACE_BYTES("DataFrame::toMatrix allocated", getRowCount() * column_names_.size() * sizeof(Scalar));
+        Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> matrix(getRowCount(), column_names_.size());
+        policy.parallel_for(0, getRowCount(), kParseRows, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+            for (std::ptrdiff_t i = begin; i < end; ++i) {
+                for (size_t j = 0; j < column_names_.size(); ++j) {
+                    const auto& value = data_[i][j];
+                    // Ensure all values are numeric for conversion to Eigen matrix
+                    if (std::holds_alternative<int>(value)) {
+                        matrix(i, j) = static_cast<Scalar>(std::get<int>(value));
+                    } else if (std::holds_alternative<double>(value)) {
+                        matrix(i, j) = static_cast<Scalar>(std::get<double>(value));
+                    } else if (std::holds_alternative<float>(value)) {
+                        matrix(i, j) = static_cast<Scalar>(std::get<float>(value));
+                    } else if (std::holds_alternative<long>(value)) {
+                        matrix(i, j) = static_cast<Scalar>(std::get<long>(value));
+                    } else {
+                        throw std::invalid_argument("Non-numeric value in DataFrame for toMatrix conversion");
+                    }
+                }
+            }
+        });
+        return matrix;
+    }
+
+    template <typename Scalar>
+    Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> DataFrame::toMatrix(const std::vector<std::string>& column_names,
+                                                                              size_t first_row, size_t row_count) const {
+        std::vector<size_t> indices;
+        for (const auto& name : column_names) {
+            auto it = column_indices_.find(name);
+            if (it == column_indices_.end()) {
+                throw std::invalid_argument("Column " + name + " not found in DataFrame.");
+            }
+            indices.push_back(it->second);
+        }
+
+        first_row = std::min(first_row, getRowCount());
+        row_count = std::min(row_count, getRowCount() - first_row);
+
+        Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic> matrix(row_count, indices.size());
+        for (size_t i = 0; i < row_count; ++i) {
+            const Row& row = data_[first_row + i];
+            for (size_t j = 0; j < indices.size(); ++j) {
+                matrix(i, j) = std::visit([](const auto& value) -> Scalar {
+                    if constexpr (std::is_arithmetic_v<std::decay_t<decltype(value)>>) {
+                        return static_cast<Scalar>(value);
+                    } else {
+                        throw std::invalid_argument("Non-numeric value in DataFrame for toMatrix conversion");
+                    }
+                }, row[indices[j]]);
+            }
+        }
+        return matrix;
+    }
+
+    template Eigen::MatrixXd DataFrame::toMatrix<double>(const U::ExecutionPolicy&) const;
+    template Eigen::MatrixXf DataFrame::toMatrix<float>(const U::ExecutionPolicy&) const;
+    template Eigen::MatrixXd DataFrame::toMatrix<double>(const std::vector<std::string>&, size_t, size_t) const;
+    template Eigen::MatrixXf DataFrame::toMatrix<float>(const std::vector<std::string>&, size_t, size_t) const;
+
+    U::SparseMatrix DataFrame::toSparseMatrix() const {
+        U_TRACE_SCOPE("DataFrame::toSparseMatrix");
+        U::SparseMatrix matrix(getRowCount(), column_names_.size());
+
+        // Rows are appended in order, so the CSR arrays are filled directly without triplets
         for (size_t i = 0; i < getRowCount(); ++i) {
+            matrix.startVec(i);
             for (size_t j = 0; j < column_names_.size(); ++j) {
                 const auto& value = data_[i][j];
-                // Ensure all values are numeric for conversion to Eigen matrix
+                double numeric;
                 if (std::holds_alternative<int>(value)) {
-                    matrix(i, j) = std::get<int>(value);
+                    numeric = std::get<int>(value);
                 } else if (std::holds_alternative<double>(value)) {
-                    matrix(i, j) = std::get<double>(value);
+                    numeric = std::get<double>(value);
                 } else if (std::holds_alternative<float>(value)) {
-                    matrix(i, j) = std::get<float>(value);
+                    numeric = std::get<float>(value);
                 } else if (std::holds_alternative<long>(value)) {
-                    matrix(i, j) = std::get<long>(value);
+                    numeric = std::get<long>(value);
                 } else {
-                    throw std::invalid_argument("Non-numeric value in DataFrame for toMatrix conversion");
+                    throw std::invalid_argument("Non-numeric value in DataFrame for toSparseMatrix conversion");
+                }
+                if (numeric != 0.0) {
+                    matrix.insertBack(i, j) = numeric;
                 }
             }
         }
+        matrix.finalize();
         return matrix;
     }
 
@@ -195,6 +483,7 @@ namespace L {
     }
 
     DataFrame DataFrame::oneHotEncode(const std::vector<std::string>& column_names) const {
+        U_TRACE_SCOPE("DataFrame::oneHotEncode");
         // New DataFrame to hold the one-hot encoded data
         DataFrame encoded_df;
 
@@ -208,6 +497,13 @@ namespace L {
                 throw std::runtime_error("Column '" + col_name + "' does not exist in the DataFrame.");
             }
 
+            // The cached statistics already list the categories of most columns
+            const ColumnStatistics column_statistics = statistics(col_name);
+            if (column_statistics.categorical && column_statistics.exact) {
+                unique_categories[col_name] = column_statistics.categories;
+                continue;
+            }
+
             size_t col_idx = column_indices_.at(col_name);
             std::set<std::string> categories_set;
 
@@ -308,7 +604,147 @@ namespace L {
             encoded_df.column_indices_[new_column_names[i]] = i;
         }
 
+        // The columns copied over keep their statistics
+        encoded_df.resetStatistics();
+        for (const auto& col_name : column_names_) {
+            auto it = encoded_df.column_indices_.find(col_name);
+            if (it != encoded_df.column_indices_.end() && statistics_.size() == column_names_.size() &&
+                std::find(column_names.begin(), column_names.end(), col_name) == column_names.end()) {
+                std::atomic_store(&encoded_df.statistics_[it->second], std::atomic_load(&statistics_[column_indices_.at(col_name)]));
+            }
+        }
+
         return encoded_df;
     }
 
+    void DataFrame::resetStatistics() {
+        statistics_.assign(column_names_.size(), nullptr);
+    }
+
+    std::shared_ptr<const DataFrame::ColumnStatistics> DataFrame::columnStatistics(size_t column, const U::ExecutionPolicy& policy) const {
+        const bool cacheable = statistics_.size() == column_names_.size();
+        if (cacheable) {
+            if (auto cached = std::atomic_load(&statistics_[column])) {
+                return cached;
+            }
+        }
+
+        U_TRACE_SCOPE("DataFrame::statistics");
+        const std::ptrdiff_t rows = static_cast<std::ptrdiff_t>(getRowCount());
+        const std::ptrdiff_t grain = std::max(kStatisticsRows, (rows + kMaxStatisticsBlocks - 1) / kMaxStatisticsBlocks);
+        ColumnAccumulator total = policy.parallel_reduce(
+            0, rows, grain, ColumnAccumulator(),
+            [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+                ColumnAccumulator partial;
+                for (std::ptrdiff_t i = begin; i < end; ++i) {
+                    partial.add(data_[i][column]);
+                }
+                return partial;
+            },
+            [](ColumnAccumulator result, ColumnAccumulator partial) {
+                result.merge(std::move(partial));
+                return result;
+            });
+
+        auto statistics = std::make_shared<ColumnStatistics>();
+        statistics->count = total.count;
+        statistics->strings = total.strings;
+        if (total.count > 0) {
+            statistics->min = total.min;
+            statistics->max = total.max;
+            statistics->mean = total.mean;
+            statistics->variance = total.m2 / total.count;
+        }
+        statistics->exact = total.exact;
+        statistics->categorical = total.categorical;
+        if (total.exact) {
+            statistics->distinct = static_cast<double>(total.numbers.size() + total.texts.size());
+            statistics->values.assign(total.numbers.begin(), total.numbers.end());
+            std::sort(statistics->values.begin(), statistics->values.end());
+            if (total.categorical) {
+                // Named as oneHotEncode names them: the string itself, or the integer written out
+                std::set<std::string> categories(total.texts.begin(), total.texts.end());
+                for (double value : statistics->values) {
+                    categories.insert(std::to_string(static_cast<int>(value)));
+                }
+                statistics->categories.assign(categories.begin(), categories.end());
+            }
+        } else {
+            statistics->distinct = total.estimate();
+        }
+
+        for (size_t row : sampleRows(getRowCount())) {
+            const DataType& value = data_[row][column];
+            if (!std::holds_alternative<std::string>(value)) {
+                double x = std::visit([](const auto& cell) -> double {
+                    if constexpr (std::is_arithmetic_v<std::decay_t<decltype(cell)>>) {
+                        return static_cast<double>(cell);
+                    } else {
+                        return 0.0;
+                    }
+                }, value);
+                if (!std::isnan(x)) {
+                    statistics->sample.push_back(x);
+                }
+            }
+        }
+        std::sort(statistics->sample.begin(), statistics->sample.end());
+
+        if (cacheable) {
+            std::atomic_store(&statistics_[column], std::shared_ptr<const ColumnStatistics>(statistics));
+        }
+        return statistics;
+    }
+
+    DataFrame::ColumnStatistics DataFrame::statistics(const std::string& column_name, const U::ExecutionPolicy& policy) const {
+        auto it = column_indices_.find(column_name);
+        if (it == column_indices_.end()) {
+            throw std::invalid_argument("Column " + column_name + " not found in DataFrame.");
+        }
+        return *columnStatistics(it->second, policy);
+    }
+
+    std::vector<DataFrame::ColumnStatistics> DataFrame::statistics(const U::ExecutionPolicy& policy) const {
+        std::vector<ColumnStatistics> all;
+        for (size_t j = 0; j < column_names_.size(); ++j) {
+            all.push_back(*columnStatistics(j, policy));
+        }
+        return all;
+    }
+
+    double DataFrame::ColumnStatistics::quantile(double q) const {
+        if (sample.empty()) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        // Linear interpolation between the closest ranks
+        const double position = std::clamp(q, 0.0, 1.0) * (sample.size() - 1);
+        const size_t below = static_cast<size_t>(position);
+        const size_t above = std::min(below + 1, sample.size() - 1);
+        return sample[below] + (position - below) * (sample[above] - sample[below]);
+    }
+
+    std::vector<double> DataFrame::ColumnStatistics::cutPoints(int max_bins) const {
+        if (count == 0) {
+            return {std::numeric_limits<double>::infinity()};
+        }
+        if (exact && values.size() <= static_cast<size_t>(max_bins)) {
+            return values;
+        }
+        // Evenly spaced ranks of the sample, so each bin holds about the same number of rows
+        std::vector<double> cuts;
+        const size_t n = sample.size();
+        for (int k = 1; k <= max_bins; ++k) {
+            const size_t rank = (static_cast<size_t>(k) * n) / max_bins;
+            if (rank > 0 && (cuts.empty() || sample[rank - 1] > cuts.back())) {
+                cuts.push_back(sample[rank - 1]);
+            }
+        }
+        // The last bin reaches the largest value, sampled or not
+        if (cuts.empty()) {
+            return {max};
+        }
+        cuts.back() = std::max(cuts.back(), max);
+        return cuts;
+    }
+
 } // namespace L
@@ -1,85 +1,504 @@
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <set>
+#include <string>
 #include <unordered_set>
 #include <unordered_map>
-#include <functional>
+#include <utility>
+#include <vector>
 #include "L/DecisionTreeClassifier.hpp"
 #include "U/TreeUtils.hpp"
 #include "U/MatrixUtils.hpp"
+#include "U/Trace.hpp"
+#include "U/Serialization.hpp"
 
 namespace L {
 
-DecisionTreeClassifier::DecisionTreeClassifier(const int max_depth)
-    : max_depth_(max_depth), root_(nullptr) {}
+namespace {
 
-void DecisionTreeClassifier::fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) {
-    root_ = buildTree(X, y, 0);
+// Rows scored per parallel chunk at inference
+constexpr std::ptrdiff_t kPredictGrain = 1024;
+
+// Below this many rows both subtrees are built on the current thread
+constexpr Eigen::Index kParallelSubtreeRows = 2048;
+
+// Majority class, size and Gini impurity of a node from the labels of its rows
+void describe(U::TreeNode* node, const Eigen::VectorXd& y) {
+    node->class_label = U::computeMode(y);
+    node->samples = static_cast<int>(y.size());
+    std::map<int, double> counts;
+    for (Eigen::Index i = 0; i < y.size(); ++i) {
+        counts[static_cast<int>(y[i])] += 1.0;
+    }
+    node->impurity = 1.0;
+    for (const auto& [label, count] : counts) {
+        const double p = count / y.size();
+        node->impurity -= p * p;
+    }
 }
 
-Eigen::VectorXd DecisionTreeClassifier::predict(const Eigen::MatrixXd& X) const {
-    Eigen::VectorXd predictions(X.rows());
-    for (int i = 0; i < X.rows(); ++i) {
-        predictions[i] = predictInstance(X.row(i), root_);
+bool isLeaf(const U::TreeNode* node) {
+    return !node->left && !node->right;
+}
+
+// Turn a split into a leaf predicting its class_label; its subtree is left to the arena
+void collapse(U::TreeNode* node) {
+    node->feature_index = -1;
+    node->threshold = 0.0;
+    node->left = nullptr;
+    node->right = nullptr;
+}
+
+// Nodes of a tree in preorder, without recursion: reversed, every node comes after its subtree
+std::vector<U::TreeNode*> preorder(U::TreeNode* root) {
+    std::vector<U::TreeNode*> nodes;
+    std::vector<U::TreeNode*> pending = {root};
+    while (!pending.empty()) {
+        U::TreeNode* node = pending.back();
+        pending.pop_back();
+        nodes.push_back(node);
+        if (!isLeaf(node)) {
+            pending.push_back(node->right);
+            pending.push_back(node->left);
+        }
     }
-    return predictions;
+    return nodes;
 }
 
-Eigen::MatrixXd DecisionTreeClassifier::predict_proba(const Eigen::MatrixXd& X) const {
-    // Determine the number of classes
-    std::unordered_set<int> class_labels;
+// Leaves that can still be split in best-first growth, the largest gain first and the earliest
+// pushed on ties, so the tree does not depend on the order of equal gains in the heap
+template <typename Candidate>
+class Frontier {
+public:
+    bool empty() const { return heap_.empty(); }
+
+    void push(Candidate candidate) {
+        candidate.order = pushed_++;
+        heap_.push_back(std::move(candidate));
+        std::push_heap(heap_.begin(), heap_.end(), before);
+    }
 
-    std::function<void(U::TreeNode*)> gatherLabels;
+    Candidate pop() {
+        std::pop_heap(heap_.begin(), heap_.end(), before);
+        Candidate best = std::move(heap_.back());
+        heap_.pop_back();
+        return best;
+    }
 
-    gatherLabels = [this, &class_labels, &gatherLabels](U::TreeNode* node) {
-        if (!node) return;
-        if (!node->left && !node->right) {
-            class_labels.insert(node->class_label);
-        } else {
-            gatherLabels(node->left);
-            gatherLabels(node->right);
+private:
+    // Heap order: a comes out after b
+    static bool before(const Candidate& a, const Candidate& b) {
+        return a.split.gain < b.split.gain || (a.split.gain == b.split.gain && a.order > b.order);
+    }
+
+    std::vector<Candidate> heap_;
+    size_t pushed_ = 0;
+};
+
+// Weakest-link pruning (Breiman et al., 1984) of the tree under root: the splits collapsed one after
+// the other while the smallest g(t) = (R(t) - R(T_t)) / (leaves(T_t) - 1) is at most alpha, and the
+// distinct effective alphas of those collapses. R(t) is the impurity of node t times its share of
+// the training rows and R(T_t) the sum over the leaves of its subtree, kept up to date along the
+// path to the root after every collapse.
+struct WeakestLinks {
+    std::vector<U::TreeNode*> collapsed;
+    std::vector<double> alphas;
+};
+
+WeakestLinks weakestLinks(U::TreeNode* root, double alpha) {
+    const std::vector<U::TreeNode*> nodes = preorder(root);
+    const size_t n = nodes.size();
+    std::unordered_map<const U::TreeNode*, int> index_of;
+    for (size_t i = 0; i < n; ++i) {
+        index_of.emplace(nodes[i], static_cast<int>(i));
+    }
+    std::vector<int> parent(n, -1), left(n, -1), right(n, -1), leaves(n, 1);
+    std::vector<double> risk(n), subtree_risk(n), strength(n);
+    for (size_t i = n; i-- > 0;) {
+        risk[i] = nodes[i]->samples * nodes[i]->impurity / root->samples;
+        subtree_risk[i] = risk[i];
+        if (!isLeaf(nodes[i])) {
+            left[i] = index_of.at(nodes[i]->left);
+            right[i] = index_of.at(nodes[i]->right);
+            parent[left[i]] = parent[right[i]] = static_cast<int>(i);
+            subtree_risk[i] = subtree_risk[left[i]] + subtree_risk[right[i]];
+            leaves[i] = leaves[left[i]] + leaves[right[i]];
         }
+    }
+
+    // Splits by strength, ties to the first in preorder
+    std::set<std::pair<double, int>> links;
+    auto link = [&](int i) {
+        strength[i] = (risk[i] - subtree_risk[i]) / (leaves[i] - 1);
+        links.emplace(strength[i], i);
     };
+    for (size_t i = 0; i < n; ++i) {
+        if (left[i] != -1) {
+            link(static_cast<int>(i));
+        }
+    }
 
-    gatherLabels(root_);
+    WeakestLinks result;
+    while (!links.empty() && links.begin()->first <= alpha) {
+        const auto [weakest, t] = *links.begin();
+
+        // The splits under t are gone with it
+        std::vector<int> pending = {t};
+        while (!pending.empty()) {
+            int i = pending.back();
+            pending.pop_back();
+            if (left[i] != -1) {
+                links.erase({strength[i], i});
+                pending.push_back(left[i]);
+                pending.push_back(right[i]);
+            }
+        }
+        const double risk_change = risk[t] - subtree_risk[t];
+        const int leaves_change = 1 - leaves[t];
+        left[t] = right[t] = -1;
+        for (int a = parent[t]; a != -1; a = parent[a]) {
+            links.erase({strength[a], a});
+            subtree_risk[a] += risk_change;
+            leaves[a] += leaves_change;
+            link(a);
+        }
 
-    int num_classes = class_labels.size();
-    std::vector<int> unique_classes(class_labels.begin(), class_labels.end());
-    std::sort(unique_classes.begin(), unique_classes.end());
+        result.collapsed.push_back(nodes[t]);
+        const double effective = std::max(weakest, result.alphas.empty() ? 0.0 : result.alphas.back());
+        if (result.alphas.empty() || effective > result.alphas.back()) {
+            result.alphas.push_back(effective);
+        }
+    }
+    return result;
+}
 
-    // Initialize the probability matrix
-    Eigen::MatrixXd probabilities(X.rows(), num_classes);
-    probabilities.setZero();
-    
-    std::function<void(const Eigen::VectorXd&, U::TreeNode*, std::unordered_map<int, double>&, int)> predictProbaInstance;
+// Rows of X with X(i, feature) <= threshold go to the left side, the others to the right, in order
+void partition(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, int feature, double threshold,
+               Eigen::MatrixXd& X_left, Eigen::VectorXd& y_left, Eigen::MatrixXd& X_right, Eigen::VectorXd& y_right) {
+    const Eigen::Index n_left = (X.col(feature).array() <= threshold).count();
+    X_left.resize(n_left, X.cols());
+    y_left.resize(n_left);
+    X_right.resize(X.rows() - n_left, X.cols());
+    y_right.resize(X.rows() - n_left);
+    Eigen::Index l = 0, r = 0;
+    for (Eigen::Index i = 0; i < X.rows(); ++i) {
+        if (X(i, feature) <= threshold) {
+            X_left.row(l) = X.row(i);
+            y_left[l++] = y[i];
+        } else {
+            X_right.row(r) = X.row(i);
+            y_right[r++] = y[i];
+        }
+    }
+}
 
-    // Helper to compute probabilities for a single instance
-    predictProbaInstance = [this, &unique_classes, &predictProbaInstance] (const Eigen::VectorXd& instance, U::TreeNode* node, std::unordered_map<int, double>& class_counts, int depth) {
-        if (!node->left && !node->right) {
-            class_counts[node->class_label] += 1.0;
-            return;
+} // namespace
+
+DecisionTreeClassifier::DecisionTreeClassifier(const int max_depth, int min_samples_split, int min_samples_leaf,
+                                               int max_leaf_nodes, double ccp_alpha)
+    : max_depth_(max_depth), min_samples_split_(min_samples_split), min_samples_leaf_(min_samples_leaf),
+      max_leaf_nodes_(max_leaf_nodes), ccp_alpha_(ccp_alpha), root_(nullptr),
+      arena_(std::make_shared<U::TreeNodeArena>()) {
+    if (min_samples_split < 2) {
+        throw std::invalid_argument("min_samples_split must be at least 2.");
+    }
+    if (min_samples_leaf < 1) {
+        throw std::invalid_argument("min_samples_leaf must be at least 1.");
+    }
+    if (max_leaf_nodes < 0) {
+        throw std::invalid_argument("max_leaf_nodes must be non-negative (0 for no limit).");
+    }
+    if (!(ccp_alpha >= 0.0)) {
+        throw std::invalid_argument("ccp_alpha must be non-negative.");
+    }
+}
+
+DecisionTreeClassifier::DecisionTreeClassifier(const DecisionTreeClassifier& other)
+    : max_depth_(other.max_depth_), min_samples_split_(other.min_samples_split_),
+      min_samples_leaf_(other.min_samples_leaf_), max_leaf_nodes_(other.max_leaf_nodes_), ccp_alpha_(other.ccp_alpha_),
+      n_features_(other.n_features_), root_(nullptr), arena_(std::make_shared<U::TreeNodeArena>()), execution_policy_(other.execution_policy_) {
+    root_ = copyTree(other.root_);
+    flat_ = other.flat_;
+}
+
+// The moved-from tree is left empty, without an arena until its next fit() or load()
+DecisionTreeClassifier::DecisionTreeClassifier(DecisionTreeClassifier&& other) noexcept
+    : max_depth_(other.max_depth_), min_samples_split_(other.min_samples_split_),
+      min_samples_leaf_(other.min_samples_leaf_), max_leaf_nodes_(other.max_leaf_nodes_), ccp_alpha_(other.ccp_alpha_),
+      n_features_(other.n_features_), root_(other.root_), arena_(std::move(other.arena_)),
+      flat_(std::move(other.flat_)), execution_policy_(other.execution_policy_) {
+    other.root_ = nullptr;
+}
+
+DecisionTreeClassifier& DecisionTreeClassifier::operator=(DecisionTreeClassifier other) noexcept {
+    std::swap(max_depth_, other.max_depth_);
+    std::swap(min_samples_split_, other.min_samples_split_);
+    std::swap(min_samples_leaf_, other.min_samples_leaf_);
+    std::swap(max_leaf_nodes_, other.max_leaf_nodes_);
+    std::swap(ccp_alpha_, other.ccp_alpha_);
+    std::swap(n_features_, other.n_features_);
+    std::swap(root_, other.root_);
+    std::swap(flat_, other.flat_);
+    std::swap(arena_, other.arena_);
+    std::swap(execution_policy_, other.execution_policy_);
+    return *this;
+}
+
+void DecisionTreeClassifier::setExecutionPolicy(const U::ExecutionPolicy& policy) {
+    execution_policy_ = policy;
+}
+
+void DecisionTreeClassifier::setArena(std::shared_ptr<U::TreeNodeArena> arena) {
+    if (!arena) {
+        throw std::invalid_argument("Tree node arena must not be null.");
+    }
+    arena_ = std::move(arena);
+    root_ = nullptr;
+    n_features_ = 0;
+    flat_ = U::FlatTree();
+}
+
+void DecisionTreeClassifier::resetArena() {
+    // A private arena is rewound and its slabs reused. A shared arena is append-only: it takes the
+    // first tree after setArena(), and a refit moves to a private arena instead of growing it.
+    if (!arena_ || (arena_.use_count() > 1 && root_)) {
+        arena_ = std::make_shared<U::TreeNodeArena>();
+    } else if (arena_.use_count() == 1) {
+        arena_->clear();
+    }
+    root_ = nullptr;
+    flat_ = U::FlatTree();
+}
+
+void DecisionTreeClassifier::fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) {
+    U_TRACE_SCOPE("DecisionTreeClassifier::fit");
+    resetArena();
+    n_features_ = static_cast<int>(X.cols());
+    root_ = max_leaf_nodes_ > 0 ? growBestFirst(X, y) : buildTree(X, y, 0);
+    finishTree();
+}
+
+struct DecisionTreeClassifier::BinnedFit {
+    const U::BinnedMatrix& X;
+    const Eigen::VectorXd& y;
+    std::vector<int> classes;   // Class index of every row, labels compared as integers
+    int n_classes = 0;
+};
+
+void DecisionTreeClassifier::fit(const U::BinnedMatrix& X, const Eigen::VectorXd& y) {
+    U_TRACE_SCOPE("DecisionTreeClassifier::fit");
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("Number of rows in X must match the size of y.");
+    }
+    if (y.size() == 0) {
+        throw std::invalid_argument("Cannot fit a DecisionTreeClassifier on an empty dataset.");
+    }
+    resetArena();
+    n_features_ = static_cast<int>(X.cols());
+
+    BinnedFit binned{X, y, std::vector<int>(y.size())};
+    for (Eigen::Index i = 0; i < y.size(); ++i) {
+        binned.classes[i] = static_cast<int>(y[i]);
+    }
+    std::vector<int> labels = binned.classes;
+    std::sort(labels.begin(), labels.end());
+    labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+    for (int& label : binned.classes) {
+        label = static_cast<int>(std::lower_bound(labels.begin(), labels.end(), label) - labels.begin());
+    }
+    binned.n_classes = static_cast<int>(labels.size());
+
+    std::vector<int> rows(y.size());
+    std::iota(rows.begin(), rows.end(), 0);
+    std::vector<double> histogram(static_cast<size_t>(X.totalBins()) * binned.n_classes);
+    U::TreeUtils::binHistogram(X, binned.classes.data(), binned.n_classes, rows.data(), y.size(), histogram.data(),
+                               execution_policy_);
+    root_ = max_leaf_nodes_ > 0 ? growBinnedBestFirst(binned, rows.data(), y.size(), std::move(histogram))
+                                : buildBinnedTree(binned, rows.data(), y.size(), std::move(histogram), 0);
+    finishTree();
+}
+
+void DecisionTreeClassifier::finishTree() {
+    // In a shared arena the nodes dropped here stay behind, at most one grown tree per fit
+    const size_t nodes = nodeCount();
+    if (ccp_alpha_ > 0.0) {
+        U_TRACE_SCOPE("DecisionTreeClassifier::prune");
+        for (U::TreeNode* node : weakestLinks(root_, ccp_alpha_).collapsed) {
+            collapse(node);
         }
-        if (instance[node->feature_index] <= node->threshold) {
-            predictProbaInstance(instance, node->left, class_counts, depth + 1);
-        } else {
-            predictProbaInstance(instance, node->right, class_counts, depth + 1);
+    }
+    compactTree(nodes, false);
+}
+
+void DecisionTreeClassifier::prune(double alpha) {
+    U_TRACE_SCOPE("DecisionTreeClassifier::prune");
+    if (!root_) {
+        throw std::logic_error("DecisionTreeClassifier must be fitted before prune.");
+    }
+    if (!(alpha >= 0.0)) {
+        throw std::invalid_argument("alpha must be non-negative.");
+    }
+    if (root_->samples == 0) {
+        throw std::logic_error("A DecisionTreeClassifier read by load() has no training statistics to prune with.");
+    }
+    const size_t nodes = nodeCount();
+    for (U::TreeNode* node : weakestLinks(root_, alpha).collapsed) {
+        collapse(node);
+    }
+    compactTree(nodes, true);
+}
+
+std::vector<double> DecisionTreeClassifier::pruningPath() const {
+    if (!root_) {
+        throw std::logic_error("DecisionTreeClassifier must be fitted before pruningPath.");
+    }
+    if (root_->samples == 0) {
+        throw std::logic_error("A DecisionTreeClassifier read by load() has no training statistics to prune with.");
+    }
+    return weakestLinks(root_, std::numeric_limits<double>::infinity()).alphas;
+}
+
+void DecisionTreeClassifier::compact() {
+    if (!root_) {
+        throw std::logic_error("DecisionTreeClassifier must be fitted before compact.");
+    }
+    compactTree(nodeCount(), true);
+}
+
+void DecisionTreeClassifier::compactTree(size_t nodes_before, bool leave_shared_arena) {
+    // Children come before their parent in reverse preorder, so merges carry up in one pass
+    const std::vector<U::TreeNode*> nodes = preorder(root_);
+    for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+        U::TreeNode* node = *it;
+        if (!isLeaf(node) && isLeaf(node->left) && isLeaf(node->right) &&
+            node->left->class_label == node->right->class_label) {
+            node->class_label = node->left->class_label;
+            collapse(node);
         }
-    };
+    }
+    releaseDeadNodes(nodes_before, leave_shared_arena);
+    flat_ = U::TreeUtils::flatten(root_);
+}
+
+void DecisionTreeClassifier::releaseDeadNodes(size_t nodes_before, bool leave_shared_arena) {
+    // Collapsed subtrees stay in the arena until it is cleared: a private arena is swapped for a
+    // fresh one holding only the live nodes. A shared arena cannot drop the nodes of one tree, so
+    // with leave_shared_arena the tree moves to a private arena as soon as it loses any.
+    const size_t nodes = nodeCount();
+    const bool shared = arena_.use_count() > 1;
+    if ((!shared && arena_->size() > nodes) || (shared && leave_shared_arena && nodes < nodes_before)) {
+        std::shared_ptr<U::TreeNodeArena> old = std::move(arena_);
+        arena_ = std::make_shared<U::TreeNodeArena>();
+        root_ = copyTree(root_);
+    }
+}
 
+size_t DecisionTreeClassifier::nodeCount() const {
+    size_t count = 0;
+    std::vector<const U::TreeNode*> pending;
+    if (root_) pending.push_back(root_);
+    while (!pending.empty()) {
+        const U::TreeNode* node = pending.back();
+        pending.pop_back();
+        ++count;
+        if (node->left) pending.push_back(node->left);
+        if (node->right) pending.push_back(node->right);
+    }
+    return count;
+}
 
-    for (int i = 0; i < X.rows(); ++i) {
-        std::unordered_map<int, double> class_counts;
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+void DecisionTreeClassifier::fit(const U::DenseMatrix<Scalar>& X, const U::DenseVector<Scalar>& y) {
+    // Widening is exact and split search copies the rows of every node anyway
+    fit(Eigen::MatrixXd(X.template cast<double>()), Eigen::VectorXd(y.template cast<double>()));
+}
+
+template void DecisionTreeClassifier::fit<float>(const Eigen::MatrixXf&, const Eigen::VectorXf&);
+
+Eigen::VectorXd DecisionTreeClassifier::predict(const Eigen::MatrixXd& X) const {
+    return labels(X);
+}
 
-        // Traverse the tree and collect class counts
-        predictProbaInstance(X.row(i), root_, class_counts, 0);
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+U::DenseVector<Scalar> DecisionTreeClassifier::predict(const U::DenseMatrix<Scalar>& X) const {
+    return labels(X);
+}
+
+template Eigen::VectorXf DecisionTreeClassifier::predict<float>(const Eigen::MatrixXf&) const;
+
+Eigen::MatrixXd DecisionTreeClassifier::predict_proba(const Eigen::MatrixXd& X) const {
+    return probabilities(X);
+}
+
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+U::DenseMatrix<Scalar> DecisionTreeClassifier::predict_proba(const U::DenseMatrix<Scalar>& X) const {
+    return probabilities(X);
+}
+
+template Eigen::MatrixXf DecisionTreeClassifier::predict_proba<float>(const Eigen::MatrixXf&) const;
+
+template <typename Scalar>
+void DecisionTreeClassifier::checkInput(const U::DenseMatrix<Scalar>& X, const char* method) const {
+    if (!root_) {
+        throw std::logic_error(std::string("DecisionTreeClassifier must be fitted before ") + method + ".");
+    }
+    if (n_features_ > 0) {
+        if (X.cols() != n_features_) {
+            throw std::invalid_argument("Number of features does not match the fitted model.");
+        }
+        return;
+    }
+    // A version-1 file only tells which features the splits read
+    for (int feature : flat_.feature) {
+        if (feature >= X.cols()) {
+            throw std::invalid_argument("Number of features does not match the fitted model.");
+        }
+    }
+}
 
-        // Normalize the counts into probabilities
-        double total = 0;
-        for (const auto& [label, count] : class_counts) {
-            total += count;
+template <typename Scalar>
+U::DenseVector<Scalar> DecisionTreeClassifier::labels(const U::DenseMatrix<Scalar>& X) const {
+    U_TRACE_SCOPE("DecisionTreeClassifier::predict");
+    checkInput(X, "predict");
+    U::DenseVector<Scalar> predictions(X.rows());
+    execution_policy_.parallel_for(0, X.rows(), kPredictGrain, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+        std::vector<int> leaves(end - begin);
+        U::TreeUtils::findLeaves(flat_, X, begin, end, leaves.data());
+        for (std::ptrdiff_t i = begin; i < end; ++i) {
+            predictions[i] = static_cast<Scalar>(flat_.label[leaves[i - begin]]);
         }
-        for (size_t j = 0; j < unique_classes.size(); ++j) {
-            int class_label = unique_classes[j];
-            probabilities(i, j) = class_counts.count(class_label) ? class_counts[class_label] / total : 0.0;
+    });
+    return predictions;
+}
+
+template <typename Scalar>
+U::DenseMatrix<Scalar> DecisionTreeClassifier::probabilities(const U::DenseMatrix<Scalar>& X) const {
+    U_TRACE_SCOPE("DecisionTreeClassifier::predict_proba");
+    checkInput(X, "predict_proba");
+
+    // Determine the classes from the leaves, one column each in sorted order
+    std::set<int> class_labels;
+    for (size_t node = 0; node < flat_.label.size(); ++node) {
+        if (flat_.left[node] == static_cast<int>(node)) {
+            class_labels.insert(flat_.label[node]);
         }
     }
+    std::unordered_map<int, Eigen::Index> column_of;
+    for (int label : class_labels) {
+        column_of.emplace(label, static_cast<Eigen::Index>(column_of.size()));
+    }
+
+    // Each row reaches a single leaf, which holds all its probability
+    U::DenseMatrix<Scalar> probabilities = U::DenseMatrix<Scalar>::Zero(X.rows(), class_labels.size());
+    execution_policy_.parallel_for(0, X.rows(), kPredictGrain, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+        std::vector<int> leaves(end - begin);
+        U::TreeUtils::findLeaves(flat_, X, begin, end, leaves.data());
+        for (std::ptrdiff_t i = begin; i < end; ++i) {
+            probabilities(i, column_of.at(flat_.label[leaves[i - begin]])) = 1.0;
+        }
+    });
 
     assert(probabilities.rows() == X.rows() && probabilities.cols() > 0);
     assert((probabilities.array() >= 0).all() && (probabilities.array() <= 1).all());
@@ -89,77 +508,302 @@ Eigen::MatrixXd DecisionTreeClassifier::predict_proba(const Eigen::MatrixXd& X)
 }
 
 
-U::TreeNode* DecisionTreeClassifier::buildTree(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, int depth) {
-    if (depth >= max_depth_ || y.size() <= 1 || std::unordered_set<double>(y.data(), y.data() + y.size()).size() == 1) {
-        auto* leaf = new U::TreeNode();
-        leaf->class_label = U::computeMode(y); // Assign most common class
-        return leaf;
-    }
+bool DecisionTreeClassifier::splittable(std::ptrdiff_t n, int depth, double impurity) const {
+    // A node of a single class has no impurity left to remove
+    return depth < max_depth_ && n >= min_samples_split_ && n >= 2 * static_cast<std::ptrdiff_t>(min_samples_leaf_) &&
+           impurity > 0.0;
+}
 
-    int best_feature;
-    double best_threshold, best_gini;
-    U::TreeUtils::findBestSplit(X, y, best_feature, best_threshold, best_gini);
+DecisionTreeClassifier::Split DecisionTreeClassifier::findSplit(const U::TreeNode* node, const Eigen::MatrixXd& X,
+                                                                const Eigen::VectorXd& y, int depth) const {
+    Split split;
+    if (!splittable(y.size(), depth, node->impurity)) {
+        return split;
+    }
+    double best_gini;
+    U::TreeUtils::findBestSplit(X, y, split.feature, split.threshold, best_gini, execution_policy_, min_samples_leaf_);
+    split.gain = y.size() * (node->impurity - best_gini);
+    return split;
+}
 
-    if (best_feature == -1) {
-        auto* leaf = new U::TreeNode();
-        leaf->class_label = U::computeMode(y);
-        return leaf;
+U::TreeNode* DecisionTreeClassifier::buildTree(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, int depth) {
+    U_TRACE_SCOPE("DecisionTreeClassifier::buildTree");
+    U_TRACE_COUNT("DecisionTreeClassifier nodes", 1);
+    auto* node = arena_->allocate();
+    describe(node, y);
+    const Split split = findSplit(node, X, y, depth);
+    if (split.feature == -1) {
+        return node;
     }
 
     Eigen::MatrixXd X_left, X_right;
     Eigen::VectorXd y_left, y_right;
+    partition(X, y, split.feature, split.threshold, X_left, y_left, X_right, y_right);
+    node->feature_index = split.feature;
+    node->threshold = split.threshold;
+
+    // Large subtrees are built side by side; small ones are not worth a task
+    if (X.rows() >= kParallelSubtreeRows) {
+        execution_policy_.parallel_for(0, 2, 1, [&](std::ptrdiff_t side, std::ptrdiff_t) {
+            if (side == 0) {
+                node->left = buildTree(X_left, y_left, depth + 1);
+            } else {
+                node->right = buildTree(X_right, y_right, depth + 1);
+            }
+        });
+    } else {
+        node->left = buildTree(X_left, y_left, depth + 1);
+        node->right = buildTree(X_right, y_right, depth + 1);
+    }
 
-    // Initialize empty matrices/vectors
-    X_left.resize(0, X.cols());
-    X_right.resize(0, X.cols());
-    y_left.resize(0);
-    y_right.resize(0);
+    return node;
+}
 
-    for (int i = 0; i < X.rows(); ++i) {
-        if (X(i, best_feature) <= best_threshold) {
-            X_left.conservativeResize(X_left.rows() + 1, X.cols());
-            X_left.row(X_left.rows() - 1) = X.row(i);
+U::TreeNode* DecisionTreeClassifier::growBestFirst(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) {
+    U_TRACE_SCOPE("DecisionTreeClassifier::buildTree");
+    // Leaves that can be split, with their rows
+    struct Candidate {
+        U::TreeNode* node;
+        Eigen::MatrixXd X;
+        Eigen::VectorXd y;
+        int depth;
+        Split split;
+        size_t order = 0;
+    };
+    Frontier<Candidate> frontier;
+    auto grow = [&](Eigen::MatrixXd X_node, Eigen::VectorXd y_node, int depth) {
+        U_TRACE_COUNT("DecisionTreeClassifier nodes", 1);
+        auto* node = arena_->allocate();
+        describe(node, y_node);
+        const Split split = findSplit(node, X_node, y_node, depth);
+        if (split.feature != -1) {
+            frontier.push({node, std::move(X_node), std::move(y_node), depth, split});
+        }
+        return node;
+    };
 
-            y_left.conservativeResize(y_left.size() + 1);
-            y_left(y_left.size() - 1) = y[i]; // Correct indexing
-        } else {
-            X_right.conservativeResize(X_right.rows() + 1, X.cols());
-            X_right.row(X_right.rows() - 1) = X.row(i);
+    U::TreeNode* root = grow(X, y, 0);
+    for (int leaves = 1; leaves < max_leaf_nodes_ && !frontier.empty(); ++leaves) {
+        Candidate best = frontier.pop();
+        Eigen::MatrixXd X_left, X_right;
+        Eigen::VectorXd y_left, y_right;
+        partition(best.X, best.y, best.split.feature, best.split.threshold, X_left, y_left, X_right, y_right);
+        best.node->feature_index = best.split.feature;
+        best.node->threshold = best.split.threshold;
+        best.node->left = grow(std::move(X_left), std::move(y_left), best.depth + 1);
+        best.node->right = grow(std::move(X_right), std::move(y_right), best.depth + 1);
+    }
+    return root;
+}
+
+U::TreeNode* DecisionTreeClassifier::binnedNode(const BinnedFit& binned, const int* rows, std::ptrdiff_t n) {
+    U_TRACE_COUNT("DecisionTreeClassifier nodes", 1);
+    // Labels of the node in row order, so the mode breaks ties as the exact search does
+    Eigen::VectorXd y(n);
+    for (std::ptrdiff_t i = 0; i < n; ++i) {
+        y[i] = binned.y[rows[i]];
+    }
+    auto* node = arena_->allocate();
+    describe(node, y);
+    return node;
+}
 
-            y_right.conservativeResize(y_right.size() + 1);
-            y_right(y_right.size() - 1) = y[i]; // Correct indexing
+DecisionTreeClassifier::Split DecisionTreeClassifier::findBinnedSplit(const BinnedFit& binned, const U::TreeNode* node,
+                                                                      const std::vector<double>& histogram, int depth) const {
+    Split split;
+    if (!splittable(node->samples, depth, node->impurity)) {
+        return split;
+    }
+    double best_gini;
+    U::TreeUtils::findBestSplit(binned.X, histogram.data(), binned.n_classes, split.feature, split.bin, best_gini,
+                                execution_policy_, min_samples_leaf_);
+    if (split.feature != -1) {
+        split.threshold = binned.X.threshold(split.feature, split.bin);
+        split.gain = node->samples * (node->impurity - best_gini);
+    }
+    return split;
+}
+
+std::ptrdiff_t DecisionTreeClassifier::partitionRows(const BinnedFit& binned, int* rows, std::ptrdiff_t n,
+                                                     const Split& split) const {
+    // Rows of each side keep their order; the split leaves at least min_samples_leaf rows on each
+    std::ptrdiff_t n_left = 0;
+    binned.X.withColumn(split.feature, [&](const auto* codes) {
+        n_left = std::stable_partition(rows, rows + n, [&](int row) { return codes[row] <= split.bin; }) - rows;
+    });
+    return n_left;
+}
+
+U::TreeNode* DecisionTreeClassifier::buildBinnedTree(const BinnedFit& binned, int* rows, std::ptrdiff_t n,
+                                                     std::vector<double> histogram, int depth) {
+    U_TRACE_SCOPE("DecisionTreeClassifier::buildTree");
+    U::TreeNode* node = binnedNode(binned, rows, n);
+    const Split split = findBinnedSplit(binned, node, histogram, depth);
+    if (split.feature == -1) {
+        return node;
+    }
+    const std::ptrdiff_t n_left = partitionRows(binned, rows, n, split);
+
+    // Count the smaller child and subtract it from the parent for the larger one;
+    // the children of the last level are leaves and need no histogram
+    std::vector<double> left_histogram, right_histogram;
+    if (depth + 1 < max_depth_) {
+        const bool left_smaller = n_left <= n - n_left;
+        std::vector<double> smaller(histogram.size());
+        U::TreeUtils::binHistogram(binned.X, binned.classes.data(), binned.n_classes, left_smaller ? rows : rows + n_left,
+                                   left_smaller ? n_left : n - n_left, smaller.data(), execution_policy_);
+        for (size_t i = 0; i < histogram.size(); ++i) {
+            histogram[i] -= smaller[i];
         }
+        left_histogram = left_smaller ? std::move(smaller) : std::move(histogram);
+        right_histogram = left_smaller ? std::move(histogram) : std::move(smaller);
     }
 
-    auto* node = new U::TreeNode();
-    node->feature_index = best_feature;
-    node->threshold = best_threshold;
-    node->left = buildTree(X_left, y_left, depth + 1);
-    node->right = buildTree(X_right, y_right, depth + 1);
+    node->feature_index = split.feature;
+    node->threshold = split.threshold;
+
+    if (n >= kParallelSubtreeRows) {
+        execution_policy_.parallel_for(0, 2, 1, [&](std::ptrdiff_t side, std::ptrdiff_t) {
+            if (side == 0) {
+                node->left = buildBinnedTree(binned, rows, n_left, std::move(left_histogram), depth + 1);
+            } else {
+                node->right = buildBinnedTree(binned, rows + n_left, n - n_left, std::move(right_histogram), depth + 1);
+            }
+        });
+    } else {
+        node->left = buildBinnedTree(binned, rows, n_left, std::move(left_histogram), depth + 1);
+        node->right = buildBinnedTree(binned, rows + n_left, n - n_left, std::move(right_histogram), depth + 1);
+    }
 
     return node;
 }
 
-int DecisionTreeClassifier::predictInstance(const Eigen::VectorXd& instance, U::TreeNode* node) const {
-    if (!node->left && !node->right) {
-        return node->class_label;
+U::TreeNode* DecisionTreeClassifier::growBinnedBestFirst(const BinnedFit& binned, int* rows, std::ptrdiff_t n,
+                                                         std::vector<double> histogram) {
+    U_TRACE_SCOPE("DecisionTreeClassifier::buildTree");
+    // Leaves that can be split keep no histogram, as there may be thousands of them: both children of
+    // a split are counted when it is taken from the frontier
+    struct Candidate {
+        U::TreeNode* node;
+        int* rows;
+        std::ptrdiff_t n;
+        int depth;
+        Split split;
+        size_t order = 0;
+    };
+    Frontier<Candidate> frontier;
+    const size_t histogram_size = histogram.size();
+    auto grow = [&](int* node_rows, std::ptrdiff_t node_n, int depth, std::vector<double> node_histogram) {
+        U::TreeNode* node = binnedNode(binned, node_rows, node_n);
+        if (node_histogram.empty() && splittable(node_n, depth, node->impurity)) {
+            node_histogram.resize(histogram_size);
+            U::TreeUtils::binHistogram(binned.X, binned.classes.data(), binned.n_classes, node_rows, node_n,
+                                       node_histogram.data(), execution_policy_);
+        }
+        const Split split = findBinnedSplit(binned, node, node_histogram, depth);
+        if (split.feature != -1) {
+            frontier.push({node, node_rows, node_n, depth, split});
+        }
+        return node;
+    };
+
+    U::TreeNode* root = grow(rows, n, 0, std::move(histogram));
+    for (int leaves = 1; leaves < max_leaf_nodes_ && !frontier.empty(); ++leaves) {
+        Candidate best = frontier.pop();
+        const std::ptrdiff_t n_left = partitionRows(binned, best.rows, best.n, best.split);
+        best.node->feature_index = best.split.feature;
+        best.node->threshold = best.split.threshold;
+        best.node->left = grow(best.rows, n_left, best.depth + 1, {});
+        best.node->right = grow(best.rows + n_left, best.n - n_left, best.depth + 1, {});
     }
-    if (instance[node->feature_index] <= node->threshold) {
-        return predictInstance(instance, node->left);
-    } else {
-        return predictInstance(instance, node->right);
+    return root;
+}
+
+U::TreeNode* DecisionTreeClassifier::copyTree(const U::TreeNode* node) {
+    if (!node) {
+        return nullptr;
+    }
+
+    // Copy node by node with an explicit stack, so deep trees cannot overflow the call stack
+    U::TreeNode* root = arena_->allocate();
+    std::vector<std::pair<const U::TreeNode*, U::TreeNode*>> pending = {{node, root}};
+    while (!pending.empty()) {
+        auto [source, copy] = pending.back();
+        pending.pop_back();
+        *copy = *source;
+        if (source->left) {
+            copy->left = arena_->allocate();
+            pending.emplace_back(source->left, copy->left);
+        }
+        if (source->right) {
+            copy->right = arena_->allocate();
+            pending.emplace_back(source->right, copy->right);
+        }
     }
+    return root;
 }
 
-void DecisionTreeClassifier::deleteTree(U::TreeNode* node) {
-    if (!node) return;
-    deleteTree(node->left);
-    deleteTree(node->right);
-    delete node;
+void DecisionTreeClassifier::save(std::ostream& out) const {
+    if (!root_) {
+        throw std::logic_error("Cannot save a DecisionTreeClassifier before fit.");
+    }
+    U::writeHeader(out, "DecisionTreeClassifier", 2);
+    out << n_features_ << '\n';
+
+    // One line per node in preorder: "leaf <label>" or "split <feature> <threshold>"
+    std::vector<const U::TreeNode*> pending = {root_};
+    while (!pending.empty()) {
+        const U::TreeNode* node = pending.back();
+        pending.pop_back();
+        if (!node->left && !node->right) {
+            out << "leaf " << node->class_label << '\n';
+            continue;
+        }
+        out << "split " << node->feature_index << ' ';
+        U::writeValue(out, node->threshold);
+        pending.push_back(node->right);
+        pending.push_back(node->left);
+    }
 }
 
-DecisionTreeClassifier::~DecisionTreeClassifier() {
-    deleteTree(root_);
+void DecisionTreeClassifier::load(std::istream& in) {
+    // Version 2 adds the number of features
+    const int version = U::readHeader(in, "DecisionTreeClassifier");
+    const int n_features = version >= 2 ? U::readValue<int>(in, "the number of features") : 0;
+    if (n_features < 0) {
+        throw std::runtime_error("Malformed model file: negative number of features.");
+    }
+
+    // Read into a fresh arena, or the shared one if it holds no tree of this model yet, so a
+    // malformed file leaves the model unchanged
+    std::shared_ptr<U::TreeNodeArena> arena =
+        arena_ && arena_.use_count() > 1 && !root_ ? arena_ : std::make_shared<U::TreeNodeArena>();
+    U::TreeNode* root = nullptr;
+
+    // Slots still waiting for their node, in preorder
+    std::vector<U::TreeNode**> pending = {&root};
+    while (!pending.empty()) {
+        U::TreeNode** slot = pending.back();
+        pending.pop_back();
+
+        auto kind = U::readValue<std::string>(in, "a tree node");
+        U::TreeNode* node = arena->allocate();
+        if (kind == "leaf") {
+            node->class_label = U::readValue<int>(in, "a leaf label");
+        } else if (kind == "split") {
+            node->feature_index = U::readValue<int>(in, "a split feature");
+            node->threshold = U::readValue<double>(in, "a split threshold");
+            pending.push_back(&node->right);
+            pending.push_back(&node->left);
+        } else {
+            throw std::runtime_error("Malformed model file: unknown tree node '" + kind + "'.");
+        }
+        *slot = node;
+    }
+    arena_ = std::move(arena);
+    root_ = root;
+    n_features_ = n_features;
+    flat_ = U::TreeUtils::flatten(root_);
 }
 
 } // namespace L
@@ -0,0 +1,154 @@
+#include "L/IncrementalPrincipalComponentAnalysis.hpp"
+#include "U/Trace.hpp"
+#include <Eigen/SVD>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace L {
+
+namespace {
+
+// Smallest sub-batch folded at once. Large batches are split into sub-batches of about k rows,
+// so each SVD is of a (2k + 1) x d matrix and a batch of b rows costs O(b d k) overall.
+constexpr Eigen::Index kMinSubBatchRows = 32;
+
+} // namespace
+
+IncrementalPrincipalComponentAnalysis::IncrementalPrincipalComponentAnalysis(int n_components)
+    : n_components_(n_components)
+{
+    if (n_components <= 0) {
+        throw std::invalid_argument("n_components must be positive.");
+    }
+}
+
+void IncrementalPrincipalComponentAnalysis::truncate(const Eigen::MatrixXd& stacked)
+{
+    // The rows of stacked have the same scatter matrix as all the centered data seen so far
+    Eigen::BDCSVD<Eigen::MatrixXd> svd(stacked, Eigen::ComputeThinV);
+    Eigen::Index rank = std::min<Eigen::Index>(n_components_, svd.singularValues().size());
+
+    singular_values_ = svd.singularValues().head(rank);
+    components_ = svd.matrixV().leftCols(rank);
+}
+
+void IncrementalPrincipalComponentAnalysis::partial_fit(const Eigen::MatrixXd& X)
+{
+    U_TRACE_SCOPE("IncrementalPrincipalComponentAnalysis::partial_fit");
+    if (count_ > 0 && X.cols() != mean_.size()) {
+        throw std::invalid_argument("Number of features does not match the fitted model.");
+    }
+
+    const Eigen::Index sub_batch = std::max<Eigen::Index>(n_components_, kMinSubBatchRows);
+    for (Eigen::Index begin = 0; begin < X.rows(); begin += sub_batch) {
+        const Eigen::Index rows = std::min(sub_batch, X.rows() - begin);
+        const auto batch = X.middleRows(begin, rows);
+        const Eigen::VectorXd batch_mean = batch.colwise().mean();
+
+        // Stack the current model, the centered batch and the mean correction:
+        //   [ S V^T ; X_b - 1 mean_b^T ; sqrt(n m / (n + m)) (mean_b - mean)^T ]
+        const Eigen::Index k = singular_values_.size();
+        Eigen::MatrixXd stacked(k + rows + (count_ > 0 ? 1 : 0), X.cols());
+        if (k > 0) {
+            stacked.topRows(k) = singular_values_.asDiagonal() * components_.transpose();
+        }
+        stacked.middleRows(k, rows) = batch.rowwise() - batch_mean.transpose();
+
+        const double total = count_ + rows;
+        if (count_ > 0) {
+            stacked.bottomRows(1) = std::sqrt(count_ * rows / total) * (batch_mean - mean_).transpose();
+            mean_ += (rows / total) * (batch_mean - mean_);
+        } else {
+            mean_ = batch_mean;
+        }
+        count_ = total;
+
+        truncate(stacked);
+    }
+}
+
+void IncrementalPrincipalComponentAnalysis::reset()
+{
+    count_ = 0.0;
+    mean_.resize(0);
+    components_.resize(0, 0);
+    singular_values_.resize(0);
+}
+
+void IncrementalPrincipalComponentAnalysis::fit(const ChunkReader& next_chunk)
+{
+    Eigen::MatrixXd chunk;
+    while (next_chunk(chunk)) {
+        partial_fit(chunk);
+    }
+}
+
+void IncrementalPrincipalComponentAnalysis::merge(const IncrementalPrincipalComponentAnalysis& other)
+{
+    U_TRACE_SCOPE("IncrementalPrincipalComponentAnalysis::merge");
+    if (other.count_ == 0) {
+        return;
+    }
+    if (count_ == 0) {
+        count_ = other.count_;
+        mean_ = other.mean_;
+        components_ = other.components_;
+        singular_values_ = other.singular_values_;
+        truncate(singular_values_.asDiagonal() * components_.transpose());
+        return;
+    }
+    if (other.mean_.size() != mean_.size()) {
+        throw std::invalid_argument("Cannot merge models with different numbers of features.");
+    }
+
+    // Same stacking as partial_fit, with the other model's S V^T in place of a batch
+    const Eigen::Index k = singular_values_.size();
+    const Eigen::Index k_other = other.singular_values_.size();
+    Eigen::MatrixXd stacked(k + k_other + 1, mean_.size());
+    stacked.topRows(k) = singular_values_.asDiagonal() * components_.transpose();
+    stacked.middleRows(k, k_other) = other.singular_values_.asDiagonal() * other.components_.transpose();
+
+    const double total = count_ + other.count_;
+    stacked.bottomRows(1) = std::sqrt(count_ * other.count_ / total) * (other.mean_ - mean_).transpose();
+    mean_ += (other.count_ / total) * (other.mean_ - mean_);
+    count_ = total;
+
+    truncate(stacked);
+}
+
+Eigen::MatrixXd IncrementalPrincipalComponentAnalysis::transform(const Eigen::MatrixXd& X) const
+{
+    U_TRACE_SCOPE("IncrementalPrincipalComponentAnalysis::transform");
+    if (count_ == 0) {
+        throw std::logic_error("IncrementalPrincipalComponentAnalysis must be fitted before transform.");
+    }
+    if (X.cols() != mean_.size()) {
+        throw std::invalid_argument("Number of features does not match the fitted model.");
+    }
+
+    Eigen::MatrixXd projected = X * components_;
+    projected.rowwise() -= mean_.transpose() * components_;
+    return projected;
+}
+
+Eigen::MatrixXd IncrementalPrincipalComponentAnalysis::eigen_vectors(int n) const
+{
+    if (n <= 0 || n > components_.cols()) {
+        return components_;
+    } else {
+        return components_.leftCols(n);
+    }
+}
+
+Eigen::VectorXd IncrementalPrincipalComponentAnalysis::eigen_values(int n) const
+{
+    Eigen::VectorXd values = singular_values_.array().square() / std::max(1.0, count_ - 1);
+    if (n <= 0 || n > values.size()) {
+        return values;
+    } else {
+        return values.head(n);
+    }
+}
+
+} // namespace L
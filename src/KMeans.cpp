@@ -0,0 +1,490 @@
+#include "L/KMeans.hpp"
+#include "U/Kernels.hpp"
+#include "U/Serialization.hpp"
+#include "U/Trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+namespace L {
+
+namespace {
+
+// Rows per block: the unit of parallel work and of the in-order reductions
+constexpr Eigen::Index kBlockRows = 4096;
+
+using RowMatrix = Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
+std::ptrdiff_t blockCount(Eigen::Index rows) {
+    return static_cast<std::ptrdiff_t>((rows + kBlockRows - 1) / kBlockRows);
+}
+
+// Sum and number of the rows assigned to each cluster
+struct ClusterSums {
+    Eigen::MatrixXd sums;
+    Eigen::VectorXd counts;
+};
+
+ClusterSums clusterSums(const Eigen::MatrixXd& X, const int* labels, int n_clusters, const U::ExecutionPolicy& policy) {
+    auto sumBlocks = [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+        ClusterSums partial{Eigen::MatrixXd::Zero(n_clusters, X.cols()), Eigen::VectorXd::Zero(n_clusters)};
+        const Eigen::Index begin = first * kBlockRows;
+        const Eigen::Index end = std::min<Eigen::Index>(X.rows(), last * kBlockRows);
+        for (Eigen::Index j = 0; j < X.cols(); ++j) {
+            for (Eigen::Index i = begin; i < end; ++i) {
+                partial.sums(labels[i], j) += X(i, j);
+            }
+        }
+        for (Eigen::Index i = begin; i < end; ++i) {
+            partial.counts[labels[i]] += 1.0;
+        }
+        return partial;
+    };
+    return policy.parallel_reduce(0, blockCount(X.rows()), 1, ClusterSums(), sumBlocks, [](ClusterSums total, const ClusterSums& partial) {
+        if (total.sums.size() == 0) {
+            return partial;
+        }
+        total.sums += partial.sums;
+        total.counts += partial.counts;
+        return total;
+    });
+}
+
+// Mean of the columns' variances, the scale of the convergence tolerance
+double meanVariance(const Eigen::MatrixXd& X, const U::ExecutionPolicy& policy) {
+    std::vector<double> variances(X.cols());
+    policy.parallel_for(0, X.cols(), 1, [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+        for (std::ptrdiff_t j = first; j < last; ++j) {
+            const double mean = X.col(j).mean();
+            variances[j] = (X.col(j).array() - mean).square().mean();
+        }
+    });
+    double total = 0.0;
+    for (double variance : variances) {
+        total += variance;
+    }
+    return variances.empty() ? 0.0 : total / variances.size();
+}
+
+double distanceBetween(const double* a, const double* b, Eigen::Index size) {
+    double squared = 0.0;
+    for (Eigen::Index j = 0; j < size; ++j) {
+        const double difference = a[j] - b[j];
+        squared += difference * difference;
+    }
+    return std::sqrt(squared);
+}
+
+} // namespace
+
+KMeans::KMeans(int n_clusters, int max_iterations, double tolerance, unsigned int seed, Algorithm algorithm)
+    : n_clusters_(n_clusters), max_iterations_(max_iterations), tolerance_(tolerance), seed_(seed), algorithm_(algorithm) {
+    if (n_clusters_ <= 0) {
+        throw std::invalid_argument("n_clusters must be positive.");
+    }
+    if (max_iterations_ <= 0) {
+        throw std::invalid_argument("max_iterations must be positive.");
+    }
+    if (tolerance_ < 0) {
+        throw std::invalid_argument("tolerance must not be negative.");
+    }
+}
+
+void KMeans::setExecutionPolicy(const U::ExecutionPolicy& policy) {
+    execution_policy_ = policy;
+}
+
+void KMeans::seed(const Eigen::MatrixXd& X) {
+    U_TRACE_SCOPE("KMeans::seed");
+    const Eigen::Index n = X.rows();
+    const std::ptrdiff_t blocks = blockCount(n);
+    const U::KernelTable& kernel = U::kernels();
+    std::mt19937_64 generator(seed_);
+
+    // Squared distance of every row to its closest centroid so far, and its sum over each block
+    std::vector<double> closest(n, std::numeric_limits<double>::infinity());
+    std::vector<double> block_sums(blocks);
+    Eigen::VectorXd center(X.cols());
+
+    centroids_.resize(n_clusters_, X.cols());
+    Eigen::Index chosen = std::uniform_int_distribution<Eigen::Index>(0, n - 1)(generator);
+    for (int c = 0; c < n_clusters_; ++c) {
+        center = X.row(chosen).transpose();
+        centroids_.row(c) = center.transpose();
+        if (c + 1 == n_clusters_) {
+            break;
+        }
+
+        execution_policy_.parallel_for(0, blocks, 1, [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+            std::vector<double> distances(kBlockRows);
+            for (std::ptrdiff_t b = first; b < last; ++b) {
+                const Eigen::Index begin = b * kBlockRows;
+                const Eigen::Index rows = std::min(kBlockRows, n - begin);
+                kernel.squared_distances(X.data() + begin, rows, X.cols(), n, center.data(), distances.data());
+                double sum = 0.0;
+                for (Eigen::Index i = 0; i < rows; ++i) {
+                    closest[begin + i] = std::min(closest[begin + i], distances[i]);
+                    sum += closest[begin + i];
+                }
+                block_sums[b] = sum;
+            }
+        });
+        double total = 0.0;
+        for (double sum : block_sums) {
+            total += sum;
+        }
+
+        // Next centroid drawn with probability proportional to the squared distance (D^2 sampling)
+        if (!(total > 0.0)) {
+            chosen = std::uniform_int_distribution<Eigen::Index>(0, n - 1)(generator);   // Every row is a centroid already
+            continue;
+        }
+        double target = std::uniform_real_distribution<double>(0.0, total)(generator);
+        std::ptrdiff_t b = 0;
+        while (b + 1 < blocks && (target >= block_sums[b] || block_sums[b] == 0.0)) {
+            target -= block_sums[b];
+            ++b;
+        }
+        const Eigen::Index begin = b * kBlockRows;
+        const Eigen::Index end = std::min(n, begin + kBlockRows);
+        chosen = -1;
+        for (Eigen::Index i = begin; i < end; ++i) {
+            if (closest[i] > 0.0) {
+                chosen = i;
+                target -= closest[i];
+                if (target < 0.0) {
+                    break;
+                }
+            }
+        }
+        if (chosen < 0) {
+            chosen = std::uniform_int_distribution<Eigen::Index>(0, n - 1)(generator);
+        }
+    }
+}
+
+double KMeans::assign(const Eigen::MatrixXd& X, int* labels, double* distances) const {
+    // |x - c|^2 = |x|^2 - 2 x.c + |c|^2, with the cross terms of a block from one matrix product
+    const Eigen::VectorXd norms = centroids_.rowwise().squaredNorm();
+    auto assignBlocks = [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+        double inertia = 0.0;
+        for (std::ptrdiff_t b = first; b < last; ++b) {
+            const Eigen::Index begin = b * kBlockRows;
+            const Eigen::Index rows = std::min(kBlockRows, X.rows() - begin);
+            const Eigen::MatrixXd scores = X.middleRows(begin, rows) * centroids_.transpose();
+            const Eigen::VectorXd row_norms = X.middleRows(begin, rows).array().square().rowwise().sum();
+            for (Eigen::Index i = 0; i < rows; ++i) {
+                int best = 0;
+                double best_distance = std::numeric_limits<double>::infinity();
+                for (int c = 0; c < n_clusters_; ++c) {
+                    double distance = row_norms[i] - 2.0 * scores(i, c) + norms[c];
+                    if (distance < best_distance) {
+                        best_distance = distance;
+                        best = c;
+                    }
+                }
+                best_distance = std::max(best_distance, 0.0);
+                labels[begin + i] = best;
+                distances[begin + i] = best_distance;
+                inertia += best_distance;
+            }
+        }
+        return inertia;
+    };
+    return execution_policy_.parallel_reduce(0, blockCount(X.rows()), 1, 0.0, assignBlocks, std::plus<double>());
+}
+
+void KMeans::lloyd(const Eigen::MatrixXd& X, double tolerance) {
+    std::vector<int> labels(X.rows());
+    std::vector<double> distances(X.rows());
+    for (iterations_ = 0; iterations_ < max_iterations_;) {
+        assign(X, labels.data(), distances.data());
+        ClusterSums sums = clusterSums(X, labels.data(), n_clusters_, execution_policy_);
+
+        // Empty clusters keep their centroid
+        double moved = 0.0;
+        for (int c = 0; c < n_clusters_; ++c) {
+            if (sums.counts[c] > 0) {
+                Eigen::RowVectorXd updated = sums.sums.row(c) / sums.counts[c];
+                moved += (updated - centroids_.row(c)).squaredNorm();
+                centroids_.row(c) = updated;
+            }
+        }
+        ++iterations_;
+        if (moved <= tolerance) {
+            break;
+        }
+    }
+}
+
+void KMeans::elkan(const Eigen::MatrixXd& X, double tolerance) {
+    // Elkan (2003): an upper bound on the distance of each row to its centroid and a lower bound on
+    // its distance to every other centroid, moved by the centroid shifts after each update. A centroid
+    // is only measured when the bounds cannot rule it out.
+    const Eigen::Index n = X.rows();
+    const Eigen::Index d = X.cols();
+    const int k = n_clusters_;
+    const std::ptrdiff_t blocks = blockCount(n);
+
+    std::vector<int> labels(n);
+    std::vector<double> upper(n);
+    std::vector<double> lower(static_cast<size_t>(n) * k);
+    RowMatrix centers = centroids_;
+
+    // Exact distances to every centroid to start with
+    execution_policy_.parallel_for(0, blocks, 1, [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+        RowMatrix block;
+        for (std::ptrdiff_t b = first; b < last; ++b) {
+            const Eigen::Index begin = b * kBlockRows;
+            block = X.middleRows(begin, std::min(kBlockRows, n - begin));
+            for (Eigen::Index i = 0; i < block.rows(); ++i) {
+                const Eigen::Index row = begin + i;
+                upper[row] = std::numeric_limits<double>::infinity();
+                for (int c = 0; c < k; ++c) {
+                    double distance = distanceBetween(block.row(i).data(), centers.row(c).data(), d);
+                    lower[row * k + c] = distance;
+                    if (distance < upper[row]) {
+                        upper[row] = distance;
+                        labels[row] = c;
+                    }
+                }
+            }
+        }
+    });
+    double computed = static_cast<double>(n) * k;
+
+    std::vector<double> shift(k);
+    std::vector<double> nearest(k);        // Half the distance from each centroid to its closest other one
+    Eigen::MatrixXd half(k, k);            // Half the distances between centroids
+    for (iterations_ = 0; iterations_ < max_iterations_;) {
+        ClusterSums sums = clusterSums(X, labels.data(), k, execution_policy_);
+        double moved = 0.0;
+        for (int c = 0; c < k; ++c) {
+            shift[c] = 0.0;
+            if (sums.counts[c] > 0) {
+                Eigen::RowVectorXd updated = sums.sums.row(c) / sums.counts[c];
+                shift[c] = distanceBetween(updated.data(), centers.row(c).data(), d);
+                moved += (updated - centroids_.row(c)).squaredNorm();
+                centroids_.row(c) = updated;
+            }
+        }
+        centers = centroids_;
+        ++iterations_;
+
+        execution_policy_.parallel_for(0, blocks, 1, [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+            const Eigen::Index begin = first * kBlockRows;
+            const Eigen::Index end = std::min<Eigen::Index>(n, last * kBlockRows);
+            for (Eigen::Index row = begin; row < end; ++row) {
+                upper[row] += shift[labels[row]];
+                double* bounds = lower.data() + row * k;
+                for (int c = 0; c < k; ++c) {
+                    bounds[c] = std::max(0.0, bounds[c] - shift[c]);
+                }
+            }
+        });
+        if (moved <= tolerance) {
+            break;
+        }
+
+        for (int c = 0; c < k; ++c) {
+            nearest[c] = std::numeric_limits<double>::infinity();
+            for (int other = 0; other < k; ++other) {
+                half(c, other) = 0.5 * distanceBetween(centers.row(c).data(), centers.row(other).data(), d);
+                if (other != c) {
+                    nearest[c] = std::min(nearest[c], half(c, other));
+                }
+            }
+        }
+
+        auto assignBlocks = [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+            double measured = 0.0;
+            std::vector<double> x(d);
+            const Eigen::Index begin = first * kBlockRows;
+            const Eigen::Index end = std::min<Eigen::Index>(n, last * kBlockRows);
+            for (Eigen::Index row = begin; row < end; ++row) {
+                int a = labels[row];
+                if (upper[row] <= nearest[a]) {
+                    continue;   // Closer to its centroid than any other centroid can be
+                }
+                double* bounds = lower.data() + row * k;
+                bool tight = false;
+                for (int c = 0; c < k; ++c) {
+                    if (c == a || upper[row] <= bounds[c] || upper[row] <= half(a, c)) {
+                        continue;
+                    }
+                    if (!tight) {
+                        for (Eigen::Index j = 0; j < d; ++j) {
+                            x[j] = X(row, j);
+                        }
+                        upper[row] = distanceBetween(x.data(), centers.row(a).data(), d);
+                        bounds[a] = upper[row];
+                        measured += 1.0;
+                        tight = true;
+                        if (upper[row] <= bounds[c] || upper[row] <= half(a, c)) {
+                            continue;
+                        }
+                    }
+                    double distance = distanceBetween(x.data(), centers.row(c).data(), d);
+                    bounds[c] = distance;
+                    measured += 1.0;
+                    if (distance < upper[row]) {
+                        upper[row] = distance;
+                        a = c;
+                    }
+                }
+                labels[row] = a;
+            }
+            return measured;
+        };
+        computed += execution_policy_.parallel_reduce(0, blocks, 1, 0.0, assignBlocks, std::plus<double>());
+    }
+    U_TRACE_COUNT("KMeans distances", static_cast<long long>(computed));
+}
+
+void KMeans::fit(const Eigen::MatrixXd& X) {
+    U_TRACE_SCOPE("KMeans::fit");
+    if (X.rows() < n_clusters_) {
+        throw std::invalid_argument("KMeans needs at least n_clusters rows.");
+    }
+    seed(X);
+    const double tolerance = tolerance_ * meanVariance(X, execution_policy_);
+    const bool use_elkan = algorithm_ == Algorithm::Elkan ||
+                           (algorithm_ == Algorithm::Auto && X.cols() >= kMinElkanFeatures &&
+                            static_cast<std::size_t>(X.rows()) * n_clusters_ <= kMaxElkanBounds);
+    if (use_elkan) {
+        elkan(X, tolerance);
+    } else {
+        lloyd(X, tolerance);
+    }
+
+    // Final assignment, which also lets partial_fit carry on from the fitted cluster sizes
+    std::vector<int> labels(X.rows());
+    std::vector<double> distances(X.rows());
+    inertia_ = assign(X, labels.data(), distances.data());
+    counts_ = Eigen::VectorXd::Zero(n_clusters_);
+    for (int label : labels) {
+        counts_[label] += 1.0;
+    }
+}
+
+void KMeans::partial_fit(const Eigen::MatrixXd& X) {
+    U_TRACE_SCOPE("KMeans::partial_fit");
+    if (centroids_.size() == 0) {
+        if (X.rows() < n_clusters_) {
+            throw std::invalid_argument("The first KMeans batch needs at least n_clusters rows.");
+        }
+        seed(X);
+        counts_ = Eigen::VectorXd::Zero(n_clusters_);
+    } else if (X.cols() != centroids_.cols()) {
+        throw std::invalid_argument("Number of features does not match the fitted KMeans.");
+    }
+
+    std::vector<int> labels(X.rows());
+    std::vector<double> distances(X.rows());
+    inertia_ = assign(X, labels.data(), distances.data());
+    ClusterSums sums = clusterSums(X, labels.data(), n_clusters_, execution_policy_);
+
+    // Same as moving the centroid towards each of its rows in turn with rate 1 / count
+    for (int c = 0; c < n_clusters_; ++c) {
+        if (sums.counts[c] > 0) {
+            counts_[c] += sums.counts[c];
+            centroids_.row(c) += (sums.sums.row(c) - sums.counts[c] * centroids_.row(c)) / counts_[c];
+        }
+    }
+}
+
+void KMeans::fit(const ChunkReader& next_chunk) {
+    U_TRACE_SCOPE("KMeans::fit");
+    centroids_.resize(0, 0);
+    counts_.resize(0);
+    Eigen::MatrixXd X;
+    while (next_chunk(X)) {
+        partial_fit(X);
+    }
+}
+
+Eigen::VectorXd KMeans::predict(const Eigen::MatrixXd& X) const {
+    U_TRACE_SCOPE("KMeans::predict");
+    if (centroids_.size() == 0) {
+        throw std::logic_error("KMeans must be fitted before predict.");
+    }
+    if (X.cols() != centroids_.cols()) {
+        throw std::invalid_argument("Number of features does not match the fitted KMeans.");
+    }
+    std::vector<int> labels(X.rows());
+    std::vector<double> distances(X.rows());
+    assign(X, labels.data(), distances.data());
+    Eigen::VectorXd predictions(X.rows());
+    for (Eigen::Index i = 0; i < X.rows(); ++i) {
+        predictions[i] = labels[i];
+    }
+    return predictions;
+}
+
+Eigen::VectorXd KMeans::fit_predict(const Eigen::MatrixXd& X) {
+    fit(X);
+    return predict(X);
+}
+
+Eigen::MatrixXd KMeans::transform(const Eigen::MatrixXd& X) const {
+    U_TRACE_SCOPE("KMeans::transform");
+    if (centroids_.size() == 0) {
+        throw std::logic_error("KMeans must be fitted before transform.");
+    }
+    if (X.cols() != centroids_.cols()) {
+        throw std::invalid_argument("Number of features does not match the fitted KMeans.");
+    }
+    const Eigen::RowVectorXd norms = centroids_.rowwise().squaredNorm().transpose();
+    Eigen::MatrixXd distances(X.rows(), n_clusters_);
+    execution_policy_.parallel_for(0, blockCount(X.rows()), 1, [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+        for (std::ptrdiff_t b = first; b < last; ++b) {
+            const Eigen::Index begin = b * kBlockRows;
+            const Eigen::Index rows = std::min(kBlockRows, X.rows() - begin);
+            auto block = distances.middleRows(begin, rows);
+            block.noalias() = -2.0 * X.middleRows(begin, rows) * centroids_.transpose();
+            block.colwise() += X.middleRows(begin, rows).array().square().rowwise().sum().matrix();
+            block.rowwise() += norms;
+            block = block.cwiseMax(0.0).cwiseSqrt();
+        }
+    });
+    return distances;
+}
+
+Eigen::MatrixXd KMeans::cluster_centers() const {
+    return centroids_;
+}
+
+double KMeans::inertia() const {
+    return inertia_;
+}
+
+int KMeans::iterations() const {
+    return iterations_;
+}
+
+void KMeans::save(std::ostream& out) const {
+    if (centroids_.size() == 0) {
+        throw std::logic_error("Cannot save a KMeans model before fit.");
+    }
+    U::writeHeader(out, "KMeans", 1);
+    U::writeMatrix(out, centroids_);
+    U::writeVector(out, counts_);
+}
+
+void KMeans::load(std::istream& in) {
+    U::readHeader(in, "KMeans");
+    Eigen::MatrixXd centroids = U::readMatrix(in);
+    Eigen::VectorXd counts = U::readVector(in);
+    if (centroids.rows() == 0 || counts.size() != centroids.rows()) {
+        throw std::runtime_error("Malformed model file: inconsistent KMeans shapes.");
+    }
+    n_clusters_ = static_cast<int>(centroids.rows());
+    centroids_ = centroids;
+    counts_ = counts;
+}
+
+} // namespace L
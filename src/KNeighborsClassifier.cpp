@@ -0,0 +1,97 @@
+#include "L/KNeighborsClassifier.hpp"
+#include "U/Trace.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace L {
+
+namespace {
+
+// Query rows voted per parallel chunk
+constexpr std::ptrdiff_t kPredictGrain = 1024;
+
+} // namespace
+
+KNeighborsClassifier::KNeighborsClassifier(int n_neighbors, U::NeighborWeights weights,
+                                           U::NeighborIndex::Kind algorithm, int leaf_size)
+    : n_neighbors_(n_neighbors), weights_(weights), algorithm_(algorithm), leaf_size_(leaf_size) {
+    if (n_neighbors_ <= 0) {
+        throw std::invalid_argument("n_neighbors must be positive.");
+    }
+    if (leaf_size_ <= 0) {
+        throw std::invalid_argument("leaf_size must be positive.");
+    }
+}
+
+void KNeighborsClassifier::setExecutionPolicy(const U::ExecutionPolicy& policy) {
+    execution_policy_ = policy;
+}
+
+void KNeighborsClassifier::fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) {
+    U_TRACE_SCOPE("KNeighborsClassifier::fit");
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("Number of rows in X must match the size of y.");
+    }
+    if (X.rows() < n_neighbors_) {
+        throw std::invalid_argument("KNeighborsClassifier needs at least n_neighbors training rows.");
+    }
+
+    labels_.resize(y.size());
+    for (Eigen::Index i = 0; i < y.size(); ++i) {
+        labels_[i] = static_cast<int>(y[i]);
+    }
+    classes_ = labels_;
+    std::sort(classes_.begin(), classes_.end());
+    classes_.erase(std::unique(classes_.begin(), classes_.end()), classes_.end());
+    for (int& label : labels_) {
+        label = static_cast<int>(std::lower_bound(classes_.begin(), classes_.end(), label) - classes_.begin());
+    }
+
+    index_ = U::NeighborIndex(X, algorithm_, leaf_size_, execution_policy_);
+}
+
+U::Neighbors KNeighborsClassifier::kneighbors(const Eigen::MatrixXd& X, int n_neighbors) const {
+    if (classes_.empty()) {
+        throw std::logic_error("KNeighborsClassifier must be fitted before kneighbors.");
+    }
+    return index_.query(X, n_neighbors > 0 ? n_neighbors : n_neighbors_, execution_policy_);
+}
+
+Eigen::MatrixXd KNeighborsClassifier::predict_proba(const Eigen::MatrixXd& X) const {
+    U_TRACE_SCOPE("KNeighborsClassifier::predict_proba");
+    if (classes_.empty()) {
+        throw std::logic_error("KNeighborsClassifier must be fitted before predict_proba.");
+    }
+    const U::Neighbors neighbors = index_.query(X, n_neighbors_, execution_policy_);
+
+    Eigen::MatrixXd probabilities = Eigen::MatrixXd::Zero(X.rows(), classes_.size());
+    execution_policy_.parallel_for(0, X.rows(), kPredictGrain, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+        std::vector<double> weights(n_neighbors_);
+        for (std::ptrdiff_t i = begin; i < end; ++i) {
+            U::neighborWeights(neighbors, i, weights_, weights.data());
+            for (int m = 0; m < n_neighbors_; ++m) {
+                probabilities(i, labels_[neighbors.indices(i, m)]) += weights[m];
+            }
+        }
+    });
+    return probabilities;
+}
+
+Eigen::VectorXd KNeighborsClassifier::predict(const Eigen::MatrixXd& X) const {
+    U_TRACE_SCOPE("KNeighborsClassifier::predict");
+    const Eigen::MatrixXd probabilities = predict_proba(X);
+
+    Eigen::VectorXd predictions(X.rows());
+    for (Eigen::Index i = 0; i < X.rows(); ++i) {
+        Eigen::Index best;
+        probabilities.row(i).maxCoeff(&best);   // First maximum, i.e. the smallest label on ties
+        predictions[i] = classes_[best];
+    }
+    return predictions;
+}
+
+std::vector<int> KNeighborsClassifier::classes() const {
+    return classes_;
+}
+
+} // namespace L
@@ -0,0 +1,71 @@
+#include "L/KNeighborsRegressor.hpp"
+#include "U/Trace.hpp"
+#include <stdexcept>
+#include <vector>
+
+namespace L {
+
+namespace {
+
+// Query rows averaged per parallel chunk
+constexpr std::ptrdiff_t kPredictGrain = 1024;
+
+} // namespace
+
+KNeighborsRegressor::KNeighborsRegressor(int n_neighbors, U::NeighborWeights weights,
+                                         U::NeighborIndex::Kind algorithm, int leaf_size)
+    : n_neighbors_(n_neighbors), weights_(weights), algorithm_(algorithm), leaf_size_(leaf_size) {
+    if (n_neighbors_ <= 0) {
+        throw std::invalid_argument("n_neighbors must be positive.");
+    }
+    if (leaf_size_ <= 0) {
+        throw std::invalid_argument("leaf_size must be positive.");
+    }
+}
+
+void KNeighborsRegressor::setExecutionPolicy(const U::ExecutionPolicy& policy) {
+    execution_policy_ = policy;
+}
+
+void KNeighborsRegressor::fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) {
+    U_TRACE_SCOPE("KNeighborsRegressor::fit");
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("Number of rows in X must match the size of y.");
+    }
+    if (X.rows() < n_neighbors_) {
+        throw std::invalid_argument("KNeighborsRegressor needs at least n_neighbors training rows.");
+    }
+    targets_ = y;
+    index_ = U::NeighborIndex(X, algorithm_, leaf_size_, execution_policy_);
+}
+
+U::Neighbors KNeighborsRegressor::kneighbors(const Eigen::MatrixXd& X, int n_neighbors) const {
+    if (targets_.size() == 0) {
+        throw std::logic_error("KNeighborsRegressor must be fitted before kneighbors.");
+    }
+    return index_.query(X, n_neighbors > 0 ? n_neighbors : n_neighbors_, execution_policy_);
+}
+
+Eigen::VectorXd KNeighborsRegressor::predict(const Eigen::MatrixXd& X) const {
+    U_TRACE_SCOPE("KNeighborsRegressor::predict");
+    if (targets_.size() == 0) {
+        throw std::logic_error("KNeighborsRegressor must be fitted before predict.");
+    }
+    const U::Neighbors neighbors = index_.query(X, n_neighbors_, execution_policy_);
+
+    Eigen::VectorXd predictions(X.rows());
+    execution_policy_.parallel_for(0, X.rows(), kPredictGrain, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+        std::vector<double> weights(n_neighbors_);
+        for (std::ptrdiff_t i = begin; i < end; ++i) {
+            U::neighborWeights(neighbors, i, weights_, weights.data());
+            double prediction = 0.0;
+            for (int m = 0; m < n_neighbors_; ++m) {
+                prediction += weights[m] * targets_[neighbors.indices(i, m)];
+            }
+            predictions[i] = prediction;
+        }
+    });
+    return predictions;
+}
+
+} // namespace L
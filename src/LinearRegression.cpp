@@ -1,33 +1,397 @@
 #include "L/LinearRegression.hpp"
+#include "U/Trace.hpp"
+#include "U/Serialization.hpp"
 #include <Eigen/Dense>
+#include <Eigen/SparseCholesky>
+#include <Eigen/IterativeLinearSolvers>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace L {
 
-LinearRegression::LinearRegression() : intercept(0) {}
+namespace {
+
+// Rows per centered block; bounds the temporary copy to kChunkRows x d
+constexpr Eigen::Index kChunkRows = 8192;
+
+// Blocks smaller than this are not worth a task
+constexpr Eigen::Index kMinRowsPerTask = 4 * kChunkRows;
+
+// Bounds the number of d x d partial accumulators alive at once
+constexpr Eigen::Index kMaxTasks = 256;
+
+// Rows per parallel chunk at prediction time
+constexpr Eigen::Index kPredictRows = 16384;
+
+// Folds the rows of X and y into statistics, one block at a time. Each block is copied into
+// double to be centered, so single-precision rows are accumulated in double as well.
+template <typename MatrixX, typename VectorY>
+void updateStatistics(LinearRegression::SufficientStatistics& statistics, const MatrixX& X, const VectorY& y) {
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("X and y must have the same number of rows.");
+    }
+
+    Eigen::MatrixXd X_centered;
+    Eigen::VectorXd y_centered;
+    for (Eigen::Index begin = 0; begin < X.rows(); begin += kChunkRows) {
+        Eigen::Index rows = std::min(kChunkRows, X.rows() - begin);
+        X_centered = X.middleRows(begin, rows).template cast<double>();
+        y_centered = y.segment(begin, rows).template cast<double>();
+
+        // Statistics of the block alone, centered on its own mean
+        LinearRegression::SufficientStatistics block;
+        block.count = static_cast<double>(rows);
+        block.mean_x = X_centered.colwise().mean();
+        block.mean_y = y_centered.mean();
+
+        X_centered.rowwise() -= block.mean_x.transpose();
+        y_centered.array() -= block.mean_y;
+
+        block.scatter_xx = Eigen::MatrixXd::Zero(X.cols(), X.cols());
+        block.scatter_xx.selfadjointView<Eigen::Lower>().rankUpdate(X_centered.transpose());
+        block.scatter_xx.triangularView<Eigen::StrictlyUpper>() = block.scatter_xx.transpose();
+        block.scatter_xy.noalias() = X_centered.transpose() * y_centered;
+        block.scatter_yy = y_centered.squaredNorm();
+
+        statistics.merge(block);
+    }
+}
+
+} // namespace
+
+LinearRegression::LinearRegression(double ridge_alpha, double forgetting_factor)
+    : intercept(0), ridge_alpha(ridge_alpha), forgetting_factor(forgetting_factor) {
+    if (ridge_alpha < 0) {
+        throw std::invalid_argument("ridge_alpha must be non-negative.");
+    }
+    if (forgetting_factor <= 0 || forgetting_factor > 1) {
+        throw std::invalid_argument("forgetting_factor must be in (0, 1].");
+    }
+}
+
+void LinearRegression::SufficientStatistics::update(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) {
+    updateStatistics(*this, X, y);
+}
+
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+void LinearRegression::SufficientStatistics::update(const U::DenseMatrix<Scalar>& X, const U::DenseVector<Scalar>& y) {
+    updateStatistics(*this, X, y);
+}
+
+template void LinearRegression::SufficientStatistics::update<float>(const Eigen::MatrixXf&, const Eigen::VectorXf&);
+
+void LinearRegression::SufficientStatistics::merge(const SufficientStatistics& other) {
+    if (other.count == 0) {
+        return;
+    }
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    if (mean_x.size() != other.mean_x.size()) {
+        throw std::invalid_argument("Cannot merge statistics with different numbers of features.");
+    }
+
+    // Pairwise update of centered co-moments (Chan et al.)
+    double total = count + other.count;
+    double weight = count * other.count / total;
+    Eigen::VectorXd delta_x = other.mean_x - mean_x;
+    double delta_y = other.mean_y - mean_y;
+
+    scatter_xx += other.scatter_xx + weight * delta_x * delta_x.transpose();
+    scatter_xy += other.scatter_xy + weight * delta_x * delta_y;
+    scatter_yy += other.scatter_yy + weight * delta_y * delta_y;
+    mean_x += (other.count / total) * delta_x;
+    mean_y += (other.count / total) * delta_y;
+    count = total;
+}
+
+LinearRegression::SufficientStatistics LinearRegression::accumulate(const Eigen::MatrixXd& X, const Eigen::VectorXd& y,
+                                                                    const U::ExecutionPolicy& policy) {
+    return accumulateRows(X, y, policy);
+}
+
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+LinearRegression::SufficientStatistics LinearRegression::accumulate(const U::DenseMatrix<Scalar>& X, const U::DenseVector<Scalar>& y,
+                                                                    const U::ExecutionPolicy& policy) {
+    return accumulateRows(X, y, policy);
+}
+
+template LinearRegression::SufficientStatistics LinearRegression::accumulate<float>(const Eigen::MatrixXf&, const Eigen::VectorXf&,
+                                                                                    const U::ExecutionPolicy&);
+
+template <typename Matrix, typename Vector>
+LinearRegression::SufficientStatistics LinearRegression::accumulateRows(const Matrix& X, const Vector& y,
+                                                                        const U::ExecutionPolicy& policy) {
+    U_TRACE_SCOPE("LinearRegression::accumulate");
+    U_TRACE_COUNT("LinearRegression rows accumulated", X.rows());
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("X and y must have the same number of rows.");
+    }
+
+    // The row ranges depend only on the number of rows, so the merged statistics are the same
+    // whatever the policy; they are reduced in row order
+    Eigen::Index rows_per_task = std::max(kMinRowsPerTask, (X.rows() + kMaxTasks - 1) / kMaxTasks);
+    return policy.parallel_reduce(
+        0, X.rows(), rows_per_task, SufficientStatistics(),
+        [&X, &y](std::ptrdiff_t begin, std::ptrdiff_t end) {
+            SufficientStatistics partial;
+            updateStatistics(partial, X.middleRows(begin, end - begin), y.segment(begin, end - begin));
+            return partial;
+        },
+        [](SufficientStatistics statistics, const SufficientStatistics& partial) {
+            statistics.merge(partial);
+            return statistics;
+        });
+}
+
+void LinearRegression::setExecutionPolicy(const U::ExecutionPolicy& policy) {
+    execution_policy = policy;
+}
 
 void LinearRegression::fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) {
-    // Add a column of 1s to X for the intercept
-    Eigen::MatrixXd X_b(X.rows(), X.cols() + 1);
-    X_b << Eigen::VectorXd::Ones(X.rows()), X;
+    U_TRACE_SCOPE("LinearRegression::fit");
+    fit(accumulate(X, y, execution_policy));
+}
+
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+void LinearRegression::fit(const U::DenseMatrix<Scalar>& X, const U::DenseVector<Scalar>& y) {
+    U_TRACE_SCOPE("LinearRegression::fit");
+    fit(accumulate(X, y, execution_policy));
+}
 
-    // Calculate the least squares solution: theta = (X_b^T * X_b).inverse() * X_b^T * y
-    Eigen::VectorXd theta = (X_b.transpose() * X_b).inverse() * X_b.transpose() * y;
+template void LinearRegression::fit<float>(const Eigen::MatrixXf&, const Eigen::VectorXf&);
+
+void LinearRegression::fit(const ChunkReader& next_chunk) {
+    U_TRACE_SCOPE("LinearRegression::fit");
+    SufficientStatistics statistics;
+    Eigen::MatrixXd X_chunk;
+    Eigen::VectorXd y_chunk;
+    while (next_chunk(X_chunk, y_chunk)) {
+        statistics.merge(accumulate(X_chunk, y_chunk, execution_policy));
+    }
+    fit(statistics);
+}
+
+void LinearRegression::fit(const SufficientStatistics& statistics) {
+    U_TRACE_SCOPE("LinearRegression::solve");
+    if (statistics.count == 0) {
+        throw std::invalid_argument("Cannot fit a linear regression on zero rows.");
+    }
+
+    // Centered normal equations: (S_xx + alpha I) w = S_xy, then b = mean_y - mean_x^T w
+    Eigen::MatrixXd system = statistics.scatter_xx;
+    system.diagonal().array() += ridge_alpha;
+
+    // LDLT is the fast path; singular or badly conditioned systems fall back to a rank-revealing QR
+    Eigen::LDLT<Eigen::MatrixXd> ldlt(system);
+    Eigen::VectorXd theta;
+    bool well_posed = ldlt.info() == Eigen::Success && ldlt.isPositive() && ldlt.rcond() > 1e-12;
+    if (well_posed) {
+        theta = ldlt.solve(statistics.scatter_xy);
+    } else {
+        theta = system.colPivHouseholderQr().solve(statistics.scatter_xy);
+    }
 
     // Separate the intercept and coefficients
+    coefficients = theta;
+    intercept = statistics.mean_y - statistics.mean_x.dot(theta);
+
+    // Keep the inverse of the uncentered system so partial_fit continues from this solution.
+    // With M = S_xx + alpha I, the Schur complement of n in [[n, n mean^T], [n mean, M + n mean mean^T]] is M, so
+    //   inverse = [[1/n + mean^T M^-1 mean, -(M^-1 mean)^T], [-M^-1 mean, M^-1]]
+    rls_inverse.resize(0, 0);
+    if (well_posed) {
+        const Eigen::Index d = theta.size();
+        Eigen::MatrixXd system_inverse = ldlt.solve(Eigen::MatrixXd::Identity(d, d));
+        Eigen::VectorXd projected_mean = system_inverse * statistics.mean_x;
+
+        rls_inverse.resize(d + 1, d + 1);
+        rls_inverse(0, 0) = 1.0 / statistics.count + statistics.mean_x.dot(projected_mean);
+        rls_inverse.block(1, 0, d, 1) = -projected_mean;
+        rls_inverse.block(0, 1, 1, d) = -projected_mean.transpose();
+        rls_inverse.bottomRightCorner(d, d) = system_inverse;
+    }
+}
+
+void LinearRegression::partial_fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) {
+    U_TRACE_SCOPE("LinearRegression::partial_fit");
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("X and y must have the same number of rows.");
+    }
+    if (coefficients.size() != 0 && coefficients.size() != X.cols()) {
+        throw std::invalid_argument("Number of features does not match the fitted model.");
+    }
+    if (X.rows() == 0) {
+        return;
+    }
+
+    const Eigen::Index d = X.cols();
+    if (rls_inverse.size() == 0 || rls_inverse.rows() != d + 1) {
+        if (coefficients.size() == 0) {
+            // Fresh model: an exact solve of the first batch when it determines the solution. It is
+            // kept only then, so otherwise the batch goes through the update below, once.
+            if (X.rows() > d) {
+                LinearRegression exact(ridge_alpha, forgetting_factor);
+                exact.fit(accumulate(X, y, execution_policy));
+                if (exact.rls_inverse.rows() == d + 1) {
+                    coefficients = std::move(exact.coefficients);
+                    intercept = exact.intercept;
+                    rls_inverse = std::move(exact.rls_inverse);
+                    return;
+                }
+            }
+            coefficients = Eigen::VectorXd::Zero(d);
+            intercept = 0;
+        }
+
+        // Otherwise start from a diffuse prior around the current solution: ridge-like on the slopes
+        // when alpha > 0, and as good as unregularized on the intercept, as in fit()
+        constexpr double kDiffusePrior = 1e8;
+        rls_inverse = (ridge_alpha > 0 ? 1.0 / ridge_alpha : kDiffusePrior) * Eigen::MatrixXd::Identity(d + 1, d + 1);
+        rls_inverse(0, 0) = kDiffusePrior;
+    }
+
+    // Rank-k update of the inverse with the Woodbury identity, on the implicit [1, X] design:
+    //   K = P A^T (lambda I + A P A^T)^-1,  theta += K (y - A theta),  P = (P - K A P) / lambda
+    Eigen::MatrixXd A(X.rows(), d + 1);
+    A << Eigen::VectorXd::Ones(X.rows()), X;
+
+    Eigen::VectorXd theta(d + 1);
+    theta << intercept, coefficients;
+
+    Eigen::MatrixXd PA_t = rls_inverse * A.transpose();
+    Eigen::MatrixXd innovation = A * PA_t;
+    innovation.diagonal().array() += forgetting_factor;
+    Eigen::MatrixXd gain = innovation.ldlt().solve(PA_t.transpose()).transpose();
+
+    theta += gain * (y - A * theta);
+    rls_inverse -= gain * PA_t.transpose();
+    rls_inverse /= forgetting_factor;
+
+    // Round-off slowly breaks the symmetry of P
+    rls_inverse = 0.5 * (rls_inverse + rls_inverse.transpose()).eval();
+
+    intercept = theta(0);
+    coefficients = theta.tail(d);
+}
+
+void LinearRegression::fit(const U::SparseMatrix& X, const Eigen::VectorXd& y) {
+    U_TRACE_SCOPE("LinearRegression::fit");
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("X and y must have the same number of rows.");
+    }
+
+    // Normal equations of the implicit [1, X] design, built without densifying X:
+    //   [ n      1^T X ] [b]   [ 1^T y ]
+    //   [ X^T 1  X^T X ] [w] = [ X^T y ]
+    const Eigen::Index d = X.cols();
+    U::SparseMatrix gram_X = X.transpose() * X;
+    Eigen::VectorXd column_sums = X.transpose() * Eigen::VectorXd::Ones(X.rows());
+
+    std::vector<Eigen::Triplet<double>> triplets;
+    triplets.reserve(gram_X.nonZeros() + 3 * d + 1);
+    triplets.emplace_back(0, 0, static_cast<double>(X.rows()));
+    for (Eigen::Index j = 0; j < d; ++j) {
+        if (column_sums(j) != 0.0) {
+            triplets.emplace_back(0, j + 1, column_sums(j));
+            triplets.emplace_back(j + 1, 0, column_sums(j));
+        }
+    }
+    for (Eigen::Index i = 0; i < gram_X.outerSize(); ++i) {
+        for (U::SparseMatrix::InnerIterator it(gram_X, i); it; ++it) {
+            triplets.emplace_back(it.row() + 1, it.col() + 1, it.value());
+        }
+    }
+
+    for (Eigen::Index j = 0; j < d && ridge_alpha > 0; ++j) {
+        triplets.emplace_back(j + 1, j + 1, ridge_alpha);
+    }
+
+    Eigen::SparseMatrix<double> gram(d + 1, d + 1);
+    gram.setFromTriplets(triplets.begin(), triplets.end()); // Duplicates are summed
+
+    Eigen::VectorXd rhs(d + 1);
+    rhs << y.sum(), X.transpose() * y;
+
+    // Sparse LDLT first; one-hot blocks plus the intercept are often rank deficient,
+    // in which case conjugate gradient from zero still converges to a least squares solution
+    Eigen::VectorXd theta;
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt(gram);
+    if (ldlt.info() == Eigen::Success) {
+        theta = ldlt.solve(rhs);
+    }
+    if (ldlt.info() != Eigen::Success || !theta.allFinite()) {
+        Eigen::ConjugateGradient<Eigen::SparseMatrix<double>, Eigen::Lower | Eigen::Upper> cg;
+        cg.setTolerance(1e-10);
+        cg.setMaxIterations(10 * (d + 1));
+        cg.compute(gram);
+        theta = cg.solve(rhs);
+        if (cg.info() != Eigen::Success || !theta.allFinite()) {
+            throw std::runtime_error("Sparse least squares solve did not converge (relative residual " +
+                                     std::to_string(cg.error()) + " after " + std::to_string(cg.iterations()) +
+                                     " conjugate gradient iterations).");
+        }
+    }
+
     intercept = theta(0);
-    coefficients = theta.tail(X.cols());
+    coefficients = theta.tail(d);
+
+    // Inverting the sparse normal matrix would be dense, so partial_fit restarts from a prior
+    rls_inverse.resize(0, 0);
+}
+
+Eigen::VectorXd LinearRegression::predict(const U::SparseMatrix& X) const {
+    U_TRACE_SCOPE("LinearRegression::predict");
+    Eigen::VectorXd predictions = X * coefficients;
+    predictions.array() += intercept;
+    return predictions;
 }
 
 Eigen::VectorXd LinearRegression::predict(const Eigen::MatrixXd& X) const {
-    // Add a column of 1s to X for the intercept in predictions
-    Eigen::MatrixXd X_b(X.rows(), X.cols() + 1);
-    X_b << Eigen::VectorXd::Ones(X.rows()), X;
+    return predictRows(X);
+}
+
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+U::DenseVector<Scalar> LinearRegression::predict(const U::DenseMatrix<Scalar>& X) const {
+    return predictRows(X);
+}
 
-    // Calculate predictions: y_pred = X_b * theta
-    Eigen::VectorXd theta(coefficients.size() + 1);
-    theta << intercept, coefficients; // Combine intercept and coefficients into one vector
+template Eigen::VectorXf LinearRegression::predict<float>(const Eigen::MatrixXf&) const;
+
+template <typename Matrix>
+U::DenseVector<typename Matrix::Scalar> LinearRegression::predictRows(const Matrix& X) const {
+    using Scalar = typename Matrix::Scalar;
+    U_TRACE_SCOPE("LinearRegression::predict");
+    // Calculate predictions: y_pred = X * coefficients + intercept, without copying X, in the precision of X
+    const U::DenseVector<Scalar> weights = coefficients.template cast<Scalar>();
+    U::DenseVector<Scalar> predictions(X.rows());
+    execution_policy.parallel_for(0, X.rows(), kPredictRows, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+        predictions.segment(begin, end - begin).noalias() = X.middleRows(begin, end - begin) * weights;
+    });
+    predictions.array() += static_cast<Scalar>(intercept);
+    return predictions;
+}
+
+void LinearRegression::save(std::ostream& out) const {
+    U::writeHeader(out, "LinearRegression", 1);
+    U::writeValue(out, ridge_alpha);
+    U::writeValue(out, forgetting_factor);
+    U::writeValue(out, intercept);
+    U::writeVector(out, coefficients);
+    U::writeMatrix(out, rls_inverse);
+}
 
-    return X_b * theta;
+void LinearRegression::load(std::istream& in) {
+    U::readHeader(in, "LinearRegression");
+    ridge_alpha = U::readValue<double>(in, "the ridge coefficient");
+    forgetting_factor = U::readValue<double>(in, "the forgetting factor");
+    intercept = U::readValue<double>(in, "the intercept");
+    coefficients = U::readVector(in);
+    rls_inverse = U::readMatrix(in);
 }
 
 Eigen::VectorXd LinearRegression::getCoefficients() const {
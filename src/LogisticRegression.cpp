@@ -1,69 +1,203 @@
 #include "L/LogisticRegression.hpp"
+#include "U/Trace.hpp"
+#include "U/Serialization.hpp"
+#include "U/Kernels.hpp"
 #include <Eigen/Dense>
 #include <cmath>
+#include <stdexcept>
+#include <type_traits>
 
 namespace L {
 
+namespace {
+
+// Rows per parallel chunk of the gradient and scoring passes
+constexpr std::ptrdiff_t kBlockRows = 4096;
+
+} // namespace
+
 // Constructor with threshold and optimize_threshold parameters
 LogisticRegression::LogisticRegression(double threshold, bool optimize_threshold)
     : intercept_(0), threshold_(threshold), optimize_threshold_(optimize_threshold) {}
 
-void LogisticRegression::fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, double learning_rate, int iterations) {
-    // Add a column of 1s to X for the intercept
-    Eigen::MatrixXd X_b(X.rows(), X.cols() + 1);
-    X_b << Eigen::VectorXd::Ones(X.rows()), X;
+void LogisticRegression::setExecutionPolicy(const U::ExecutionPolicy& policy) {
+    execution_policy_ = policy;
+}
+
+void LogisticRegression::setWarmStart(bool warm_start) {
+    warm_start_ = warm_start;
+}
+
+template <typename Matrix, typename Vector>
+void LogisticRegression::gradientDescent(const Matrix& X, const Vector& y, double learning_rate, int iterations, bool incremental,
+                                         const GradientReducer* reduce) {
+    using Scalar = typename Matrix::Scalar;
+    U_TRACE_SCOPE("LogisticRegression::fit");
+    U_TRACE_COUNT("LogisticRegression gradient iterations", iterations);
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("X and y must have the same number of rows.");
+    }
 
-    // Initialize theta with zeros
-    Eigen::VectorXd theta = Eigen::VectorXd::Zero(X_b.cols());
+    // The intercept is kept apart from the slopes instead of prepending a column of 1s,
+    // so X is never copied and sparse inputs stay sparse
+    const bool resume = (incremental || warm_start_) && coefficients_.size() == X.cols();
+    Eigen::VectorXd weights = resume ? coefficients_ : Eigen::VectorXd::Zero(X.cols());
+    double bias = resume ? intercept_ : 0.0;
 
     // Gradient descent
+    const Eigen::Index d = X.cols();
+    double rows = static_cast<double>(X.rows());
     for (int i = 0; i < iterations; ++i) {
-        // Calculate the predictions using the sigmoid function
-        Eigen::VectorXd predictions = (X_b * theta).unaryExpr([](double z) { return 1 / (1 + std::exp(-z)); });
+        // Blocks are scored in the precision of X; their partial gradients are summed in double
+        const U::DenseVector<Scalar> block_weights = weights.template cast<Scalar>();
+        const Scalar block_bias = static_cast<Scalar>(bias);
+
+        // Per block of rows: sigmoid residuals, X^T residuals in the first d entries and their sum in the last
+        Eigen::VectorXd gradient = execution_policy_.parallel_reduce(
+            0, X.rows(), kBlockRows, Eigen::VectorXd(Eigen::VectorXd::Zero(d + 1)),
+            [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+                U::DenseVector<Scalar> residuals = X.middleRows(begin, end - begin) * block_weights;
+                residuals = (residuals.array() + block_bias).unaryExpr([](Scalar z) { return 1 / (1 + std::exp(-z)); });
+                residuals -= y.segment(begin, end - begin);
+
+                Eigen::VectorXd partial(d + 1);
+                partial.head(d) = (X.middleRows(begin, end - begin).transpose() * residuals).template cast<double>();
+                partial(d) = residuals.template cast<double>().sum();
+                return partial;
+            },
+            [](Eigen::VectorXd total, const Eigen::VectorXd& partial) {
+                total += partial;
+                return total;
+            });
+        if (reduce) {
+            Eigen::VectorXd sums(d + 2);
+            sums << gradient, static_cast<double>(X.rows());
+            (*reduce)(sums);
+            gradient = sums.head(d + 1);
+            rows = sums(d + 1);
+        }
+
+        // Update
+        weights -= (learning_rate / rows) * gradient.head(d);
+        bias -= learning_rate * gradient(d) / rows;
+    }
+
+    intercept_ = bias;
+    coefficients_ = weights;
+
+    // Optimize threshold if required (once, at the end of a full fit)
+    if (optimize_threshold_ && !incremental && !reduce) {
+        optimizeThreshold(probabilities(X).template cast<double>(), y.template cast<double>());
+    }
+}
+
+template <typename Matrix>
+U::DenseVector<typename Matrix::Scalar> LogisticRegression::probabilities(const Matrix& X) const {
+    using Scalar = typename Matrix::Scalar;
+    U_TRACE_SCOPE("LogisticRegression::predict_proba");
+    if (coefficients_.size() == 0) {
+        throw std::logic_error("LogisticRegression must be fitted before predicting.");
+    }
+    if (X.cols() != coefficients_.size()) {
+        throw std::invalid_argument("Number of features does not match the fitted model.");
+    }
+    // Calculate predictions: y_pred = sigmoid(X * coefficients + intercept)
+    U::DenseVector<Scalar> predictions(X.rows());
+    const U::DenseVector<Scalar> weights = coefficients_.template cast<Scalar>();
+    execution_policy_.parallel_for(0, X.rows(), kBlockRows, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+        if constexpr (std::is_same_v<Matrix, Eigen::MatrixXd>) {
+            // Dense rows go through the kernel built for this CPU
+            U::kernels().sigmoid_affine(X.data() + begin, end - begin, X.cols(), X.rows(), weights.data(), intercept_,
+                                        predictions.data() + begin);
+        } else if constexpr (std::is_same_v<Matrix, Eigen::MatrixXf>) {
+            // Twice the rows per vector in single precision
+            U::kernels().sigmoid_affine_f32(X.data() + begin, end - begin, X.cols(), X.rows(), weights.data(),
+                                            static_cast<float>(intercept_), predictions.data() + begin);
+        } else {
+            Eigen::VectorXd linear_preds = X.middleRows(begin, end - begin) * coefficients_;
+            predictions.segment(begin, end - begin) =
+                (linear_preds.array() + intercept_).unaryExpr([](double z) { return 1 / (1 + std::exp(-z)); });
+        }
+    });
+    return predictions;
+}
 
-        // Calculate the gradient
-        Eigen::VectorXd gradient = X_b.transpose() * (predictions - y) / X.rows();
+void LogisticRegression::fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, double learning_rate, int iterations) {
+    gradientDescent(X, y, learning_rate, iterations, false);
+}
+
+void LogisticRegression::fit(const U::SparseMatrix& X, const Eigen::VectorXd& y, double learning_rate, int iterations) {
+    gradientDescent(X, y, learning_rate, iterations, false);
+}
 
-        // Update theta
-        theta -= learning_rate * gradient;
+void LogisticRegression::fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, const GradientReducer& reduce,
+                             double learning_rate, int iterations) {
+    if (!reduce) {
+        throw std::invalid_argument("GradientReducer must not be empty.");
     }
+    gradientDescent(X, y, learning_rate, iterations, false, &reduce);
+}
 
-    // Separate the intercept and coefficients
-    intercept_ = theta(0);
-    coefficients_ = theta.tail(X.cols());
+void LogisticRegression::partial_fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, double learning_rate, int iterations) {
+    if (coefficients_.size() != 0 && coefficients_.size() != X.cols()) {
+        throw std::invalid_argument("Number of features does not match the fitted model.");
+    }
+    gradientDescent(X, y, learning_rate, iterations, true);
+}
 
-    // Optimize threshold if required
-    if (optimize_threshold_) {
-        optimizeThreshold(X, y);
+void LogisticRegression::fit(const ChunkReader& next_chunk, double learning_rate, int iterations) {
+    U_TRACE_SCOPE("LogisticRegression::fit");
+    if (!warm_start_) {
+        coefficients_.resize(0);
+        intercept_ = 0.0;
+    }
+    Eigen::MatrixXd X_chunk;
+    Eigen::VectorXd y_chunk;
+    while (next_chunk(X_chunk, y_chunk)) {
+        partial_fit(X_chunk, y_chunk, learning_rate, iterations);
     }
 }
 
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+void LogisticRegression::fit(const U::DenseMatrix<Scalar>& X, const U::DenseVector<Scalar>& y, double learning_rate, int iterations) {
+    gradientDescent(X, y, learning_rate, iterations, false);
+}
+
+template void LogisticRegression::fit<float>(const Eigen::MatrixXf&, const Eigen::VectorXf&, double, int);
+
 Eigen::VectorXd LogisticRegression::predict_proba(const Eigen::MatrixXd& X) const {
-    // Add a column of 1s to X for the intercept in predictions
-    Eigen::MatrixXd X_b(X.rows(), X.cols() + 1);
-    X_b << Eigen::VectorXd::Ones(X.rows()), X;
+    return probabilities(X);
+}
 
-    // Combine intercept and coefficients into one vector
-    Eigen::VectorXd theta(coefficients_.size() + 1);
-    theta << intercept_, coefficients_;
+Eigen::VectorXd LogisticRegression::predict_proba(const U::SparseMatrix& X) const {
+    return probabilities(X);
+}
 
-    // Calculate predictions: y_pred = sigmoid(X_b * theta)
-    Eigen::VectorXd linear_preds = X_b * theta;
-    return linear_preds.unaryExpr([](double z) { return 1 / (1 + std::exp(-z)); });
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+U::DenseVector<Scalar> LogisticRegression::predict_proba(const U::DenseMatrix<Scalar>& X) const {
+    return probabilities(X);
 }
 
-Eigen::VectorXd LogisticRegression::predict(const Eigen::MatrixXd& X) const {
-    // Get probability predictions
-    Eigen::VectorXd probabilities = predict_proba(X);
+template Eigen::VectorXf LogisticRegression::predict_proba<float>(const Eigen::MatrixXf&) const;
 
+Eigen::VectorXd LogisticRegression::predict(const Eigen::MatrixXd& X) const {
     // Apply threshold to get binary predictions
-    return probabilities.unaryExpr([this](double p) { return p >= threshold_ ? 1.0 : 0.0; });
+    return predict_proba(X).unaryExpr([this](double p) { return p >= threshold_ ? 1.0 : 0.0; });
 }
 
-void LogisticRegression::optimizeThreshold(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) {
-    // Generate probabilities with current coefficients
-    Eigen::VectorXd probabilities = predict_proba(X);
+Eigen::VectorXd LogisticRegression::predict(const U::SparseMatrix& X) const {
+    return predict_proba(X).unaryExpr([this](double p) { return p >= threshold_ ? 1.0 : 0.0; });
+}
+
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+U::DenseVector<Scalar> LogisticRegression::predict(const U::DenseMatrix<Scalar>& X) const {
+    return predict_proba(X).unaryExpr([this](Scalar p) { return p >= threshold_ ? Scalar(1) : Scalar(0); });
+}
 
+template Eigen::VectorXf LogisticRegression::predict<float>(const Eigen::MatrixXf&) const;
+
+void LogisticRegression::optimizeThreshold(const Eigen::VectorXd& probabilities, const Eigen::VectorXd& y) {
+    U_TRACE_SCOPE("LogisticRegression::optimizeThreshold");
     // Find the threshold that maximizes F1 score
     double best_threshold = 0.5;
     double best_f1_score = 0.0;
@@ -96,6 +230,20 @@ void LogisticRegression::optimizeThreshold(const Eigen::MatrixXd& X, const Eigen
     threshold_ = best_threshold;
 }
 
+void LogisticRegression::save(std::ostream& out) const {
+    U::writeHeader(out, "LogisticRegression", 1);
+    U::writeValue(out, threshold_);
+    U::writeValue(out, intercept_);
+    U::writeVector(out, coefficients_);
+}
+
+void LogisticRegression::load(std::istream& in) {
+    U::readHeader(in, "LogisticRegression");
+    threshold_ = U::readValue<double>(in, "the threshold");
+    intercept_ = U::readValue<double>(in, "the intercept");
+    coefficients_ = U::readVector(in);
+}
+
 Eigen::VectorXd LogisticRegression::coefficients() const {
     return coefficients_;
 }
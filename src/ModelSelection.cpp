@@ -0,0 +1,404 @@
+#include "L/ModelSelection.hpp"
+#include "L/DecisionTreeClassifier.hpp"
+#include "L/LinearRegression.hpp"
+#include "L/LogisticRegression.hpp"
+#include "L/RegressionMetrics.hpp"
+#include "L/SoftmaxRegression.hpp"
+#include "U/Trace.hpp"
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <set>
+#include <stdexcept>
+
+namespace L {
+
+namespace {
+
+void checkSplits(int n_splits, Eigen::Index n_rows) {
+    if (n_splits < 2) {
+        throw std::invalid_argument("n_splits must be at least 2.");
+    }
+    if (n_rows < n_splits) {
+        throw std::invalid_argument("Cannot split fewer rows than n_splits.");
+    }
+}
+
+// Folds from the fold number of every row; indices are kept sorted so views read rows in order
+std::vector<Fold> foldsOf(const std::vector<int>& fold_of, int n_splits) {
+    std::vector<Fold> folds(n_splits);
+    for (size_t i = 0; i < fold_of.size(); ++i) {
+        for (int f = 0; f < n_splits; ++f) {
+            (f == fold_of[i] ? folds[f].test : folds[f].train).push_back(static_cast<Eigen::Index>(i));
+        }
+    }
+    return folds;
+}
+
+double parameter(const ParameterSet& parameters, const std::string& name, double fallback) {
+    auto it = parameters.find(name);
+    return it == parameters.end() ? fallback : it->second;
+}
+
+// Iterations run for a budget fraction, at least one
+int iterationsFor(double budget, int iterations) {
+    return std::max(1, static_cast<int>(std::lround(budget * iterations)));
+}
+
+class LogisticSearchModel : public SearchModel {
+public:
+    explicit LogisticSearchModel(const ParameterSet& parameters)
+        : model_(parameter(parameters, "threshold", 0.5)),
+          learning_rate_(parameter(parameters, "learning_rate", 0.01)),
+          iterations_(static_cast<int>(parameter(parameters, "iterations", 1000))) {
+        model_.setWarmStart(true);
+    }
+
+    void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, double budget) override {
+        int target = iterationsFor(budget, iterations_);
+        if (target > done_) {
+            model_.fit(X, y, learning_rate_, target - done_);
+            done_ = target;
+        }
+    }
+    Eigen::VectorXd predict(const Eigen::MatrixXd& X) const override { return model_.predict(X); }
+    bool iterative() const override { return true; }
+    void setExecutionPolicy(const U::ExecutionPolicy& policy) override { model_.setExecutionPolicy(policy); }
+
+private:
+    LogisticRegression model_;
+    double learning_rate_;
+    int iterations_;
+    int done_ = 0;   // Iterations run so far
+};
+
+class SoftmaxSearchModel : public SearchModel {
+public:
+    explicit SoftmaxSearchModel(const ParameterSet& parameters)
+        : learning_rate_(parameter(parameters, "learning_rate", 0.01)),
+          iterations_(static_cast<int>(parameter(parameters, "iterations", 1000))),
+          batch_size_(static_cast<int>(parameter(parameters, "batch_size", 0))) {
+        model_.setWarmStart(true);
+    }
+
+    void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, double budget) override {
+        int target = iterationsFor(budget, iterations_);
+        if (target > done_) {
+            model_.fit(X, y, learning_rate_, target - done_, batch_size_);
+            done_ = target;
+        }
+    }
+    Eigen::VectorXd predict(const Eigen::MatrixXd& X) const override { return model_.predict(X); }
+    bool iterative() const override { return true; }
+    void setExecutionPolicy(const U::ExecutionPolicy& policy) override { model_.setExecutionPolicy(policy); }
+
+private:
+    SoftmaxRegression model_;
+    double learning_rate_;
+    int iterations_;
+    int batch_size_;
+    int done_ = 0;
+};
+
+class LinearSearchModel : public SearchModel {
+public:
+    explicit LinearSearchModel(const ParameterSet& parameters) : model_(parameter(parameters, "ridge_alpha", 0.0)) {}
+
+    void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, double) override { model_.fit(X, y); }
+    Eigen::VectorXd predict(const Eigen::MatrixXd& X) const override { return model_.predict(X); }
+    void setExecutionPolicy(const U::ExecutionPolicy& policy) override { model_.setExecutionPolicy(policy); }
+
+private:
+    LinearRegression model_;
+};
+
+class TreeSearchModel : public SearchModel {
+public:
+    explicit TreeSearchModel(const ParameterSet& parameters)
+        : model_(static_cast<int>(parameter(parameters, "max_depth", 1000)),
+                 static_cast<int>(parameter(parameters, "min_samples_split", 2)),
+                 static_cast<int>(parameter(parameters, "min_samples_leaf", 1)),
+                 static_cast<int>(parameter(parameters, "max_leaf_nodes", 0)), parameter(parameters, "ccp_alpha", 0.0)) {}
+
+    void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, double) override { model_.fit(X, y); }
+    Eigen::VectorXd predict(const Eigen::MatrixXd& X) const override { return model_.predict(X); }
+    void setExecutionPolicy(const U::ExecutionPolicy& policy) override { model_.setExecutionPolicy(policy); }
+
+private:
+    DecisionTreeClassifier model_;
+};
+
+// Train one model on a fold at a budget and score it on the held-out rows
+double runJob(SearchModel& model, const Eigen::MatrixXd& X, const Eigen::VectorXd& y, const Fold& fold, double budget,
+              const Scorer& scorer) {
+    U_TRACE_SCOPE("HyperparameterSearch::job");
+    if (model.iterative() || budget >= 1.0) {
+        model.fit(rowsOf(X, fold.train), rowsOf(y, fold.train), budget);
+    } else {
+        // Evenly spaced rows of the training fold
+        size_t n = fold.train.size();
+        size_t m = std::max<size_t>(1, static_cast<size_t>(std::ceil(budget * n)));
+        std::vector<Eigen::Index> subset(m);
+        for (size_t i = 0; i < m; ++i) {
+            subset[i] = fold.train[i * n / m];
+        }
+        model.fit(rowsOf(X, subset), rowsOf(y, subset), budget);
+    }
+    return scorer(model.predict(rowsOf(X, fold.test)), rowsOf(y, fold.test));
+}
+
+} // namespace
+
+KFold::KFold(int n_splits, bool shuffle, unsigned int seed)
+    : n_splits_(n_splits), shuffle_(shuffle), seed_(seed) {
+    checkSplits(n_splits_, n_splits_);
+}
+
+std::vector<Fold> KFold::split(Eigen::Index n_rows) const {
+    checkSplits(n_splits_, n_rows);
+    std::vector<Eigen::Index> order(n_rows);
+    std::iota(order.begin(), order.end(), 0);
+    if (shuffle_) {
+        std::mt19937 generator(seed_);
+        std::shuffle(order.begin(), order.end(), generator);
+    }
+
+    // The first n_rows % n_splits folds get one extra row
+    std::vector<int> fold_of(n_rows);
+    Eigen::Index position = 0;
+    for (int f = 0; f < n_splits_; ++f) {
+        Eigen::Index size = n_rows / n_splits_ + (f < n_rows % n_splits_ ? 1 : 0);
+        for (Eigen::Index i = 0; i < size; ++i) {
+            fold_of[order[position++]] = f;
+        }
+    }
+    return foldsOf(fold_of, n_splits_);
+}
+
+StratifiedKFold::StratifiedKFold(int n_splits, bool shuffle, unsigned int seed)
+    : n_splits_(n_splits), shuffle_(shuffle), seed_(seed) {
+    checkSplits(n_splits_, n_splits_);
+}
+
+std::vector<Fold> StratifiedKFold::split(const Eigen::VectorXd& y) const {
+    checkSplits(n_splits_, y.size());
+    std::map<double, std::vector<Eigen::Index>> rows_of_class;
+    for (Eigen::Index i = 0; i < y.size(); ++i) {
+        rows_of_class[y(i)].push_back(i);
+    }
+
+    // Deal the rows of each class to the folds in turn; the turn carries over between classes
+    // so the fold sizes differ by at most one
+    std::mt19937 generator(seed_);
+    std::vector<int> fold_of(y.size());
+    size_t turn = 0;
+    for (auto& [label, rows] : rows_of_class) {
+        if (shuffle_) {
+            std::shuffle(rows.begin(), rows.end(), generator);
+        }
+        for (Eigen::Index row : rows) {
+            fold_of[row] = static_cast<int>(turn++ % n_splits_);
+        }
+    }
+    return foldsOf(fold_of, n_splits_);
+}
+
+ParameterGrid& ParameterGrid::add(const std::string& name, std::vector<double> values) {
+    if (values.empty()) {
+        throw std::invalid_argument("Parameter " + name + " needs at least one value.");
+    }
+    parameters_.emplace_back(name, std::move(values));
+    return *this;
+}
+
+size_t ParameterGrid::size() const {
+    size_t count = 1;
+    for (const auto& [name, values] : parameters_) {
+        count *= values.size();
+    }
+    return count;
+}
+
+ParameterSet ParameterGrid::combination(size_t index) const {
+    // Mixed-radix digits of the index, the last parameter varying fastest
+    ParameterSet parameters;
+    for (auto it = parameters_.rbegin(); it != parameters_.rend(); ++it) {
+        parameters[it->first] = it->second[index % it->second.size()];
+        index /= it->second.size();
+    }
+    return parameters;
+}
+
+std::vector<ParameterSet> ParameterGrid::configurations() const {
+    std::vector<ParameterSet> configurations;
+    size_t count = size();
+    configurations.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        configurations.push_back(combination(i));
+    }
+    return configurations;
+}
+
+std::vector<ParameterSet> ParameterGrid::sample(size_t count, unsigned int seed) const {
+    size_t total = size();
+    if (count >= total) {
+        return configurations();
+    }
+
+    // Floyd's algorithm: count distinct indices without enumerating the grid
+    std::mt19937_64 generator(seed);
+    std::set<size_t> picked;
+    for (size_t j = total - count; j < total; ++j) {
+        size_t index = std::uniform_int_distribution<size_t>(0, j)(generator);
+        picked.insert(picked.count(index) ? j : index);
+    }
+
+    std::vector<ParameterSet> configurations;
+    configurations.reserve(count);
+    for (size_t index : picked) {
+        configurations.push_back(combination(index));
+    }
+    return configurations;
+}
+
+ModelFactory logisticRegressionFactory() {
+    return [](const ParameterSet& parameters) { return std::make_unique<LogisticSearchModel>(parameters); };
+}
+
+ModelFactory softmaxRegressionFactory() {
+    return [](const ParameterSet& parameters) { return std::make_unique<SoftmaxSearchModel>(parameters); };
+}
+
+ModelFactory linearRegressionFactory() {
+    return [](const ParameterSet& parameters) { return std::make_unique<LinearSearchModel>(parameters); };
+}
+
+ModelFactory decisionTreeFactory() {
+    return [](const ParameterSet& parameters) { return std::make_unique<TreeSearchModel>(parameters); };
+}
+
+double accuracyScore(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true) {
+    if (predictions.size() != y_true.size() || y_true.size() == 0) {
+        throw std::invalid_argument("Predictions and true values must have the same, non-zero size.");
+    }
+    return (predictions.array() == y_true.array()).cast<double>().mean();
+}
+
+double r2Score(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true) {
+    return RegressionMetrics(predictions, y_true, U::ExecutionPolicy::sequential()).r2Score();
+}
+
+double negativeMeanSquaredError(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true) {
+    return -RegressionMetrics(predictions, y_true, U::ExecutionPolicy::sequential()).meanSquaredError();
+}
+
+HyperparameterSearch::HyperparameterSearch(ModelFactory factory, std::vector<ParameterSet> candidates, Scorer scorer)
+    : factory_(std::move(factory)), candidates_(std::move(candidates)), scorer_(std::move(scorer)) {
+    if (!factory_ || !scorer_) {
+        throw std::invalid_argument("HyperparameterSearch needs a model factory and a scorer.");
+    }
+    if (candidates_.empty()) {
+        throw std::invalid_argument("HyperparameterSearch needs at least one candidate.");
+    }
+}
+
+void HyperparameterSearch::setSuccessiveHalving(int factor, double min_budget) {
+    if (factor < 2 || !(min_budget > 0.0 && min_budget <= 1.0)) {
+        throw std::invalid_argument("Successive halving needs factor >= 2 and min_budget in (0, 1].");
+    }
+    factor_ = factor;
+    min_budget_ = min_budget;
+}
+
+void HyperparameterSearch::setExecutionPolicy(const U::ExecutionPolicy& policy) {
+    execution_policy_ = policy;
+}
+
+SearchResult HyperparameterSearch::fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, const std::vector<Fold>& folds) const {
+    U_TRACE_SCOPE("HyperparameterSearch::fit");
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("X and y must have the same number of rows.");
+    }
+    if (folds.empty()) {
+        throw std::invalid_argument("HyperparameterSearch needs at least one fold.");
+    }
+
+    const size_t n_folds = folds.size();
+    SearchResult result;
+    result.candidates.resize(candidates_.size());
+    for (size_t c = 0; c < candidates_.size(); ++c) {
+        result.candidates[c].parameters = candidates_[c];
+        result.candidates[c].fold_scores.assign(n_folds, 0.0);
+    }
+
+    // One model per (candidate, fold), kept between budgets so iterative models warm-start
+    std::vector<std::unique_ptr<SearchModel>> models(candidates_.size() * n_folds);
+    std::vector<size_t> alive(candidates_.size());
+    std::iota(alive.begin(), alive.end(), 0);
+
+    double budget = min_budget_;
+    while (true) {
+        // With enough jobs to fill the threads, each model runs sequentially inside its job
+        size_t jobs = alive.size() * n_folds;
+        bool sequential_models = jobs >= execution_policy_.concurrency();
+        execution_policy_.parallel_for(0, jobs, 1, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+            for (std::ptrdiff_t job = begin; job < end; ++job) {
+                size_t c = alive[job / n_folds];
+                size_t f = job % n_folds;
+                std::unique_ptr<SearchModel>& model = models[c * n_folds + f];
+                if (!model) {
+                    model = factory_(candidates_[c]);
+                    if (sequential_models) {
+                        model->setExecutionPolicy(U::ExecutionPolicy::sequential());
+                    }
+                }
+                result.candidates[c].fold_scores[f] = runJob(*model, X, y, folds[f], budget, scorer_);
+            }
+        });
+
+        for (size_t c : alive) {
+            CandidateResult& candidate = result.candidates[c];
+            Eigen::Map<const Eigen::VectorXd> scores(candidate.fold_scores.data(), n_folds);
+            candidate.mean_score = scores.mean();
+            candidate.std_score = std::sqrt((scores.array() - candidate.mean_score).square().mean());
+            candidate.budget = budget;
+        }
+        if (budget >= 1.0) {
+            break;
+        }
+
+        // Keep the best 1/factor, ties going to the earlier candidate
+        std::stable_sort(alive.begin(), alive.end(), [&result](size_t a, size_t b) {
+            return result.candidates[a].mean_score > result.candidates[b].mean_score;
+        });
+        size_t keep = std::max<size_t>(1, (alive.size() + factor_ - 1) / factor_);
+        for (size_t i = keep; i < alive.size(); ++i) {
+            for (size_t f = 0; f < n_folds; ++f) {
+                models[alive[i] * n_folds + f].reset();
+            }
+        }
+        alive.resize(keep);
+        std::sort(alive.begin(), alive.end());
+        budget = std::min(1.0, budget * factor_);
+    }
+
+    result.best_index = alive.front();
+    for (size_t c : alive) {
+        if (result.candidates[c].mean_score > result.candidates[result.best_index].mean_score) {
+            result.best_index = c;
+        }
+    }
+    return result;
+}
+
+std::vector<double> crossValScore(const ModelFactory& factory, const ParameterSet& parameters, const Eigen::MatrixXd& X,
+                                  const Eigen::VectorXd& y, const std::vector<Fold>& folds, const Scorer& scorer,
+                                  const U::ExecutionPolicy& policy) {
+    HyperparameterSearch search(factory, {parameters}, scorer);
+    search.setExecutionPolicy(policy);
+    return search.fit(X, y, folds).candidates.front().fold_scores;
+}
+
+} // namespace L
@@ -0,0 +1,403 @@
+#include "L/Pipeline.hpp"
+#include "U/Trace.hpp"
+#include "U/MatrixUtils.hpp"
+#include <Eigen/Dense>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+
+namespace L {
+
+namespace {
+
+// Adapters from the library models to the stage interfaces
+
+class PCATransform : public Pipeline::Transform {
+public:
+    explicit PCATransform(std::shared_ptr<PrincipalComponentAnalysis> model) : model_(std::move(model)) {}
+    void fit(const Eigen::MatrixXd& X) override { model_->fit(X); }
+    Eigen::MatrixXd transform(const Eigen::MatrixXd& X) const override { return model_->transform(X); }
+
+    // (X - 1 mean^T) V = X V - 1 (mean^T V)
+    bool affine(Eigen::MatrixXd& weights, Eigen::RowVectorXd& offset) const override {
+        weights = model_->eigen_vectors();
+        if (weights.size() == 0) {
+            return false;
+        }
+        offset = -(model_->mean().transpose() * weights);
+        return true;
+    }
+
+private:
+    std::shared_ptr<PrincipalComponentAnalysis> model_;
+};
+
+// fit() starts from scratch, so refitting the pipeline does not mix in the rows of the previous
+// fit; to stream batches, call partial_fit on the model itself, then Pipeline::fuse()
+class IPCATransform : public Pipeline::Transform {
+public:
+    explicit IPCATransform(std::shared_ptr<IncrementalPrincipalComponentAnalysis> model) : model_(std::move(model)) {}
+    void fit(const Eigen::MatrixXd& X) override {
+        model_->reset();
+        model_->partial_fit(X);
+    }
+    Eigen::MatrixXd transform(const Eigen::MatrixXd& X) const override { return model_->transform(X); }
+
+    bool affine(Eigen::MatrixXd& weights, Eigen::RowVectorXd& offset) const override {
+        if (model_->count() == 0) {
+            return false;
+        }
+        weights = model_->eigen_vectors();
+        offset = -(model_->mean().transpose() * weights);
+        return true;
+    }
+
+private:
+    std::shared_ptr<IncrementalPrincipalComponentAnalysis> model_;
+};
+
+class LogisticEstimator : public Pipeline::Estimator {
+public:
+    explicit LogisticEstimator(std::shared_ptr<LogisticRegression> model) : model_(std::move(model)) {}
+    void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) override { model_->fit(X, y); }
+    Eigen::VectorXd predict(const Eigen::MatrixXd& X) const override { return model_->predict(X); }
+    Eigen::MatrixXd predict_proba(const Eigen::MatrixXd& X) const override { return model_->predict_proba(X); }
+
+    bool linear(Eigen::MatrixXd& weights, Eigen::RowVectorXd& intercepts) const override {
+        weights = model_->coefficients();
+        if (weights.size() == 0) {
+            return false;
+        }
+        intercepts = Eigen::RowVectorXd::Constant(1, model_->intercept());
+        return true;
+    }
+
+    Eigen::VectorXd predictFromScores(Eigen::MatrixXd& scores) const override {
+        double threshold = model_->threshold();
+        return probaFromScores(scores).col(0).unaryExpr([threshold](double p) { return p >= threshold ? 1.0 : 0.0; });
+    }
+
+    Eigen::MatrixXd probaFromScores(Eigen::MatrixXd& scores) const override {
+        scores = scores.unaryExpr([](double z) { return 1 / (1 + std::exp(-z)); });
+        return scores;
+    }
+
+private:
+    std::shared_ptr<LogisticRegression> model_;
+};
+
+class LinearEstimator : public Pipeline::Estimator {
+public:
+    explicit LinearEstimator(std::shared_ptr<LinearRegression> model) : model_(std::move(model)) {}
+    void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) override { model_->fit(X, y); }
+    Eigen::VectorXd predict(const Eigen::MatrixXd& X) const override { return model_->predict(X); }
+    Eigen::MatrixXd predict_proba(const Eigen::MatrixXd&) const override {
+        throw std::logic_error("LinearRegression has no predict_proba.");
+    }
+
+    bool linear(Eigen::MatrixXd& weights, Eigen::RowVectorXd& intercepts) const override {
+        weights = model_->getCoefficients();
+        if (weights.size() == 0) {
+            return false;
+        }
+        intercepts = Eigen::RowVectorXd::Constant(1, model_->getIntercept());
+        return true;
+    }
+
+    Eigen::VectorXd predictFromScores(Eigen::MatrixXd& scores) const override { return scores.col(0); }
+    Eigen::MatrixXd probaFromScores(Eigen::MatrixXd& scores) const override { return predict_proba(scores); }
+
+private:
+    std::shared_ptr<LinearRegression> model_;
+};
+
+class SoftmaxEstimator : public Pipeline::Estimator {
+public:
+    explicit SoftmaxEstimator(std::shared_ptr<SoftmaxRegression> model) : model_(std::move(model)) {}
+    void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) override { model_->fit(X, y); }
+    Eigen::VectorXd predict(const Eigen::MatrixXd& X) const override { return model_->predict(X); }
+    Eigen::MatrixXd predict_proba(const Eigen::MatrixXd& X) const override { return model_->predict_proba(X); }
+
+    bool linear(Eigen::MatrixXd& weights, Eigen::RowVectorXd& intercepts) const override {
+        weights = model_->coefficients();
+        if (weights.size() == 0) {
+            return false;
+        }
+        intercepts = model_->intercept().transpose();
+        return true;
+    }
+
+    // The arg max of the logits is the arg max of the probabilities, so skip the softmax
+    Eigen::VectorXd predictFromScores(Eigen::MatrixXd& scores) const override {
+        std::vector<int> classes = model_->classes();
+        Eigen::VectorXd predictions(scores.rows());
+        for (Eigen::Index i = 0; i < scores.rows(); ++i) {
+            Eigen::Index best;
+            scores.row(i).maxCoeff(&best);
+            predictions(i) = classes[best];
+        }
+        return predictions;
+    }
+
+    Eigen::MatrixXd probaFromScores(Eigen::MatrixXd& scores) const override {
+        U::softmaxRows(scores);
+        return scores;
+    }
+
+private:
+    std::shared_ptr<SoftmaxRegression> model_;
+};
+
+// Not linear: blocks go through the fused transforms, then the tree
+class TreeEstimator : public Pipeline::Estimator {
+public:
+    explicit TreeEstimator(std::shared_ptr<DecisionTreeClassifier> model) : model_(std::move(model)) {}
+    void fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) override { model_->fit(X, y); }
+    Eigen::VectorXd predict(const Eigen::MatrixXd& X) const override { return model_->predict(X); }
+    Eigen::MatrixXd predict_proba(const Eigen::MatrixXd& X) const override { return model_->predict_proba(X); }
+
+private:
+    std::shared_ptr<DecisionTreeClassifier> model_;
+};
+
+} // namespace
+
+Eigen::VectorXd Pipeline::Estimator::predictFromScores(Eigen::MatrixXd&) const {
+    throw std::logic_error("Estimator is not linear.");
+}
+
+Eigen::MatrixXd Pipeline::Estimator::probaFromScores(Eigen::MatrixXd&) const {
+    throw std::logic_error("Estimator is not linear.");
+}
+
+Pipeline::Pipeline(std::vector<std::string> feature_columns)
+    : feature_columns_(std::move(feature_columns)) {}
+
+std::unique_ptr<Pipeline::Transform> Pipeline::wrap(std::shared_ptr<PrincipalComponentAnalysis> model) {
+    return std::make_unique<PCATransform>(std::move(model));
+}
+
+std::unique_ptr<Pipeline::Transform> Pipeline::wrap(std::shared_ptr<IncrementalPrincipalComponentAnalysis> model) {
+    return std::make_unique<IPCATransform>(std::move(model));
+}
+
+std::unique_ptr<Pipeline::Estimator> Pipeline::wrap(std::shared_ptr<LogisticRegression> model) {
+    return std::make_unique<LogisticEstimator>(std::move(model));
+}
+
+std::unique_ptr<Pipeline::Estimator> Pipeline::wrap(std::shared_ptr<LinearRegression> model) {
+    return std::make_unique<LinearEstimator>(std::move(model));
+}
+
+std::unique_ptr<Pipeline::Estimator> Pipeline::wrap(std::shared_ptr<SoftmaxRegression> model) {
+    return std::make_unique<SoftmaxEstimator>(std::move(model));
+}
+
+std::unique_ptr<Pipeline::Estimator> Pipeline::wrap(std::shared_ptr<DecisionTreeClassifier> model) {
+    return std::make_unique<TreeEstimator>(std::move(model));
+}
+
+void Pipeline::addTransform(std::unique_ptr<Transform> transform) {
+    if (!transform) {
+        throw std::invalid_argument("Transform must not be null.");
+    }
+    transforms_.push_back(std::move(transform));
+    ready_ = false;
+}
+
+void Pipeline::setEstimator(std::unique_ptr<Estimator> estimator) {
+    if (!estimator) {
+        throw std::invalid_argument("Estimator must not be null.");
+    }
+    estimator_ = std::move(estimator);
+    ready_ = false;
+}
+
+void Pipeline::setBlockSize(Eigen::Index block_rows) {
+    if (block_rows <= 0) {
+        throw std::invalid_argument("block_rows must be positive.");
+    }
+    block_rows_ = block_rows;
+}
+
+void Pipeline::setExecutionPolicy(const U::ExecutionPolicy& policy) {
+    execution_policy_ = policy;
+}
+
+void Pipeline::fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) {
+    U_TRACE_SCOPE("Pipeline::fit");
+    if (!estimator_) {
+        throw std::logic_error("Pipeline has no estimator.");
+    }
+
+    Eigen::MatrixXd Z = X;
+    for (auto& transform : transforms_) {
+        transform->fit(Z);
+        Z = transform->transform(Z);
+    }
+    estimator_->fit(Z, y);
+    fuse();
+}
+
+void Pipeline::fit(const DataFrame& df, const std::string& target_column) {
+    std::map<std::string, size_t> indices = df.columnIndices();
+    if (indices.find(target_column) == indices.end()) {
+        throw std::invalid_argument("Column not found: " + target_column);
+    }
+
+    // Without explicit features, use every other column in file order
+    if (feature_columns_.empty()) {
+        std::vector<std::string> ordered(indices.size());
+        for (const auto& [name, index] : indices) {
+            ordered[index] = name;
+        }
+        for (const auto& name : ordered) {
+            if (name != target_column) {
+                feature_columns_.push_back(name);
+            }
+        }
+    }
+    fit(df.toMatrix(feature_columns_), df.toMatrix({target_column}).col(0));
+}
+
+void Pipeline::fuse() {
+    U_TRACE_SCOPE("Pipeline::fuse");
+
+    // Compose the leading affine transforms: (X W1 + b1) W2 + b2 = X (W1 W2) + (b1 W2 + b2)
+    affine_stages_ = 0;
+    for (const auto& transform : transforms_) {
+        Eigen::MatrixXd weights;
+        Eigen::RowVectorXd offset;
+        if (!transform->affine(weights, offset)) {
+            break;
+        }
+        if (affine_stages_ == 0) {
+            affine_weights_ = std::move(weights);
+            affine_offset_ = std::move(offset);
+        } else {
+            affine_offset_ = affine_offset_ * weights + offset;
+            affine_weights_ = affine_weights_ * weights;
+        }
+        ++affine_stages_;
+    }
+
+    // Then fold them into a linear estimator: (X A + a) W + c = X (A W) + (a W + c)
+    Eigen::MatrixXd weights;
+    Eigen::RowVectorXd intercepts;
+    fully_fused_ = affine_stages_ == transforms_.size() && estimator_ && estimator_->linear(weights, intercepts);
+    if (fully_fused_) {
+        if (affine_stages_ > 0) {
+            fused_weights_ = affine_weights_ * weights;
+            fused_intercepts_ = affine_offset_ * weights + intercepts;
+        } else {
+            fused_weights_ = std::move(weights);
+            fused_intercepts_ = std::move(intercepts);
+        }
+    }
+    ready_ = true;
+}
+
+void Pipeline::requireFitted() const {
+    if (!ready_) {
+        throw std::logic_error("Pipeline must be fitted (or fused) before predicting.");
+    }
+}
+
+Eigen::MatrixXd Pipeline::applyTransforms(const Eigen::MatrixXd& X) const {
+    Eigen::MatrixXd Z;
+    if (affine_stages_ > 0) {
+        if (X.cols() != affine_weights_.rows()) {
+            throw std::invalid_argument("Number of features does not match the fitted pipeline.");
+        }
+        Z = X * affine_weights_;
+        Z.rowwise() += affine_offset_;
+    } else {
+        Z = X;
+    }
+    for (size_t i = affine_stages_; i < transforms_.size(); ++i) {
+        Z = transforms_[i]->transform(Z);
+    }
+    return Z;
+}
+
+Eigen::MatrixXd Pipeline::scoreBlock(const Eigen::MatrixXd& X, Output output) const {
+    if (output == Output::Transform) {
+        return applyTransforms(X);
+    }
+    if (!estimator_) {
+        throw std::logic_error("Pipeline has no estimator.");
+    }
+    if (!fully_fused_) {
+        Eigen::MatrixXd Z = applyTransforms(X);
+        return output == Output::Predict ? Eigen::MatrixXd(estimator_->predict(Z)) : estimator_->predict_proba(Z);
+    }
+
+    if (X.cols() != fused_weights_.rows()) {
+        throw std::invalid_argument("Number of features does not match the fitted pipeline.");
+    }
+    Eigen::MatrixXd scores = X * fused_weights_;
+    scores.rowwise() += fused_intercepts_;
+    return output == Output::Predict ? Eigen::MatrixXd(estimator_->predictFromScores(scores))
+                                     : estimator_->probaFromScores(scores);
+}
+
+template <typename BlockSource>
+Eigen::MatrixXd Pipeline::stream(Eigen::Index n, const BlockSource& block, Output output) const {
+    requireFitted();
+
+    // An empty block gives the width of the output
+    Eigen::MatrixXd result(n, scoreBlock(block(0, 0), output).cols());
+    execution_policy_.parallel_for(0, n, block_rows_, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+        result.middleRows(begin, end - begin) = scoreBlock(block(begin, end - begin), output);
+    });
+    U_TRACE_COUNT("Pipeline::rows", n);
+    return result;
+}
+
+namespace {
+
+// Blocks of rows of a matrix, or of the feature columns of a DataFrame
+auto matrixBlocks(const Eigen::MatrixXd& X) {
+    return [&X](Eigen::Index begin, Eigen::Index rows) -> Eigen::MatrixXd { return X.middleRows(begin, rows); };
+}
+
+auto frameBlocks(const DataFrame& df, const std::vector<std::string>& columns) {
+    if (columns.empty()) {
+        throw std::logic_error("Pipeline has no feature columns to read from a DataFrame.");
+    }
+    return [&df, &columns](Eigen::Index begin, Eigen::Index rows) { return df.toMatrix(columns, begin, rows); };
+}
+
+} // namespace
+
+Eigen::VectorXd Pipeline::predict(const Eigen::MatrixXd& X) const {
+    U_TRACE_SCOPE("Pipeline::predict");
+    return stream(X.rows(), matrixBlocks(X), Output::Predict).col(0);
+}
+
+Eigen::VectorXd Pipeline::predict(const DataFrame& df) const {
+    U_TRACE_SCOPE("Pipeline::predict");
+    return stream(df.getRowCount(), frameBlocks(df, feature_columns_), Output::Predict).col(0);
+}
+
+Eigen::MatrixXd Pipeline::predict_proba(const Eigen::MatrixXd& X) const {
+    U_TRACE_SCOPE("Pipeline::predict_proba");
+    return stream(X.rows(), matrixBlocks(X), Output::Proba);
+}
+
+Eigen::MatrixXd Pipeline::predict_proba(const DataFrame& df) const {
+    U_TRACE_SCOPE("Pipeline::predict_proba");
+    return stream(df.getRowCount(), frameBlocks(df, feature_columns_), Output::Proba);
+}
+
+Eigen::MatrixXd Pipeline::transform(const Eigen::MatrixXd& X) const {
+    U_TRACE_SCOPE("Pipeline::transform");
+    return stream(X.rows(), matrixBlocks(X), Output::Transform);
+}
+
+Eigen::MatrixXd Pipeline::transform(const DataFrame& df) const {
+    U_TRACE_SCOPE("Pipeline::transform");
+    return stream(df.getRowCount(), frameBlocks(df, feature_columns_), Output::Transform);
+}
+
+} // namespace L
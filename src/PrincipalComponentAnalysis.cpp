@@ -1,44 +1,321 @@
 #include "L/PrincipalComponentAnalysis.hpp"
+#include "U/Trace.hpp"
+#include "U/Serialization.hpp"
 #include <Eigen/Eigenvalues> // For Eigenvalue decomposition
+#include <Eigen/SVD>
+#include <algorithm>
+#include <random>
 #include <stdexcept>         // For std::runtime_error
 
 namespace L {
 
-PrincipalComponentAnalysis::PrincipalComponentAnalysis(const Eigen::MatrixXd& X)
-    : X_(X)
+namespace {
+
+// Below this size a full eigendecomposition is cheap enough that randomization does not pay off
+constexpr Eigen::Index kRandomizedMinDimension = 500;
+
+// Rows centered (or widened from float) at a time when accumulating the dense moments
+constexpr Eigen::Index kBlockRows = 4096;
+
+// (X - 1 mean^T) * B, without forming the centered matrix
+template <typename Matrix>
+Eigen::MatrixXd centeredProduct(const Matrix& X, const Eigen::VectorXd& mean, const Eigen::MatrixXd& B) {
+    Eigen::MatrixXd product = X * B;
+    product.rowwise() -= mean.transpose() * B;
+    return product;
+}
+
+// (X - 1 mean^T)^T * B, without forming the centered matrix
+template <typename Matrix>
+Eigen::MatrixXd centeredTransposeProduct(const Matrix& X, const Eigen::VectorXd& mean, const Eigen::MatrixXd& B) {
+    Eigen::MatrixXd product = X.transpose() * B;
+    product -= mean * B.colwise().sum();
+    return product;
+}
+
+// Single-precision data is never multiplied in float: the products below widen one block of
+// rows at a time to double, so the moments are accumulated in double without a double copy of X
+Eigen::MatrixXd centeredProduct(const Eigen::MatrixXf& X, const Eigen::VectorXd& mean, const Eigen::MatrixXd& B) {
+    Eigen::MatrixXd product(X.rows(), B.cols());
+    Eigen::MatrixXd block;
+    for (Eigen::Index begin = 0; begin < X.rows(); begin += kBlockRows) {
+        Eigen::Index rows = std::min(kBlockRows, X.rows() - begin);
+        block = X.middleRows(begin, rows).cast<double>();
+        product.middleRows(begin, rows).noalias() = block * B;
+    }
+    product.rowwise() -= mean.transpose() * B;
+    return product;
+}
+
+Eigen::MatrixXd centeredTransposeProduct(const Eigen::MatrixXf& X, const Eigen::VectorXd& mean, const Eigen::MatrixXd& B) {
+    Eigen::MatrixXd product = Eigen::MatrixXd::Zero(X.cols(), B.cols());
+    Eigen::MatrixXd block;
+    for (Eigen::Index begin = 0; begin < X.rows(); begin += kBlockRows) {
+        Eigen::Index rows = std::min(kBlockRows, X.rows() - begin);
+        block = X.middleRows(begin, rows).cast<double>();
+        product.noalias() += block.transpose() * B.middleRows(begin, rows);
+    }
+    product -= mean * B.colwise().sum();
+    return product;
+}
+
+// Column means, accumulated in double
+template <typename Matrix>
+Eigen::VectorXd columnMeans(const Matrix& X) {
+    return (X.transpose() * Eigen::VectorXd::Ones(X.rows())) / X.rows();
+}
+
+Eigen::VectorXd columnMeans(const Eigen::MatrixXf& X) {
+    return centeredTransposeProduct(X, Eigen::VectorXd::Zero(X.cols()), Eigen::MatrixXd::Ones(X.rows(), 1)) / X.rows();
+}
+
+// (X - 1 mean^T)^T (X - 1 mean^T), centering one block of rows at a time to avoid
+// the cancellation of X^T X - n mean mean^T without copying the whole matrix
+template <typename Scalar>
+Eigen::MatrixXd centeredScatter(const U::DenseMatrix<Scalar>& X, const Eigen::VectorXd& mean) {
+    Eigen::MatrixXd scatter = Eigen::MatrixXd::Zero(X.cols(), X.cols());
+    Eigen::MatrixXd block;
+    for (Eigen::Index begin = 0; begin < X.rows(); begin += kBlockRows) {
+        Eigen::Index rows = std::min(kBlockRows, X.rows() - begin);
+        block = X.middleRows(begin, rows).template cast<double>().rowwise() - mean.transpose();
+        scatter.selfadjointView<Eigen::Lower>().rankUpdate(block.transpose());
+    }
+    return scatter.selfadjointView<Eigen::Lower>();
+}
+
+// Sparse rows cannot be centered without filling them in: X^T X - n mean mean^T
+Eigen::MatrixXd centeredScatter(const U::SparseMatrix& X, const Eigen::VectorXd& mean) {
+    Eigen::MatrixXd scatter = Eigen::MatrixXd(X.transpose() * X);
+    scatter -= static_cast<double>(X.rows()) * mean * mean.transpose();
+    return scatter;
+}
+
+// (X - 1 mean^T)(X - 1 mean^T)^T, the n x n Gram matrix
+template <typename Matrix>
+Eigen::MatrixXd centeredGram(const Matrix& X, const Eigen::VectorXd& mean) {
+    Eigen::MatrixXd gram = Eigen::MatrixXd(X * X.transpose());
+    Eigen::VectorXd row_offsets = X * mean;
+    gram.colwise() -= row_offsets;
+    gram.rowwise() -= row_offsets.transpose();
+    gram.array() += mean.squaredNorm();
+    return gram;
+}
+
+// Float rows are widened a block of columns at a time, the Gram matrix being n x n
+Eigen::MatrixXd centeredGram(const Eigen::MatrixXf& X, const Eigen::VectorXd& mean) {
+    Eigen::MatrixXd gram = Eigen::MatrixXd::Zero(X.rows(), X.rows());
+    Eigen::VectorXd row_offsets = Eigen::VectorXd::Zero(X.rows());
+    Eigen::MatrixXd block;
+    for (Eigen::Index begin = 0; begin < X.cols(); begin += kBlockRows) {
+        Eigen::Index cols = std::min(kBlockRows, X.cols() - begin);
+        block = X.middleCols(begin, cols).cast<double>();
+        gram.selfadjointView<Eigen::Lower>().rankUpdate(block);
+        row_offsets.noalias() += block * mean.segment(begin, cols);
+    }
+    gram.triangularView<Eigen::StrictlyUpper>() = gram.transpose();
+    gram.colwise() -= row_offsets;
+    gram.rowwise() -= row_offsets.transpose();
+    gram.array() += mean.squaredNorm();
+    return gram;
+}
+
+// Orthonormal basis of the columns of Y
+Eigen::MatrixXd orthonormalize(const Eigen::MatrixXd& Y) {
+    Eigen::HouseholderQR<Eigen::MatrixXd> qr(Y);
+    return qr.householderQ() * Eigen::MatrixXd::Identity(Y.rows(), Y.cols());
+}
+
+} // namespace
+
+PrincipalComponentAnalysis::PrincipalComponentAnalysis(int n_components, Solver solver)
+    : n_components_(n_components), solver_(solver)
 {
-    // Center the data
-    Eigen::VectorXd mean = X_.colwise().mean();
-    X_.rowwise() -= mean.transpose();
+    if (n_components < 0) {
+        throw std::invalid_argument("n_components must be non-negative.");
+    }
 }
 
-void PrincipalComponentAnalysis::transform()
+void PrincipalComponentAnalysis::setRandomizedOptions(int oversamples, int power_iterations, unsigned int seed)
 {
-    // Compute the covariance matrix
-    Eigen::MatrixXd covariance = (X_.transpose() * X_) / (X_.rows() - 1);
+    if (oversamples < 0 || power_iterations < 0) {
+        throw std::invalid_argument("oversamples and power_iterations must be non-negative.");
+    }
+    oversamples_ = oversamples;
+    power_iterations_ = power_iterations;
+    seed_ = seed;
+}
 
-    // Perform eigenvalue decomposition
-    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigen_solver(covariance);
+void PrincipalComponentAnalysis::fit(const Eigen::MatrixXd& X)
+{
+    decompose(X);
+}
 
-    if (eigen_solver.info() != Eigen::Success) {
-        throw std::runtime_error("Eigenvalue decomposition failed.");
+void PrincipalComponentAnalysis::fit(const U::SparseMatrix& X)
+{
+    decompose(X);
+}
+
+void PrincipalComponentAnalysis::fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& mean)
+{
+    if (mean.size() != X.cols()) {
+        throw std::invalid_argument("Size of mean does not match the number of features.");
     }
+    decompose(X, &mean);
+}
 
-    // Eigenvalues are returned in increasing order; reverse for decreasing order
-    eigen_values_ = eigen_solver.eigenvalues().reverse();
-    eigen_vectors_ = eigen_solver.eigenvectors().rowwise().reverse();
+Eigen::MatrixXd PrincipalComponentAnalysis::transform(const Eigen::MatrixXd& X) const
+{
+    return project(X);
+}
 
-    // Project the data onto the principal components
-    principal_components_ = X_ * eigen_vectors_;
+Eigen::MatrixXd PrincipalComponentAnalysis::transform(const U::SparseMatrix& X) const
+{
+    return project(X);
+}
+
+Eigen::MatrixXd PrincipalComponentAnalysis::fit_transform(const Eigen::MatrixXd& X)
+{
+    decompose(X);
+    return project(X);
 }
 
-Eigen::MatrixXd PrincipalComponentAnalysis::principal_components(int n) const
+Eigen::MatrixXd PrincipalComponentAnalysis::fit_transform(const U::SparseMatrix& X)
 {
-    if (n <= 0 || n > principal_components_.cols()) {
-        return principal_components_;
+    decompose(X);
+    return project(X);
+}
+
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+void PrincipalComponentAnalysis::fit(const U::DenseMatrix<Scalar>& X)
+{
+    decompose(X);
+}
+
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+U::DenseMatrix<Scalar> PrincipalComponentAnalysis::transform(const U::DenseMatrix<Scalar>& X) const
+{
+    return project(X);
+}
+
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+U::DenseMatrix<Scalar> PrincipalComponentAnalysis::fit_transform(const U::DenseMatrix<Scalar>& X)
+{
+    decompose(X);
+    return project(X);
+}
+
+template void PrincipalComponentAnalysis::fit<float>(const Eigen::MatrixXf&);
+template Eigen::MatrixXf PrincipalComponentAnalysis::transform<float>(const Eigen::MatrixXf&) const;
+template Eigen::MatrixXf PrincipalComponentAnalysis::fit_transform<float>(const Eigen::MatrixXf&);
+
+template <typename Matrix>
+U::DenseMatrix<typename Matrix::Scalar> PrincipalComponentAnalysis::project(const Matrix& X) const
+{
+    using Scalar = typename Matrix::Scalar;
+    U_TRACE_SCOPE("PrincipalComponentAnalysis::transform");
+    if (eigen_vectors_.size() == 0) {
+        throw std::logic_error("PCA must be fitted before transform.");
+    }
+    if (X.cols() != mean_.size()) {
+        throw std::invalid_argument("Number of features does not match the fitted PCA.");
+    }
+
+    // (X - 1 mean^T) V = X V - 1 (mean^T V), in the precision of X
+    U::DenseMatrix<Scalar> projected = X * eigen_vectors_.template cast<Scalar>();
+    projected.rowwise() -= projected_mean_.template cast<Scalar>();
+    return projected;
+}
+
+template <typename Matrix>
+void PrincipalComponentAnalysis::decompose(const Matrix& X, const Eigen::VectorXd* known_mean)
+{
+    U_TRACE_SCOPE("PrincipalComponentAnalysis::fit");
+    const Eigen::Index n = X.rows();
+    const Eigen::Index d = X.cols();
+    if (n < 2) {
+        throw std::invalid_argument("PCA needs at least two rows.");
+    }
+
+    // The data is centered implicitly in every product below, so X is never copied
+    const Eigen::VectorXd mean = known_mean ? *known_mean : columnMeans(X);
+
+    const Eigen::Index rank_bound = std::min(n, d);
+    const Eigen::Index k = (n_components_ > 0) ? std::min<Eigen::Index>(n_components_, rank_bound) : d;
+
+    solver_used_ = solver_;
+    if (solver_used_ == Solver::Auto) {
+        if (k < rank_bound * 4 / 5 && rank_bound >= kRandomizedMinDimension) {
+            solver_used_ = Solver::Randomized;
+        } else if (n < d) {
+            solver_used_ = Solver::Gram;
+        } else {
+            solver_used_ = Solver::Full;
+        }
+    }
+
+    if (solver_used_ == Solver::Full) {
+        // Compute the covariance matrix
+        Eigen::MatrixXd covariance = centeredScatter(X, mean) / (n - 1);
+
+        // Perform eigenvalue decomposition
+        Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigen_solver(covariance);
+
+        if (eigen_solver.info() != Eigen::Success) {
+            throw std::runtime_error("Eigenvalue decomposition failed.");
+        }
+
+        // Eigenvalues are returned in increasing order; reverse for decreasing order
+        eigen_values_ = eigen_solver.eigenvalues().reverse().head(k);
+        eigen_vectors_ = eigen_solver.eigenvectors().rowwise().reverse().leftCols(k);
+
+    } else if (solver_used_ == Solver::Gram) {
+        // The non-zero eigenvalues of Xc Xc^T and Xc^T Xc coincide, and v = Xc^T u / sqrt(lambda)
+        Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eigen_solver(centeredGram(X, mean));
+
+        if (eigen_solver.info() != Eigen::Success) {
+            throw std::runtime_error("Eigenvalue decomposition failed.");
+        }
+
+        Eigen::VectorXd gram_values = eigen_solver.eigenvalues().reverse();
+        Eigen::MatrixXd gram_vectors = eigen_solver.eigenvectors().rowwise().reverse();
+
+        // Centering removes one degree of freedom; null directions have no defined axis
+        const double tolerance = gram_values(0) * 1e-12 * n;
+        Eigen::Index kept = std::min(k, n - 1);
+        while (kept > 0 && gram_values(kept - 1) <= tolerance) {
+            --kept;
+        }
+
+        eigen_values_ = gram_values.head(kept) / (n - 1);
+        eigen_vectors_ = centeredTransposeProduct(X, mean, gram_vectors.leftCols(kept));
+        eigen_vectors_ *= gram_values.head(kept).cwiseSqrt().cwiseInverse().asDiagonal();
+
     } else {
-        return principal_components_.leftCols(n);
+        // Randomized range finder (Halko, Martinsson & Tropp) with subspace iterations. Each pass
+        // over X is one whole-matrix Eigen product with the d x sketch or n x sketch basis; only
+        // float data is multiplied a block of rows at a time, to widen it to double
+        const Eigen::Index sketch = std::min(rank_bound, k + oversamples_);
+
+        std::mt19937 generator(seed_);
+        std::normal_distribution<double> gaussian(0.0, 1.0);
+        Eigen::MatrixXd omega = Eigen::MatrixXd::NullaryExpr(d, sketch, [&]() { return gaussian(generator); });
+
+        Eigen::MatrixXd Q = orthonormalize(centeredProduct(X, mean, omega));
+        for (int i = 0; i < power_iterations_; ++i) {
+            Eigen::MatrixXd Z = orthonormalize(centeredTransposeProduct(X, mean, Q));
+            Q = orthonormalize(centeredProduct(X, mean, Z));
+        }
+
+        // Xc ~ Q B with B = Q^T Xc; the right singular vectors of B are the principal axes
+        Eigen::MatrixXd B_t = centeredTransposeProduct(X, mean, Q);
+        Eigen::BDCSVD<Eigen::MatrixXd> svd(B_t, Eigen::ComputeThinU);
+
+        eigen_values_ = svd.singularValues().head(k).array().square() / (n - 1);
+        eigen_vectors_ = svd.matrixU().leftCols(k);
     }
+
+    mean_ = mean;
+    projected_mean_ = mean_.transpose() * eigen_vectors_;
 }
 
 Eigen::MatrixXd PrincipalComponentAnalysis::eigen_vectors(int n) const
@@ -59,4 +336,29 @@ Eigen::VectorXd PrincipalComponentAnalysis::eigen_values(int n) const
     }
 }
 
+void PrincipalComponentAnalysis::save(std::ostream& out) const {
+    U::writeHeader(out, "PrincipalComponentAnalysis", 1);
+    out << n_components_ << '\n';
+    U::writeVector(out, mean_);
+    U::writeVector(out, eigen_values_);
+    U::writeMatrix(out, eigen_vectors_);
+}
+
+void PrincipalComponentAnalysis::load(std::istream& in) {
+    U::readHeader(in, "PrincipalComponentAnalysis");
+    int n_components = U::readValue<int>(in, "the number of components");
+    Eigen::VectorXd mean = U::readVector(in);
+    Eigen::VectorXd eigen_values = U::readVector(in);
+    Eigen::MatrixXd eigen_vectors = U::readMatrix(in);
+    if (eigen_vectors.rows() != mean.size() || eigen_vectors.cols() != eigen_values.size()) {
+        throw std::runtime_error("Malformed model file: inconsistent PrincipalComponentAnalysis shapes.");
+    }
+
+    n_components_ = n_components;
+    mean_ = mean;
+    eigen_values_ = eigen_values;
+    eigen_vectors_ = eigen_vectors;
+    projected_mean_ = mean_.transpose() * eigen_vectors_;
+}
+
 } // namespace L
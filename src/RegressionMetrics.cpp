@@ -1,38 +1,143 @@
 #include "L/RegressionMetrics.hpp"
+#include "U/Trace.hpp"
 #include <stdexcept>
 #include <cmath>
 
 namespace L {
 
-RegressionMetrics::RegressionMetrics(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true)
-    : predictions(predictions), y_true(y_true) {
+namespace {
+
+// Rows folded per parallel chunk by the one-shot constructor
+constexpr std::ptrdiff_t kChunkRows = 65536;
+
+} // namespace
+
+void RegressionMetricsAccumulator::update(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true) {
+    fold(predictions, y_true);
+}
+
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+void RegressionMetricsAccumulator::update(const U::DenseVector<Scalar>& predictions, const U::DenseVector<Scalar>& y_true) {
+    fold(predictions, y_true);
+}
+
+template void RegressionMetricsAccumulator::update<float>(const Eigen::VectorXf&, const Eigen::VectorXf&);
+
+template <typename Vector>
+void RegressionMetricsAccumulator::fold(const Vector& predictions, const Vector& y_true) {
+    U_TRACE_SCOPE("RegressionMetrics::update");
     if (predictions.size() != y_true.size()) {
         throw std::invalid_argument("Predictions and actual values must have the same length.");
     }
+    if (predictions.size() == 0) {
+        return;
+    }
+
+    // One pass for all the metrics: error sums and a Welford update of the target variance
+    RegressionMetricsAccumulator batch;
+    // Every value is widened before it is used, so float inputs are accumulated in double
+    for (Eigen::Index i = 0; i < predictions.size(); ++i) {
+        const double actual = y_true[i];
+        double error = actual - static_cast<double>(predictions[i]);
+        batch.sum_absolute_error_ += std::abs(error);
+        batch.sum_squared_error_ += error * error;
+
+        batch.count_ += 1.0;
+        double delta = actual - batch.mean_y_;
+        batch.mean_y_ += delta / batch.count_;
+        batch.scatter_y_ += delta * (actual - batch.mean_y_);
+    }
+    merge(batch);
 }
 
-double RegressionMetrics::mean(const Eigen::VectorXd& values) const {
-    return values.mean();
+void RegressionMetricsAccumulator::merge(const RegressionMetricsAccumulator& other) {
+    if (other.count_ == 0) {
+        return;
+    }
+
+    // Pairwise combination of the target means and scatters (Chan et al.)
+    double total = count_ + other.count_;
+    double delta = other.mean_y_ - mean_y_;
+    scatter_y_ += other.scatter_y_ + delta * delta * count_ * other.count_ / total;
+    mean_y_ += delta * other.count_ / total;
+    count_ = total;
+
+    sum_absolute_error_ += other.sum_absolute_error_;
+    sum_squared_error_ += other.sum_squared_error_;
 }
 
-double RegressionMetrics::r2Score() const {
-    double y_mean = mean(y_true);
-    double ss_tot = (y_true.array() - y_mean).square().sum();
-    double ss_res = (y_true - predictions).array().square().sum();
+void RegressionMetricsAccumulator::checkNotEmpty() const {
+    if (count_ == 0) {
+        throw std::logic_error("RegressionMetricsAccumulator has no values; call update before reading a metric.");
+    }
+}
+
+double RegressionMetricsAccumulator::r2Score() const {
+    checkNotEmpty();
+    return 1 - (sum_squared_error_ / scatter_y_);
+}
+
+double RegressionMetricsAccumulator::meanAbsoluteError() const {
+    checkNotEmpty();
+    return sum_absolute_error_ / count_;
+}
+
+double RegressionMetricsAccumulator::meanSquaredError() const {
+    checkNotEmpty();
+    return sum_squared_error_ / count_;
+}
 
-    return 1 - (ss_res / ss_tot);
+double RegressionMetricsAccumulator::rootMeanSquaredError() const {
+    return std::sqrt(meanSquaredError());
+}
+
+RegressionMetrics::RegressionMetrics(const Eigen::VectorXd& predictions, const Eigen::VectorXd& y_true,
+                                     const U::ExecutionPolicy& policy)
+    : accumulator_(accumulate(predictions, y_true, policy)) {}
+
+template <typename Scalar, U::IfSinglePrecision<Scalar>>
+RegressionMetrics::RegressionMetrics(const U::DenseVector<Scalar>& predictions, const U::DenseVector<Scalar>& y_true,
+                                     const U::ExecutionPolicy& policy)
+    : accumulator_(accumulate(predictions, y_true, policy)) {}
+
+template RegressionMetrics::RegressionMetrics<float>(const Eigen::VectorXf&, const Eigen::VectorXf&, const U::ExecutionPolicy&);
+
+template <typename Vector>
+RegressionMetricsAccumulator RegressionMetrics::accumulate(const Vector& predictions, const Vector& y_true,
+                                                           const U::ExecutionPolicy& policy) {
+    if (predictions.size() != y_true.size()) {
+        throw std::invalid_argument("Predictions and actual values must have the same length.");
+    }
+    if (predictions.size() == 0) {
+        throw std::invalid_argument("Predictions and actual values must not be empty.");
+    }
+    return policy.parallel_reduce(
+        0, predictions.size(), kChunkRows, RegressionMetricsAccumulator(),
+        [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+            RegressionMetricsAccumulator partial;
+            partial.fold(predictions.segment(begin, end - begin), y_true.segment(begin, end - begin));
+            return partial;
+        },
+        [](RegressionMetricsAccumulator total, const RegressionMetricsAccumulator& partial) {
+            total.merge(partial);
+            return total;
+        });
+}
+
+double RegressionMetrics::r2Score() const {
+    return accumulator_.r2Score();
 }
 
 double RegressionMetrics::meanAbsoluteError() const {
-    return (y_true - predictions).array().abs().mean();
+    return accumulator_.meanAbsoluteError();
 }
 
 double RegressionMetrics::meanSquaredError() const {
-    return (y_true - predictions).array().square().mean();
+    return accumulator_.meanSquaredError();
 }
 
 double RegressionMetrics::rootMeanSquaredError() const {
-    return std::sqrt(meanSquaredError());
+    return accumulator_.rootMeanSquaredError();
 }
 
 } // namespace L
@@ -0,0 +1,278 @@
+#include "L/SoftmaxRegression.hpp"
+#include "U/Trace.hpp"
+#include "U/Serialization.hpp"
+#include "U/MatrixUtils.hpp"
+#include <Eigen/Dense>
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+namespace L {
+
+namespace {
+
+// Gradient of one block of rows
+struct Gradient {
+    Eigen::MatrixXd W;
+    Eigen::RowVectorXd b;
+};
+
+} // namespace
+
+SoftmaxRegression::SoftmaxRegression(int block_size)
+    : block_size_(block_size) {
+    if (block_size_ <= 0) {
+        throw std::invalid_argument("block_size must be positive.");
+    }
+}
+
+void SoftmaxRegression::setExecutionPolicy(const U::ExecutionPolicy& policy) {
+    execution_policy_ = policy;
+}
+
+void SoftmaxRegression::setWarmStart(bool warm_start) {
+    warm_start_ = warm_start;
+}
+
+void SoftmaxRegression::initialize(const std::vector<int>& classes, Eigen::Index n_features) {
+    std::set<int> unique_classes(classes.begin(), classes.end());
+    if (unique_classes.size() < 2) {
+        throw std::invalid_argument("SoftmaxRegression needs at least two classes.");
+    }
+
+    classes_.assign(unique_classes.begin(), unique_classes.end());
+    class_index_.clear();
+    for (size_t k = 0; k < classes_.size(); ++k) {
+        class_index_[classes_[k]] = static_cast<int>(k);
+    }
+
+    coefficients_ = Eigen::MatrixXd::Zero(n_features, classes_.size());
+    intercept_ = Eigen::VectorXd::Zero(classes_.size());
+}
+
+std::vector<int> SoftmaxRegression::classIndices(const Eigen::VectorXd& y) const {
+    // Map labels to columns once, so the training passes only do integer lookups
+    std::vector<int> labels(y.size());
+    for (Eigen::Index i = 0; i < y.size(); ++i) {
+        auto it = class_index_.find(static_cast<int>(y(i)));
+        if (it == class_index_.end()) {
+            throw std::invalid_argument("Label " + std::to_string(static_cast<int>(y(i))) + " is not one of the model classes.");
+        }
+        labels[i] = it->second;
+    }
+    return labels;
+}
+
+Eigen::VectorXd SoftmaxRegression::blockProbabilities(const Eigen::MatrixXd& X, Eigen::Index begin, Eigen::Index rows, Eigen::MatrixXd& probabilities) const {
+    // All K logits of the block in one GEMM
+    probabilities.noalias() = X.middleRows(begin, rows) * coefficients_;
+    probabilities.rowwise() += intercept_.transpose();
+    return U::softmaxRows(probabilities);
+}
+
+void SoftmaxRegression::accumulateGradient(const Eigen::MatrixXd& X, const std::vector<int>& labels, Eigen::Index begin, Eigen::Index rows,
+                                           Eigen::MatrixXd& grad_W, Eigen::RowVectorXd& grad_b) const {
+    Gradient total = execution_policy_.parallel_reduce(
+        begin, begin + rows, block_size_, Gradient(),
+        [&](std::ptrdiff_t start, std::ptrdiff_t end) {
+            Eigen::Index block_rows = end - start;
+            Eigen::MatrixXd residuals(block_rows, classes_.size());
+            blockProbabilities(X, start, block_rows, residuals);
+
+            // Gradient of the cross-entropy w.r.t. the logits is P - one_hot(y)
+            for (Eigen::Index i = 0; i < block_rows; ++i) {
+                residuals(i, labels[start + i]) -= 1.0;
+            }
+
+            Gradient partial;
+            partial.W.noalias() = X.middleRows(start, block_rows).transpose() * residuals;
+            partial.b = residuals.colwise().sum();
+            return partial;
+        },
+        [](Gradient sum, const Gradient& partial) {
+            if (sum.W.size() == 0) {
+                return partial;
+            }
+            sum.W += partial.W;
+            sum.b += partial.b;
+            return sum;
+        });
+
+    if (total.W.size() != 0) {
+        grad_W += total.W;
+        grad_b += total.b;
+    }
+}
+
+void SoftmaxRegression::fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, double learning_rate, int iterations, int batch_size) {
+    U_TRACE_SCOPE("SoftmaxRegression::fit");
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("X and y must have the same number of rows.");
+    }
+
+    std::vector<int> observed(y.size());
+    for (Eigen::Index i = 0; i < y.size(); ++i) {
+        observed[i] = static_cast<int>(y(i));
+    }
+    bool resume = warm_start_ && !classes_.empty() && coefficients_.rows() == X.cols() &&
+                  std::all_of(observed.begin(), observed.end(), [this](int label) { return class_index_.count(label) > 0; });
+    if (!resume) {
+        initialize(observed, X.cols());
+    }
+    std::vector<int> labels = classIndices(y);
+
+    Eigen::Index step_rows = (batch_size <= 0) ? X.rows() : batch_size;
+    Eigen::MatrixXd grad_W(X.cols(), classes_.size());
+    Eigen::RowVectorXd grad_b(classes_.size());
+
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        for (Eigen::Index begin = 0; begin < X.rows(); begin += step_rows) {
+            Eigen::Index rows = std::min(step_rows, X.rows() - begin);
+            grad_W.setZero();
+            grad_b.setZero();
+            accumulateGradient(X, labels, begin, rows, grad_W, grad_b);
+
+            coefficients_ -= (learning_rate / rows) * grad_W;
+            intercept_ -= (learning_rate / rows) * grad_b.transpose();
+        }
+    }
+}
+
+void SoftmaxRegression::partial_fit(const Eigen::MatrixXd& X, const Eigen::VectorXd& y, double learning_rate, const std::vector<int>& classes) {
+    U_TRACE_SCOPE("SoftmaxRegression::partial_fit");
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("X and y must have the same number of rows.");
+    }
+
+    if (classes_.empty()) {
+        if (classes.empty()) {
+            throw std::invalid_argument("classes must be given on the first call to partial_fit.");
+        }
+        initialize(classes, X.cols());
+    } else if (X.cols() != coefficients_.rows()) {
+        throw std::invalid_argument("Number of features does not match the fitted model.");
+    }
+
+    if (X.rows() == 0) {
+        return;
+    }
+
+    std::vector<int> labels = classIndices(y);
+    Eigen::MatrixXd grad_W = Eigen::MatrixXd::Zero(X.cols(), classes_.size());
+    Eigen::RowVectorXd grad_b = Eigen::RowVectorXd::Zero(classes_.size());
+    accumulateGradient(X, labels, 0, X.rows(), grad_W, grad_b);
+
+    coefficients_ -= (learning_rate / X.rows()) * grad_W;
+    intercept_ -= (learning_rate / X.rows()) * grad_b.transpose();
+}
+
+void SoftmaxRegression::checkInput(const Eigen::MatrixXd& X) const {
+    if (classes_.empty()) {
+        throw std::logic_error("SoftmaxRegression must be fitted before predicting.");
+    }
+    if (X.cols() != coefficients_.rows()) {
+        throw std::invalid_argument("Number of features does not match the fitted model.");
+    }
+}
+
+Eigen::MatrixXd SoftmaxRegression::predict_proba(const Eigen::MatrixXd& X) const {
+    U_TRACE_SCOPE("SoftmaxRegression::predict_proba");
+    checkInput(X);
+    Eigen::MatrixXd probabilities(X.rows(), classes_.size());
+    execution_policy_.parallel_for(0, X.rows(), block_size_, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+        Eigen::MatrixXd block(end - begin, classes_.size());
+        blockProbabilities(X, begin, end - begin, block);
+        probabilities.middleRows(begin, end - begin) = block;
+    });
+    return probabilities;
+}
+
+Eigen::VectorXd SoftmaxRegression::predict(const Eigen::MatrixXd& X) const {
+    U_TRACE_SCOPE("SoftmaxRegression::predict");
+    checkInput(X);
+    Eigen::VectorXd predictions(X.rows());
+    execution_policy_.parallel_for(0, X.rows(), block_size_, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+        Eigen::Index rows = end - begin;
+
+        // The arg max of the logits is the arg max of the probabilities, so skip the softmax
+        Eigen::MatrixXd logits = X.middleRows(begin, rows) * coefficients_;
+        logits.rowwise() += intercept_.transpose();
+
+        for (Eigen::Index i = 0; i < rows; ++i) {
+            Eigen::Index best;
+            logits.row(i).maxCoeff(&best);
+            predictions(begin + i) = classes_[best];
+        }
+    });
+    return predictions;
+}
+
+double SoftmaxRegression::log_loss(const Eigen::MatrixXd& X, const Eigen::VectorXd& y) const {
+    if (X.rows() != y.size()) {
+        throw std::invalid_argument("X and y must have the same number of rows.");
+    }
+
+    std::vector<int> labels = classIndices(y);
+    double loss = execution_policy_.parallel_reduce(
+        0, X.rows(), block_size_, 0.0,
+        [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+            Eigen::Index rows = end - begin;
+            Eigen::MatrixXd logits = X.middleRows(begin, rows) * coefficients_;
+            logits.rowwise() += intercept_.transpose();
+
+            // -log p(y|x) = logsumexp(z) - z_y, computed before the logits are overwritten
+            Eigen::VectorXd true_logits(rows);
+            for (Eigen::Index i = 0; i < rows; ++i) {
+                true_logits(i) = logits(i, labels[begin + i]);
+            }
+            Eigen::VectorXd log_normalizers = U::softmaxRows(logits);
+            return (log_normalizers - true_logits).sum();
+        },
+        [](double sum, double partial) { return sum + partial; });
+    return loss / X.rows();
+}
+
+void SoftmaxRegression::save(std::ostream& out) const {
+    U::writeHeader(out, "SoftmaxRegression", 1);
+    out << block_size_ << ' ' << classes_.size() << '\n';
+    for (size_t k = 0; k < classes_.size(); ++k) {
+        out << (k == 0 ? "" : " ") << classes_[k];
+    }
+    out << '\n';
+    U::writeMatrix(out, coefficients_);
+    U::writeVector(out, intercept_);
+}
+
+void SoftmaxRegression::load(std::istream& in) {
+    U::readHeader(in, "SoftmaxRegression");
+    int block_size = U::readValue<int>(in, "the block size");
+    auto n_classes = U::readValue<size_t>(in, "the number of classes");
+    std::vector<int> classes(n_classes);
+    for (auto& label : classes) {
+        label = U::readValue<int>(in, "a class label");
+    }
+    Eigen::MatrixXd coefficients = U::readMatrix(in);
+    Eigen::VectorXd intercept = U::readVector(in);
+    if (block_size <= 0 || coefficients.cols() != static_cast<Eigen::Index>(n_classes) || intercept.size() != coefficients.cols()) {
+        throw std::runtime_error("Malformed model file: inconsistent SoftmaxRegression shapes.");
+    }
+
+    block_size_ = block_size;
+    initialize(classes, coefficients.rows());
+    coefficients_ = coefficients;
+    intercept_ = intercept;
+}
+
+Eigen::MatrixXd SoftmaxRegression::coefficients() const {
+    return coefficients_;
+}
+
+Eigen::VectorXd SoftmaxRegression::intercept() const {
+    return intercept_;
+}
+
+std::vector<int> SoftmaxRegression::classes() const {
+    return classes_;
+}
+
+} // namespace L
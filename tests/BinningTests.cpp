@@ -0,0 +1,84 @@
+// Regression tests for U::BinnedMatrix; exits non-zero on the first failed check.
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <set>
+#include "U/Binning.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char* what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+// Every non-NaN value lies in the bin whose upper edge is the first cut point at or above it
+void checkBins(const U::BinnedMatrix& binned, const Eigen::MatrixXd& X) {
+    for (Eigen::Index feature = 0; feature < X.cols(); ++feature) {
+        const std::vector<double>& cuts = binned.cutPoints(feature);
+        bool increasing = true;
+        for (size_t b = 1; b < cuts.size(); ++b) {
+            increasing = increasing && cuts[b] > cuts[b - 1];
+        }
+        check(increasing, "cut points are strictly increasing");
+
+        bool consistent = true;
+        for (Eigen::Index i = 0; i < X.rows(); ++i) {
+            const double value = X(i, feature);
+            if (std::isnan(value)) {
+                continue;
+            }
+            const int bin = binned.bin(i, feature);
+            consistent = consistent && value <= cuts[bin] && (bin == 0 || value > cuts[bin - 1]);
+        }
+        check(consistent, "every value is binned below its cut point and above the previous one");
+    }
+}
+
+// Over kQuantileSampleRows rows, quantiles come from a sample and its NaNs are dropped: with more
+// distinct values than bins in the column but fewer than bins in the sample, the quantile ranks
+// used to start at 0 and read before the sorted sample
+void sparseColumnWithMoreDistinctValuesThanBins() {
+    const Eigen::Index rows = 3000000;
+    const int distinct = 300;
+    Eigen::MatrixXd X = Eigen::MatrixXd::Constant(rows, 1, std::numeric_limits<double>::quiet_NaN());
+    std::set<double> values;
+    for (int k = 0; k < distinct; ++k) {
+        X(static_cast<Eigen::Index>(k) * (rows / distinct), 0) = k;
+        values.insert(k);
+    }
+
+    U::BinnedMatrix binned(X, 256);
+    const std::vector<double>& cuts = binned.cutPoints(0);
+    check(!cuts.empty() && static_cast<int>(cuts.size()) <= 256, "between 1 and max_bins cut points");
+    bool observed = true;
+    for (double cut : cuts) {
+        observed = observed && values.count(cut) == 1;
+    }
+    check(observed, "cut points are values of the column");
+    check(!cuts.empty() && cuts.back() == distinct - 1, "the last cut point is the largest value");
+    checkBins(binned, X);
+}
+
+void fewDistinctValuesGetOneBinEach() {
+    Eigen::MatrixXd X(6, 1);
+    X << 3, 1, 2, 3, std::numeric_limits<double>::quiet_NaN(), 1;
+    U::BinnedMatrix binned(X, 256);
+    check(binned.cutPoints(0) == std::vector<double>({1, 2, 3}), "one bin per distinct value");
+    checkBins(binned, X);
+}
+
+} // namespace
+
+int main() {
+    sparseColumnWithMoreDistinctValuesThanBins();
+    fewDistinctValuesGetOneBinEach();
+    if (failures == 0) {
+        std::cout << "BinningTests: all checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,81 @@
+// Regression tests for L::LinearRegression; exits non-zero on the first failed check.
+#include <iostream>
+#include <random>
+#include <string>
+#include "L/LinearRegression.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+// y = 50 + X w + noise: the large intercept shows any shrinkage of it
+void makeData(Eigen::MatrixXd& X, Eigen::VectorXd& y) {
+    std::mt19937 generator(29);
+    std::normal_distribution<double> normal;
+    X.resize(1000, 5);
+    y.resize(1000);
+    for (Eigen::Index i = 0; i < X.rows(); ++i) {
+        for (Eigen::Index j = 0; j < X.cols(); ++j) {
+            X(i, j) = normal(generator);
+        }
+        y(i) = 50.0 + 1.5 * X(i, 0) - 2.0 * X(i, 1) + 0.5 * X(i, 4) + 0.1 * normal(generator);
+    }
+}
+
+// partial_fit over chunks (the first one first_rows long) against fit on all the rows
+void partialFitMatchesFit(double ridge_alpha, Eigen::Index first_rows, double tolerance) {
+    Eigen::MatrixXd X;
+    Eigen::VectorXd y;
+    makeData(X, y);
+
+    L::LinearRegression batch(ridge_alpha);
+    batch.fit(X, y);
+    L::LinearRegression streamed(ridge_alpha);
+    streamed.partial_fit(X.topRows(first_rows), y.head(first_rows));
+    for (Eigen::Index begin = first_rows; begin < X.rows(); begin += 100) {
+        const Eigen::Index rows = std::min<Eigen::Index>(100, X.rows() - begin);
+        streamed.partial_fit(X.middleRows(begin, rows), y.segment(begin, rows));
+    }
+
+    const std::string name = "partial_fit matches fit (ridge_alpha " + std::to_string(ridge_alpha) +
+                             ", first chunk of " + std::to_string(first_rows) + " rows): ";
+    const double slopes = (streamed.getCoefficients() - batch.getCoefficients()).lpNorm<Eigen::Infinity>();
+    const double intercept = std::abs(streamed.getIntercept() - batch.getIntercept());
+    check(slopes <= tolerance, name + "slopes differ by " + std::to_string(slopes));
+    check(intercept <= tolerance, name + "intercept differs by " + std::to_string(intercept));
+}
+
+void partialFitRejectsOtherFeatureCounts() {
+    L::LinearRegression model;
+    model.partial_fit(Eigen::MatrixXd::Random(10, 3), Eigen::VectorXd::Random(10));
+    bool threw = false;
+    try {
+        model.partial_fit(Eigen::MatrixXd::Random(10, 4), Eigen::VectorXd::Random(10));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    check(threw, "partial_fit throws on a different number of features");
+}
+
+} // namespace
+
+int main() {
+    // A well-posed first chunk starts from its exact solution
+    partialFitMatchesFit(0.0, 100, 1e-8);
+    partialFitMatchesFit(2.0, 100, 1e-8);
+    // An ill-posed first chunk (fewer rows than features) starts from the diffuse prior
+    partialFitMatchesFit(0.0, 3, 1e-5);
+    partialFitMatchesFit(2.0, 3, 1e-5);
+    partialFitRejectsOtherFeatureCounts();
+    if (failures == 0) {
+        std::cout << "LinearRegressionTests: all checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+// Regression tests for serve::ModelChain; exits non-zero on the first failed check.
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "ModelChain.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+template <typename Exception, typename Function>
+bool throws(Function function) {
+    try {
+        function();
+    } catch (const Exception&) {
+        return true;
+    }
+    return false;
+}
+
+// Class 1 when feature 2 is positive
+void makeData(Eigen::MatrixXd& X, Eigen::VectorXd& y) {
+    X = Eigen::MatrixXd::Random(200, 3);
+    y = (X.col(2).array() > 0.0).cast<double>();
+}
+
+void treeRecordsItsFeatureCount() {
+    Eigen::MatrixXd X;
+    Eigen::VectorXd y;
+    makeData(X, y);
+    L::DecisionTreeClassifier tree(3);
+    tree.fit(X, y);
+    check(tree.featureCount() == 3, "fit records the number of features");
+    check(throws<std::invalid_argument>([&] { tree.predict(X.leftCols(1)); }), "predict rejects short rows");
+    check(throws<std::invalid_argument>([&] { tree.predict_proba(X.leftCols(1)); }), "predict_proba rejects short rows");
+    check(throws<std::invalid_argument>([&] { tree.predict(Eigen::MatrixXf(X.leftCols(2).cast<float>())); }),
+          "float predict rejects short rows");
+
+    const std::string path = "model_chain_tests_tree.model";
+    serve::ModelChain::save(path, tree);
+    serve::ModelChain chain = serve::ModelChain::load(path);
+    std::remove(path.c_str());
+    check(chain.inputDimension() == 3, "a tree chain knows its input dimension");
+    check(chain.score(X).col(0).isApprox(tree.predict(X)), "the loaded chain scores like the tree");
+    check(throws<std::invalid_argument>([&] { chain.score(Eigen::MatrixXd::Ones(1, 1)); }),
+          "the chain rejects a one-feature row for a three-feature tree");
+}
+
+// Files written before the count was saved still load; rows must reach every split feature
+void versionOneTreeLoads() {
+    const std::string path = "model_chain_tests_tree_v1.model";
+    {
+        std::ofstream out(path);
+        out << "ModelChain 1\n1\ntree\nDecisionTreeClassifier 1\nsplit 2 0.5\nleaf 0\nleaf 1\n";
+    }
+    serve::ModelChain chain = serve::ModelChain::load(path);
+    std::remove(path.c_str());
+    check(chain.inputDimension() == 0, "a version-1 tree does not know its input dimension");
+    Eigen::MatrixXd row(1, 3);
+    row << 0.0, 0.0, 1.0;
+    check(chain.score(row)(0, 0) == 1.0, "a version-1 tree scores rows");
+    check(throws<std::invalid_argument>([&] { chain.score(Eigen::MatrixXd::Ones(1, 2)); }),
+          "a version-1 tree rejects rows without its split features");
+}
+
+} // namespace
+
+int main() {
+    treeRecordsItsFeatureCount();
+    versionOneTreeLoads();
+    if (failures == 0) {
+        std::cout << "ModelChainTests: all checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
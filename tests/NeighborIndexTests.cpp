@@ -0,0 +1,70 @@
+// Regression tests for U::NeighborIndex; exits non-zero on the first failed check.
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "U/NeighborIndex.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+// k nearest rows of X to every row of Q by a full scan, ties by row index as the index orders them
+U::Neighbors bruteForce(const Eigen::MatrixXd& X, const Eigen::MatrixXd& Q, int k) {
+    U::Neighbors neighbors{Eigen::MatrixXi(Q.rows(), k), Eigen::MatrixXd(Q.rows(), k)};
+    std::vector<std::pair<double, int>> candidates(X.rows());
+    for (Eigen::Index i = 0; i < Q.rows(); ++i) {
+        for (Eigen::Index r = 0; r < X.rows(); ++r) {
+            candidates[r] = {(X.row(r) - Q.row(i)).squaredNorm(), static_cast<int>(r)};
+        }
+        std::sort(candidates.begin(), candidates.end());
+        for (int m = 0; m < k; ++m) {
+            neighbors.indices(i, m) = candidates[m].second;
+            neighbors.distances(i, m) = std::sqrt(candidates[m].first);
+        }
+    }
+    return neighbors;
+}
+
+// Every node holds rows, and queries match the brute force, for small row counts that are not powers of two
+void smallIndexMatchesBruteForce(U::NeighborIndex::Kind kind, const char* name) {
+    std::mt19937 generator(44);
+    std::normal_distribution<double> normal;
+    for (int n = 1; n <= 37; ++n) {
+        for (int leaf_size : {1, 2, 3}) {
+            Eigen::MatrixXd X = Eigen::MatrixXd::NullaryExpr(n, 3, [&]() { return normal(generator); });
+            Eigen::MatrixXd Q = Eigen::MatrixXd::NullaryExpr(5, 3, [&]() { return normal(generator); });
+            const std::string label = std::string(name) + " n=" + std::to_string(n) + " leaf_size=" +
+                                      std::to_string(leaf_size);
+
+            U::NeighborIndex index(X, kind, leaf_size);
+            for (int k : {1, std::min(n, 3), n}) {
+                U::Neighbors expected = bruteForce(X, Q, k);
+                U::Neighbors found = index.query(Q, k);
+                check(found.indices == expected.indices, label + " k=" + std::to_string(k) + ": same neighbours");
+                check((found.distances - expected.distances).cwiseAbs().maxCoeff() < 1e-12,
+                      label + " k=" + std::to_string(k) + ": same distances");
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    smallIndexMatchesBruteForce(U::NeighborIndex::Kind::KDTree, "KD-tree");
+    smallIndexMatchesBruteForce(U::NeighborIndex::Kind::BallTree, "ball tree");
+    if (failures == 0) {
+        std::cout << "NeighborIndexTests: all checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
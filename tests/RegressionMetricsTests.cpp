@@ -0,0 +1,72 @@
+// Regression tests for L::RegressionMetrics; exits non-zero on the first failed check.
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "L/RegressionMetrics.hpp"
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        ++failures;
+    }
+}
+
+template <typename Exception, typename Function>
+bool throws(Function function) {
+    try {
+        function();
+    } catch (const Exception&) {
+        return true;
+    }
+    return false;
+}
+
+void emptyAccumulatorThrows() {
+    L::RegressionMetricsAccumulator accumulator;
+    check(throws<std::logic_error>([&] { accumulator.r2Score(); }), "r2Score throws on an empty accumulator");
+    check(throws<std::logic_error>([&] { accumulator.meanAbsoluteError(); }),
+          "meanAbsoluteError throws on an empty accumulator");
+    check(throws<std::logic_error>([&] { accumulator.meanSquaredError(); }),
+          "meanSquaredError throws on an empty accumulator");
+    check(throws<std::logic_error>([&] { accumulator.rootMeanSquaredError(); }),
+          "rootMeanSquaredError throws on an empty accumulator");
+
+    // An empty batch leaves it empty
+    accumulator.update(Eigen::VectorXd(), Eigen::VectorXd());
+    check(throws<std::logic_error>([&] { accumulator.meanAbsoluteError(); }),
+          "an empty update does not make the accumulator readable");
+
+    check(throws<std::invalid_argument>([] { L::RegressionMetrics(Eigen::VectorXd(), Eigen::VectorXd()); }),
+          "RegressionMetrics throws on empty vectors");
+}
+
+void accumulatorMatchesBatch() {
+    Eigen::VectorXd y_true = Eigen::VectorXd::LinSpaced(100, -3.0, 5.0);
+    Eigen::VectorXd predictions = y_true + 0.25 * Eigen::VectorXd::Random(100);
+    L::RegressionMetrics batch(predictions, y_true);
+
+    L::RegressionMetricsAccumulator accumulator;
+    accumulator.update(predictions.head(30), y_true.head(30));
+    accumulator.update(predictions.tail(70), y_true.tail(70));
+    check(std::abs(accumulator.r2Score() - batch.r2Score()) < 1e-12, "streamed R2 matches the batch R2");
+    check(std::abs(accumulator.meanAbsoluteError() - batch.meanAbsoluteError()) < 1e-12,
+          "streamed MAE matches the batch MAE");
+    check(std::abs(accumulator.meanSquaredError() - batch.meanSquaredError()) < 1e-12,
+          "streamed MSE matches the batch MSE");
+}
+
+} // namespace
+
+int main() {
+    emptyAccumulatorThrows();
+    accumulatorMatchesBatch();
+    if (failures == 0) {
+        std::cout << "RegressionMetricsTests: all checks passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}